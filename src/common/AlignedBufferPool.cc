@@ -0,0 +1,122 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t -*-
+// vim: ts=8 sw=2 smarttab
+/*
+ * Ceph - scalable distributed file system
+ *
+ * This is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License version 2.1, as published by the Free Software
+ * Foundation.  See file COPYING.
+ *
+ */
+
+#include <stdlib.h>
+
+#include "common/AlignedBufferPool.h"
+#include "common/deleter.h"
+#include "include/assert.h"
+#include "include/intarith.h"
+#include "include/mempool.h"
+
+// idle buffers are accounted here; buffers in use are accounted by
+// their buffer::raw
+static mempool::pool_t& cached_pool()
+{
+  return mempool::get_pool(mempool::mempool_buffer_anon);
+}
+
+AlignedBufferPool::Shared::~Shared()
+{
+  for (auto& p : free) {
+    for (auto buf : p.second) {
+      ::free(buf);
+    }
+    cached_pool().adjust_count(-(ssize_t)p.second.size(),
+			       -(ssize_t)(p.first * p.second.size()));
+  }
+}
+
+char *AlignedBufferPool::Shared::get(unsigned size)
+{
+  {
+    std::lock_guard<std::mutex> l(lock);
+    auto p = free.find(size);
+    if (p != free.end() && !p->second.empty()) {
+      char *buf = p->second.back();
+      p->second.pop_back();
+      cached -= size;
+      ++hits;
+      cached_pool().adjust_count(-1, -(ssize_t)size);
+      return buf;
+    }
+  }
+  ++misses;
+  void *buf = nullptr;
+  int r = ::posix_memalign(&buf, align, size);
+  if (r)
+    throw buffer::bad_alloc();
+  return static_cast<char*>(buf);
+}
+
+void AlignedBufferPool::Shared::put(char *buf, unsigned size)
+{
+  {
+    std::lock_guard<std::mutex> l(lock);
+    if (cached + size <= max_cached) {
+      free[size].push_back(buf);
+      cached += size;
+      cached_pool().adjust_count(1, size);
+      return;
+    }
+  }
+  ::free(buf);
+}
+
+AlignedBufferPool::AlignedBufferPool(unsigned align, uint64_t max_cached)
+  : shared(std::make_shared<Shared>(align, max_cached))
+{
+  assert(align && (align & (align - 1)) == 0);
+}
+
+void AlignedBufferPool::alloc(unsigned len, unsigned off, bufferlist *bl)
+{
+  if (!len)
+    return;
+  const unsigned align = shared->align;
+  unsigned head = off & (align - 1);
+  unsigned size = ROUND_UP_TO(head + len, align);
+  // whole blocks up to four of them, then four classes per power of
+  // two, so that less than a quarter of a buffer goes unused
+  size = ROUND_UP_TO(size, MAX(align, (1u << (cbits(size) - 1)) / 4));
+
+  char *buf = shared->get(size);
+  std::shared_ptr<Shared> s = shared;
+  buffer::raw *r = buffer::claim_buffer(
+    size, buf, make_deleter([s, buf, size] { s->put(buf, size); }));
+  bufferptr whole(r);
+
+  // split at the alignment boundaries so that the middle stands on its own
+  unsigned pos = head;
+  unsigned left = len;
+  if (head) {
+    unsigned l = MIN(align - head, left);
+    bl->push_back(bufferptr(whole, pos, l));
+    pos += l;
+    left -= l;
+  }
+  unsigned middle = left & ~(align - 1);
+  if (middle) {
+    bl->push_back(bufferptr(whole, pos, middle));
+    pos += middle;
+    left -= middle;
+  }
+  if (left) {
+    bl->push_back(bufferptr(whole, pos, left));
+  }
+}
+
+uint64_t AlignedBufferPool::get_cached_bytes() const
+{
+  std::lock_guard<std::mutex> l(shared->lock);
+  return shared->cached;
+}
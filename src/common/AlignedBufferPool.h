@@ -0,0 +1,76 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t -*-
+// vim: ts=8 sw=2 smarttab
+/*
+ * Ceph - scalable distributed file system
+ *
+ * This is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License version 2.1, as published by the Free Software
+ * Foundation.  See file COPYING.
+ *
+ */
+
+#ifndef CEPH_COMMON_ALIGNEDBUFFERPOOL_H
+#define CEPH_COMMON_ALIGNEDBUFFERPOOL_H
+
+#include <atomic>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include "include/buffer.h"
+
+/**
+ * @class AlignedBufferPool
+ * Recycles large, aligned receive buffers.
+ *
+ * Buffers are handed out in size classes of whole blocks, four per
+ * power of two, and return to the pool when the last bufferptr
+ * referencing them goes away, which may happen on any thread and after
+ * the pool itself was destroyed.  At most @p max_cached bytes are kept
+ * around once released, accounted in the buffer_anon mempool; anything
+ * beyond that is freed.
+ */
+class AlignedBufferPool {
+  struct Shared {
+    const unsigned align;
+    const uint64_t max_cached;
+    std::mutex lock;
+    uint64_t cached = 0;
+    std::map<unsigned, std::vector<char*>> free;  ///< size class -> buffers
+    std::atomic<uint64_t> hits = { 0 }, misses = { 0 };
+
+    Shared(unsigned a, uint64_t m) : align(a), max_cached(m) {}
+    ~Shared();
+
+    char *get(unsigned size);
+    void put(char *buf, unsigned size);
+  };
+  std::shared_ptr<Shared> shared;
+
+public:
+  AlignedBufferPool(unsigned align, uint64_t max_cached);
+
+  /**
+   * Append @p len bytes of pooled memory to @p bl, laid out so that
+   * payload byte i sits at an address congruent to (@p off + i) modulo
+   * the pool alignment.  The portion between the first and last
+   * alignment boundary is a separate aligned, align-sized bufferptr,
+   * so that it can be submitted for direct I/O as is.
+   */
+  void alloc(unsigned len, unsigned off, bufferlist *bl);
+
+  unsigned get_align() const {
+    return shared->align;
+  }
+  uint64_t get_cached_bytes() const;
+  uint64_t get_hits() const {
+    return shared->hits;
+  }
+  uint64_t get_misses() const {
+    return shared->misses;
+  }
+};
+
+#endif
@@ -41,6 +41,11 @@ static int _set_affinity(int id)
   return 0;
 }
 
+int ceph_thread_set_affinity(int cpuid)
+{
+  return _set_affinity(cpuid);
+}
+
 Thread::Thread()
   : thread_id(0),
     pid(0),
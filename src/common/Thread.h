@@ -56,4 +56,7 @@ class Thread {
   int set_affinity(int cpuid);
 };
 
+// pin the calling thread to the given cpu; a negative cpuid is a no-op
+int ceph_thread_set_affinity(int cpuid);
+
 #endif
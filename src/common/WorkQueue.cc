@@ -353,7 +353,11 @@ void ShardedThreadPool::start_threads()
   while (threads_shardedpool.size() < num_threads) {
 
     WorkThreadSharded *wt = new WorkThreadSharded(this, thread_index);
-    ldout(cct, 10) << "start_threads creating and starting " << wt << dendl;
+    int cpu = wq->get_thread_cpu(thread_index);
+    if (cpu >= 0)
+      wt->set_affinity(cpu);
+    ldout(cct, 10) << "start_threads creating and starting " << wt
+		   << " cpu " << cpu << dendl;
     threads_shardedpool.push_back(wt);
     wt->create(thread_name.c_str());
     thread_index++;
@@ -645,6 +645,10 @@ public:
     virtual void _process(uint32_t thread_index, heartbeat_handle_d *hb ) = 0;
     virtual void return_waiting_threads() = 0;
     virtual bool is_shard_empty(uint32_t thread_index) = 0;
+    /// cpu to pin the given thread to, or -1 to leave it alone
+    virtual int get_thread_cpu(uint32_t thread_index) {
+      return -1;
+    }
   };      
 
   template <typename T>
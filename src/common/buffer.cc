@@ -1094,6 +1094,13 @@ static std::atomic_flag buffer_debug_lock = ATOMIC_FLAG_INIT;
         _raw->invalidate_crc();
     memset(c_str()+o, 0, l);
   }
+
+  void buffer::ptr::set_crc(uint32_t base, uint32_t crc) const
+  {
+    assert(_raw);
+    _raw->set_crc(make_pair(_off, _off + _len), make_pair(base, crc));
+  }
+
   bool buffer::ptr::can_zero_copy() const
   {
     return _raw->can_zero_copy();
@@ -162,3 +162,26 @@ bool parse_network(const char *s, struct sockaddr_storage *network, unsigned int
 
   return false;
 }
+
+
+bool network_contains(const struct sockaddr_storage& network,
+		      unsigned int prefix_len,
+		      const struct sockaddr *addr) {
+  if (addr->sa_family != network.ss_family)
+    return false;
+  switch (addr->sa_family) {
+    case AF_INET: {
+      struct in_addr a, n;
+      netmask_ipv4(&((const struct sockaddr_in*)addr)->sin_addr, prefix_len, &a);
+      netmask_ipv4(&((const struct sockaddr_in*)&network)->sin_addr, prefix_len, &n);
+      return a.s_addr == n.s_addr;
+    }
+    case AF_INET6: {
+      struct in6_addr a, n;
+      netmask_ipv6(&((const struct sockaddr_in6*)addr)->sin6_addr, prefix_len, &a);
+      netmask_ipv6(&((const struct sockaddr_in6*)&network)->sin6_addr, prefix_len, &n);
+      return IN6_ARE_ADDR_EQUAL(&a, &n);
+    }
+  }
+  return false;
+}
@@ -123,11 +123,13 @@ OPTION(ms_public_type, OPT_STR)   // messenger backend
 OPTION(ms_cluster_type, OPT_STR)   // messenger backend
 OPTION(ms_tcp_nodelay, OPT_BOOL)
 OPTION(ms_tcp_rcvbuf, OPT_INT)
+OPTION(ms_tcp_zerocopy_threshold, OPT_U32) // send buffers at least this large with MSG_ZEROCOPY; 0 disables
 OPTION(ms_tcp_prefetch_max_size, OPT_INT) // max prefetch size, we limit this to avoid extra memcpy
 OPTION(ms_initial_backoff, OPT_DOUBLE)
 OPTION(ms_max_backoff, OPT_DOUBLE)
 OPTION(ms_crc_data, OPT_BOOL)
 OPTION(ms_crc_header, OPT_BOOL)
+OPTION(ms_crc_data_trusted_networks, OPT_STR) // skip data crc for peers on these networks
 OPTION(ms_die_on_bad_msg, OPT_BOOL)
 OPTION(ms_die_on_unhandled_msg, OPT_BOOL)
 OPTION(ms_die_on_old_message, OPT_BOOL)     // assert if we get a dup incoming message and shouldn't have (may be triggered by pre-541cd3c64be0dfa04e8a2df39422e0eb9541a428 code)
@@ -161,6 +163,9 @@ OPTION(ms_async_set_affinity, OPT_BOOL)
 // If ms_async_affinity_cores is empty, all threads will be bind to current running
 // core
 OPTION(ms_async_affinity_cores, OPT_STR)
+OPTION(ms_async_send_batch_bytes, OPT_U64) // flush coalesced outgoing messages at this many bytes
+OPTION(ms_async_send_batch_messages, OPT_U32) // ... or at this many messages
+OPTION(ms_async_zero_copy_rx_min_size, OPT_U32) // read message data this large in place on zero-copy stacks
 OPTION(ms_async_rdma_device_name, OPT_STR)
 OPTION(ms_async_rdma_enable_hugepage, OPT_BOOL)
 OPTION(ms_async_rdma_buffer_size, OPT_INT)
@@ -423,6 +428,7 @@ OPTION(objecter_completion_locks_per_session, OPT_U64) // num of completion lock
 OPTION(objecter_inject_no_watch_ping, OPT_BOOL)   // suppress watch pings
 OPTION(objecter_retry_writes_after_first_reply, OPT_BOOL)   // ignore the first reply for each write, and resend the osd op instead
 OPTION(objecter_debug_inject_relock_delay, OPT_BOOL)
+OPTION(objecter_placement_cache, OPT_BOOL) // cache pg up/acting sets across osdmap epochs
 
 // Max number of deletes at once in a single Filer::purge call
 OPTION(filer_max_purge_ops, OPT_U32)
@@ -609,6 +615,9 @@ OPTION(osd_journal_flush_on_shutdown, OPT_BOOL) // Flush journal to data store o
 // and we still want to bring the osd daemon back normally, etc.
 OPTION(osd_os_flags, OPT_U32)
 OPTION(osd_max_write_size, OPT_INT)
+OPTION(osd_rx_buffer_pool_size, OPT_U64) // bytes of released write payload buffers kept for reuse
+OPTION(osd_rx_buffer_pool_min_alloc, OPT_U32) // smallest payload received into a pooled buffer
+OPTION(osd_rx_buffer_pool_align, OPT_U32) // alignment of pooled payload buffers
 OPTION(osd_max_pgls, OPT_U64) // max number of pgls entries to return
 OPTION(osd_client_message_size_cap, OPT_U64) // client data allowed in-memory (in bytes)
 OPTION(osd_client_message_cap, OPT_U64)              // num client messages allowed in-memory
@@ -682,6 +691,7 @@ OPTION(osd_disk_thread_ioprio_class, OPT_STR) // rt realtime be best effort idle
 OPTION(osd_disk_thread_ioprio_priority, OPT_INT) // 0-7
 OPTION(osd_recover_clone_overlap, OPT_BOOL)   // preserve clone_overlap during recovery/migration
 OPTION(osd_op_num_threads_per_shard, OPT_INT)
+OPTION(osd_op_shard_affinity_cores, OPT_STR) // cpus to pin op shard threads to, one per shard
 OPTION(osd_op_num_threads_per_shard_hdd, OPT_INT)
 OPTION(osd_op_num_threads_per_shard_ssd, OPT_INT)
 OPTION(osd_op_num_shards, OPT_INT)
@@ -722,6 +732,12 @@ OPTION(osd_ignore_stale_divergent_priors, OPT_BOOL) // do not assert on divergen
 // If set to true even after reading enough shards to
 // decode the object, any error will be reported.
 OPTION(osd_read_ec_check_for_errors, OPT_BOOL) // return error if any ec shard has an error
+OPTION(osd_ec_parity_delta_writes, OPT_BOOL) // parity delta partial stripe overwrites
+OPTION(osd_ec_read_extra_shards, OPT_U32) // speculative extra shards per ec client read
+OPTION(osd_ec_read_slow_shard_ratio, OPT_FLOAT) // skip shards of osds slower than this multiple of the median
+OPTION(osd_ec_encode_threads, OPT_INT) // threads encoding large ec writes off the pg lock
+OPTION(osd_ec_encode_min_bytes, OPT_U64) // full stripe bytes for a write to be encoded off the pg lock
+OPTION(osd_ec_tail_stripe_cache_size, OPT_U64) // bytes of last stripes kept per ec pg for appends
 
 // Only use clone_overlap for recovery if there are fewer than
 // osd_recover_clone_overlap_limit entries in the overlap set
@@ -775,7 +791,12 @@ OPTION(osd_auto_mark_unfound_lost, OPT_BOOL)
 OPTION(osd_recovery_delay_start, OPT_FLOAT)
 OPTION(osd_recovery_max_active, OPT_U64)
 OPTION(osd_recovery_max_single_start, OPT_U64)
+OPTION(osd_recovery_max_bytes_per_sec, OPT_U64)
+OPTION(osd_recovery_delta_extents, OPT_BOOL)
+OPTION(osd_pg_log_max_dirty_extents, OPT_U64)
+OPTION(osd_recovery_client_latency_target, OPT_FLOAT)
 OPTION(osd_recovery_max_chunk, OPT_U64)  // max size of push chunk
+OPTION(osd_ec_recovery_read_ahead, OPT_BOOL) // overlap ec recovery reads with pushes
 OPTION(osd_recovery_max_omap_entries_per_chunk, OPT_U64) // max number of omap entries per chunk; 0 to disable limit
 OPTION(osd_copyfrom_max_chunk, OPT_U64)   // max size of a COPYFROM chunk
 OPTION(osd_push_per_object_cost, OPT_U64)  // push cost per object
@@ -799,6 +820,8 @@ OPTION(osd_scrub_auto_repair_num_errors, OPT_U32)   // only auto-repair when num
 OPTION(osd_deep_scrub_interval, OPT_FLOAT) // once a week
 OPTION(osd_deep_scrub_randomize_ratio, OPT_FLOAT) // scrubs will randomly become deep scrubs at this rate (0.15 -> 15% of scrubs are deep)
 OPTION(osd_deep_scrub_stride, OPT_INT)
+OPTION(osd_deep_scrub_read_ahead, OPT_U64) // objects of a deep scrub chunk read at once
+OPTION(osd_scrub_max_bytes_per_sec, OPT_U64)
 OPTION(osd_deep_scrub_update_digest_min_age, OPT_INT)   // objects must be this old (seconds) before we update the whole-object digest on scrub
 OPTION(osd_class_dir, OPT_STR) // where rados plugins are stored
 OPTION(osd_open_classes_on_start, OPT_BOOL)
@@ -1665,6 +1688,9 @@ OPTION(mgr_mon_messages, OPT_U64)        // messages from mons
 
 OPTION(mgr_connect_retry_interval, OPT_DOUBLE)
 OPTION(mgr_service_beacon_grace, OPT_DOUBLE)
+OPTION(mgr_weight_set_max_deviation, OPT_FLOAT) // stop optimizing weight-sets below this
+OPTION(mgr_weight_set_max_iterations, OPT_INT)
+OPTION(mgr_weight_set_max_moved, OPT_INT) // max pgs a weight-set optimization moves, 0 for no limit
 
 OPTION(mon_mgr_digest_period, OPT_INT)  // How frequently to send digests
 OPTION(mon_mgr_beacon_grace, OPT_INT)  // How long to wait to failover
@@ -577,6 +577,11 @@ std::vector<Option> get_global_options() {
     .set_default(0)
     .set_description(""),
 
+    Option("ms_tcp_zerocopy_threshold", Option::TYPE_UINT, Option::LEVEL_ADVANCED)
+    .set_default(0)
+    .set_description("Send data buffers at least this large with MSG_ZEROCOPY (0 disables)")
+    .set_long_description("Only the async posix messenger on linux 4.14 or later uses this. The data stays referenced until the kernel reports that it is done with it, so it only pays off for large buffers, typically 64 KB and up. Connections over loopback are copied by the kernel regardless."),
+
     Option("ms_tcp_prefetch_max_size", Option::TYPE_INT, Option::LEVEL_ADVANCED)
     .set_default(4096)
     .set_description(""),
@@ -597,6 +602,11 @@ std::vector<Option> get_global_options() {
     .set_default(true)
     .set_description(""),
 
+    Option("ms_crc_data_trusted_networks", Option::TYPE_STR, Option::LEVEL_ADVANCED)
+    .set_default("")
+    .set_description("Networks (CIDR, comma separated) whose links are trusted to deliver message data intact")
+    .set_long_description("Messages sent to peers on these networks carry no data crc, and the receiver does not check one; use only where the link and NIC already protect the payload.  Header and front crcs are unaffected."),
+
     Option("ms_die_on_bad_msg", Option::TYPE_BOOL, Option::LEVEL_ADVANCED)
     .set_default(false)
     .set_description(""),
@@ -720,6 +730,20 @@ std::vector<Option> get_global_options() {
     .set_default("")
     .set_description(""),
 
+    Option("ms_async_send_batch_bytes", Option::TYPE_UINT, Option::LEVEL_ADVANCED)
+    .set_default(256 << 10)
+    .set_description("Flush coalesced outgoing messages once this many bytes are queued")
+    .set_long_description("All messages pending on a connection when it becomes writable are encoded back to back and sent with as few send calls as possible; a batch is flushed early once it holds this many bytes."),
+
+    Option("ms_async_send_batch_messages", Option::TYPE_UINT, Option::LEVEL_ADVANCED)
+    .set_default(64)
+    .set_description("Flush coalesced outgoing messages once this many are queued; 1 sends each message on its own"),
+
+    Option("ms_async_zero_copy_rx_min_size", Option::TYPE_UINT, Option::LEVEL_ADVANCED)
+    .set_default(64 << 10)
+    .set_description("Hand message data at least this large to the dispatcher in the transport's own receive buffers")
+    .set_long_description("Only used by network stacks that can read without copying (rdma, dpdk); the receive buffers then stay in use until the message is released, so only dispatchers that opt in (the OSD) get them and others get a copy.  0 disables."),
+
     Option("ms_async_rdma_device_name", Option::TYPE_STR, Option::LEVEL_ADVANCED)
     .set_default("")
     .set_description(""),
@@ -1500,6 +1524,11 @@ std::vector<Option> get_global_options() {
     .set_default(false)
     .set_description(""),
 
+    Option("objecter_placement_cache", Option::TYPE_BOOL, Option::LEVEL_ADVANCED)
+    .set_default(true)
+    .set_description("Cache the up and acting sets of the PGs ops are sent to")
+    .set_long_description("PGs are mapped on first use and the mapping is kept across OSDMap epochs until an incremental map may change it, so that resending the in-flight ops after a new map mostly skips CRUSH."),
+
     Option("filer_max_purge_ops", Option::TYPE_UINT, Option::LEVEL_ADVANCED)
     .set_default(10)
     .set_description(""),
@@ -1600,6 +1629,19 @@ std::vector<Option> get_global_options() {
     .set_default(90)
     .set_description(""),
 
+    Option("osd_rx_buffer_pool_size", Option::TYPE_UINT, Option::LEVEL_ADVANCED)
+    .set_default(64 << 20)
+    .set_description("Bytes of released write payload buffers the OSD keeps for reuse")
+    .set_long_description("Large write payloads are received directly into aligned buffers that can be submitted to the store without copying; this many bytes of them are recycled instead of freed.  0 disables the pool."),
+
+    Option("osd_rx_buffer_pool_min_alloc", Option::TYPE_UINT, Option::LEVEL_ADVANCED)
+    .set_default(64 << 10)
+    .set_description("Smallest write payload received into a pooled buffer"),
+
+    Option("osd_rx_buffer_pool_align", Option::TYPE_UINT, Option::LEVEL_ADVANCED)
+    .set_default(4096)
+    .set_description("Alignment of pooled write payload buffers; should match the store block size"),
+
     Option("osd_max_pgls", Option::TYPE_UINT, Option::LEVEL_ADVANCED)
     .set_default(1024)
     .set_description(""),
@@ -1790,7 +1832,7 @@ std::vector<Option> get_global_options() {
 
     Option("osd_map_dedup", Option::TYPE_BOOL, Option::LEVEL_ADVANCED)
     .set_default(true)
-    .set_description(""),
+    .set_description("Share unchanged parts of consecutive cached OSDMaps"),
 
     Option("osd_map_max_advance", Option::TYPE_INT, Option::LEVEL_ADVANCED)
     .set_default(40)
@@ -1856,6 +1898,11 @@ std::vector<Option> get_global_options() {
     .set_default(true)
     .set_description(""),
 
+    Option("osd_op_shard_affinity_cores", Option::TYPE_STR, Option::LEVEL_ADVANCED)
+    .set_default("")
+    .set_description("CPUs (comma separated) to pin op shard threads to; shard i uses entry i")
+    .set_long_description("This only pins the threads.  Ops are still queued to the shard of their PG (pgid.hash_to_shard()), whichever messenger worker received them, so listing the same cores as ms_async_affinity_cores does not keep an op on the core that read it.  Empty leaves scheduling to the kernel."),
+
     Option("osd_op_num_threads_per_shard", Option::TYPE_INT, Option::LEVEL_ADVANCED)
     .set_default(0)
     .set_description(""),
@@ -1952,10 +1999,44 @@ std::vector<Option> get_global_options() {
     .set_default(false)
     .set_description(""),
 
+    Option("osd_ec_parity_delta_writes", Option::TYPE_BOOL, Option::LEVEL_ADVANCED)
+    .set_default(false)
+    .set_description("Update coding chunks from the changed data chunks on small erasure coded overwrites")
+    .set_long_description("With allow_ec_overwrites, a partial stripe overwrite reads the old changed data chunks and coding chunks and writes only those shards, instead of reading and re-encoding the whole stripe. Used when the erasure code plugin supports it and it reads no more chunks than the stripe."),
+
     Option("osd_read_ec_check_for_errors", Option::TYPE_BOOL, Option::LEVEL_ADVANCED)
     .set_default(false)
     .set_description(""),
 
+    Option("osd_ec_read_extra_shards", Option::TYPE_UINT, Option::LEVEL_ADVANCED)
+    .set_default(0)
+    .set_description("Number of shards beyond the minimum that an erasure coded client read is sent to")
+    .set_long_description("The read completes as soon as the shards that replied are enough to decode it, so one slow OSD does not set the read latency. The extra shards are the ones whose OSDs answered recent sub reads fastest. Pools with fast_read set read all shards regardless.")
+    .add_see_also("osd_ec_read_slow_shard_ratio"),
+
+    Option("osd_ec_read_slow_shard_ratio", Option::TYPE_FLOAT, Option::LEVEL_ADVANCED)
+    .set_default(0)
+    .set_description("Avoid reading erasure coded shards from OSDs this many times slower than the median")
+    .set_long_description("The primary keeps a moving average of the sub read latency of each OSD. A client read skips the shards of OSDs whose average exceeds this multiple of the median of the candidate shards, as long as the other shards are enough to decode. 0 disables it.")
+    .add_see_also("osd_ec_read_extra_shards"),
+
+    Option("osd_ec_encode_threads", Option::TYPE_INT, Option::LEVEL_ADVANCED)
+    .set_default(2)
+    .set_description("Number of threads encoding erasure coded writes outside of the PG lock")
+    .set_long_description("Large writes to an erasure coded pool are encoded by this thread pool while the op waits in the write pipeline, so that the PG lock is not held for the encoding and the writes of one PG are encoded in parallel. 0 encodes every write inline. Takes effect when the OSD starts.")
+    .add_see_also("osd_ec_encode_min_bytes"),
+
+    Option("osd_ec_encode_min_bytes", Option::TYPE_UINT, Option::LEVEL_ADVANCED)
+    .set_default(256 << 10)
+    .set_description("Smallest amount of full stripe data in a write that is encoded on the encode thread pool")
+    .set_long_description("Smaller writes are encoded inline, where the encoding costs less than handing them to another thread. 0 encodes every write inline.")
+    .add_see_also("osd_ec_encode_threads"),
+
+    Option("osd_ec_tail_stripe_cache_size", Option::TYPE_UINT, Option::LEVEL_ADVANCED)
+    .set_default(0)
+    .set_description("Bytes of the last stripe of recently written objects kept by each erasure coded PG")
+    .set_long_description("A partial stripe write to an erasure coded pool that allows overwrites reads the rest of the stripe from the shards first. Small sequential appends rewrite the last stripe of the object over and over: keeping it in memory after each write lets the next append skip that read. 0 disables the cache; a few hundred KiB is enough for a handful of appending clients per PG."),
+
     Option("osd_recover_clone_overlap_limit", Option::TYPE_INT, Option::LEVEL_ADVANCED)
     .set_default(10)
     .set_description(""),
@@ -2112,10 +2193,36 @@ std::vector<Option> get_global_options() {
     .set_default(1)
     .set_description(""),
 
+    Option("osd_recovery_max_bytes_per_sec", Option::TYPE_UINT, Option::LEVEL_ADVANCED)
+    .set_default(0)
+    .set_description("Limit on bytes read and pushed for recovery and backfill per second (0 = unlimited)")
+    .add_see_also("osd_recovery_client_latency_target"),
+
+    Option("osd_recovery_client_latency_target", Option::TYPE_FLOAT, Option::LEVEL_ADVANCED)
+    .set_default(0)
+    .set_description("Average client op latency (seconds) above which the recovery byte budget is reduced (0 = do not adapt)")
+    .add_see_also("osd_recovery_max_bytes_per_sec"),
+
+    Option("osd_recovery_delta_extents", Option::TYPE_BOOL, Option::LEVEL_ADVANCED)
+    .set_default(false)
+    .set_description("Push only the ranges modified since the replica's version of an object")
+    .set_long_description("Uses the data ranges recorded in PG log entries to recover a replicated object by pushing only what changed, when the peer still has an older version covered by the log. Ranges are only recorded for writes to replicated pools made while this is enabled.  Has no effect until require_osd_release is mimic, since older replicas mishandle such a push.")
+    .add_see_also("osd_pg_log_max_dirty_extents"),
+
+    Option("osd_pg_log_max_dirty_extents", Option::TYPE_UINT, Option::LEVEL_ADVANCED)
+    .set_default(16)
+    .set_description("Maximum number of modified ranges recorded per PG log entry before the whole object is considered modified"),
+
     Option("osd_recovery_max_chunk", Option::TYPE_UINT, Option::LEVEL_ADVANCED)
     .set_default(8<<20)
     .set_description(""),
 
+    Option("osd_ec_recovery_read_ahead", Option::TYPE_BOOL, Option::LEVEL_ADVANCED)
+    .set_default(true)
+    .set_description("Read and decode the next chunk of an erasure coded object being recovered while the previous one is pushed")
+    .set_long_description("Objects larger than osd_recovery_max_chunk are recovered one chunk at a time. With this set, reading the next chunk overlaps with pushing the previous one, at the cost of holding two chunks in memory.")
+    .add_see_also("osd_recovery_max_chunk"),
+
     Option("osd_recovery_max_omap_entries_per_chunk", Option::TYPE_UINT, Option::LEVEL_ADVANCED)
     .set_default(64000)
     .set_description(""),
@@ -2208,6 +2315,18 @@ std::vector<Option> get_global_options() {
     .set_default(524288)
     .set_description(""),
 
+    Option("osd_deep_scrub_read_ahead", Option::TYPE_UINT, Option::LEVEL_ADVANCED)
+    .set_default(1)
+    .set_description("Number of objects in a deep scrub chunk being read at once (1 = no read-ahead)")
+    .set_long_description("While deep scrub checksums an object, the object store is hinted to start reading the next osd_deep_scrub_read_ahead - 1 objects of the chunk. Only stores that can read ahead in the background, such as FileStore, make use of the hint.")
+    .add_see_also("osd_deep_scrub_stride"),
+
+    Option("osd_scrub_max_bytes_per_sec", Option::TYPE_UINT, Option::LEVEL_ADVANCED)
+    .set_default(0)
+    .set_description("Maximum bytes per second read by deep scrub on this OSD (0 = unlimited)")
+    .set_long_description("When the budget is spent, primaries on this OSD delay their next scrub chunk until it has refilled.")
+    .add_see_also("osd_scrub_sleep"),
+
     Option("osd_deep_scrub_update_digest_min_age", Option::TYPE_INT, Option::LEVEL_ADVANCED)
     .set_default(2*60*60)
     .set_description(""),
@@ -3838,6 +3957,18 @@ std::vector<Option> get_global_options() {
     .set_default(60.0)
     .set_description(""),
 
+    Option("mgr_weight_set_max_deviation", Option::TYPE_FLOAT, Option::LEVEL_ADVANCED)
+    .set_default(.01)
+    .set_description("Ratio of misplaced PGs or bytes at which 'osd crush weight-set optimize' stops"),
+
+    Option("mgr_weight_set_max_iterations", Option::TYPE_INT, Option::LEVEL_ADVANCED)
+    .set_default(100)
+    .set_description("Default number of weight adjustments 'osd crush weight-set optimize' simulates"),
+
+    Option("mgr_weight_set_max_moved", Option::TYPE_INT, Option::LEVEL_ADVANCED)
+    .set_default(0)
+    .set_description("Default max number of PGs 'osd crush weight-set optimize' moves at once, 0 for no limit"),
+
     Option("mon_mgr_digest_period", Option::TYPE_INT, Option::LEVEL_ADVANCED)
     .set_default(5)
     .set_description(""),
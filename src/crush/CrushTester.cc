@@ -7,6 +7,7 @@
 #include "include/ceph_features.h"
 
 #include <algorithm>
+#include <thread>
 #include <stdlib.h>
 #include <boost/lexical_cast.hpp>
 // to workaround https://svn.boost.org/trac/boost/ticket/9501
@@ -20,6 +21,7 @@
 #include <boost/algorithm/string/join.hpp>
 #include "common/SubProcess.h"
 #include "common/fork_function.h"
+#include "common/ceph_time.h"
 
 void CrushTester::set_device_weight(int dev, float f)
 {
@@ -469,33 +471,86 @@ void CrushTester::check_overlapped_rules() const
   }
 }
 
-int CrushTester::test()
+static uint64_t mappings_per_second(size_t n, ceph::timespan t)
 {
-  if (min_rule < 0 || max_rule < 0) {
-    min_rule = 0;
-    max_rule = crush.get_max_rules() - 1;
+  double seconds = std::chrono::duration<double>(t).count();
+  return seconds > 0 ? n / seconds : 0;
+}
+
+int CrushTester::benchmark_rule(int ruleno, int nr,
+				const vector<__u32>& weight)
+{
+  vector<int> xs;
+  for (int x = min_x; x <= max_x; x++) {
+    uint32_t real_x = x;
+    if (pool_id != -1) {
+      real_x = crush_hash32_2(CRUSH_HASH_RJENKINS1, x, (uint32_t)pool_id);
+    }
+    xs.push_back(real_x);
   }
-  if (min_x < 0 || max_x < 0) {
-    min_x = 0;
-    max_x = 1023;
+
+  vector<vector<int> > one(xs.size());
+  auto start = ceph::mono_clock::now();
+  for (unsigned i = 0; i < xs.size(); i++)
+    crush.do_rule(ruleno, xs[i], one[i], nr, weight, 0);
+  ceph::timespan one_time = ceph::mono_clock::now() - start;
+
+  vector<vector<int> > batch;
+  start = ceph::mono_clock::now();
+  crush.do_rule_batch(ruleno, xs, &batch, nr, weight, 0);
+  ceph::timespan batch_time = ceph::mono_clock::now() - start;
+
+  for (unsigned i = 0; i < xs.size(); i++) {
+    if (one[i] != batch[i]) {
+      err << "rule " << ruleno << " x " << (min_x + i) << " num_rep " << nr
+	  << " do_rule " << one[i] << " != do_rule_batch " << batch[i]
+	  << std::endl;
+      return -EINVAL;
+    }
   }
+  err << "rule " << ruleno << " (" << crush.get_rule_name(ruleno)
+      << ") num_rep " << nr << " x " << min_x << ".." << max_x
+      << ": do_rule " << mappings_per_second(xs.size(), one_time)
+      << " mappings/s, do_rule_batch "
+      << mappings_per_second(xs.size(), batch_time) << " mappings/s"
+      << std::endl;
+  return 0;
+}
 
-  // initial osd weights
+vector<__u32> CrushTester::get_weights(const CrushWrapper& c) const
+{
   vector<__u32> weight;
 
   /*
    * note device weight is set by crushtool
    * (likely due to a given a command line option)
    */
-  for (int o = 0; o < crush.get_max_devices(); o++) {
-    if (device_weight.count(o)) {
-      weight.push_back(device_weight[o]);
-    } else if (crush.check_item_present(o)) {
+  for (int o = 0; o < c.get_max_devices(); o++) {
+    auto p = device_weight.find(o);
+    if (p != device_weight.end()) {
+      weight.push_back(p->second);
+    } else if (c.check_item_present(o)) {
       weight.push_back(0x10000);
     } else {
       weight.push_back(0);
     }
   }
+  return weight;
+}
+
+int CrushTester::test()
+{
+  if (min_rule < 0 || max_rule < 0) {
+    min_rule = 0;
+    max_rule = crush.get_max_rules() - 1;
+  }
+  if (min_x < 0 || max_x < 0) {
+    min_x = 0;
+    max_x = 1023;
+  }
+
+  // initial osd weights
+  vector<__u32> weight = get_weights(crush);
 
   if (output_utilization_all)
     err << "devices weights (hex): " << hex << weight << dec << std::endl;
@@ -535,6 +590,13 @@ int CrushTester::test()
       << std::endl;
 
     for (int nr = minr; nr <= maxr; nr++) {
+      if (output_benchmark) {
+	int ret = benchmark_rule(r, nr, weight);
+	if (ret < 0)
+	  return ret;
+	continue;
+      }
+
       vector<int> per(crush.get_max_devices());
       map<int,int> sizes;
 
@@ -723,3 +785,183 @@ int CrushTester::test()
 
   return 0;
 }
+
+namespace {
+  // what moved between two maps for one rule and num_rep
+  struct compare_result_t {
+    uint64_t changed = 0;   ///< inputs mapped differently
+    uint64_t moved = 0;     ///< replicas/shards mapped to another device
+    uint64_t total = 0;     ///< replicas/shards mapped by the first map
+    map<int, int> before;   ///< device -> replicas/shards, first map
+    map<int, int> after;    ///< device -> replicas/shards, second map
+    map<int, int> in;       ///< device -> replicas/shards it gains
+    map<int, int> out;      ///< device -> replicas/shards it loses
+
+    void add(const vector<int>& a, const vector<int>& b, bool positional) {
+      for (auto o : a) {
+	if (o != CRUSH_ITEM_NONE) {
+	  before[o]++;
+	  total++;
+	}
+      }
+      for (auto o : b) {
+	if (o != CRUSH_ITEM_NONE)
+	  after[o]++;
+      }
+      if (a == b)
+	return;
+      changed++;
+      if (positional) {
+	// erasure coded: a shard moves if its position maps elsewhere
+	for (unsigned i = 0; i < std::max(a.size(), b.size()); i++) {
+	  int ao = i < a.size() ? a[i] : CRUSH_ITEM_NONE;
+	  int bo = i < b.size() ? b[i] : CRUSH_ITEM_NONE;
+	  if (ao == bo)
+	    continue;
+	  if (ao != CRUSH_ITEM_NONE) {
+	    out[ao]++;
+	    moved++;
+	  }
+	  if (bo != CRUSH_ITEM_NONE)
+	    in[bo]++;
+	}
+      } else {
+	// replicated: only membership matters, not the order
+	for (auto o : a) {
+	  if (o != CRUSH_ITEM_NONE &&
+	      std::find(b.begin(), b.end(), o) == b.end()) {
+	    out[o]++;
+	    moved++;
+	  }
+	}
+	for (auto o : b) {
+	  if (o != CRUSH_ITEM_NONE &&
+	      std::find(a.begin(), a.end(), o) == a.end())
+	    in[o]++;
+	}
+      }
+    }
+
+    void merge(const compare_result_t& o) {
+      changed += o.changed;
+      moved += o.moved;
+      total += o.total;
+      for (auto& p : o.before)
+	before[p.first] += p.second;
+      for (auto& p : o.after)
+	after[p.first] += p.second;
+      for (auto& p : o.in)
+	in[p.first] += p.second;
+      for (auto& p : o.out)
+	out[p.first] += p.second;
+    }
+  };
+}
+
+int CrushTester::compare(CrushWrapper& other)
+{
+  if (min_rule < 0 || max_rule < 0) {
+    min_rule = 0;
+    max_rule = crush.get_max_rules() - 1;
+  }
+  if (min_x < 0 || max_x < 0) {
+    min_x = 0;
+    max_x = 1023;
+  }
+  int threads = num_threads;
+  if (threads <= 0)
+    threads = std::max(1u, std::thread::hardware_concurrency());
+
+  vector<__u32> weight = get_weights(crush);
+  vector<__u32> other_weight = get_weights(other);
+
+  vector<int> xs;
+  for (int x = min_x; x <= max_x; x++) {
+    uint32_t real_x = x;
+    if (pool_id != -1) {
+      real_x = crush_hash32_2(CRUSH_HASH_RJENKINS1, x, (uint32_t)pool_id);
+    }
+    xs.push_back(real_x);
+  }
+  if (xs.empty()) {
+    err << "no input to compare: min_x " << min_x << " > max_x " << max_x
+	<< std::endl;
+    return -EINVAL;
+  }
+  threads = std::min<int>(threads, xs.size());
+  uint64_t choose_args_index = pool_id;
+
+  int compared = 0;
+  for (int r = min_rule; r < crush.get_max_rules() && r <= max_rule; r++) {
+    if (!crush.rule_exists(r)) {
+      continue;
+    }
+    if (ruleset >= 0 &&
+	crush.get_rule_mask_ruleset(r) != ruleset) {
+      continue;
+    }
+    if (!other.rule_exists(r)) {
+      err << "rule " << r << " (" << crush.get_rule_name(r)
+	  << ") dne in the other map" << std::endl;
+      continue;
+    }
+    bool positional = crush.get_rule_mask_type(r) == CEPH_PG_TYPE_ERASURE;
+    int minr = min_rep, maxr = max_rep;
+    if (min_rep < 0 || max_rep < 0) {
+      minr = crush.get_rule_mask_min_size(r);
+      maxr = crush.get_rule_mask_max_size(r);
+    }
+    for (int nr = minr; nr <= maxr; nr++) {
+      vector<compare_result_t> results(threads);
+      vector<std::thread> workers;
+      size_t per_thread = (xs.size() + threads - 1) / threads;
+      for (int t = 0; t < threads; t++) {
+	workers.emplace_back([&, t] {
+	    size_t first = t * per_thread;
+	    size_t last = std::min(xs.size(), first + per_thread);
+	    if (first >= last)
+	      return;
+	    vector<int> mine(xs.begin() + first, xs.begin() + last);
+	    vector<vector<int>> a, b;
+	    crush.do_rule_batch(r, mine, &a, nr, weight, choose_args_index);
+	    other.do_rule_batch(r, mine, &b, nr, other_weight,
+				choose_args_index);
+	    for (unsigned i = 0; i < mine.size(); i++)
+	      results[t].add(a[i], b[i], positional);
+	  });
+      }
+      for (auto& w : workers)
+	w.join();
+      compare_result_t res;
+      for (auto& t : results)
+	res.merge(t);
+
+      err << "rule " << r << " (" << crush.get_rule_name(r)
+	  << ") num_rep " << nr << ": "
+	  << res.changed << "/" << xs.size() << " mappings changed ("
+	  << (xs.empty() ? 0.0 : (double)res.changed / xs.size()) << "), "
+	  << res.moved << "/" << res.total << " replicas moved ("
+	  << (res.total ? (double)res.moved / res.total : 0.0) << ")"
+	  << std::endl;
+      if (output_utilization || output_utilization_all) {
+	set<int> devices;
+	for (auto& p : res.before)
+	  devices.insert(p.first);
+	for (auto& p : res.after)
+	  devices.insert(p.first);
+	for (auto d : devices) {
+	  if (!output_utilization_all && !res.in.count(d) && !res.out.count(d))
+	    continue;
+	  err << "  device " << d << ":\t"
+	      << " before " << res.before[d]
+	      << "\t after " << res.after[d]
+	      << "\t in " << res.in[d]
+	      << "\t out " << res.out[d]
+	      << std::endl;
+	}
+      }
+      ++compared;
+    }
+  }
+  return compared ? 0 : -ENOENT;
+}
@@ -20,6 +20,7 @@ class CrushTester {
   int64_t pool_id;
 
   int num_batches;
+  int num_threads;
   bool use_crush;
 
   float mark_down_device_ratio;
@@ -31,6 +32,7 @@ class CrushTester {
   bool output_mappings;
   bool output_bad_mappings;
   bool output_choose_tries;
+  bool output_benchmark;
 
   bool output_data_file;
   bool output_csv;
@@ -75,6 +77,18 @@ class CrushTester {
    */
   int random_placement(int ruleno, vector<int>& out, int maxout, vector<__u32>& weight);
 
+  /*
+   * time mapping the inputs one by one against mapping them with
+   * CrushWrapper::do_rule_batch, and check that both agree
+   */
+  int benchmark_rule(int ruleno, int nr, const vector<__u32>& weight);
+
+  /*
+   * the device weights to test c with: those set with set_device_weight,
+   * and 1.0 for any other device present in the hierarchy
+   */
+  vector<__u32> get_weights(const CrushWrapper& c) const;
+
   // scaffolding to store data for off-line processing
    struct tester_data_set {
      vector <string> device_utilization;
@@ -174,6 +188,7 @@ public:
       min_rep(-1), max_rep(-1),
       pool_id(-1),
       num_batches(1),
+      num_threads(0),
       use_crush(true),
       mark_down_device_ratio(0.0),
       mark_down_bucket_ratio(1.0),
@@ -183,6 +198,7 @@ public:
       output_mappings(false),
       output_bad_mappings(false),
       output_choose_tries(false),
+      output_benchmark(false),
       output_data_file(false),
       output_csv(false),
       output_data_file_name("")
@@ -252,6 +268,13 @@ public:
     return output_choose_tries;
   }
 
+  void set_output_benchmark(bool b) {
+    output_benchmark = b;
+  }
+  bool get_output_benchmark() const {
+    return output_benchmark;
+  }
+
   void set_batches(int b) {
     num_batches = b;
   }
@@ -259,6 +282,14 @@ public:
     return num_batches;
   }
 
+  /// number of threads for compare(), 0 for one per cpu
+  void set_num_threads(int n) {
+    num_threads = n;
+  }
+  int get_num_threads() const {
+    return num_threads;
+  }
+
   void set_random_placement() {
     use_crush = false;
   }
@@ -359,6 +390,21 @@ public:
   void check_overlapped_rules() const;
   int test();
   int test_with_fork(int timeout);
+  /**
+   * map the inputs of each rule with both this map and other, and
+   * report how many of the mappings and replicas would move between
+   * them, per rule and per device
+   *
+   * the inputs are split between num_threads threads, each of which
+   * maps its share with CrushWrapper::do_rule_batch
+   *
+   * the mappings are made with the choose_args of pool_id, falling back
+   * to the default weight-set, as for the pool's pgs
+   *
+   * @return -EINVAL if the input range is empty, -ENOENT if no rule
+   *         could be compared, 0 otherwise
+   */
+  int compare(CrushWrapper& other);
 };
 
 #endif
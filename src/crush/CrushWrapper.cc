@@ -3132,6 +3132,27 @@ int CrushWrapper::_choose_args_adjust_item_weight_in_bucket(
   return changed;
 }
 
+int CrushWrapper::choose_args_get_item_weight(
+  crush_choose_arg_map cmap,
+  int id) const
+{
+  for (unsigned bidx = 0;
+       bidx < cmap.size && bidx < (unsigned)crush->max_buckets;
+       ++bidx) {
+    const crush_bucket *b = crush->buckets[bidx];
+    const crush_choose_arg& arg = cmap.args[bidx];
+    if (b == nullptr || arg.weight_set_size == 0) {
+      continue;
+    }
+    for (unsigned i = 0; i < b->size && i < arg.weight_set[0].size; ++i) {
+      if (b->items[i] == id) {
+	return arg.weight_set[0].weights[i];
+      }
+    }
+  }
+  return -1;
+}
+
 int CrushWrapper::choose_args_adjust_item_weight(
   CephContext *cct,
   crush_choose_arg_map cmap,
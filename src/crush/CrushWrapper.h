@@ -1405,6 +1405,9 @@ public:
     return choose_args_adjust_item_weight(cct, cmap, id, weight, ss);
   }
 
+  /// weight of item **id** in the first position, or -1 if it has none
+  int choose_args_get_item_weight(crush_choose_arg_map cmap, int id) const;
+
   int get_choose_args_positions(crush_choose_arg_map cmap) {
     // infer positions from other buckets
     for (unsigned j = 0; j < cmap.size; ++j) {
@@ -1433,6 +1436,37 @@ public:
       out[i] = rawout[i];
   }
 
+  /**
+   * map each of xs as do_rule() does, with one workspace and
+   * choose_args lookup for all of them
+   */
+  template<typename WeightVector>
+  void do_rule_batch(int rule, const vector<int>& xs,
+		     vector<vector<int>> *out, int maxout,
+		     const WeightVector& weight,
+		     uint64_t choose_args_index) const {
+    out->resize(xs.size());
+    if (xs.empty())
+      return;
+    vector<int> rawout(xs.size() * maxout);
+    vector<int> numrep(xs.size());
+    char work[crush_work_size(crush, maxout)];
+    crush_init_workspace(crush, work);
+    crush_choose_arg_map arg_map = choose_args_get_with_fallback(
+      choose_args_index);
+    if (!crush_do_rule_batch(crush, rule, &xs[0], xs.size(),
+			     &rawout[0], maxout, &numrep[0],
+			     &weight[0], weight.size(), work, arg_map.args)) {
+      for (auto& o : *out)
+	o.clear();
+      return;
+    }
+    for (unsigned i = 0; i < xs.size(); i++) {
+      auto first = rawout.begin() + i * maxout;
+      (*out)[i].assign(first, first + std::max(numrep[i], 0));
+    }
+  }
+
   int _choose_type_stack(
     CephContext *cct,
     const vector<pair<int,int>>& stack,
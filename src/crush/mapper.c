@@ -24,6 +24,10 @@
 #endif
 #include "crush_ln_table.h"
 #include "mapper.h"
+#ifdef HAVE_INTEL_AVX2
+# include "arch/intel.h"
+# include "mapper_avx2.h"
+#endif
 
 #define dprintk(args...) /* printf(args) */
 
@@ -289,6 +293,11 @@ static __u64 crush_ln(unsigned int xin)
 	return result;
 }
 
+__s64 crush_straw2_ln(__u32 u)
+{
+	return crush_ln(u) - 0x1000000000000ll;
+}
+
 
 /*
  * straw2
@@ -328,8 +337,24 @@ static int bucket_straw2_choose(const struct crush_bucket_straw2 *bucket,
 	__s64 ln, draw, high_draw = 0;
         __u32 *weights = get_choose_arg_weights(bucket, arg, position);
         __s32 *ids = get_choose_arg_ids(bucket, arg);
+#ifdef HAVE_INTEL_AVX2
+	/* the ln of the items before lanes_end are computed in groups */
+	__s64 lanes[CRUSH_STRAW2_AVX2_LANES];
+	unsigned int lanes_end = 0;
+	if (ceph_arch_intel_avx2 && bucket->h.hash == CRUSH_HASH_RJENKINS1)
+		lanes_end = bucket->h.size -
+			bucket->h.size % CRUSH_STRAW2_AVX2_LANES;
+#endif
 	for (i = 0; i < bucket->h.size; i++) {
                 dprintk("weight 0x%x item %d\n", weights[i], ids[i]);
+#ifdef HAVE_INTEL_AVX2
+		if (i < lanes_end && i % CRUSH_STRAW2_AVX2_LANES == 0)
+			crush_straw2_ln_avx2(x, ids + i, r, lanes);
+		if (weights[i] && i < lanes_end) {
+			ln = lanes[i % CRUSH_STRAW2_AVX2_LANES];
+			draw = div64_s64(ln, weights[i]);
+		} else
+#endif
 		if (weights[i]) {
 			u = crush_hash32_3(bucket->h.hash, x, ids[i], r);
 			u &= 0xffff;
@@ -1086,3 +1111,36 @@ int crush_do_rule(const struct crush_map *map,
 
 	return result_len;
 }
+
+/**
+ * crush_do_rule_batch - map many inputs with the same rule
+ * @map: the crush_map
+ * @ruleno: the rule id
+ * @x: the hash inputs
+ * @x_count: number of inputs
+ * @result: x_count result vectors of result_max items, one after the other
+ * @result_max: maximum result size
+ * @result_len: x_count result sizes
+ * @weight: weight vector (for map leaves)
+ * @weight_max: size of weight vector
+ * @cwin: Pointer to at least map->working_size bytes of memory or NULL.
+ */
+int crush_do_rule_batch(const struct crush_map *map,
+			int ruleno, const int *x, int x_count,
+			int *result, int result_max, int *result_len,
+			const __u32 *weight, int weight_max,
+			void *cwin, const struct crush_choose_arg *choose_args)
+{
+	int i;
+
+	if ((__u32)ruleno >= map->max_rules) {
+		dprintk(" bad ruleno %d\n", ruleno);
+		return 0;
+	}
+	for (i = 0; i < x_count; i++)
+		result_len[i] = crush_do_rule(map, ruleno, x[i],
+					      result + i * result_max,
+					      result_max, weight, weight_max,
+					      cwin, choose_args);
+	return x_count;
+}
@@ -78,6 +78,47 @@ extern int crush_do_rule(const struct crush_map *map,
 			 const __u32 *weights, int weight_max,
 			 void *cwin, const struct crush_choose_arg *choose_args);
 
+/** @ingroup API
+ *
+ * Map each of the __x_count__ inputs in __x__ as crush_do_rule()
+ * does, with the same __ruleno__, __weights__, __cwin__ and
+ * __choose_args__. The result of __x[i]__ is stored in
+ * __result[i * result_max, (i + 1) * result_max[__ and its size in
+ * __result_len[i]__.
+ *
+ * The workspace is initialized once by the caller for all the
+ * inputs, which is most of the cost of mapping an input of a large
+ * map with a fresh workspace, as CrushWrapper::do_rule() does.
+ *
+ * @param map the crush_map
+ * @param ruleno a positive integer < __CRUSH_MAX_RULES__
+ * @param x the values to map
+ * @param x_count the size of the __x__ and __result_len__ arrays
+ * @param result an array of items of size __x_count * result_max__
+ * @param result_max the maximum size of a result
+ * @param result_len the size of each result
+ * @param weights an array of weights of size __weight_max__
+ * @param weight_max the size of the __weights__ array
+ * @param cwin must be an char array initialized by crush_init_workspace
+ * @param choose_args weights and ids for each known bucket
+ *
+ * @return 0 on error or __x_count__ on success
+ */
+extern int crush_do_rule_batch(const struct crush_map *map,
+			       int ruleno,
+			       const int *x, int x_count,
+			       int *result, int result_max, int *result_len,
+			       const __u32 *weights, int weight_max,
+			       void *cwin,
+			       const struct crush_choose_arg *choose_args);
+
+/*
+ * crush_ln(__u__) - 0x1000000000000 for a straw2 item whose hash is
+ * __u__ (masked to [0, 0xffff]): its draw before the division by the
+ * item weight. Exported as the reference for the simd versions.
+ */
+extern __s64 crush_straw2_ln(__u32 u);
+
 /* Returns the exact amount of workspace that will need to be used
    for a given combination of crush_map and result_max. The caller can
    then allocate this much on its own, either on the stack, in a
@@ -0,0 +1,135 @@
+/*
+ * Ceph - scalable distributed file system
+ *
+ * This is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License version 2.1, as published by the Free Software
+ * Foundation.  See file COPYING.
+ *
+ */
+
+#include <immintrin.h>
+
+#include "crush_ln_table.h"
+#include "mapper_avx2.h"
+
+/* crush_hashmix() of hash.c, eight lanes at a time */
+#define crush_hashmix_avx2(a, b, c) do {				\
+		a = _mm256_sub_epi32(a, b);				\
+		a = _mm256_sub_epi32(a, c);				\
+		a = _mm256_xor_si256(a, _mm256_srli_epi32(c, 13));	\
+		b = _mm256_sub_epi32(b, c);				\
+		b = _mm256_sub_epi32(b, a);				\
+		b = _mm256_xor_si256(b, _mm256_slli_epi32(a, 8));	\
+		c = _mm256_sub_epi32(c, a);				\
+		c = _mm256_sub_epi32(c, b);				\
+		c = _mm256_xor_si256(c, _mm256_srli_epi32(b, 13));	\
+		a = _mm256_sub_epi32(a, b);				\
+		a = _mm256_sub_epi32(a, c);				\
+		a = _mm256_xor_si256(a, _mm256_srli_epi32(c, 12));	\
+		b = _mm256_sub_epi32(b, c);				\
+		b = _mm256_sub_epi32(b, a);				\
+		b = _mm256_xor_si256(b, _mm256_slli_epi32(a, 16));	\
+		c = _mm256_sub_epi32(c, a);				\
+		c = _mm256_sub_epi32(c, b);				\
+		c = _mm256_xor_si256(c, _mm256_srli_epi32(b, 5));	\
+		a = _mm256_sub_epi32(a, b);				\
+		a = _mm256_sub_epi32(a, c);				\
+		a = _mm256_xor_si256(a, _mm256_srli_epi32(c, 3));	\
+		b = _mm256_sub_epi32(b, c);				\
+		b = _mm256_sub_epi32(b, a);				\
+		b = _mm256_xor_si256(b, _mm256_slli_epi32(a, 10));	\
+		c = _mm256_sub_epi32(c, a);				\
+		c = _mm256_sub_epi32(c, b);				\
+		c = _mm256_xor_si256(c, _mm256_srli_epi32(b, 15));	\
+	} while (0)
+
+#define crush_hash_seed 1315423911
+
+/* crush_hash32_rjenkins1_3() of hash.c */
+static __m256i crush_hash32_rjenkins1_3_avx2(__m256i a, __m256i b, __m256i c)
+{
+	__m256i hash = _mm256_xor_si256(
+		_mm256_set1_epi32(crush_hash_seed),
+		_mm256_xor_si256(a, _mm256_xor_si256(b, c)));
+	__m256i x = _mm256_set1_epi32(231232);
+	__m256i y = _mm256_set1_epi32(1232);
+	crush_hashmix_avx2(a, b, hash);
+	crush_hashmix_avx2(c, x, hash);
+	crush_hashmix_avx2(y, a, hash);
+	crush_hashmix_avx2(b, x, hash);
+	crush_hashmix_avx2(y, c, hash);
+	return hash;
+}
+
+/*
+ * crush_ln() of mapper.c for four inputs already normalized to
+ * [2^15, 2^17) in 64 bit lanes, with their exponent
+ */
+static __m256i crush_ln_avx2(__m256i x, __m256i iexpon)
+{
+	/* index1 - 256 = ((x >> 8) << 1) - 256 */
+	__m128i index1 = _mm256_castsi256_si128(
+		_mm256_permutevar8x32_epi32(
+			_mm256_sub_epi64(
+				_mm256_slli_epi64(_mm256_srli_epi64(x, 8), 1),
+				_mm256_set1_epi64x(256)),
+			_mm256_setr_epi32(0, 2, 4, 6, 0, 2, 4, 6)));
+	__m256i RH = _mm256_i32gather_epi64((const long long *)__RH_LH_tbl,
+					    index1, 8);
+	__m256i LH = _mm256_i32gather_epi64((const long long *)__RH_LH_tbl + 1,
+					    index1, 8);
+
+	/* xl64 = x * RH >> 48, with 32x32 bit multiplies */
+	__m256i xl64 = _mm256_add_epi64(
+		_mm256_mul_epu32(x, RH),
+		_mm256_slli_epi64(_mm256_mul_epu32(x, _mm256_srli_epi64(RH, 32)),
+				  32));
+	xl64 = _mm256_srli_epi64(xl64, 48);
+
+	__m256i index2 = _mm256_and_si256(xl64, _mm256_set1_epi64x(0xff));
+	__m256i LL = _mm256_i64gather_epi64((const long long *)__LL_tbl,
+					    index2, 8);
+
+	LH = _mm256_srli_epi64(_mm256_add_epi64(LH, LL), 48 - 12 - 32);
+	return _mm256_add_epi64(_mm256_slli_epi64(iexpon, 12 + 32), LH);
+}
+
+/* crush_ln(u) - 0x1000000000000 for eight u in [0, 0xffff] */
+static void crush_straw2_ln_lanes_avx2(__m256i u, __s64 *ln)
+{
+	/* x = u + 1 in [1, 2^16], normalized to [2^15, 2^17) */
+	u = _mm256_add_epi32(u, _mm256_set1_epi32(1));
+	/* the exponent of the exact float conversion is floor(log2(u)) */
+	__m256i iexpon = _mm256_sub_epi32(
+		_mm256_srli_epi32(_mm256_castps_si256(_mm256_cvtepi32_ps(u)), 23),
+		_mm256_set1_epi32(127));
+	iexpon = _mm256_min_epi32(iexpon, _mm256_set1_epi32(15));
+	u = _mm256_sllv_epi32(u, _mm256_sub_epi32(_mm256_set1_epi32(15),
+						  iexpon));
+
+	__m256i lo = crush_ln_avx2(
+		_mm256_cvtepu32_epi64(_mm256_castsi256_si128(u)),
+		_mm256_cvtepu32_epi64(_mm256_castsi256_si128(iexpon)));
+	__m256i hi = crush_ln_avx2(
+		_mm256_cvtepu32_epi64(_mm256_extracti128_si256(u, 1)),
+		_mm256_cvtepu32_epi64(_mm256_extracti128_si256(iexpon, 1)));
+	__m256i one = _mm256_set1_epi64x(0x1000000000000ll);
+	_mm256_storeu_si256((__m256i *)ln, _mm256_sub_epi64(lo, one));
+	_mm256_storeu_si256((__m256i *)(ln + 4), _mm256_sub_epi64(hi, one));
+}
+
+void crush_straw2_ln_avx2(__u32 x, const __s32 *ids, __u32 r, __s64 *ln)
+{
+	__m256i u = crush_hash32_rjenkins1_3_avx2(
+		_mm256_set1_epi32(x),
+		_mm256_loadu_si256((const __m256i *)ids),
+		_mm256_set1_epi32(r));
+	crush_straw2_ln_lanes_avx2(
+		_mm256_and_si256(u, _mm256_set1_epi32(0xffff)), ln);
+}
+
+void crush_straw2_ln_u_avx2(const __u32 *u, __s64 *ln)
+{
+	crush_straw2_ln_lanes_avx2(_mm256_loadu_si256((const __m256i *)u), ln);
+}
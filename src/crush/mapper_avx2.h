@@ -0,0 +1,31 @@
+#ifndef CEPH_CRUSH_MAPPER_AVX2_H
+#define CEPH_CRUSH_MAPPER_AVX2_H
+
+/*
+ * AVX2 kernels for the CRUSH mapper, compiled with -mavx2 and only
+ * called when ceph_arch_intel_avx2 says the cpu has it.
+ *
+ * LGPL2
+ */
+
+#include "crush_compat.h"
+
+/* number of bucket items handled by one call */
+#define CRUSH_STRAW2_AVX2_LANES 8
+
+/*
+ * crush_ln(crush_hash32_3(CRUSH_HASH_RJENKINS1, x, ids[i], r) & 0xffff)
+ * - 0x1000000000000 in ln[i], for the CRUSH_STRAW2_AVX2_LANES first
+ * items of ids: the part of the straw2 draw of each item that does not
+ * depend on its weight. Bit identical to the scalar code.
+ */
+extern void crush_straw2_ln_avx2(__u32 x, const __s32 *ids, __u32 r,
+				 __s64 *ln);
+
+/*
+ * crush_straw2_ln(u[i]) in ln[i] for CRUSH_STRAW2_AVX2_LANES hash
+ * values in [0, 0xffff]: the table lookup part of the above.
+ */
+extern void crush_straw2_ln_u_avx2(const __u32 *u, __s64 *ln);
+
+#endif
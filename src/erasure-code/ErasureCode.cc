@@ -112,11 +112,32 @@ int ErasureCode::minimum_to_decode_with_cost(const set<int> &want_to_read,
                                              set<int> *minimum)
 {
   set <int> available_chunks;
+  vector<pair<int, int> > by_cost;
   for (map<int, int>::const_iterator i = available.begin();
        i != available.end();
-       ++i)
+       ++i) {
     available_chunks.insert(i->first);
-  return minimum_to_decode(want_to_read, available_chunks, minimum);
+    by_cost.push_back(make_pair(i->second, i->first));
+  }
+  int r = minimum_to_decode(want_to_read, available_chunks, minimum);
+  if (r)
+    return r;
+  // grow the candidates from the cheapest chunk up until they contain a
+  // subset as small as the one found without looking at the cost
+  sort(by_cost.begin(), by_cost.end());
+  set<int> candidates;
+  for (vector<pair<int, int> >::iterator i = by_cost.begin();
+       i != by_cost.end();
+       ++i) {
+    candidates.insert(i->second);
+    set<int> cheaper;
+    if (minimum_to_decode(want_to_read, candidates, &cheaper) == 0 &&
+	cheaper.size() <= minimum->size()) {
+      minimum->swap(cheaper);
+      break;
+    }
+  }
+  return 0;
 }
 
 int ErasureCode::encode_prepare(const bufferlist &raw,
@@ -320,3 +341,184 @@ int ErasureCode::decode_concat(const map<int, bufferlist> &chunks,
   }
   return r;
 }
+
+int ErasureCode::encode_delta(const map<int, bufferlist> &delta,
+			      map<int, bufferlist> *parity_delta)
+{
+  if (!supports_parity_delta())
+    return -EOPNOTSUPP;
+  if (delta.empty())
+    return -EINVAL;
+  unsigned int k = get_data_chunk_count();
+  unsigned int m = get_chunk_count() - k;
+  unsigned blocksize = delta.begin()->second.length();
+
+  // the code is linear: encoding the changes alone, with the unchanged
+  // data chunks contributing zeros, yields the changes of the coding
+  // chunks
+  map<int, bufferlist> encoded;
+  unsigned int found = 0;
+  for (unsigned int i = 0; i < k; i++) {
+    bufferlist &chunk = encoded[chunk_index(i)];
+    map<int, bufferlist>::const_iterator d = delta.find(chunk_index(i));
+    if (d != delta.end()) {
+      if (d->second.length() != blocksize)
+	return -EINVAL;
+      chunk = d->second;
+      chunk.rebuild_aligned_size_and_memory(blocksize, SIMD_ALIGN);
+      found++;
+    } else {
+      bufferptr buf(buffer::create_aligned(blocksize, SIMD_ALIGN));
+      buf.zero();
+      chunk.push_back(std::move(buf));
+    }
+  }
+  if (found != delta.size())
+    return -EINVAL;
+  set<int> want_to_encode;
+  for (unsigned int i = k; i < k + m; i++) {
+    encoded[chunk_index(i)].push_back(
+      buffer::create_aligned(blocksize, SIMD_ALIGN));
+    want_to_encode.insert(chunk_index(i));
+  }
+  int r = encode_chunks(want_to_encode, &encoded);
+  if (r)
+    return r;
+  for (set<int>::iterator i = want_to_encode.begin();
+       i != want_to_encode.end();
+       ++i) {
+    (*parity_delta)[*i].claim(encoded[*i]);
+  }
+  return 0;
+}
+
+int ErasureCode::encode_stripes(const set<int> &want_to_encode,
+				const bufferlist &in,
+				unsigned int chunk_size,
+				map<int, bufferlist> *encoded)
+{
+  unsigned int k = get_data_chunk_count();
+  unsigned int m = get_chunk_count() - k;
+  unsigned int stripe_width = k * chunk_size;
+  if (chunk_size == 0 || in.length() % stripe_width)
+    return -EINVAL;
+  unsigned int stripes = in.length() / stripe_width;
+  if (stripes == 0)
+    return 0;
+  unsigned int blocksize = stripes * chunk_size;
+
+  // scatter the stripes into one aligned buffer per chunk
+  map<int, bufferlist> chunks;
+  vector<char*> data(k);
+  for (unsigned int i = 0; i < k + m; i++) {
+    bufferptr buf(buffer::create_aligned(blocksize, SIMD_ALIGN));
+    if (i < k)
+      data[i] = buf.c_str();
+    chunks[chunk_index(i)].push_back(std::move(buf));
+  }
+  bufferlist::const_iterator p = in.begin();
+  for (unsigned int s = 0; s < stripes; s++) {
+    for (unsigned int i = 0; i < k; i++)
+      p.copy(chunk_size, data[i] + s * chunk_size);
+  }
+
+  int r = 0;
+  if (stripes == 1 || stripes_are_independent()) {
+    r = encode_chunks(want_to_encode, &chunks);
+  } else {
+    for (unsigned int s = 0; s < stripes && r == 0; s++) {
+      map<int, bufferlist> stripe;
+      for (map<int, bufferlist>::iterator i = chunks.begin();
+	   i != chunks.end();
+	   ++i) {
+	bufferlist &chunk = stripe[i->first];
+	chunk.substr_of(i->second, s * chunk_size, chunk_size);
+	// no-op unless chunk_size is not a multiple of SIMD_ALIGN
+	chunk.rebuild_aligned(SIMD_ALIGN);
+      }
+      r = encode_chunks(want_to_encode, &stripe);
+      for (set<int>::const_iterator i = want_to_encode.begin();
+	   r == 0 && i != want_to_encode.end();
+	   ++i) {
+	char *dest = chunks[*i].c_str() + s * chunk_size;
+	if (stripe[*i].c_str() != dest)
+	  stripe[*i].copy(0, chunk_size, dest);
+      }
+    }
+  }
+  if (r)
+    return r;
+  for (set<int>::const_iterator i = want_to_encode.begin();
+       i != want_to_encode.end();
+       ++i) {
+    (*encoded)[*i].claim_append(chunks[*i]);
+  }
+  return 0;
+}
+
+int ErasureCode::decode_stripes(const set<int> &want_to_read,
+				const map<int, bufferlist> &chunks,
+				unsigned int chunk_size,
+				map<int, bufferlist> *decoded)
+{
+  if (chunks.empty() || chunk_size == 0)
+    return -EINVAL;
+  unsigned blocksize = chunks.begin()->second.length();
+  if (blocksize % chunk_size)
+    return -EINVAL;
+  for (map<int, bufferlist>::const_iterator i = chunks.begin();
+       i != chunks.end();
+       ++i) {
+    if (i->second.length() != blocksize)
+      return -EINVAL;
+  }
+  if (blocksize == 0)
+    return 0;
+  if (blocksize == chunk_size || stripes_are_independent())
+    return decode(want_to_read, chunks, decoded);
+
+  for (unsigned int off = 0; off < blocksize; off += chunk_size) {
+    map<int, bufferlist> stripe;
+    for (map<int, bufferlist>::const_iterator i = chunks.begin();
+	 i != chunks.end();
+	 ++i) {
+      stripe[i->first].substr_of(i->second, off, chunk_size);
+    }
+    map<int, bufferlist> stripe_decoded;
+    int r = decode(want_to_read, stripe, &stripe_decoded);
+    if (r)
+      return r;
+    for (set<int>::const_iterator i = want_to_read.begin();
+	 i != want_to_read.end();
+	 ++i) {
+      (*decoded)[*i].claim_append(stripe_decoded[*i]);
+    }
+  }
+  return 0;
+}
+
+int ErasureCode::minimum_to_decode_sub_chunks(
+  const set<int> &want_to_read,
+  const set<int> &available,
+  map<int, vector<pair<int, int> > > *minimum)
+{
+  set<int> minimum_chunks;
+  int r = minimum_to_decode(want_to_read, available, &minimum_chunks);
+  if (r)
+    return r;
+  vector<pair<int, int> > all(1, make_pair(0, (int)get_sub_chunk_count()));
+  for (set<int>::iterator i = minimum_chunks.begin();
+       i != minimum_chunks.end();
+       ++i) {
+    (*minimum)[*i] = all;
+  }
+  return 0;
+}
+
+int ErasureCode::decode_sub_chunks(const set<int> &want_to_read,
+				   const map<int, bufferlist> &chunks,
+				   unsigned int chunk_size,
+				   map<int, bufferlist> *decoded)
+{
+  return decode_stripes(want_to_read, chunks, chunk_size, decoded);
+}
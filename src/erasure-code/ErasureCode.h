@@ -108,10 +108,51 @@ namespace ceph {
     int decode_concat(const std::map<int, bufferlist> &chunks,
 			      bufferlist *decoded) override;
 
+    bool supports_parity_delta() const override {
+      return false;
+    }
+
+    int encode_delta(const std::map<int, bufferlist> &delta,
+		     std::map<int, bufferlist> *parity_delta) override;
+
+    int encode_stripes(const std::set<int> &want_to_encode,
+		       const bufferlist &in,
+		       unsigned int chunk_size,
+		       std::map<int, bufferlist> *encoded) override;
+
+    int decode_stripes(const std::set<int> &want_to_read,
+		       const std::map<int, bufferlist> &chunks,
+		       unsigned int chunk_size,
+		       std::map<int, bufferlist> *decoded) override;
+
+    unsigned int get_sub_chunk_count() const override {
+      return 1;
+    }
+
+    int minimum_to_decode_sub_chunks(
+      const std::set<int> &want_to_read,
+      const std::set<int> &available,
+      std::map<int, std::vector<std::pair<int, int> > > *minimum) override;
+
+    int decode_sub_chunks(const std::set<int> &want_to_read,
+			  const std::map<int, bufferlist> &chunks,
+			  unsigned int chunk_size,
+			  std::map<int, bufferlist> *decoded) override;
+
   protected:
     int parse(const ErasureCodeProfile &profile,
 	      std::ostream *ss);
 
+    /**
+     * Return true if encode_chunks and decode_chunks give the same
+     * result on chunks holding several stripes back to back as they
+     * do on each stripe separately, so that encode_stripes and
+     * decode_stripes can process all stripes in one call.
+     */
+    virtual bool stripes_are_independent() const {
+      return false;
+    }
+
   private:
     int chunk_index(unsigned int i) const;
   };
@@ -0,0 +1,229 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t -*-
+// vim: ts=8 sw=2 smarttab
+/*
+ * Ceph distributed storage system
+ *
+ *  This library is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Lesser General Public
+ *  License as published by the Free Software Foundation; either
+ *  version 2.1 of the License, or (at your option) any later version.
+ *
+ */
+
+#include <thread>
+#include <vector>
+
+#include "ErasureCodeDecodeTableCache.h"
+
+using namespace std;
+using namespace ceph;
+
+// at least twice as many slots as tables so that probes stay short
+static size_t slot_count(unsigned max_tables)
+{
+  size_t slots = 16;
+  while (slots < 2 * (size_t)max_tables)
+    slots <<= 1;
+  return slots;
+}
+
+ErasureCodeDecodeTableCache::Table::Table(size_t mask)
+  : mask(mask),
+    slots(new std::atomic<Entry*>[mask + 1]),
+    count(0)
+{
+  for (size_t i = 0; i <= mask; i++)
+    slots[i].store(nullptr, std::memory_order_relaxed);
+}
+
+ErasureCodeDecodeTableCache::Table::~Table()
+{
+  delete[] slots;
+}
+
+/*
+ * Registers a lookup or insertion in the readers of the current epoch.
+ * An eviction publishes the new Table, bumps the epoch and then waits
+ * for the readers of the previous epoch: whoever registered in time
+ * is waited for, whoever did not sees the new epoch, retries and can
+ * only load the new Table.
+ */
+class ErasureCodeDecodeTableCache::Guard {
+  const ErasureCodeDecodeTableCache &cache;
+  unsigned e;
+public:
+  explicit Guard(const ErasureCodeDecodeTableCache &c) : cache(c) {
+    while (true) {
+      e = cache.epoch.load();
+      cache.readers[e & 1]++;
+      if (cache.epoch.load() == e)
+	break;
+      cache.readers[e & 1]--;
+    }
+  }
+  ~Guard() {
+    cache.readers[e & 1]--;
+  }
+};
+
+ErasureCodeDecodeTableCache::ErasureCodeDecodeTableCache(unsigned max_tables)
+  : max_tables(max_tables),
+    current(new Table(slot_count(max_tables) - 1)),
+    epoch(0)
+{
+  readers[0] = 0;
+  readers[1] = 0;
+}
+
+ErasureCodeDecodeTableCache::~ErasureCodeDecodeTableCache()
+{
+  Table *t = current.load(std::memory_order_relaxed);
+  for (size_t i = 0; i <= t->mask; i++)
+    delete t->slots[i].load(std::memory_order_relaxed);
+  delete t;
+}
+
+unsigned ErasureCodeDecodeTableCache::size() const
+{
+  Guard g(*this);
+  return current.load()->count;
+}
+
+ErasureCodeDecodeTableCache::Entry *ErasureCodeDecodeTableCache::find(
+  const Table *t, const string &signature) const
+{
+  for (size_t i = std::hash<string>()(signature) & t->mask;
+       ;
+       i = (i + 1) & t->mask) {
+    Entry *entry = t->slots[i].load(std::memory_order_acquire);
+    if (!entry || entry->signature == signature)
+      return entry;
+  }
+}
+
+bool ErasureCodeDecodeTableCache::get(const string &signature,
+				      bufferptr *table) const
+{
+  Guard g(*this);
+  Entry *entry = find(current.load(), signature);
+  if (!entry)
+    return false;
+  // only write the flag once per sweep, lookups are mostly hits
+  if (!entry->referenced.load(std::memory_order_relaxed))
+    entry->referenced.store(true, std::memory_order_relaxed);
+  *table = entry->table;
+  return true;
+}
+
+/*
+ * Insert into **t**, unless **signature** is there already.
+ *
+ * @return the entry for **signature**, nullptr if **t** is full
+ */
+ErasureCodeDecodeTableCache::Entry *ErasureCodeDecodeTableCache::insert(
+  Table *t, const string &signature, const bufferptr &table)
+{
+  // reserve room first: with fewer tables than slots the probe below
+  // always finds a free one
+  if (t->count.fetch_add(1) >= max_tables) {
+    t->count--;
+    return find(t, signature);
+  }
+
+  Entry *entry = new Entry(signature, table);
+  for (size_t i = std::hash<string>()(signature) & t->mask;
+       ;
+       i = (i + 1) & t->mask) {
+    Entry *expected = nullptr;
+    if (t->slots[i].compare_exchange_strong(expected, entry,
+					    std::memory_order_acq_rel))
+      return entry;
+    if (expected->signature == signature) {
+      t->count--;
+      delete entry;
+      return expected;
+    }
+  }
+}
+
+bufferptr ErasureCodeDecodeTableCache::put(const string &signature,
+					   const bufferptr &table)
+{
+  if (!max_tables)
+    return table;
+  while (true) {
+    {
+      Guard g(*this);
+      Entry *entry = insert(current.load(), signature, table);
+      if (entry)
+	return entry->table;
+    }
+    evict();
+  }
+}
+
+void ErasureCodeDecodeTableCache::evict()
+{
+  std::lock_guard<std::mutex> l(evict_lock);
+  Table *old = current.load();
+  if (old->count < max_tables)
+    return;  // another thread evicted first
+
+  // second chance: keep what was looked up since the last eviction
+  Table *t = new Table(old->mask);
+  set<Entry*> kept;
+  for (size_t i = 0; i <= old->mask && kept.size() < max_tables / 2; i++) {
+    Entry *entry = old->slots[i].load();
+    if (!entry || !entry->referenced.load())
+      continue;
+    entry->referenced.store(false);
+    for (size_t j = std::hash<string>()(entry->signature) & t->mask;
+	 ;
+	 j = (j + 1) & t->mask) {
+      if (!t->slots[j].load(std::memory_order_relaxed)) {
+	t->slots[j].store(entry, std::memory_order_relaxed);
+	break;
+      }
+    }
+    kept.insert(entry);
+  }
+  t->count = kept.size();
+  current.store(t);
+
+  unsigned e = epoch.load();
+  epoch.store(e + 1);
+  while (readers[e & 1].load())
+    std::this_thread::yield();
+
+  // nothing reads the old table now, including entries inserted into
+  // it while it was being copied
+  for (size_t i = 0; i <= old->mask; i++) {
+    Entry *entry = old->slots[i].load();
+    if (entry && !kept.count(entry))
+      delete entry;
+  }
+  delete old;
+}
+
+void ErasureCodeDecodeTableCache::for_each_erasure(
+  int chunk_count,
+  int erasures,
+  const std::function<void(const set<int>&)> &f)
+{
+  if (erasures <= 0 || erasures > chunk_count)
+    return;
+  vector<int> chunks(erasures);
+  for (int i = 0; i < erasures; i++)
+    chunks[i] = i;
+  while (true) {
+    f(set<int>(chunks.begin(), chunks.end()));
+    int i = erasures - 1;
+    while (i >= 0 && chunks[i] == chunk_count - erasures + i)
+      i--;
+    if (i < 0)
+      return;
+    chunks[i]++;
+    for (int j = i + 1; j < erasures; j++)
+      chunks[j] = chunks[j - 1] + 1;
+  }
+}
@@ -0,0 +1,124 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t -*-
+// vim: ts=8 sw=2 smarttab
+/*
+ * Ceph distributed storage system
+ *
+ *  This library is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Lesser General Public
+ *  License as published by the Free Software Foundation; either
+ *  version 2.1 of the License, or (at your option) any later version.
+ *
+ */
+
+#ifndef CEPH_ERASURE_CODE_DECODE_TABLE_CACHE_H
+#define CEPH_ERASURE_CODE_DECODE_TABLE_CACHE_H
+
+/*! @file ErasureCodeDecodeTableCache.h
+    @brief Decoding tables shared by the instances of a plugin
+
+ */
+
+#include <atomic>
+#include <functional>
+#include <mutex>
+#include <set>
+#include <string>
+
+#include "include/buffer.h"
+
+namespace ceph {
+
+  /**
+   * Cache of decoding tables (inverted matrices, multiplication
+   * tables, ...) by signature. The signature is chosen by the plugin
+   * and must name both the profile and the erasure pattern the table
+   * decodes, so that every instance of the plugin, one per PG, can
+   * share the tables of the others.
+   *
+   * Lookups and insertions are lock free: the tables are held in an
+   * open addressing hash table of atomic pointers and a cached table
+   * is never modified. The tables must be treated as read only.
+   *
+   * When **max_tables** are cached, the next insertion evicts with a
+   * single second chance sweep: the tables looked up since the
+   * previous eviction, up to half of **max_tables**, are moved to a
+   * fresh hash table which replaces the current one, and the others
+   * are dropped. Evictions are serialized by a mutex and wait for the
+   * lookups still reading the replaced hash table before freeing it.
+   */
+  class ErasureCodeDecodeTableCache {
+  public:
+    explicit ErasureCodeDecodeTableCache(unsigned max_tables);
+    ~ErasureCodeDecodeTableCache();
+
+    ErasureCodeDecodeTableCache(const ErasureCodeDecodeTableCache&) = delete;
+    ErasureCodeDecodeTableCache& operator=(
+      const ErasureCodeDecodeTableCache&) = delete;
+
+    /**
+     * Set **table** to the table cached for **signature**.
+     *
+     * @return true if there is one, false otherwise
+     */
+    bool get(const std::string &signature, bufferptr *table) const;
+
+    /**
+     * Cache **table** for **signature** unless another thread did
+     * it first, evicting tables if the cache is full.
+     *
+     * @return the table cached for **signature**
+     */
+    bufferptr put(const std::string &signature, const bufferptr &table);
+
+    unsigned size() const;
+
+    unsigned get_max_tables() const {
+      return max_tables;
+    }
+
+    /**
+     * Call **f** with every set of **erasures** chunks out of
+     * **chunk_count**, in lexicographic order. Used to compute the
+     * tables of the most likely erasure patterns when a profile is
+     * loaded, instead of on the first degraded read.
+     */
+    static void for_each_erasure(
+      int chunk_count,
+      int erasures,
+      const std::function<void(const std::set<int>&)> &f);
+
+  private:
+    struct Entry {
+      const std::string signature;
+      const bufferptr table;
+      std::atomic<bool> referenced;  ///< looked up since the last eviction
+      Entry(const std::string &s, const bufferptr &t)
+	: signature(s), table(t), referenced(false) {}
+    };
+
+    struct Table {
+      const size_t mask;
+      std::atomic<Entry*> *slots;
+      std::atomic<unsigned> count;
+      explicit Table(size_t mask);
+      ~Table();
+    };
+
+    /// pins the current Table against eviction for its lifetime
+    class Guard;
+
+    Entry *find(const Table *t, const std::string &signature) const;
+    Entry *insert(Table *t, const std::string &signature,
+		  const bufferptr &table);
+    void evict();
+
+    const unsigned max_tables;
+    std::atomic<Table*> current;
+    /// bumped by every eviction; lookups register in readers[epoch & 1]
+    std::atomic<unsigned> epoch;
+    mutable std::atomic<unsigned> readers[2];
+    std::mutex evict_lock;
+  };
+}
+
+#endif
@@ -446,6 +446,134 @@ namespace ceph {
      */
     virtual int decode_concat(const std::map<int, bufferlist> &chunks,
 			      bufferlist *decoded) = 0;
+
+    /**
+     * Return true if the coding chunks are a linear function of the
+     * data chunks over GF(2^w), i.e. encoding the XOR of two inputs
+     * gives the XOR of their coding chunks. Such codes can update
+     * the coding chunks of a stripe with **encode_delta** after some
+     * of its data chunks changed, without reading the others.
+     *
+     * @return **true** if **encode_delta** is supported
+     */
+    virtual bool supports_parity_delta() const = 0;
+
+    /**
+     * Compute the change of every coding chunk caused by changing
+     * the data chunks listed in **delta**, which maps the chunk
+     * index of each changed data chunk to the XOR of its old and
+     * new content. All buffers have the same size, which must be
+     * valid for **encode_chunks**.
+     *
+     * On success **parity_delta** maps each coding chunk index to
+     * the buffer to XOR into the old coding chunk.
+     *
+     * @param [in] delta map changed data chunk indexes to old ^ new
+     * @param [out] parity_delta map coding chunk indexes to their change
+     * @return **0** on success or a negative errno on error.
+     */
+    virtual int encode_delta(const std::map<int, bufferlist> &delta,
+			     std::map<int, bufferlist> *parity_delta) = 0;
+
+    /**
+     * Encode **in**, made of consecutive stripes of
+     * **chunk_size** * **get_data_chunk_count()** bytes each. The
+     * result is the same as calling **encode** on every stripe and
+     * appending each chunk to the chunk of the same index in
+     * **encoded**: on success, every chunk in **encoded** holds the
+     * chunks of all stripes back to back in one contiguous, aligned
+     * buffer.
+     *
+     * **chunk_size** must be a value returned by **get_chunk_size**
+     * so that a stripe needs no padding. Plugins whose
+     * **encode_chunks** works on such back to back chunks as if
+     * they were one larger chunk encode all stripes in a single
+     * call.
+     *
+     * @param [in] want_to_encode chunk indexes to be encoded
+     * @param [in] in data to be encoded, a multiple of the stripe width
+     * @param [in] chunk_size size of the chunk of a single stripe
+     * @param [out] encoded map chunk indexes to all their stripes
+     * @return **0** on success or a negative errno on error.
+     */
+    virtual int encode_stripes(const std::set<int> &want_to_encode,
+			       const bufferlist &in,
+			       unsigned int chunk_size,
+			       std::map<int, bufferlist> *encoded) = 0;
+
+    /**
+     * Decode the chunks listed in **want_to_read** for consecutive
+     * stripes. Every buffer in **chunks** holds the chunks of the
+     * same stripes back to back, **chunk_size** bytes per stripe.
+     * The result is the same as calling **decode** on every stripe
+     * and appending each decoded chunk to the chunk of the same index
+     * in **decoded**.
+     *
+     * @param [in] want_to_read chunk indexes to be decoded
+     * @param [in] chunks map chunk indexes to all their stripes
+     * @param [in] chunk_size size of the chunk of a single stripe
+     * @param [out] decoded map chunk indexes to all their stripes
+     * @return **0** on success or a negative errno on error.
+     */
+    virtual int decode_stripes(const std::set<int> &want_to_read,
+			       const std::map<int, bufferlist> &chunks,
+			       unsigned int chunk_size,
+			       std::map<int, bufferlist> *decoded) = 0;
+
+    /**
+     * Return the number of sub-chunks each chunk is divided into.
+     * Codes that do not divide chunks return **1**. A code with more
+     * than one sub-chunk may be able to rebuild a lost chunk by
+     * reading only some of the sub-chunks of the chunks it reads.
+     *
+     * @return the number of sub-chunks in a chunk
+     */
+    virtual unsigned int get_sub_chunk_count() const = 0;
+
+    /**
+     * Compute the chunks and the sub-chunk ranges within each of
+     * them that need to be retrieved in order to decode
+     * **want_to_read** chunks. Every range is a pair of the index of
+     * the first sub-chunk and the number of consecutive sub-chunks.
+     * A chunk that must be read entirely is mapped to the single
+     * range **(0, get_sub_chunk_count())**.
+     *
+     * Returns -EIO if there are not enough chunk indexes in
+     * **available** to decode **want_to_read**.
+     *
+     * @param [in] want_to_read chunk indexes to be decoded
+     * @param [in] available chunk indexes containing valid data
+     * @param [out] minimum map chunk indexes to the sub-chunk ranges
+     *              to retrieve
+     * @return **0** on success or a negative errno on error.
+     */
+    virtual int minimum_to_decode_sub_chunks(
+      const std::set<int> &want_to_read,
+      const std::set<int> &available,
+      std::map<int, std::vector<std::pair<int, int> > > *minimum) = 0;
+
+    /**
+     * Decode the chunks listed in **want_to_read** from the sub-chunk
+     * ranges returned by **minimum_to_decode_sub_chunks** for the
+     * same **want_to_read**. The keys of **chunks** must be the keys
+     * of the map returned by **minimum_to_decode_sub_chunks** and each
+     * buffer holds the requested sub-chunks of one or more
+     * consecutive stripes, in order and back to back. **chunk_size**
+     * is the size of a whole chunk of a single stripe.
+     *
+     * The **decoded** map holds the whole decoded chunks of every
+     * stripe, as **decode_stripes** would return them.
+     *
+     * @param [in] want_to_read chunk indexes to be decoded
+     * @param [in] chunks map chunk indexes to the sub-chunks read
+     * @param [in] chunk_size size of a whole chunk of a single stripe
+     * @param [out] decoded map chunk indexes to all their stripes
+     * @return **0** on success or a negative errno on error.
+     */
+    virtual int decode_sub_chunks(const std::set<int> &want_to_read,
+				  const std::map<int, bufferlist> &chunks,
+				  unsigned int chunk_size,
+				  std::map<int, bufferlist> *decoded) = 0;
   };
 
   typedef std::shared_ptr<ErasureCodeInterface> ErasureCodeInterfaceRef;
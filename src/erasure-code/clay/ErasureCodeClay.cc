@@ -0,0 +1,696 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t -*-
+// vim: ts=8 sw=2 smarttab
+/*
+ * Ceph distributed storage system
+ *
+ *  This library is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Lesser General Public
+ *  License as published by the Free Software Foundation; either
+ *  version 2.1 of the License, or (at your option) any later version.
+ *
+ */
+
+#include <errno.h>
+#include <algorithm>
+
+#include "common/debug.h"
+#include "include/intarith.h"
+#include "include/stringify.h"
+#include "erasure-code/ErasureCodePlugin.h"
+
+#include "ErasureCodeClay.h"
+
+// re-include our assert to clobber boost's
+#include "include/assert.h"
+
+#define dout_context g_ceph_context
+#define dout_subsys ceph_subsys_osd
+#undef dout_prefix
+#define dout_prefix _prefix(_dout)
+
+using namespace std;
+
+static ostream& _prefix(std::ostream* _dout)
+{
+  return *_dout << "ErasureCodeClay: ";
+}
+
+static int pow_int(int a, int x)
+{
+  int power = 1;
+  while (x) {
+    if (x & 1)
+      power *= a;
+    x /= 2;
+    a *= a;
+  }
+  return power;
+}
+
+static bufferlist aligned_buffer(unsigned len)
+{
+  bufferlist bl;
+  bl.push_back(buffer::create_aligned(len, ErasureCode::SIMD_ALIGN));
+  return bl;
+}
+
+static bufferlist zero_buffer(unsigned len)
+{
+  bufferptr ptr(buffer::create_aligned(len, ErasureCode::SIMD_ALIGN));
+  ptr.zero();
+  bufferlist bl;
+  bl.push_back(ptr);
+  return bl;
+}
+
+//
+// The sub-chunks are updated in place through slices of their
+// chunk: every chunk must be a single aligned buffer.
+//
+static void make_contiguous(bufferlist &bl)
+{
+  if (bl.is_contiguous() && bl.is_aligned(ErasureCode::SIMD_ALIGN))
+    return;
+  bufferptr ptr(buffer::create_aligned(bl.length(), ErasureCode::SIMD_ALIGN));
+  bl.copy(0, bl.length(), ptr.c_str());
+  bl.clear();
+  bl.push_back(ptr);
+}
+
+static bufferlist sub_chunk(const bufferlist &chunk, int z, unsigned sc_size)
+{
+  bufferlist bl;
+  bl.substr_of(chunk, z * sc_size, sc_size);
+  return bl;
+}
+
+//
+// The pairwise transform couples sub-chunk z of node (x, y) with
+// sub-chunk z_sw of node (z_y, y). Its four positions hold, in order,
+// the coupled and the uncoupled sub-chunks of the node with the
+// smallest x, then of the node with the largest x. Return the
+// positions of C(x, y), C(z_y, y), U(x, y) and U(z_y, y) in **pos**.
+//
+static void set_pft_chunks(int x, int z_y,
+			   const bufferlist &c_xy, const bufferlist &c_sw,
+			   const bufferlist &u_xy, const bufferlist &u_sw,
+			   int pos[4],
+			   map<int, bufferlist> *pft_chunks)
+{
+  if (z_y > x) {
+    pos[0] = 1; pos[1] = 0; pos[2] = 3; pos[3] = 2;
+  } else {
+    pos[0] = 0; pos[1] = 1; pos[2] = 2; pos[3] = 3;
+  }
+  pft_chunks->clear();
+  (*pft_chunks)[pos[0]] = c_xy;
+  (*pft_chunks)[pos[1]] = c_sw;
+  (*pft_chunks)[pos[2]] = u_xy;
+  (*pft_chunks)[pos[3]] = u_sw;
+}
+
+int ErasureCodeClay::init(ErasureCodeProfile &profile,
+			  ostream *ss)
+{
+  int r = parse(profile, ss);
+  if (r)
+    return r;
+
+  r = ErasureCode::init(profile, ss);
+  if (r)
+    return r;
+
+  ErasureCodePluginRegistry &registry = ErasureCodePluginRegistry::instance();
+  r = registry.factory(mds.profile["plugin"],
+		       directory,
+		       mds.profile,
+		       &mds.erasure_code,
+		       ss);
+  if (r)
+    return r;
+  r = registry.factory(pft.profile["plugin"],
+		       directory,
+		       pft.profile,
+		       &pft.erasure_code,
+		       ss);
+  if (r)
+    return r;
+
+  dout(10) << "init k=" << k << " m=" << m << " d=" << d
+	   << " q=" << q << " t=" << t << " nu=" << nu
+	   << " sub_chunk_no=" << sub_chunk_no << dendl;
+  return 0;
+}
+
+int ErasureCodeClay::parse(ErasureCodeProfile &profile,
+			   ostream *ss)
+{
+  int err = 0;
+  err |= to_int("k", profile, &k, DEFAULT_K, ss);
+  err |= to_int("m", profile, &m, DEFAULT_M, ss);
+  err |= sanity_check_k(k, ss);
+  err |= to_int("d", profile, &d, stringify(k + m - 1), ss);
+
+  string scalar_mds;
+  string technique;
+  err |= to_string("scalar_mds", profile, &scalar_mds, "jerasure", ss);
+  if (scalar_mds == "jerasure") {
+    err |= to_string("technique", profile, &technique, "reed_sol_van", ss);
+    if (technique != "reed_sol_van" &&
+	technique != "cauchy_orig" &&
+	technique != "cauchy_good") {
+      *ss << "technique=" << technique << " is not supported by"
+	  << " scalar_mds=jerasure, use one of reed_sol_van, cauchy_orig,"
+	  << " cauchy_good" << std::endl;
+      err = -EINVAL;
+    }
+  } else if (scalar_mds == "isa") {
+    err |= to_string("technique", profile, &technique, "reed_sol_van", ss);
+    if (technique != "reed_sol_van" &&
+	technique != "cauchy") {
+      *ss << "technique=" << technique << " is not supported by"
+	  << " scalar_mds=isa, use one of reed_sol_van, cauchy" << std::endl;
+      err = -EINVAL;
+    }
+  } else {
+    *ss << "scalar_mds=" << scalar_mds << " is not supported,"
+	<< " use one of jerasure, isa" << std::endl;
+    err = -EINVAL;
+  }
+  if (err)
+    return err;
+
+  if (d < k + 1 || d > k + m - 1) {
+    *ss << "d=" << d << " must be within [" << k + 1 << ","
+	<< k + m - 1 << "]" << std::endl;
+    return -EINVAL;
+  }
+
+  q = d - k + 1;
+  nu = (k + m) % q ? q - (k + m) % q : 0;
+  t = (k + m + nu) / q;
+  sub_chunk_no = pow_int(q, t);
+
+  mds.profile["plugin"] = scalar_mds;
+  mds.profile["technique"] = technique;
+  mds.profile["k"] = stringify(k + nu);
+  mds.profile["m"] = stringify(m);
+  mds.profile["w"] = "8";
+
+  pft.profile["plugin"] = scalar_mds;
+  pft.profile["technique"] = technique;
+  pft.profile["k"] = "2";
+  pft.profile["m"] = "2";
+  pft.profile["w"] = "8";
+
+  return 0;
+}
+
+unsigned int ErasureCodeClay::get_chunk_size(unsigned int object_size) const
+{
+  // every sub-chunk must satisfy the alignment of both scalar codes
+  unsigned alignment_scalar_code =
+    std::max(mds.erasure_code->get_chunk_size(1),
+	     pft.erasure_code->get_chunk_size(1));
+  unsigned alignment = sub_chunk_no * k * alignment_scalar_code;
+  return ROUND_UP_TO(object_size, alignment) / k;
+}
+
+void ErasureCodeClay::get_plane_vector(int z, vector<int> *z_vec) const
+{
+  z_vec->resize(t);
+  for (int i = 0; i < t; i++) {
+    (*z_vec)[t - 1 - i] = z % q;
+    z /= q;
+  }
+}
+
+bool ErasureCodeClay::is_repair(const set<int> &want_to_read,
+				const set<int> &available) const
+{
+  if (want_to_read.size() != 1)
+    return false;
+  int lost_chunk = *want_to_read.begin();
+  if (available.count(lost_chunk))
+    return false;
+  if ((int)available.size() < d)
+    return false;
+  // every other node of the row of the lost node must be a helper
+  int lost_node = to_node(lost_chunk);
+  for (int x = 0; x < q; x++) {
+    int node = lost_node - lost_node % q + x;
+    if (node == lost_node || (node >= k && node < k + nu))
+      continue;
+    int chunk = node < k ? node : node - nu;
+    if (!available.count(chunk))
+      return false;
+  }
+  return true;
+}
+
+void ErasureCodeClay::get_repair_sub_chunks(
+  int lost_chunk,
+  vector<pair<int, int> > *repair_sub_chunks) const
+{
+  int lost_node = to_node(lost_chunk);
+  int y = lost_node / q;
+  int x = lost_node % q;
+  int seq_sc_count = pow_int(q, t - 1 - y);
+  int num_seq = pow_int(q, y);
+  int index = x * seq_sc_count;
+  for (int i = 0; i < num_seq; i++) {
+    repair_sub_chunks->push_back(make_pair(index, seq_sc_count));
+    index += q * seq_sc_count;
+  }
+}
+
+int ErasureCodeClay::get_repair_sub_chunk_count() const
+{
+  return sub_chunk_no / q;
+}
+
+int ErasureCodeClay::minimum_to_repair(
+  int lost_chunk,
+  const set<int> &available,
+  map<int, vector<pair<int, int> > > *minimum) const
+{
+  vector<pair<int, int> > repair_sub_chunks;
+  get_repair_sub_chunks(lost_chunk, &repair_sub_chunks);
+  int lost_node = to_node(lost_chunk);
+  for (int x = 0; x < q; x++) {
+    int node = lost_node - lost_node % q + x;
+    if (node == lost_node || (node >= k && node < k + nu))
+      continue;
+    (*minimum)[node < k ? node : node - nu] = repair_sub_chunks;
+  }
+  for (set<int>::const_iterator i = available.begin();
+       i != available.end() && (int)minimum->size() < d;
+       ++i) {
+    if (!minimum->count(*i))
+      (*minimum)[*i] = repair_sub_chunks;
+  }
+  if ((int)minimum->size() != d)
+    return -EIO;
+  return 0;
+}
+
+int ErasureCodeClay::minimum_to_decode_sub_chunks(
+  const set<int> &want_to_read,
+  const set<int> &available,
+  map<int, vector<pair<int, int> > > *minimum)
+{
+  if (is_repair(want_to_read, available))
+    return minimum_to_repair(*want_to_read.begin(), available, minimum);
+  return ErasureCode::minimum_to_decode_sub_chunks(want_to_read,
+						   available,
+						   minimum);
+}
+
+int ErasureCodeClay::encode_chunks(const set<int> &want_to_encode,
+				   map<int, bufferlist> *encoded)
+{
+  unsigned chunk_size = encoded->begin()->second.length();
+  map<int, bufferlist> nodes;
+  set<int> parity_nodes;
+  for (int i = 0; i < k + m; i++) {
+    make_contiguous((*encoded)[i]);
+    nodes[to_node(i)] = (*encoded)[i];
+    if (i >= k)
+      parity_nodes.insert(to_node(i));
+  }
+  for (int i = k; i < k + nu; i++)
+    nodes[i] = zero_buffer(chunk_size);
+  return decode_layered(parity_nodes, &nodes);
+}
+
+int ErasureCodeClay::decode_chunks(const set<int> &want_to_read,
+				   const map<int, bufferlist> &chunks,
+				   map<int, bufferlist> *decoded)
+{
+  unsigned chunk_size = decoded->begin()->second.length();
+  map<int, bufferlist> nodes;
+  set<int> erased_nodes;
+  for (int i = 0; i < k + m; i++) {
+    if (chunks.find(i) == chunks.end())
+      erased_nodes.insert(to_node(i));
+    make_contiguous((*decoded)[i]);
+    nodes[to_node(i)] = (*decoded)[i];
+  }
+  if ((int)erased_nodes.size() > m)
+    return -EIO;
+  for (int i = k; i < k + nu; i++)
+    nodes[i] = zero_buffer(chunk_size);
+  assert(erased_nodes.size() > 0);
+  return decode_layered(erased_nodes, &nodes);
+}
+
+int ErasureCodeClay::decode_sub_chunks(const set<int> &want_to_read,
+				       const map<int, bufferlist> &chunks,
+				       unsigned int chunk_size,
+				       map<int, bufferlist> *decoded)
+{
+  set<int> available;
+  for (map<int, bufferlist>::const_iterator i = chunks.begin();
+       i != chunks.end();
+       ++i) {
+    available.insert(i->first);
+  }
+  if (!is_repair(want_to_read, available) || (int)available.size() != d)
+    return ErasureCode::decode_sub_chunks(want_to_read, chunks,
+					  chunk_size, decoded);
+
+  if (chunk_size == 0 || chunk_size % sub_chunk_no)
+    return -EINVAL;
+  unsigned repair_size = chunk_size / q;
+  unsigned blocksize = chunks.begin()->second.length();
+  if (blocksize % repair_size)
+    return -EINVAL;
+  for (map<int, bufferlist>::const_iterator i = chunks.begin();
+       i != chunks.end();
+       ++i) {
+    if (i->second.length() != blocksize)
+      return -EINVAL;
+  }
+
+  int lost_chunk = *want_to_read.begin();
+  for (unsigned off = 0; off < blocksize; off += repair_size) {
+    map<int, bufferlist> helpers;
+    for (map<int, bufferlist>::const_iterator i = chunks.begin();
+	 i != chunks.end();
+	 ++i) {
+      helpers[i->first].substr_of(i->second, off, repair_size);
+    }
+    bufferlist repaired;
+    int r = repair_one_lost_chunk(lost_chunk, helpers, chunk_size, &repaired);
+    if (r)
+      return r;
+    (*decoded)[lost_chunk].claim_append(repaired);
+  }
+  return 0;
+}
+
+int ErasureCodeClay::repair_one_lost_chunk(int lost_chunk,
+					   const map<int, bufferlist> &helpers,
+					   unsigned int chunk_size,
+					   bufferlist *repaired)
+{
+  unsigned sc_size = chunk_size / sub_chunk_no;
+  unsigned repair_size = chunk_size / q;
+  int lost_node = to_node(lost_chunk);
+  int lost_y = lost_node / q;
+
+  // the helpers hold the repair planes back to back
+  vector<pair<int, int> > repair_sub_chunks;
+  get_repair_sub_chunks(lost_chunk, &repair_sub_chunks);
+  map<int, int> plane_index;
+  int n = 0;
+  for (vector<pair<int, int> >::iterator i = repair_sub_chunks.begin();
+       i != repair_sub_chunks.end();
+       ++i) {
+    for (int z = i->first; z < i->first + i->second; z++)
+      plane_index[z] = n++;
+  }
+
+  map<int, bufferlist> helper_nodes;
+  for (map<int, bufferlist>::const_iterator i = helpers.begin();
+       i != helpers.end();
+       ++i) {
+    bufferlist bl = i->second;
+    make_contiguous(bl);
+    helper_nodes[to_node(i->first)] = bl;
+  }
+  for (int i = k; i < k + nu; i++)
+    helper_nodes[i] = zero_buffer(repair_size);
+
+  // the nodes that are neither lost nor helpers are aloof
+  set<int> aloof_nodes;
+  for (int i = 0; i < k + m; i++) {
+    int node = to_node(i);
+    if (node != lost_node && !helper_nodes.count(node))
+      aloof_nodes.insert(node);
+  }
+  set<int> erasures(aloof_nodes);
+  for (int x = 0; x < q; x++)
+    erasures.insert(lost_y * q + x);
+  if ((int)erasures.size() > m)
+    return -EIO;
+
+  map<int, bufferlist> uncoupled;
+  for (int i = 0; i < q * t; i++)
+    uncoupled[i] = aligned_buffer(chunk_size);
+  bufferlist result = aligned_buffer(chunk_size);
+  bufferlist scratch = aligned_buffer(sc_size);
+
+  // planes with fewer aloof nodes at their crossing point first
+  vector<int> z_vec;
+  map<int, set<int> > ordered_planes;
+  for (map<int, int>::iterator p = plane_index.begin();
+       p != plane_index.end();
+       ++p) {
+    get_plane_vector(p->first, &z_vec);
+    int order = 1;
+    for (set<int>::iterator i = aloof_nodes.begin();
+	 i != aloof_nodes.end();
+	 ++i) {
+      if (*i % q == z_vec[*i / q])
+	order++;
+    }
+    ordered_planes[order].insert(p->first);
+  }
+
+  int pos[4];
+  map<int, bufferlist> pft_chunks;
+  set<int> pft_erasures;
+  for (map<int, set<int> >::iterator o = ordered_planes.begin();
+       o != ordered_planes.end();
+       ++o) {
+    for (set<int>::iterator zi = o->second.begin();
+	 zi != o->second.end();
+	 ++zi) {
+      int z = *zi;
+      get_plane_vector(z, &z_vec);
+
+      for (int y = 0; y < t; y++) {
+	for (int x = 0; x < q; x++) {
+	  int node_xy = q * y + x;
+	  if (erasures.count(node_xy))
+	    continue;
+	  int node_sw = q * y + z_vec[y];
+	  int z_sw = z + (x - z_vec[y]) * pow_int(q, t - 1 - y);
+	  bufferlist h_xy = sub_chunk(helper_nodes[node_xy],
+				      plane_index[z], sc_size);
+	  if (aloof_nodes.count(node_sw)) {
+	    set_pft_chunks(x, z_vec[y],
+			   h_xy,
+			   scratch,
+			   sub_chunk(uncoupled[node_xy], z, sc_size),
+			   sub_chunk(uncoupled[node_sw], z_sw, sc_size),
+			   pos, &pft_chunks);
+	    pft_erasures.clear();
+	    pft_erasures.insert(pos[1]);
+	    pft_erasures.insert(pos[2]);
+	  } else if (z_vec[y] != x) {
+	    set_pft_chunks(x, z_vec[y],
+			   h_xy,
+			   sub_chunk(helper_nodes[node_sw],
+				     plane_index[z_sw], sc_size),
+			   sub_chunk(uncoupled[node_xy], z, sc_size),
+			   scratch,
+			   pos, &pft_chunks);
+	    pft_erasures.clear();
+	    pft_erasures.insert(pos[2]);
+	    pft_erasures.insert(pos[3]);
+	  } else {
+	    uncoupled[node_xy].copy_in(z * sc_size, sc_size, h_xy.c_str());
+	    continue;
+	  }
+	  int r = pft_decode(pft_erasures, &pft_chunks);
+	  if (r)
+	    return r;
+	}
+      }
+
+      int r = decode_uncoupled(erasures, z, sc_size, &uncoupled);
+      if (r)
+	return r;
+
+      for (int x = 0; x < q; x++) {
+	int node = lost_y * q + x;
+	if (x == z_vec[lost_y]) {
+	  result.copy_in(z * sc_size, sc_size,
+			 uncoupled[node].c_str() + z * sc_size);
+	  continue;
+	}
+	int z_sw = z + (x - z_vec[lost_y]) * pow_int(q, t - 1 - lost_y);
+	set_pft_chunks(x, z_vec[lost_y],
+		       sub_chunk(helper_nodes[node], plane_index[z], sc_size),
+		       sub_chunk(result, z_sw, sc_size),
+		       sub_chunk(uncoupled[node], z, sc_size),
+		       scratch,
+		       pos, &pft_chunks);
+	pft_erasures.clear();
+	pft_erasures.insert(pos[1]);
+	pft_erasures.insert(pos[3]);
+	r = pft_decode(pft_erasures, &pft_chunks);
+	if (r)
+	  return r;
+      }
+    }
+  }
+  repaired->claim_append(result);
+  return 0;
+}
+
+int ErasureCodeClay::decode_layered(const set<int> &erased_nodes,
+				    map<int, bufferlist> *nodes)
+{
+  unsigned chunk_size = nodes->begin()->second.length();
+  if (chunk_size % sub_chunk_no)
+    return -EINVAL;
+  unsigned sc_size = chunk_size / sub_chunk_no;
+
+  map<int, bufferlist> uncoupled;
+  for (int i = 0; i < q * t; i++)
+    uncoupled[i] = aligned_buffer(chunk_size);
+  bufferlist scratch = aligned_buffer(sc_size);
+
+  // the intersection score of a plane is the number of erased nodes
+  // whose coordinate in the row matches the plane vector
+  vector<int> z_vec;
+  vector<int> order(sub_chunk_no, 0);
+  set<int> erased_rows;
+  for (set<int>::const_iterator i = erased_nodes.begin();
+       i != erased_nodes.end();
+       ++i) {
+    erased_rows.insert(*i / q);
+  }
+  for (int z = 0; z < sub_chunk_no; z++) {
+    get_plane_vector(z, &z_vec);
+    for (set<int>::const_iterator i = erased_nodes.begin();
+	 i != erased_nodes.end();
+	 ++i) {
+      if (*i % q == z_vec[*i / q])
+	order[z]++;
+    }
+  }
+
+  int pos[4];
+  map<int, bufferlist> pft_chunks;
+  set<int> pft_erasures;
+  for (int score = 0; score <= (int)erased_rows.size(); score++) {
+    for (int z = 0; z < sub_chunk_no; z++) {
+      if (order[z] != score)
+	continue;
+      get_plane_vector(z, &z_vec);
+      for (int y = 0; y < t; y++) {
+	for (int x = 0; x < q; x++) {
+	  int node_xy = q * y + x;
+	  if (erased_nodes.count(node_xy))
+	    continue;
+	  int node_sw = q * y + z_vec[y];
+	  if (z_vec[y] == x) {
+	    uncoupled[node_xy].copy_in(z * sc_size, sc_size,
+				       (*nodes)[node_xy].c_str() + z * sc_size);
+	  } else if (z_vec[y] < x || erased_nodes.count(node_sw)) {
+	    // uncoupled from coupled
+	    int z_sw = z + (x - z_vec[y]) * pow_int(q, t - 1 - y);
+	    set_pft_chunks(x, z_vec[y],
+			   sub_chunk((*nodes)[node_xy], z, sc_size),
+			   sub_chunk((*nodes)[node_sw], z_sw, sc_size),
+			   sub_chunk(uncoupled[node_xy], z, sc_size),
+			   sub_chunk(uncoupled[node_sw], z_sw, sc_size),
+			   pos, &pft_chunks);
+	    pft_erasures.clear();
+	    pft_erasures.insert(pos[2]);
+	    pft_erasures.insert(pos[3]);
+	    int r = pft_decode(pft_erasures, &pft_chunks);
+	    if (r)
+	      return r;
+	  }
+	}
+      }
+      int r = decode_uncoupled(erased_nodes, z, sc_size, &uncoupled);
+      if (r)
+	return r;
+    }
+
+    for (int z = 0; z < sub_chunk_no; z++) {
+      if (order[z] != score)
+	continue;
+      get_plane_vector(z, &z_vec);
+      for (set<int>::const_iterator i = erased_nodes.begin();
+	   i != erased_nodes.end();
+	   ++i) {
+	int node_xy = *i;
+	int x = node_xy % q;
+	int y = node_xy / q;
+	int node_sw = q * y + z_vec[y];
+	if (z_vec[y] == x) {
+	  (*nodes)[node_xy].copy_in(z * sc_size, sc_size,
+				    uncoupled[node_xy].c_str() + z * sc_size);
+	  continue;
+	}
+	int z_sw = z + (x - z_vec[y]) * pow_int(q, t - 1 - y);
+	if (!erased_nodes.count(node_sw)) {
+	  // coupled from the coupled companion and the uncoupled
+	  set_pft_chunks(x, z_vec[y],
+			 sub_chunk((*nodes)[node_xy], z, sc_size),
+			 sub_chunk((*nodes)[node_sw], z_sw, sc_size),
+			 sub_chunk(uncoupled[node_xy], z, sc_size),
+			 scratch,
+			 pos, &pft_chunks);
+	  pft_erasures.clear();
+	  pft_erasures.insert(pos[0]);
+	  pft_erasures.insert(pos[3]);
+	} else if (z_vec[y] < x) {
+	  // both coupled from both uncoupled, once per pair
+	  set_pft_chunks(x, z_vec[y],
+			 sub_chunk((*nodes)[node_xy], z, sc_size),
+			 sub_chunk((*nodes)[node_sw], z_sw, sc_size),
+			 sub_chunk(uncoupled[node_xy], z, sc_size),
+			 sub_chunk(uncoupled[node_sw], z_sw, sc_size),
+			 pos, &pft_chunks);
+	  pft_erasures.clear();
+	  pft_erasures.insert(pos[0]);
+	  pft_erasures.insert(pos[1]);
+	} else {
+	  continue;
+	}
+	int r = pft_decode(pft_erasures, &pft_chunks);
+	if (r)
+	  return r;
+      }
+    }
+  }
+  return 0;
+}
+
+int ErasureCodeClay::decode_uncoupled(const set<int> &erased_nodes, int z,
+				      unsigned int sc_size,
+				      map<int, bufferlist> *uncoupled)
+{
+  map<int, bufferlist> known_sub_chunks;
+  map<int, bufferlist> all_sub_chunks;
+  for (int i = 0; i < q * t; i++) {
+    bufferlist bl = sub_chunk((*uncoupled)[i], z, sc_size);
+    all_sub_chunks[i] = bl;
+    if (!erased_nodes.count(i))
+      known_sub_chunks[i] = bl;
+  }
+  return mds.erasure_code->decode_chunks(erased_nodes,
+					 known_sub_chunks,
+					 &all_sub_chunks);
+}
+
+int ErasureCodeClay::pft_decode(const set<int> &erasures,
+				map<int, bufferlist> *pft_chunks)
+{
+  map<int, bufferlist> known;
+  for (map<int, bufferlist>::iterator i = pft_chunks->begin();
+       i != pft_chunks->end();
+       ++i) {
+    if (!erasures.count(i->first))
+      known[i->first] = i->second;
+  }
+  return pft.erasure_code->decode_chunks(erasures, known, pft_chunks);
+}
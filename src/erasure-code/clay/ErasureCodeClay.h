@@ -0,0 +1,158 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t -*-
+// vim: ts=8 sw=2 smarttab
+/*
+ * Ceph distributed storage system
+ *
+ *  This library is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Lesser General Public
+ *  License as published by the Free Software Foundation; either
+ *  version 2.1 of the License, or (at your option) any later version.
+ *
+ */
+
+#ifndef CEPH_ERASURE_CODE_CLAY_H
+#define CEPH_ERASURE_CODE_CLAY_H
+
+#include "erasure-code/ErasureCode.h"
+
+/**
+ * Coupled-layer (Clay) code built on top of a scalar MDS code.
+ *
+ * Every chunk is divided into **q^t** sub-chunks, where **q = d - k + 1**
+ * and **t = (k + m + nu) / q**. The **k + m** chunks, plus **nu**
+ * shortened chunks that are always zero, are arranged in a grid of
+ * **q** columns and **t** rows. Decoding works plane by plane, each
+ * plane being one sub-chunk of every chunk: the coupled sub-chunks
+ * are transformed into uncoupled ones with a 2x2 pairwise transform
+ * (the **pft** code), the uncoupled plane is decoded with the
+ * **(k + nu, m)** scalar code (the **mds** code) and the result is
+ * transformed back.
+ *
+ * A single lost chunk is repaired from **d** helpers by reading only
+ * **1/q** of the sub-chunks of each of them, instead of **k** whole
+ * chunks.
+ */
+class ErasureCodeClay : public ErasureCode {
+public:
+  struct ScalarMDS {
+    ErasureCodeInterfaceRef erasure_code;
+    ErasureCodeProfile profile;
+  };
+
+  std::string directory;
+  int k;
+  std::string DEFAULT_K;
+  int m;
+  std::string DEFAULT_M;
+  int d;
+  int q;
+  int t;
+  int nu;
+  int sub_chunk_no;
+  ScalarMDS mds;
+  ScalarMDS pft;
+
+  explicit ErasureCodeClay(const std::string &dir) :
+    directory(dir),
+    k(0),
+    DEFAULT_K("4"),
+    m(0),
+    DEFAULT_M("2"),
+    d(0),
+    q(0),
+    t(0),
+    nu(0),
+    sub_chunk_no(0)
+  {}
+
+  ~ErasureCodeClay() override {}
+
+  unsigned int get_chunk_count() const override {
+    return k + m;
+  }
+
+  unsigned int get_data_chunk_count() const override {
+    return k;
+  }
+
+  unsigned int get_sub_chunk_count() const override {
+    return sub_chunk_no;
+  }
+
+  unsigned int get_chunk_size(unsigned int object_size) const override;
+
+  int minimum_to_decode_sub_chunks(
+    const std::set<int> &want_to_read,
+    const std::set<int> &available,
+    std::map<int, std::vector<std::pair<int, int> > > *minimum) override;
+
+  int encode_chunks(const std::set<int> &want_to_encode,
+		    std::map<int, bufferlist> *encoded) override;
+
+  int decode_chunks(const std::set<int> &want_to_read,
+		    const std::map<int, bufferlist> &chunks,
+		    std::map<int, bufferlist> *decoded) override;
+
+  int decode_sub_chunks(const std::set<int> &want_to_read,
+			const std::map<int, bufferlist> &chunks,
+			unsigned int chunk_size,
+			std::map<int, bufferlist> *decoded) override;
+
+  int init(ErasureCodeProfile &profile, std::ostream *ss) override;
+
+  /**
+   * Return true if **want_to_read** is a single chunk that can be
+   * repaired from **available** by reading a fraction of the
+   * sub-chunks of **d** helpers.
+   */
+  bool is_repair(const std::set<int> &want_to_read,
+		 const std::set<int> &available) const;
+
+  /**
+   * Return the sub-chunk ranges, as (first, count) pairs, that
+   * every helper sends to repair chunk **lost_chunk**.
+   */
+  void get_repair_sub_chunks(
+    int lost_chunk,
+    std::vector<std::pair<int, int> > *repair_sub_chunks) const;
+
+  /**
+   * Return the number of sub-chunks every helper sends to repair
+   * a single chunk.
+   */
+  int get_repair_sub_chunk_count() const;
+
+protected:
+  int parse(ErasureCodeProfile &profile, std::ostream *ss);
+
+private:
+  // chunk index to node index in the q x t grid, skipping the
+  // shortened nodes k .. k + nu - 1
+  int to_node(int chunk) const {
+    return chunk < k ? chunk : chunk + nu;
+  }
+
+  void get_plane_vector(int z, std::vector<int> *z_vec) const;
+
+  int minimum_to_repair(
+    int lost_chunk,
+    const std::set<int> &available,
+    std::map<int, std::vector<std::pair<int, int> > > *minimum) const;
+
+  int repair_one_lost_chunk(int lost_chunk,
+			    const std::map<int, bufferlist> &helpers,
+			    unsigned int chunk_size,
+			    bufferlist *repaired);
+
+  int decode_layered(const std::set<int> &erased_nodes,
+		     std::map<int, bufferlist> *nodes);
+
+  int decode_uncoupled(const std::set<int> &erased_nodes, int z,
+		       unsigned int sc_size,
+		       std::map<int, bufferlist> *uncoupled);
+
+  int pft_decode(const std::set<int> &erasures,
+		 std::map<int, bufferlist> *pft_chunks);
+};
+
+#endif
@@ -80,6 +80,16 @@ public:
                             const std::map<int, bufferlist> &chunks,
                             std::map<int, bufferlist> *decoded) override;
 
+  // Vandermonde and Cauchy matrices over GF(2^8) are both linear
+  bool supports_parity_delta() const override {
+    return true;
+  }
+
+  // the code works on each byte position of the chunks separately
+  bool stripes_are_independent() const override {
+    return true;
+  }
+
   int init(ErasureCodeProfile &profile, std::ostream *ss) override;
 
   virtual void isa_encode(char **data,
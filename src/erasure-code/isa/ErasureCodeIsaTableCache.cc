@@ -53,9 +53,6 @@ ErasureCodeIsaTableCache::~ErasureCodeIsaTableCache()
   codec_tables_t::const_iterator tables_it;
   codec_table_t::const_iterator table_it;
 
-  std::map<int, lru_map_t*>::const_iterator lru_map_it;
-  std::map<int, lru_list_t*>::const_iterator lru_list_it;
-
   // clean-up all allocated tables
   for (ttables_it = encoding_coefficient.begin(); ttables_it != encoding_coefficient.end(); ++ttables_it) {
     for (tables_it = ttables_it->second.begin(); tables_it != ttables_it->second.end(); ++tables_it) {
@@ -83,17 +80,6 @@ ErasureCodeIsaTableCache::~ErasureCodeIsaTableCache()
     }
   }
 
-  for (lru_map_it = decoding_tables.begin(); lru_map_it != decoding_tables.end(); ++lru_map_it) {
-    if (lru_map_it->second) {
-      delete lru_map_it->second;
-    }
-  }
-
-  for (lru_list_it = decoding_tables_lru.begin(); lru_list_it != decoding_tables_lru.end(); ++lru_list_it) {
-    if (lru_list_it->second) {
-      delete lru_list_it->second;
-    }
-  }
 }
 
 // -----------------------------------------------------------------------------
@@ -101,41 +87,29 @@ ErasureCodeIsaTableCache::~ErasureCodeIsaTableCache()
 int
 ErasureCodeIsaTableCache::getDecodingTableCacheSize(int matrixtype)
 {
-  Mutex::Locker lock(codec_tables_guard);
-  if (decoding_tables[matrixtype])
-    return decoding_tables[matrixtype]->size();
-  else
-    return -1;
+  return getDecodingTables(matrixtype)->size();
 }
 
 // -----------------------------------------------------------------------------
 
-ErasureCodeIsaTableCache::lru_map_t*
+ceph::ErasureCodeDecodeTableCache*
 ErasureCodeIsaTableCache::getDecodingTables(int matrix_type)
 {
-  // the caller must hold the guard mutex:
-  // => Mutex::Locker lock(codec_tables_guard);
-
-  // create an lru_map if not yet allocated
-  if (!decoding_tables[matrix_type]) {
-    decoding_tables[matrix_type] = new lru_map_t;
-  }
-  return decoding_tables[matrix_type];
+  assert(matrix_type >= 0 && matrix_type < decoding_table_types);
+  return decoding_tables[matrix_type].get();
 }
 
 // -----------------------------------------------------------------------------
 
-ErasureCodeIsaTableCache::lru_list_t*
-ErasureCodeIsaTableCache::getDecodingTablesLru(int matrix_type)
+std::string
+ErasureCodeIsaTableCache::getDecodingTableSignature(const std::string &signature,
+                                                    int k,
+                                                    int m)
 {
-  // the caller must hold the guard mutex:
-  // => Mutex::Locker lock(codec_tables_guard);
-
-  // create an lru_list if not yet allocated
-  if (!decoding_tables_lru[matrix_type]) {
-    decoding_tables_lru[matrix_type] = new lru_list_t;
-  }
-  return decoding_tables_lru[matrix_type];
+  // the erasure signature alone does not tell the table size
+  char id[128];
+  snprintf(id, sizeof (id), "%d,%d", k, m);
+  return id + signature;
 }
 
 // -----------------------------------------------------------------------------
@@ -238,33 +212,21 @@ ErasureCodeIsaTableCache::getDecodingTableFromCache(std::string &signature,
                                                     int m)
 {
   // --------------------------------------------------------------------------
-  // LRU decoding matrix cache
+  // lock free decoding table cache
   // --------------------------------------------------------------------------
 
   dout(12) << "[ get table    ] = " << signature << dendl;
 
-  // we try to fetch a decoding table from an LRU cache
-  bool found = false;
-
-  Mutex::Locker lock(codec_tables_guard);
-
-  lru_map_t* decode_tbls_map =
-    getDecodingTables(matrixtype);
-
-  lru_list_t* decode_tbls_lru =
-    getDecodingTablesLru(matrixtype);
-
-  if (decode_tbls_map->count(signature)) {
-    dout(12) << "[ cached table ] = " << signature << dendl;
-    // copy the table out of the cache
-    memcpy(table, (*decode_tbls_map)[signature].second.c_str(), k * (m + k)*32);
-    // find item in LRU queue and push back
-    dout(12) << "[ cache size   ] = " << decode_tbls_lru->size() << dendl;
-    decode_tbls_lru->splice( (decode_tbls_lru->begin()), *decode_tbls_lru, (*decode_tbls_map)[signature].first);
-    found = true;
+  bufferptr cachetable;
+  if (!getDecodingTables(matrixtype)->get(
+        getDecodingTableSignature(signature, k, m), &cachetable)) {
+    return false;
   }
 
-  return found;
+  dout(12) << "[ cached table ] = " << signature << dendl;
+  // copy the table out of the cache
+  memcpy(table, cachetable.c_str(), k * (m + k)*32);
+  return true;
 }
 
 // -----------------------------------------------------------------------------
@@ -277,51 +239,18 @@ ErasureCodeIsaTableCache::putDecodingTableToCache(std::string &signature,
                                                   int m)
 {
   // --------------------------------------------------------------------------
-  // LRU decoding matrix cache
+  // lock free decoding table cache
   // --------------------------------------------------------------------------
 
   dout(12) << "[ put table    ] = " << signature << dendl;
 
-  // we store a new table to the cache
-
-  bufferptr cachetable;
-
-  Mutex::Locker lock(codec_tables_guard);
-
-  lru_map_t* decode_tbls_map =
-    getDecodingTables(matrixtype);
-
-  lru_list_t* decode_tbls_lru =
-    getDecodingTablesLru(matrixtype);
-
-  // evt. shrink the LRU queue/map
-  if ((int) decode_tbls_lru->size() >= ErasureCodeIsaTableCache::decoding_tables_lru_length) {
-    dout(12) << "[ shrink lru   ] = " << signature << dendl;
-    // reuse old buffer
-    cachetable = (*decode_tbls_map)[decode_tbls_lru->back()].second;
-
-    if ((int) cachetable.length() != (k * (m + k)*32)) {
-      // we need to replace this with a different size buffer
-      cachetable = buffer::create(k * (m + k)*32);
-    }
-
-    // remove from map
-    decode_tbls_map->erase(decode_tbls_lru->back());
-    // remove from lru
-    decode_tbls_lru->pop_back();
-    // add to the head of lru
-    decode_tbls_lru->push_front(signature);
-    // add the new to the map
-    (*decode_tbls_map)[signature] = std::make_pair(decode_tbls_lru->begin(), cachetable);
-  } else {
-    dout(12) << "[ store table  ] = " << signature << dendl;
-    // allocate a new buffer
-    cachetable = buffer::create(k * (m + k)*32);
-    decode_tbls_lru->push_front(signature);
-    (*decode_tbls_map)[signature] = std::make_pair(decode_tbls_lru->begin(), cachetable);
-    dout(12) << "[ cache size   ] = " << decode_tbls_lru->size() << dendl;
-  }
-
-  // copy-in the new table
+  // we store a copy of the new table; when the cache is full, only the
+  // tables looked up since the previous eviction are kept to make room
+  bufferptr cachetable = buffer::create(k * (m + k)*32);
   memcpy(cachetable.c_str(), table, k * (m + k)*32);
+  getDecodingTables(matrixtype)->put(
+    getDecodingTableSignature(signature, k, m), cachetable);
+
+  dout(12) << "[ cache size   ] = "
+           << getDecodingTables(matrixtype)->size() << dendl;
 }
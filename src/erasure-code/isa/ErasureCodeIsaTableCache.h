@@ -28,6 +28,7 @@
 // -----------------------------------------------------------------------------
 #include "common/Mutex.h"
 #include "erasure-code/ErasureCodeInterface.h"
+#include "erasure-code/ErasureCodeDecodeTableCache.h"
 // -----------------------------------------------------------------------------
 #include <list>
 // -----------------------------------------------------------------------------
@@ -36,9 +37,9 @@ class ErasureCodeIsaTableCache {
   // ---------------------------------------------------------------------------
   // This class implements a table cache for encoding and decoding matrices.
   // Encoding matrices are shared for the same (k,m) combination. It supplies
-  // a decoding matrix lru cache which is shared for identical
-  // matrix types e.g. there is one cache (lru-list + lru-map) for Cauchy and
-  // one for Vandermonde matrices!
+  // a lock free decoding table cache which is shared for identical
+  // matrix types e.g. there is one cache for Cauchy and one for Vandermonde
+  // matrices!
   // ---------------------------------------------------------------------------
 
 public:
@@ -47,22 +48,25 @@ public:
 
   static const int decoding_tables_lru_length = 2516;
 
-  typedef std::pair<std::list<std::string>::iterator, bufferptr> lru_entry_t;
+  // Vandermonde and Cauchy
+  static const int decoding_table_types = 2;
+
   typedef std::map< int, unsigned char** > codec_table_t;
   typedef std::map< int, codec_table_t > codec_tables_t;
   typedef std::map< int, codec_tables_t > codec_technique_tables_t;
 
-  typedef std::map< std::string, lru_entry_t > lru_map_t;
-  typedef std::list< std::string > lru_list_t;
-
   ErasureCodeIsaTableCache() :
   codec_tables_guard("isa-lru-cache")
   {
+    for (int i = 0; i < decoding_table_types; i++) {
+      decoding_tables[i].reset(
+        new ceph::ErasureCodeDecodeTableCache(decoding_tables_lru_length));
+    }
   }
 
   virtual ~ErasureCodeIsaTableCache();
 
-  Mutex codec_tables_guard; // mutex used to protect modifications in encoding/decoding table maps
+  Mutex codec_tables_guard; // mutex used to protect modifications in encoding table maps
 
   bool getDecodingTableFromCache(std::string &signature,
                                  unsigned char* &table,
@@ -91,12 +95,14 @@ private:
   codec_technique_tables_t encoding_coefficient; // encoding coefficients accessed via table[matrix][k][m]
   codec_technique_tables_t encoding_table; // encoding coefficients accessed via table[matrix][k][m]
 
-  std::map<int, lru_map_t*> decoding_tables; // decoding table cache accessed via map[matrixtype]
-  std::map<int, lru_list_t*> decoding_tables_lru; // decoding table lru list accessed via list[matrixtype]
+  // decoding table cache accessed via decoding_tables[matrixtype]
+  std::unique_ptr<ceph::ErasureCodeDecodeTableCache> decoding_tables[decoding_table_types];
 
-  lru_map_t* getDecodingTables(int matrix_type);
+  ceph::ErasureCodeDecodeTableCache* getDecodingTables(int matrix_type);
 
-  lru_list_t* getDecodingTablesLru(int matrix_type);
+  static std::string getDecodingTableSignature(const std::string &signature,
+                                               int k,
+                                               int m);
 
   Mutex* getLock();
 
@@ -16,6 +16,7 @@
  */
 
 #include "common/debug.h"
+#include "erasure-code/ErasureCodeDecodeTableCache.h"
 #include "ErasureCodeJerasure.h"
 
 using namespace std;
@@ -40,6 +41,13 @@ static ostream& _prefix(std::ostream* _dout)
   return *_dout << "ErasureCodeJerasure: ";
 }
 
+// decoding matrices of every instance of the plugin
+static ErasureCodeDecodeTableCache &decoding_tables()
+{
+  static ErasureCodeDecodeTableCache cache(10000);
+  return cache;
+}
+
 
 int ErasureCodeJerasure::init(ErasureCodeProfile& profile, ostream *ss)
 {
@@ -131,6 +139,99 @@ int ErasureCodeJerasure::decode_chunks(const set<int> &want_to_read,
   return jerasure_decode(erasures, data, coding, blocksize);
 }
 
+string ErasureCodeJerasure::decoding_table_signature(const int *erased) const
+{
+  ostringstream signature;
+  signature << technique << " k=" << k << " m=" << m << " w=" << w << " -";
+  for (int i = 0; i < k + m; i++)
+    if (erased[i])
+      signature << " " << i;
+  return signature.str();
+}
+
+int ErasureCodeJerasure::get_decoding_table(int *matrix,
+					    const int *erased,
+					    bufferptr *table)
+{
+  string signature = decoding_table_signature(erased);
+  if (decoding_tables().get(signature, table))
+    return 0;
+  // the decoding matrix followed by the ids of the chunks it applies to
+  bufferptr computed(buffer::create((k * k + k) * sizeof(int)));
+  int *decoding_matrix = (int*)computed.c_str();
+  int *dm_ids = decoding_matrix + k * k;
+  if (jerasure_make_decoding_matrix(k, m, w, matrix,
+				    const_cast<int*>(erased),
+				    decoding_matrix, dm_ids) < 0) {
+    dout(0) << "get_decoding_table: " << signature
+	    << " cannot be inverted" << dendl;
+    return -EINVAL;
+  }
+  dout(20) << "get_decoding_table: computed " << signature << dendl;
+  *table = decoding_tables().put(signature, computed);
+  return 0;
+}
+
+int ErasureCodeJerasure::matrix_decode(int *matrix,
+				       int *erasures,
+				       char **data,
+				       char **coding,
+				       int blocksize)
+{
+  int erased[k + m];
+  memset(erased, 0, sizeof(erased));
+  int erasures_count = 0;
+  bool data_erased = false;
+  for (int i = 0; erasures[i] != -1; i++) {
+    erased[erasures[i]] = 1;
+    erasures_count++;
+    if (erasures[i] < k)
+      data_erased = true;
+  }
+  if (erasures_count > m)
+    return -1;
+
+  if (data_erased) {
+    bufferptr table;
+    if (get_decoding_table(matrix, erased, &table) < 0)
+      return -1;
+    int *decoding_matrix = (int*)table.c_str();
+    int *dm_ids = decoding_matrix + k * k;
+    for (int i = 0; i < k; i++) {
+      if (erased[i])
+	jerasure_matrix_dotprod(k, w, decoding_matrix + i * k, dm_ids, i,
+				data, coding, blocksize);
+    }
+  }
+  // the data chunks are all there now
+  for (int i = 0; i < m; i++) {
+    if (erased[k + i])
+      jerasure_matrix_dotprod(k, w, matrix + i * k, NULL, k + i,
+			      data, coding, blocksize);
+  }
+  return 0;
+}
+
+void ErasureCodeJerasure::prepare_decoding_tables(int *matrix)
+{
+  for (int erasures = 1; erasures <= min(m, 2); erasures++) {
+    ErasureCodeDecodeTableCache::for_each_erasure(
+      k + m, erasures,
+      [&](const set<int> &pattern) {
+	if (*pattern.begin() >= k)
+	  return; // coding chunks only, no inversion
+	int erased[k + m];
+	memset(erased, 0, sizeof(erased));
+	for (set<int>::const_iterator i = pattern.begin();
+	     i != pattern.end();
+	     ++i)
+	  erased[*i] = 1;
+	bufferptr table;
+	get_decoding_table(matrix, erased, &table);
+      });
+  }
+}
+
 bool ErasureCodeJerasure::is_prime(int value)
 {
   int prime55[] = {
@@ -161,8 +262,7 @@ int ErasureCodeJerasureReedSolomonVandermonde::jerasure_decode(int *erasures,
                                                                 char **coding,
                                                                 int blocksize)
 {
-  return jerasure_matrix_decode(k, m, w, matrix, 1,
-				erasures, data, coding, blocksize);
+  return matrix_decode(matrix, erasures, data, coding, blocksize);
 }
 
 unsigned ErasureCodeJerasureReedSolomonVandermonde::get_alignment() const
@@ -197,6 +297,7 @@ int ErasureCodeJerasureReedSolomonVandermonde::parse(ErasureCodeProfile &profile
 void ErasureCodeJerasureReedSolomonVandermonde::prepare()
 {
   matrix = reed_sol_vandermonde_coding_matrix(k, m, w);
+  prepare_decoding_tables(matrix);
 }
 
 // 
@@ -214,7 +315,7 @@ int ErasureCodeJerasureReedSolomonRAID6::jerasure_decode(int *erasures,
 							 char **coding,
 							 int blocksize)
 {
-  return jerasure_matrix_decode(k, m, w, matrix, 1, erasures, data, coding, blocksize);
+  return matrix_decode(matrix, erasures, data, coding, blocksize);
 }
 
 unsigned ErasureCodeJerasureReedSolomonRAID6::get_alignment() const
@@ -248,6 +349,7 @@ int ErasureCodeJerasureReedSolomonRAID6::parse(ErasureCodeProfile &profile,
 void ErasureCodeJerasureReedSolomonRAID6::prepare()
 {
   matrix = reed_sol_r6_coding_matrix(k, w);
+  prepare_decoding_tables(matrix);
 }
 
 // 
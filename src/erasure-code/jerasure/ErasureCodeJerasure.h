@@ -63,6 +63,16 @@ public:
 			    const std::map<int, bufferlist> &chunks,
 			    std::map<int, bufferlist> *decoded) override;
 
+  // every technique is a matrix or bit-matrix code over GF(2^w)
+  bool supports_parity_delta() const override {
+    return true;
+  }
+
+  // words and packets never cross the end of a chunk
+  bool stripes_are_independent() const override {
+    return true;
+  }
+
   int init(ErasureCodeProfile &profile, std::ostream *ss) override;
 
   virtual void jerasure_encode(char **data,
@@ -77,6 +87,30 @@ public:
   static bool is_prime(int value);
 protected:
   virtual int parse(ErasureCodeProfile &profile, std::ostream *ss);
+
+  /**
+   * Same as jerasure_matrix_decode, except that the decoding matrix
+   * of the erasures is computed once and shared by all the instances
+   * with the same technique, k, m and w instead of being inverted on
+   * every call.
+   */
+  int matrix_decode(int *matrix,
+		    int *erasures,
+		    char **data,
+		    char **coding,
+		    int blocksize);
+
+  /**
+   * Compute the decoding matrices of every single and double erasure
+   * of a data chunk so that degraded reads do not have to.
+   */
+  void prepare_decoding_tables(int *matrix);
+
+private:
+  std::string decoding_table_signature(const int *erased) const;
+  int get_decoding_table(int *matrix,
+			 const int *erased,
+			 bufferptr *table);
 };
 
 class ErasureCodeJerasureReedSolomonVandermonde : public ErasureCodeJerasure {
@@ -68,51 +68,6 @@ ErasureCodeShecTableCache::~ErasureCodeShecTableCache()
       }
     }
   }
-
-  {
-    std::map<int, lru_map_t*>::const_iterator lru_map_it;
-    std::map<int, lru_list_t*>::const_iterator lru_list_it;
-
-    for (lru_map_it = decoding_tables.begin();
-         lru_map_it != decoding_tables.end();
-         ++lru_map_it) {
-      if (lru_map_it->second) {
-        delete lru_map_it->second;
-      }
-    }
-
-    for (lru_list_it = decoding_tables_lru.begin();
-         lru_list_it != decoding_tables_lru.end();
-         ++lru_list_it) {
-      if (lru_list_it->second) {
-        delete lru_list_it->second;
-      }
-    }
-  }
-}
-
-ErasureCodeShecTableCache::lru_map_t*
-ErasureCodeShecTableCache::getDecodingTables(int technique) {
-  // the caller must hold the guard mutex:
-  // => Mutex::Locker lock(codec_tables_guard);
-
-  // create an lru_map if not yet allocated
-  if (!decoding_tables[technique]) {
-    decoding_tables[technique] = new lru_map_t;
-  }
-  return decoding_tables[technique];
-}
-
-ErasureCodeShecTableCache::lru_list_t*
-ErasureCodeShecTableCache::getDecodingTablesLru(int technique) {
-  // the caller must hold the guard mutex:
-  // => Mutex::Locker lock(codec_tables_guard);
-
-  // create an lru_list if not yet allocated
-  if (!decoding_tables_lru[technique]) {
-    decoding_tables_lru[technique] = new lru_list_t;
-  }
-  return decoding_tables_lru[technique];
 }
 
 int**
@@ -158,8 +113,9 @@ ErasureCodeShecTableCache::getLock()
   return &codec_tables_guard;
 }
 
-uint64_t
-ErasureCodeShecTableCache::getDecodingCacheSignature(int k, int m, int c, int w,
+std::string
+ErasureCodeShecTableCache::getDecodingCacheSignature(int technique,
+                                                     int k, int m, int c, int w,
                                                      int *erased, int *avails) {
   uint64_t signature = 0;
   signature = (uint64_t)k;
@@ -173,7 +129,9 @@ ErasureCodeShecTableCache::getDecodingCacheSignature(int k, int m, int c, int w,
   for (int i=0; i < k+m; i++) {
     signature |= ((uint64_t)(erased[i] ? 1 : 0) << (44+i));
   }
-  return signature;
+  char id[64];
+  snprintf(id, sizeof(id), "%d-%llx", technique, (unsigned long long)signature);
+  return id;
 }
 
 bool
@@ -189,46 +147,29 @@ ErasureCodeShecTableCache::getDecodingTableFromCache(int* decoding_matrix,
                                                      int* erased,
                                                      int* avails) {
   // --------------------------------------------------------------------------
-  // LRU decoding matrix cache
+  // lock free decoding matrix cache
   // --------------------------------------------------------------------------
 
-  uint64_t signature = getDecodingCacheSignature(k, m, c, w, erased, avails);
-  Mutex::Locker lock(codec_tables_guard);
+  std::string signature = getDecodingCacheSignature(technique, k, m, c, w,
+                                                    erased, avails);
 
   dout(20) << "[ get table    ] = " << signature << dendl;
 
-  // we try to fetch a decoding table from an LRU cache
-  lru_map_t* decode_tbls_map =
-    getDecodingTables(technique);
-
-  lru_list_t* decode_tbls_lru =
-    getDecodingTablesLru(technique);
-
-  lru_map_t::iterator decode_tbls_map_it = decode_tbls_map->find(signature);
-  if (decode_tbls_map_it == decode_tbls_map->end()) {
+  bufferptr table;
+  if (!decoding_tables.get(signature, &table)) {
     return false;
   }
 
   dout(20) << "[ cached table ] = " << signature << dendl;
   // copy parameters out of the cache
-
-  memcpy(decoding_matrix,
-         decode_tbls_map_it->second.second.decoding_matrix,
-         k * k * sizeof(int));
-  memcpy(dm_row,
-         decode_tbls_map_it->second.second.dm_row,
-         k * sizeof(int));
-  memcpy(dm_column,
-         decode_tbls_map_it->second.second.dm_column,
-         k * sizeof(int));
-  memcpy(minimum,
-         decode_tbls_map_it->second.second.minimum,
-         (k+m) * sizeof(int));
-
-  // find item in LRU queue and push back
-  decode_tbls_lru->splice(decode_tbls_lru->end(),
-                          *decode_tbls_lru,
-                          decode_tbls_map_it->second.first);
+  const int *p = (const int*)table.c_str();
+  memcpy(decoding_matrix, p, k * k * sizeof(int));
+  p += k * k;
+  memcpy(dm_row, p, k * sizeof(int));
+  p += k;
+  memcpy(dm_column, p, k * sizeof(int));
+  p += k;
+  memcpy(minimum, p, (k+m) * sizeof(int));
   return true;
 }
 
@@ -245,74 +186,25 @@ ErasureCodeShecTableCache::putDecodingTableToCache(int* decoding_matrix,
                                                    int* erased,
                                                    int* avails) {
   // --------------------------------------------------------------------------
-  // LRU decoding matrix cache
+  // lock free decoding matrix cache
   // --------------------------------------------------------------------------
 
-  Mutex::Locker lock(codec_tables_guard);
-
-  uint64_t signature = getDecodingCacheSignature(k, m, c, w, erased, avails);
+  std::string signature = getDecodingCacheSignature(technique, k, m, c, w,
+                                                    erased, avails);
   dout(20) << "[ put table    ] = " << signature << dendl;
 
-  // we store a new table to the cache
-
-  //  bufferptr cachetable;
-
-  lru_map_t* decode_tbls_map =
-    getDecodingTables(technique);
-
-  lru_list_t* decode_tbls_lru =
-    getDecodingTablesLru(technique);
-
-  if (decode_tbls_map->count(signature)) {
-    dout(20) << "[ already on table ] = " << signature << dendl;
-
-    // find item in LRU queue and push back
-    decode_tbls_lru->splice(decode_tbls_lru->end(),
-                            *decode_tbls_lru,
-                            (*decode_tbls_map)[signature].first);
-    return;
-  }
-
-  // evt. shrink the LRU queue/map
-  if ((int)decode_tbls_lru->size() >=
-      ErasureCodeShecTableCache::decoding_tables_lru_length) {
-    dout(20) << "[ shrink lru   ] = " << signature << dendl;
-    // remove from map
-    decode_tbls_map->erase(decode_tbls_lru->front());
-    // remove from lru
-    decode_tbls_lru->pop_front();
-  }
-
-  {
-    dout(20) << "[ store table  ] = " << signature << dendl;
-
-    decode_tbls_lru->push_back(signature);
-
-    // allocate a new buffer
-    lru_list_t::iterator it_end = decode_tbls_lru->end();
-    --it_end;
-
-    lru_entry_t &map_value =
-      (*decode_tbls_map)[signature] =
-      std::make_pair(it_end, DecodingCacheParameter());
-    map_value.second.decoding_matrix = new int[k*k];
-    map_value.second.dm_row = new int[k];
-    map_value.second.dm_column = new int[k];
-    map_value.second.minimum = new int[k+m];
-
-    memcpy(map_value.second.decoding_matrix,
-           decoding_matrix,
-           k * k * sizeof(int));
-    memcpy(map_value.second.dm_row,
-           dm_row,
-           k * sizeof(int));
-    memcpy(map_value.second.dm_column,
-           dm_column,
-           k * sizeof(int));
-    memcpy(map_value.second.minimum,
-           minimum,
-           (k+m) * sizeof(int));
-
-    dout(20) << "[ cache size   ] = " << decode_tbls_lru->size() << dendl;
-  }
+  // when the cache is full, only the tables looked up since the previous
+  // eviction are kept to make room for this one
+  bufferptr table = buffer::create((k * k + k + k + k + m) * sizeof(int));
+  int *p = (int*)table.c_str();
+  memcpy(p, decoding_matrix, k * k * sizeof(int));
+  p += k * k;
+  memcpy(p, dm_row, k * sizeof(int));
+  p += k;
+  memcpy(p, dm_column, k * sizeof(int));
+  p += k;
+  memcpy(p, minimum, (k+m) * sizeof(int));
+  decoding_tables.put(signature, table);
+
+  dout(20) << "[ cache size   ] = " << decoding_tables.size() << dendl;
 }
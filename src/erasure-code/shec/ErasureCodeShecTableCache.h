@@ -23,6 +23,7 @@
 // -----------------------------------------------------------------------------
 #include "common/Mutex.h"
 #include "erasure-code/ErasureCodeInterface.h"
+#include "erasure-code/ErasureCodeDecodeTableCache.h"
 // -----------------------------------------------------------------------------
 #include <list>
 // -----------------------------------------------------------------------------
@@ -31,61 +32,29 @@ class ErasureCodeShecTableCache {
   // ---------------------------------------------------------------------------
   // This class implements a table cache for encoding and decoding matrices.
   // Encoding matrices are shared for the same (k,m,c,w) combination.
-  // It supplies a decoding matrix lru cache which is shared for identical
-  // matrix types e.g. there is one cache (lru-list + lru-map)
+  // It supplies a lock free decoding matrix cache which is shared for
+  // identical techniques
   // ---------------------------------------------------------------------------
 
-  class DecodingCacheParameter {
-   public:
-    int* decoding_matrix;  // size: k*k
-    int* dm_row;  // size: k
-    int* dm_column;  // size: k
-    int* minimum;  // size: k+m
-    DecodingCacheParameter() {
-      decoding_matrix = 0;
-      dm_row = 0;
-      dm_column = 0;
-      minimum = 0;
-    }
-    ~DecodingCacheParameter() {
-      if (decoding_matrix) {
-        delete[] decoding_matrix;
-      }
-      if (dm_row) {
-        delete[] dm_row;
-      }
-      if (dm_column) {
-        delete[] dm_column;
-      }
-      if (minimum) {
-        delete[] minimum;
-      }
-    }
-  };
-
  public:
 
   static const int decoding_tables_lru_length = 10000;
-  typedef std::pair<std::list<uint64_t>::iterator,
-                    DecodingCacheParameter> lru_entry_t;
   typedef std::map< int, int** > codec_table_t;
   typedef std::map< int, codec_table_t > codec_tables_t__;
   typedef std::map< int, codec_tables_t__ > codec_tables_t_;
   typedef std::map< int, codec_tables_t_ > codec_tables_t;
   typedef std::map< int, codec_tables_t > codec_technique_tables_t;
   // int** matrix = codec_technique_tables_t[technique][k][m][c][w]
-  
-  typedef std::map< uint64_t, lru_entry_t > lru_map_t;
-  typedef std::list< uint64_t > lru_list_t;
 
  ErasureCodeShecTableCache() :
-  codec_tables_guard("shec-lru-cache")
+  codec_tables_guard("shec-lru-cache"),
+  decoding_tables(decoding_tables_lru_length)
     {
     }
   
   virtual ~ErasureCodeShecTableCache();
   
-  Mutex codec_tables_guard; // mutex used to protect modifications in encoding/decoding table maps
+  Mutex codec_tables_guard; // mutex used to protect modifications in encoding table maps
   
   bool getDecodingTableFromCache(int* matrix,
                                  int* dm_row, int* dm_column,
@@ -107,16 +76,14 @@ class ErasureCodeShecTableCache {
   
  private:
   // encoding table accessed via table[matrix][k][m][c][w]
-  // decoding table cache accessed via map[matrixtype]
-  // decoding table lru list accessed via list[matrixtype]
+  // decoding tables of every technique, the decoding matrix, dm_row,
+  // dm_column and minimum back to back
   codec_technique_tables_t encoding_table;
-  std::map<int, lru_map_t*> decoding_tables;
-  std::map<int, lru_list_t*> decoding_tables_lru;
+  ceph::ErasureCodeDecodeTableCache decoding_tables;
 
-  lru_map_t* getDecodingTables(int technique);
-  lru_list_t* getDecodingTablesLru(int technique);
-  uint64_t getDecodingCacheSignature(int k, int m, int c, int w,
-                                     int *want, int *avails);
+  std::string getDecodingCacheSignature(int technique,
+                                        int k, int m, int c, int w,
+                                        int *want, int *avails);
 
   Mutex* getLock();
 };
@@ -335,6 +335,10 @@ namespace buffer CEPH_BUFFER_API {
     void zero(unsigned o, unsigned l);
     void zero(unsigned o, unsigned l, bool crc_reset);
 
+    /// record crc32c(@p base) of this ptr's data as @p crc, as
+    /// list::crc32c() would have, so that it is not recomputed
+    void set_crc(uint32_t base, uint32_t crc) const;
+
   };
 
 
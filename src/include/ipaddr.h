@@ -14,4 +14,11 @@ const struct sockaddr *find_ip_in_subnet(const struct ifaddrs *addrs,
 
 bool parse_network(const char *s, struct sockaddr_storage *network, unsigned int *prefix_len);
 
+/*
+  Check whether addr lies within network/prefix_len.
+ */
+bool network_contains(const struct sockaddr_storage& network,
+		      unsigned int prefix_len,
+		      const struct sockaddr *addr);
+
 #endif
@@ -71,6 +71,7 @@ Thus for mempool "osd" we have automatically available to us:
    mempool::osd::list
    mempool::osd::vector
    mempool::osd::unordered_map
+   mempool::osd::unordered_multimap
 
 
 Putting objects in a mempool
@@ -410,6 +411,13 @@ public:
     using unordered_map =						\
       std::unordered_map<k,v,h,eq,pool_allocator<std::pair<const k,v>>>;\
                                                                         \
+    template<typename k, typename v,					\
+	     typename h=std::hash<k>,					\
+	     typename eq = std::equal_to<k>>				\
+    using unordered_multimap =						\
+      std::unordered_multimap<k,v,h,eq,					\
+			      pool_allocator<std::pair<const k,v>>>;	\
+                                                                        \
     inline size_t allocated_bytes() {					\
       return mempool::get_pool(id).allocated_bytes();			\
     }									\
@@ -11,4 +11,24 @@
 # define MSG_MORE 0
 #endif
 
+/*
+ * MSG_ZEROCOPY needs linux 4.14, but the libc headers may be older
+ * than the kernel we run on.
+ */
+#ifdef __linux__
+# include <linux/errqueue.h>
+# ifndef SO_ZEROCOPY
+#  define SO_ZEROCOPY 60
+# endif
+# ifndef MSG_ZEROCOPY
+#  define MSG_ZEROCOPY 0x4000000
+# endif
+# ifndef SO_EE_ORIGIN_ZEROCOPY
+#  define SO_EE_ORIGIN_ZEROCOPY 5
+# endif
+# ifndef SO_EE_CODE_ZEROCOPY_COPIED
+#  define SO_EE_CODE_ZEROCOPY_COPIED 1
+# endif
+#endif
+
 #endif
@@ -910,6 +910,122 @@ bool DaemonServer::handle_command(MCommand *m)
 			      &on_finish->from_mon, &on_finish->outs, on_finish);
       return true;
     }
+  } else if (prefix == "osd crush weight-set optimize" ||
+	     prefix == "osd crush weight-set test-optimize") {
+    bool dry_run = prefix == "osd crush weight-set test-optimize";
+    string mode = "compat", by = "pgs";
+    cmd_getval(g_ceph_context, cmdctx->cmdmap, "mode", mode);
+    cmd_getval(g_ceph_context, cmdctx->cmdmap, "by", by);
+    int64_t max_iterations = g_conf->mgr_weight_set_max_iterations;
+    cmd_getval(g_ceph_context, cmdctx->cmdmap, "max_iterations",
+	       max_iterations);
+    int64_t max_moved = g_conf->mgr_weight_set_max_moved;
+    cmd_getval(g_ceph_context, cmdctx->cmdmap, "max_moved", max_moved);
+    vector<string> poolnames;
+    cmd_getval(g_ceph_context, cmdctx->cmdmap, "pools", poolnames);
+    set<int64_t> pools;
+    map<pg_t,uint64_t> pg_bytes;
+    if (by == "bytes") {
+      cluster_state.with_pgmap([&](const PGMap& pgmap) {
+	  for (auto& p : pgmap.pg_stat) {
+	    pg_bytes[p.first] = p.second.stats.sum.num_bytes;
+	  }
+	});
+    }
+    // take a cheap copy of the map and optimize it on the finisher: each
+    // iteration remaps every pool, which must neither hold the map lock
+    // nor block the dispatch thread
+    auto osdmap = std::make_shared<OSDMap>();
+    cluster_state.with_osdmap([&](const OSDMap& o) {
+	for (const auto& poolname : poolnames) {
+	  int64_t pool = o.lookup_pg_pool_name(poolname);
+	  if (pool < 0) {
+	    ss << "pool '" << poolname << "' does not exist";
+	    r = -ENOENT;
+	    return;
+	  }
+	  pools.insert(pool);
+	}
+	osdmap->cow_copy_from(o);
+      });
+    if (r < 0) {
+      cmdctx->reply(r, ss);
+      return true;
+    }
+    finisher.queue(new FunctionContext(
+      [this, cmdctx, osdmap, format, dry_run, mode, max_iterations,
+       max_moved, pools, pg_bytes](int) {
+	std::stringstream ss;
+	boost::scoped_ptr<Formatter> f(Formatter::create(format));
+	OSDMap::Incremental pending_inc;
+	map<int64_t,map<int,float>> weights;
+	int moved = osdmap->calc_choose_args(
+	  g_ceph_context, g_conf->mgr_weight_set_max_deviation,
+	  max_iterations, max_moved, mode == "per-pool", pools, pg_bytes,
+	  &weights, &pending_inc);
+	if (moved < 0) {
+	  ss << "failed to optimize weight-sets";
+	  cmdctx->reply(moved, ss);
+	  return;
+	}
+	if (f) {
+	  f->open_object_section("weight_sets");
+	  f->dump_int("pgs_moved", moved);
+	  f->open_array_section("weight_sets");
+	  for (auto& i : weights) {
+	    f->open_object_section("weight_set");
+	    if (i.first == CrushWrapper::DEFAULT_CHOOSE_ARGS) {
+	      f->dump_string("pool", "(compat)");
+	    } else {
+	      f->dump_string("pool", osdmap->get_pool_name(i.first));
+	    }
+	    f->open_array_section("weights");
+	    for (auto& p : i.second) {
+	      f->open_object_section("item");
+	      f->dump_int("id", p.first);
+	      f->dump_float("weight", p.second);
+	      f->close_section();
+	    }
+	    f->close_section();
+	    f->close_section();
+	  }
+	  f->close_section();
+	  f->close_section();
+	  f->flush(cmdctx->odata);
+	} else {
+	  for (auto& i : weights) {
+	    for (auto& p : i.second) {
+	      ss << (i.first == CrushWrapper::DEFAULT_CHOOSE_ARGS ?
+		     string("(compat)") : osdmap->get_pool_name(i.first))
+		 << " " << osdmap->crush->get_item_name(p.first)
+		 << " " << p.second << "\n";
+	    }
+	  }
+	  cmdctx->odata.append(ss.str());
+	}
+	ss.str("");
+	if (!pending_inc.crush.length()) {
+	  ss << "no change";
+	  cmdctx->reply(0, ss);
+	  return;
+	}
+	if (dry_run) {
+	  ss << "would move " << moved << " pgs";
+	  cmdctx->reply(0, ss);
+	  return;
+	}
+	const string cmd =
+	  "{"
+	  "\"prefix\": \"osd setcrushmap\", "
+	  "\"prior_version\": " +
+	  std::to_string(osdmap->get_crush_version()) +
+	  "}";
+	auto on_finish = new ReplyOnFinish(cmdctx);
+	monc->start_mon_command({cmd}, pending_inc.crush,
+				&on_finish->from_mon, &on_finish->outs,
+				on_finish);
+      }));
+    return true;
   } else if (prefix == "osd df") {
     string method;
     cmd_getval(g_ceph_context, cmdctx->cmdmap, "output_method", method);
@@ -106,6 +106,22 @@ COMMAND("osd test-reweight-by-pg " \
 	"name=pools,type=CephPoolname,n=N,req=false",			\
 	"dry run of reweight OSDs by PG distribution [overload-percentage-for-consideration, default 120]", \
 	"osd", "r", "cli,rest")
+COMMAND("osd crush weight-set optimize " \
+	"name=mode,type=CephChoices,strings=compat|per-pool,req=false " \
+	"name=by,type=CephChoices,strings=pgs|bytes,req=false " \
+	"name=max_iterations,type=CephInt,range=1,req=false " \
+	"name=max_moved,type=CephInt,range=0,req=false " \
+	"name=pools,type=CephPoolname,n=N,req=false", \
+	"adjust crush weight-sets to balance PGs or bytes [mode default compat, by default pgs]", \
+	"osd", "rw", "cli,rest")
+COMMAND("osd crush weight-set test-optimize " \
+	"name=mode,type=CephChoices,strings=compat|per-pool,req=false " \
+	"name=by,type=CephChoices,strings=pgs|bytes,req=false " \
+	"name=max_iterations,type=CephInt,range=1,req=false " \
+	"name=max_moved,type=CephInt,range=0,req=false " \
+	"name=pools,type=CephPoolname,n=N,req=false", \
+	"dry run of adjusting crush weight-sets to balance PGs or bytes", \
+	"osd", "r", "cli,rest")
 
 COMMAND("osd scrub " \
 	"name=who,type=CephString", \
@@ -1034,7 +1034,7 @@ void OSDMonitor::encode_pending(MonitorDBStore::TransactionRef t)
         // auto-enable pool applications upon upgrade
         // NOTE: this can be removed post-Luminous assuming upgrades need to
         // proceed through Luminous
-        for (auto &pool_pair : tmp.pools) {
+        for (auto &pool_pair : *tmp.pools) {
           int64_t pool_id = pool_pair.first;
           pg_pool_t pg_pool = pool_pair.second;
           if (pg_pool.is_tier()) {
@@ -2409,8 +2409,8 @@ bool OSDMonitor::prepare_boot(MonOpRequestRef op)
 	(g_conf->mon_osd_auto_mark_new_in && (oldstate & CEPH_OSD_NEW)) ||
 	(g_conf->mon_osd_auto_mark_in)) {
       if (can_mark_in(from)) {
-	if (osdmap.osd_xinfo[from].old_weight > 0) {
-	  pending_inc.new_weight[from] = osdmap.osd_xinfo[from].old_weight;
+	if (osdmap.get_xinfo(from).old_weight > 0) {
+	  pending_inc.new_weight[from] = osdmap.get_xinfo(from).old_weight;
 	  xi.old_weight = 0;
 	} else {
 	  pending_inc.new_weight[from] = CEPH_OSD_IN;
@@ -2837,7 +2837,7 @@ bool OSDMonitor::prepare_remove_snaps(MonOpRequestRef op)
       continue;
     }
 
-    pg_pool_t& pi = osdmap.pools[p->first];
+    const pg_pool_t& pi = *osdmap.get_pg_pool(p->first);
     for (vector<snapid_t>::iterator q = p->second.begin();
 	 q != p->second.end();
 	 ++q) {
@@ -3391,7 +3391,7 @@ void OSDMonitor::tick()
 
 	  // remember previous weight
 	  if (pending_inc.new_xinfo.count(o) == 0)
-	    pending_inc.new_xinfo[o] = osdmap.osd_xinfo[o];
+	    pending_inc.new_xinfo[o] = osdmap.get_xinfo(o);
 	  pending_inc.new_xinfo[o].old_weight = osdmap.osd_weight[o];
 
 	  do_propose = true;
@@ -3706,8 +3706,8 @@ void OSDMonitor::get_health(list<pair<health_status_t,string> >& summary,
     // hit_set-less cache_mode?
     if (g_conf->mon_warn_on_cache_pools_without_hit_sets) {
       int problem_cache_pools = 0;
-      for (map<int64_t, pg_pool_t>::const_iterator p = osdmap.pools.begin();
-	   p != osdmap.pools.end();
+      for (map<int64_t, pg_pool_t>::const_iterator p = osdmap.pools->begin();
+	   p != osdmap.pools->end();
 	   ++p) {
 	const pg_pool_t& info = p->second;
 	if (info.cache_mode_requires_hit_set() &&
@@ -4322,8 +4322,8 @@ bool OSDMonitor::preprocess_command(MonOpRequestRef op)
     cmd_getval(g_ceph_context, cmdmap, "auid", auid, int64_t(0));
     if (f)
       f->open_array_section("pools");
-    for (map<int64_t, pg_pool_t>::iterator p = osdmap.pools.begin();
-	 p != osdmap.pools.end();
+    for (map<int64_t, pg_pool_t>::const_iterator p = osdmap.pools->begin();
+	 p != osdmap.pools->end();
 	 ++p) {
       if (!auid || p->second.auid == (uint64_t)auid) {
 	if (f) {
@@ -8247,7 +8247,7 @@ bool OSDMonitor::prepare_command_impl(MonOpRequestRef op,
     if (erasure_code_profile_in_use(pending_inc.new_pools, name, &ss))
       goto wait;
 
-    if (erasure_code_profile_in_use(osdmap.pools, name, &ss)) {
+    if (erasure_code_profile_in_use(*osdmap.pools, name, &ss)) {
       err = -EBUSY;
       goto reply;
     }
@@ -8819,7 +8819,7 @@ bool OSDMonitor::prepare_command_impl(MonOpRequestRef op,
 	    pending_inc.new_weight[osd] = CEPH_OSD_OUT;
 	    if (osdmap.osd_weight[osd]) {
 	      if (pending_inc.new_xinfo.count(osd) == 0) {
-	        pending_inc.new_xinfo[osd] = osdmap.osd_xinfo[osd];
+	        pending_inc.new_xinfo[osd] = osdmap.get_xinfo(osd);
 	      }
 	      pending_inc.new_xinfo[osd].old_weight = osdmap.osd_weight[osd];
 	    }
@@ -8842,10 +8842,10 @@ bool OSDMonitor::prepare_command_impl(MonOpRequestRef op,
             if (verbose)
 	      ss << "osd." << osd << " is already in. ";
 	  } else {
-	    if (osdmap.osd_xinfo[osd].old_weight > 0) {
-	      pending_inc.new_weight[osd] = osdmap.osd_xinfo[osd].old_weight;
+	    if (osdmap.get_xinfo(osd).old_weight > 0) {
+	      pending_inc.new_weight[osd] = osdmap.get_xinfo(osd).old_weight;
 	      if (pending_inc.new_xinfo.count(osd) == 0) {
-	        pending_inc.new_xinfo[osd] = osdmap.osd_xinfo[osd];
+	        pending_inc.new_xinfo[osd] = osdmap.get_xinfo(osd);
 	      }
 	      pending_inc.new_xinfo[osd].old_weight = 0;
 	    } else {
@@ -26,6 +26,7 @@ class Connection;
 class AuthAuthorizer;
 class CryptoKey;
 class CephContext;
+struct ceph_msg_header;
 
 class Dispatcher {
 public:
@@ -90,6 +91,42 @@ public:
    * @param m A message which has been received
    */
   virtual void ms_fast_preprocess(Message *m) {}
+  /**
+   * Let the Dispatcher provide the buffers the data payload of an
+   * incoming Message is read into. This is called from the Messenger's
+   * reader as soon as the header, front and middle are in, and like
+   * ms_fast_preprocess it must be essentially lock-free. It lets a
+   * Dispatcher that knows what it will do with the payload (e.g. write
+   * it to disk with O_DIRECT) pick the alignment and allocator.
+   *
+   * @param con The Connection the Message is arriving on.
+   * @param header The header of the incoming Message.
+   * @param data Empty bufferlist to be filled with exactly
+   * header.data_len bytes of (uninitialized) buffer space.
+   * @returns True if @p data was filled; false to let the Messenger
+   * allocate as usual.
+   */
+  virtual bool ms_fast_alloc_data(Connection *con,
+				  const ceph_msg_header& header,
+				  bufferlist *data) {
+    return false;
+  }
+  /**
+   * Let the Messenger hand the data payload of an incoming Message over
+   * in the transport's own receive buffers (rdma, dpdk) instead of
+   * copying it out of them. Those buffers belong to the Messenger, so
+   * only a Dispatcher that drops every reference to message data before
+   * the Messenger is destroyed may accept them. Asked only when
+   * ms_fast_alloc_data() did not provide buffers.
+   *
+   * @param con The Connection the Message is arriving on.
+   * @param header The header of the incoming Message.
+   * @returns True to accept the transport's buffers.
+   */
+  virtual bool ms_can_zero_copy_rx(Connection *con,
+				   const ceph_msg_header& header) {
+    return false;
+  }
   /**
    * The Messenger calls this function to deliver a single message.
    *
@@ -6,6 +6,8 @@
 #include "include/Spinlock.h"
 
 #include "include/types.h"
+#include "include/ipaddr.h"
+#include "include/str_list.h"
 #include "Messenger.h"
 
 #include "msg/simple/SimpleMessenger.h"
@@ -85,3 +87,31 @@ int Messenger::get_default_crc_flags(md_config_t * conf)
     r |= MSG_CRC_HEADER;
   return r;
 }
+
+vector<pair<sockaddr_storage, unsigned>> Messenger::get_crc_trusted_networks(
+  CephContext *cct)
+{
+  vector<pair<sockaddr_storage, unsigned>> nets;
+  list<string> l;
+  get_str_list(cct->_conf->ms_crc_data_trusted_networks, l);
+  for (auto& s : l) {
+    sockaddr_storage net;
+    unsigned prefix_len;
+    if (!parse_network(s.c_str(), &net, &prefix_len)) {
+      lderr(cct) << "unable to parse network '" << s
+		 << "' in ms_crc_data_trusted_networks" << dendl;
+      continue;
+    }
+    nets.push_back(make_pair(net, prefix_len));
+  }
+  return nets;
+}
+
+bool Messenger::is_crc_trusted(const entity_addr_t& peer) const
+{
+  for (auto& p : crc_trusted_networks) {
+    if (network_contains(p.first, p.second, peer.get_sockaddr()))
+      return true;
+  }
+  return false;
+}
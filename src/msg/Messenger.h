@@ -71,6 +71,12 @@ public:
   CephContext *cct;
   int crcflags;
 
+private:
+  /// peers on these networks are sent data without a data crc
+  vector<pair<sockaddr_storage, unsigned>> crc_trusted_networks;
+
+public:
+
   /**
    * A Policy describes the rules of a Connection. Is there a limit on how
    * much data this Connection can have locally? When the underlying connection
@@ -146,7 +152,8 @@ public:
       magic(0),
       socket_priority(-1),
       cct(cct_),
-      crcflags(get_default_crc_flags(cct->_conf))
+      crcflags(get_default_crc_flags(cct->_conf)),
+      crc_trusted_networks(get_crc_trusted_networks(cct))
   {
     my_inst.name = w;
   }
@@ -281,6 +288,22 @@ public:
    * but not yet dispatched.
    */
   static int get_default_crc_flags(md_config_t *);
+  static vector<pair<sockaddr_storage, unsigned>> get_crc_trusted_networks(
+    CephContext *cct);
+  /**
+   * Get the crc flags to encode a message for @p peer with.
+   *
+   * Data crcs are skipped for peers on ms_crc_data_trusted_networks. The
+   * footer then carries CEPH_MSG_FOOTER_NOCRC, which tells the receiver
+   * not to check it either.
+   */
+  int get_send_crc_flags(const entity_addr_t& peer) const {
+    if ((crcflags & MSG_CRC_DATA) && is_crc_trusted(peer))
+      return crcflags & ~MSG_CRC_DATA;
+    return crcflags;
+  }
+  /// true if @p peer is on one of ms_crc_data_trusted_networks
+  bool is_crc_trusted(const entity_addr_t& peer) const;
 
   /**
    * @} // Accessors
@@ -609,6 +632,42 @@ public:
       (*p)->ms_fast_preprocess(m);
     }
   }
+  /**
+   * Ask each fast Dispatcher in turn for the buffers to read an incoming
+   * Message's data payload into.
+   *
+   * @param con The Connection the Message is arriving on.
+   * @param header The header of the incoming Message.
+   * @param data Empty bufferlist to fill.
+   * @returns True if a Dispatcher filled @p data.
+   */
+  bool ms_fast_alloc_data(Connection *con, const ceph_msg_header& header,
+			  bufferlist *data) {
+    for (list<Dispatcher*>::iterator p = fast_dispatchers.begin();
+	 p != fast_dispatchers.end();
+	 ++p) {
+      if ((*p)->ms_fast_alloc_data(con, header, data))
+	return true;
+    }
+    return false;
+  }
+  /**
+   * Ask the fast Dispatchers whether an incoming Message's data payload
+   * may be left in the transport's receive buffers.
+   *
+   * @param con The Connection the Message is arriving on.
+   * @param header The header of the incoming Message.
+   * @returns True if a Dispatcher accepts them.
+   */
+  bool ms_can_zero_copy_rx(Connection *con, const ceph_msg_header& header) {
+    for (list<Dispatcher*>::iterator p = fast_dispatchers.begin();
+	 p != fast_dispatchers.end();
+	 ++p) {
+      if ((*p)->ms_can_zero_copy_rx(con, header))
+	return true;
+    }
+    return false;
+  }
   /**
    *  Deliver a single Message. Send it to each Dispatcher
    *  in sequence until one of them handles it.
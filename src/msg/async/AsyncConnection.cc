@@ -14,10 +14,12 @@
  *
  */
 
+#include <limits.h>
 #include <unistd.h>
 
 #include "include/Context.h"
 #include "common/errno.h"
+#include "include/crc32c.h"
 #include "AsyncMessenger.h"
 #include "AsyncConnection.h"
 
@@ -97,6 +99,10 @@ class C_tick_wakeup : public EventCallback {
   }
 };
 
+// data is read and checksummed in pieces of at most this size when the
+// data crc is computed on the fly, so each piece is still in cache
+static const unsigned DATA_CRC_CHUNK = 64 << 10;
+
 static void alloc_aligned_buffer(bufferlist& data, unsigned len, unsigned off)
 {
   // create a buffer to read into that matches the data alignment
@@ -330,6 +336,11 @@ void AsyncConnection::process()
   std::lock_guard<std::mutex> l(lock);
   last_active = ceph::coarse_mono_clock::now();
   auto recv_start_time = ceph::mono_clock::now();
+  if (cs) {
+    // zero-copy send completions poll as an error on the socket; drain
+    // them here even if this state reads nothing, lest we spin on them
+    cs.reap_send_completions();
+  }
   do {
     ldout(async_msgr->cct, 20) << __func__ << " prev state is " << get_state_name(prev_state) << dendl;
     prev_state = state;
@@ -606,6 +617,8 @@ void AsyncConnection::process()
           // read data
           unsigned data_len = le32_to_cpu(current_header.data_len);
           unsigned data_off = le32_to_cpu(current_header.data_off);
+          unsigned zero_copy_min = async_msgr->cct->_conf->ms_async_zero_copy_rx_min_size;
+          data_zero_copy = false;
           if (data_len) {
             // get a buffer
             map<ceph_tid_t,pair<bufferlist,int> >::iterator p = rx_buffers.find(current_header.tid);
@@ -618,6 +631,15 @@ void AsyncConnection::process()
               if (data_buf.length() < data_len)
                 data_buf.push_back(buffer::create(data_len - data_buf.length()));
               data_blp = data_buf.begin();
+            } else if (async_msgr->ms_fast_alloc_data(this, current_header, &data_buf)) {
+              ldout(async_msgr->cct,20) << __func__ << " dispatcher provided rx buffer at offset " << data_off << dendl;
+              assert(data_buf.length() == data_len);
+              data_blp = data_buf.begin();
+            } else if (zero_copy_min && data_len >= zero_copy_min &&
+                       async_msgr->get_stack()->support_zero_copy_read() &&
+                       async_msgr->ms_can_zero_copy_rx(this, current_header)) {
+              ldout(async_msgr->cct,20) << __func__ << " reading data in place at offset " << data_off << dendl;
+              data_zero_copy = true;
             } else {
               ldout(async_msgr->cct,20) << __func__ << " allocating new rx buffer at offset " << data_off << dendl;
               alloc_aligned_buffer(data_buf, data_len, data_off);
@@ -625,26 +647,81 @@ void AsyncConnection::process()
             }
           }
 
+          // checksum the data while it is still hot in cache rather than
+          // walking the whole payload again in decode_message
+          data_crc_fused = data_len && (async_msgr->crcflags & MSG_CRC_DATA) &&
+            !async_msgr->is_crc_trusted(get_peer_addr());
+          data_crc = 0;
+          data_seg_read = 0;
           msg_left = data_len;
           state = STATE_OPEN_MESSAGE_READ_DATA;
         }
 
       case STATE_OPEN_MESSAGE_READ_DATA:
         {
-          while (msg_left > 0) {
-            bufferptr bp = data_blp.get_current_ptr();
-            unsigned read = MIN(bp.length(), msg_left);
-            r = read_until(read, bp.c_str());
-            if (r < 0) {
-              ldout(async_msgr->cct, 1) << __func__ << " read data error " << dendl;
-              goto fail;
-            } else if (r > 0) {
-              break;
+          // data_blp is not set up for in place reads; when those stop
+          // short, wait for more rather than falling back to copying
+          if (data_zero_copy) {
+            while (msg_left > 0) {
+              bufferptr bp;
+              if (recv_end > recv_start) {
+                // the head of the data may already sit in the prefetch buffer
+                bp = buffer::create(MIN(recv_end - recv_start, msg_left));
+                r = read_until(bp.length(), bp.c_str());
+                assert(r == 0);
+              } else {
+                r = cs.zero_copy_read_upto(bp, msg_left);
+                if (r == -EAGAIN) {
+                  break;
+                } else if (r <= 0) {
+                  ldout(async_msgr->cct, 1) << __func__ << " read data error "
+                                            << cpp_strerror(r) << dendl;
+                  goto fail;
+                }
+              }
+
+              if (data_crc_fused) {
+                uint32_t base = data_crc;
+                data_crc = ceph_crc32c(data_crc, (unsigned char*)bp.c_str(), bp.length());
+                bp.set_crc(base, data_crc);
+              }
+              msg_left -= bp.length();
+              data.append(std::move(bp));
             }
+          } else {
+            while (msg_left > 0) {
+              bufferptr bp = data_blp.get_current_ptr();
+              unsigned read = MIN(bp.length(), msg_left);
+              if (data_crc_fused)
+                read = MIN(read, DATA_CRC_CHUNK);
+              r = read_until(read, bp.c_str());
+              if (r < 0) {
+                ldout(async_msgr->cct, 1) << __func__ << " read data error " << dendl;
+                goto fail;
+              } else if (r > 0) {
+                break;
+              }
 
-            data_blp.advance(read);
-            data.append(bp, 0, read);
-            msg_left -= read;
+              if (!data_seg_read)
+                data_seg_crc = data_crc;
+              if (data_crc_fused)
+                data_crc = ceph_crc32c(data_crc, (unsigned char*)bp.c_str(), read);
+              data_blp.advance(read);
+              // one data ptr per data_buf ptr, never merged with the previous
+              // one, so that the layout of data_buf and the crc cached for
+              // each ptr hold in data
+              if (data_seg_read)
+                data.append(bp, 0, read);
+              else
+                data.push_back(bufferptr(bp, 0, read));
+              data_seg_read += read;
+              msg_left -= read;
+              if (read == bp.length() || !msg_left) {
+                if (data_crc_fused)
+                  data.buffers().back().set_crc(data_seg_crc, data_crc);
+                data_seg_read = 0;
+              }
+            }
           }
 
           if (msg_left > 0)
@@ -692,7 +769,17 @@ void AsyncConnection::process()
 
           ldout(async_msgr->cct, 20) << __func__ << " got " << front.length() << " + " << middle.length()
                               << " + " << data.length() << " byte message" << dendl;
-          Message *message = decode_message(async_msgr->cct, async_msgr->crcflags, current_header, footer,
+          int crcflags = async_msgr->crcflags;
+          if (data_crc_fused) {
+            if ((footer.flags & CEPH_MSG_FOOTER_NOCRC) == 0 &&
+                data_crc != footer.data_crc) {
+              ldout(async_msgr->cct, 0) << __func__ << " bad crc in data " << data_crc
+                                        << " != exp " << footer.data_crc << dendl;
+              goto fail;
+            }
+            crcflags &= ~MSG_CRC_DATA;
+          }
+          Message *message = decode_message(async_msgr->cct, crcflags, current_header, footer,
                                             front, middle, data, this);
           if (!message) {
             ldout(async_msgr->cct, 1) << __func__ << " decode message failed " << dendl;
@@ -890,6 +977,7 @@ ssize_t AsyncConnection::_process_connection()
         SocketOptions opts;
         opts.priority = async_msgr->get_socket_priority();
         opts.connect_bind_addr = msgr->get_myaddr();
+        opts.zerocopy_threshold = async_msgr->cct->_conf->ms_tcp_zerocopy_threshold;
         r = worker->connect(get_peer_addr(), opts, &cs);
         if (r < 0)
           goto fail;
@@ -1421,6 +1509,7 @@ int AsyncConnection::handle_connect_reply(ceph_msg_connect &connect, ceph_msg_co
     was_session_reset();
     // see was_session_reset
     outcoming_bl.clear();
+    out_batch_messages = 0;
     state = STATE_CONNECTING_SEND_CONNECT_MSG;
   }
   if (reply.tag == CEPH_MSGR_TAG_RETRY_GLOBAL) {
@@ -1715,6 +1804,7 @@ ssize_t AsyncConnection::handle_connect_msg(ceph_msg_connect &connect, bufferlis
         existing->write_lock.lock();
         existing->requeue_sent();
         existing->outcoming_bl.clear();
+        existing->out_batch_messages = 0;
         existing->open_write = false;
         existing->write_lock.unlock();
         if (existing->state == STATE_NONE) {
@@ -2064,6 +2154,7 @@ void AsyncConnection::fault()
   replacing = false;
   is_reset_from_peer = false;
   outcoming_bl.clear();
+  out_batch_messages = 0;
   if (!once_ready && !is_queued() &&
       state >=STATE_ACCEPTING && state <= STATE_ACCEPTING_WAIT_CONNECT_MSG_AUTH) {
     ldout(async_msgr->cct, 10) << __func__ << " with nothing to send and in the half "
@@ -2178,13 +2269,22 @@ void AsyncConnection::prepare_send_message(uint64_t features, Message *m, buffer
                                << features << " " << m << " " << *m << dendl;
 
   // encode and copy out of *m
-  m->encode(features, msgr->crcflags);
+  m->encode(features, msgr->get_send_crc_flags(get_peer_addr()));
 
   bl.append(m->get_payload());
   bl.append(m->get_middle());
   bl.append(m->get_data());
 }
 
+ssize_t AsyncConnection::_flush_batch(bool more)
+{
+  if (out_batch_messages) {
+    logger->inc(l_msgr_send_batch_messages, out_batch_messages);
+    out_batch_messages = 0;
+  }
+  return _try_send(more);
+}
+
 ssize_t AsyncConnection::write_message(Message *m, bufferlist& bl, bool more)
 {
   FUNCTRACE();
@@ -2267,16 +2367,25 @@ ssize_t AsyncConnection::write_message(Message *m, bufferlist& bl, bool more)
   m->trace.event("async writing message");
   ldout(async_msgr->cct, 20) << __func__ << " sending " << m->get_seq()
                              << " " << m << dendl;
-  ssize_t total_send_size = outcoming_bl.length();
-  ssize_t rc = _try_send(more);
+  logger->inc(l_msgr_send_bytes, outcoming_bl.length() - original_bl_len);
+  ++out_batch_messages;
+
+  // Coalesce everything handle_write drains in one wakeup into as few
+  // sends as possible; the batch is flushed there once out_q is empty,
+  // or here early (corked, if more is coming) when it grows too large.
+  ssize_t rc = 0;
+  const auto& conf = async_msgr->cct->_conf;
+  if (out_batch_messages >= conf->ms_async_send_batch_messages ||
+      outcoming_bl.length() >= conf->ms_async_send_batch_bytes ||
+      outcoming_bl.get_num_buffers() >= IOV_MAX) {
+    rc = _flush_batch(more);
+  }
   if (rc < 0) {
     ldout(async_msgr->cct, 1) << __func__ << " error sending " << m << ", "
                               << cpp_strerror(rc) << dendl;
   } else if (rc == 0) {
-    logger->inc(l_msgr_send_bytes, total_send_size - original_bl_len);
     ldout(async_msgr->cct, 10) << __func__ << " sending " << m << " done." << dendl;
   } else {
-    logger->inc(l_msgr_send_bytes, total_send_size - outcoming_bl.length());
     ldout(async_msgr->cct, 10) << __func__ << " sending " << m << " continuely." << dendl;
   }
   if (m->get_type() == CEPH_MSG_OSD_OP)
@@ -2471,6 +2580,7 @@ void AsyncConnection::handle_write()
     } while (can_write == WriteStatus::CANWRITE);
     write_lock.unlock();
 
+    // the ack rides along with whatever is left of the batch
     uint64_t left = ack_left;
     if (left) {
       ceph_le64 s;
@@ -2480,9 +2590,9 @@ void AsyncConnection::handle_write()
       ldout(async_msgr->cct, 10) << __func__ << " try send msg ack, acked " << left << " messages" << dendl;
       ack_left -= left;
       left = ack_left;
-      r = _try_send(left);
+      r = _flush_batch(left);
     } else if (is_queued()) {
-      r = _try_send();
+      r = _flush_batch(false);
     }
 
     logger->tinc(l_msgr_running_send_time, ceph::mono_clock::now() - start);
@@ -75,6 +75,7 @@ class AsyncConnection : public Connection {
   void handle_ack(uint64_t seq);
   void _append_keepalive_or_ack(bool ack=false, utime_t *t=NULL);
   ssize_t write_message(Message *m, bufferlist& bl, bool more);
+  ssize_t _flush_batch(bool more);
   void inject_delay();
   ssize_t _reply_accept(char tag, ceph_msg_connect &connect, ceph_msg_connect_reply &reply,
                     bufferlist &authorizer_reply) {
@@ -306,6 +307,7 @@ class AsyncConnection : public Connection {
 
   // lockfree, only used in own thread
   bufferlist outcoming_bl;
+  unsigned out_batch_messages = 0;  ///< messages in outcoming_bl not yet flushed
   bool open_write = false;
 
   std::mutex write_lock;
@@ -346,6 +348,11 @@ class AsyncConnection : public Connection {
   ceph_msg_header current_header;
   bufferlist data_buf;
   bufferlist::iterator data_blp;
+  bool data_zero_copy = false;  ///< data references the transport's rx buffers
+  bool data_crc_fused = false;  ///< data crc is computed as the data is read
+  uint32_t data_crc = 0;
+  unsigned data_seg_read = 0;   ///< bytes read into the current data_buf ptr
+  uint32_t data_seg_crc = 0;    ///< data_crc before that ptr
   bufferlist front, middle, data;
   ceph_msg_connect connect_msg;
   // Connecting state
@@ -165,6 +165,7 @@ void Processor::accept()
   opts.nodelay = msgr->cct->_conf->ms_tcp_nodelay;
   opts.rcbuf_size = msgr->cct->_conf->ms_tcp_rcvbuf;
   opts.priority = msgr->get_socket_priority();
+  opts.zerocopy_threshold = msgr->cct->_conf->ms_tcp_zerocopy_threshold;
   while (true) {
     entity_addr_t addr;
     ConnectedSocket cli_socket;
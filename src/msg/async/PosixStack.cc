@@ -21,6 +21,8 @@
 #include <errno.h>
 
 #include <algorithm>
+#include <deque>
+#include <map>
 
 #include "PosixStack.h"
 
@@ -47,9 +49,40 @@ class PosixConnectedSocketImpl final : public ConnectedSocketImpl {
   bool sigpipe_unblock;
 #endif
 
+  // MSG_ZEROCOPY: the kernel numbers each zero-copy sendmsg() on the
+  // socket, and reports ranges of those numbers on the error queue
+  // once it no longer needs their pages.  we keep the sent data
+  // referenced until then.
+  unsigned zerocopy_threshold;
+  PerfCounters *logger;
+  uint32_t zc_next = 0;   ///< number of the next zero-copy sendmsg()
+  uint32_t zc_done = 0;   ///< all sends numbered below this completed
+  std::map<uint32_t, uint32_t> zc_done_ahead; ///< completed, past zc_done
+  /// sent data, by the number of the last zero-copy send it was part of
+  std::deque<std::pair<uint32_t, bufferlist>> zc_pinned;
+
  public:
-  explicit PosixConnectedSocketImpl(NetHandler &h, const entity_addr_t &sa, int f, bool connected)
-      : handler(h), _fd(f), sa(sa), connected(connected) {}
+  explicit PosixConnectedSocketImpl(NetHandler &h, const entity_addr_t &sa, int f, bool connected,
+				    unsigned zc_threshold = 0, PerfCounters *l = nullptr)
+      : handler(h), _fd(f), sa(sa), connected(connected),
+	zerocopy_threshold(zc_threshold), logger(l) {}
+
+  // turn on SO_ZEROCOPY for sd, and return the zerocopy_threshold to
+  // use with it: 0 if the kernel does not support it
+  static unsigned enable_zerocopy(CephContext *cct, int sd, unsigned threshold)
+  {
+    if (!threshold)
+      return 0;
+#ifdef __linux__
+    int on = 1;
+    if (::setsockopt(sd, SOL_SOCKET, SO_ZEROCOPY, &on, sizeof(on)) == 0)
+      return threshold;
+    int r = -errno;
+    ldout(cct, 1) << __func__ << " SO_ZEROCOPY not supported: "
+		  << cpp_strerror(r) << dendl;
+#endif
+    return 0;
+  }
 
   int is_connected() override {
     if (connected)
@@ -71,6 +104,8 @@ class PosixConnectedSocketImpl final : public ConnectedSocketImpl {
   }
 
   ssize_t read(char *buf, size_t len) override {
+    if (!zc_pinned.empty())
+      reap_send_completions();
     ssize_t r = ::read(_fd, buf, len);
     if (r < 0)
       r = -errno;
@@ -141,7 +176,10 @@ class PosixConnectedSocketImpl final : public ConnectedSocketImpl {
 
   // return the sent length
   // < 0 means error occured
-  static ssize_t do_sendmsg(int fd, struct msghdr &msg, unsigned len, bool more)
+  // *zc_sends is increased by the number of sendmsg() calls that went
+  // out with MSG_ZEROCOPY
+  static ssize_t do_sendmsg(int fd, struct msghdr &msg, unsigned len, bool more,
+			    int flags, unsigned *zc_sends)
   {
     suppress_sigpipe();
 
@@ -149,9 +187,9 @@ class PosixConnectedSocketImpl final : public ConnectedSocketImpl {
     while (1) {
       ssize_t r;
   #if defined(MSG_NOSIGNAL)
-      r = ::sendmsg(fd, &msg, MSG_NOSIGNAL | (more ? MSG_MORE : 0));
+      r = ::sendmsg(fd, &msg, MSG_NOSIGNAL | flags | (more ? MSG_MORE : 0));
   #else
-      r = ::sendmsg(fd, &msg, (more ? MSG_MORE : 0));
+      r = ::sendmsg(fd, &msg, flags | (more ? MSG_MORE : 0));
   #endif /* defined(MSG_NOSIGNAL) */
 
       if (r < 0) {
@@ -159,10 +197,20 @@ class PosixConnectedSocketImpl final : public ConnectedSocketImpl {
           continue;
         } else if (errno == EAGAIN) {
           break;
+  #ifdef __linux__
+        } else if (errno == ENOBUFS && (flags & MSG_ZEROCOPY)) {
+          // out of optmem to track the pinned pages; just copy
+          flags &= ~MSG_ZEROCOPY;
+          continue;
+  #endif
         }
         return -errno;
       }
 
+  #ifdef __linux__
+      if (flags & MSG_ZEROCOPY)
+        ++*zc_sends;
+  #endif
       sent += r;
       if (len == sent) break;
 
@@ -184,7 +232,12 @@ class PosixConnectedSocketImpl final : public ConnectedSocketImpl {
   }
 
   ssize_t send(bufferlist &bl, bool more) override {
+    if (!zc_pinned.empty())
+      reap_send_completions();
+
     size_t sent_bytes = 0;
+    unsigned zc_sends = 0;
+    uint64_t zc_bytes = 0;
     std::list<bufferptr>::const_iterator pb = bl.buffers().begin();
     uint64_t left_pbrs = bl.buffers().size();
     while (left_pbrs) {
@@ -196,18 +249,31 @@ class PosixConnectedSocketImpl final : public ConnectedSocketImpl {
       msg.msg_iovlen = 0;
       msg.msg_iov = msgvec;
       unsigned msglen = 0;
+      bool zerocopy = false;
       while (size > 0) {
         msgvec[msg.msg_iovlen].iov_base = (void*)(pb->c_str());
         msgvec[msg.msg_iovlen].iov_len = pb->length();
         msg.msg_iovlen++;
         msglen += pb->length();
+        if (zerocopy_threshold && pb->length() >= zerocopy_threshold)
+          zerocopy = true;
         ++pb;
         size--;
       }
 
-      ssize_t r = do_sendmsg(_fd, msg, msglen, left_pbrs || more);
+      int flags = 0;
+  #ifdef __linux__
+      if (zerocopy)
+        flags |= MSG_ZEROCOPY;
+  #endif
+      unsigned calls = 0;
+      ssize_t r = do_sendmsg(_fd, msg, msglen, left_pbrs || more, flags, &calls);
       if (r < 0)
         return r;
+      if (calls) {
+        zc_sends += calls;
+        zc_bytes += r;
+      }
 
       // "r" is the remaining length
       sent_bytes += r;
@@ -222,12 +288,67 @@ class PosixConnectedSocketImpl final : public ConnectedSocketImpl {
         bl.splice(sent_bytes, bl.length()-sent_bytes, &swapped);
         bl.swap(swapped);
       } else {
-        bl.clear();
+        swapped.swap(bl);
+      }
+      if (zc_sends) {
+        // swapped is what we sent; the kernel may still be reading it
+        zc_next += zc_sends;
+        zc_pinned.emplace_back(zc_next - 1, std::move(swapped));
+        if (logger)
+          logger->inc(l_msgr_send_zerocopy_bytes, zc_bytes);
       }
     }
 
     return static_cast<ssize_t>(sent_bytes);
   }
+
+  void reap_send_completions() override {
+#ifdef __linux__
+    while (!zc_pinned.empty()) {
+      char control[CMSG_SPACE(sizeof(struct sock_extended_err)) +
+		   CMSG_SPACE(sizeof(struct sockaddr_in6))];
+      struct msghdr msg;
+      memset(&msg, 0, sizeof(msg));
+      msg.msg_control = control;
+      msg.msg_controllen = sizeof(control);
+      ssize_t r = ::recvmsg(_fd, &msg, MSG_ERRQUEUE | MSG_DONTWAIT);
+      if (r < 0)
+        break;  // EAGAIN: nothing (more) has completed
+      for (struct cmsghdr *cm = CMSG_FIRSTHDR(&msg); cm;
+           cm = CMSG_NXTHDR(&msg, cm)) {
+        if (!(cm->cmsg_level == SOL_IP && cm->cmsg_type == IP_RECVERR) &&
+            !(cm->cmsg_level == SOL_IPV6 && cm->cmsg_type == IPV6_RECVERR))
+          continue;
+        struct sock_extended_err *serr =
+          (struct sock_extended_err *)CMSG_DATA(cm);
+        if (serr->ee_errno != 0 || serr->ee_origin != SO_EE_ORIGIN_ZEROCOPY)
+          continue;
+        if ((serr->ee_code & SO_EE_CODE_ZEROCOPY_COPIED) && logger)
+          logger->inc(l_msgr_send_zerocopy_copied);
+        zerocopy_completed(serr->ee_info, serr->ee_data);
+      }
+    }
+#endif
+  }
+
+  /// sends numbered first..last (inclusive) no longer need their data
+  void zerocopy_completed(uint32_t first, uint32_t last) {
+    if (first != zc_done) {
+      zc_done_ahead[first] = last;
+    } else {
+      zc_done = last + 1;
+      for (auto p = zc_done_ahead.find(zc_done);
+           p != zc_done_ahead.end();
+           p = zc_done_ahead.find(zc_done)) {
+        zc_done = p->second + 1;
+        zc_done_ahead.erase(p);
+      }
+    }
+    // the numbers wrap around, compare them as serial numbers
+    while (!zc_pinned.empty() &&
+           (int32_t)(zc_pinned.front().first - zc_done) < 0)
+      zc_pinned.pop_front();
+  }
   void shutdown() override {
     ::shutdown(_fd, SHUT_RDWR);
   }
@@ -283,7 +404,12 @@ int PosixServerSocketImpl::accept(ConnectedSocket *sock, const SocketOptions &op
   out->set_sockaddr((sockaddr*)&ss);
   handler.set_priority(sd, opt.priority, out->get_family());
 
-  std::unique_ptr<PosixConnectedSocketImpl> csi(new PosixConnectedSocketImpl(handler, *out, sd, true));
+  std::unique_ptr<PosixConnectedSocketImpl> csi(
+    new PosixConnectedSocketImpl(
+      handler, *out, sd, true,
+      PosixConnectedSocketImpl::enable_zerocopy(w->cct, sd,
+						opt.zerocopy_threshold),
+      w->get_perf_counter()));
   *sock = ConnectedSocket(std::move(csi));
   return 0;
 }
@@ -351,7 +477,12 @@ int PosixWorker::connect(const entity_addr_t &addr, const SocketOptions &opts, C
 
   net.set_priority(sd, opts.priority, addr.get_family());
   *socket = ConnectedSocket(
-      std::unique_ptr<PosixConnectedSocketImpl>(new PosixConnectedSocketImpl(net, addr, sd, !opts.nonblock)));
+      std::unique_ptr<PosixConnectedSocketImpl>(
+	new PosixConnectedSocketImpl(
+	  net, addr, sd, !opts.nonblock,
+	  PosixConnectedSocketImpl::enable_zerocopy(cct, sd,
+						    opts.zerocopy_threshold),
+	  perf_logger)));
   return 0;
 }
 
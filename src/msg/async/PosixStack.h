@@ -42,7 +42,7 @@ class PosixNetworkStack : public NetworkStack {
  public:
   explicit PosixNetworkStack(CephContext *c, const string &t);
 
-  int get_cpuid(int id) const {
+  int get_cpuid(int id) const override {
     if (coreids.empty())
       return -1;
     return coreids[id % coreids.size()];
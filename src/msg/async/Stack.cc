@@ -16,6 +16,7 @@
 
 #include "include/compat.h"
 #include "common/Cond.h"
+#include "common/Thread.h"
 #include "common/errno.h"
 #include "PosixStack.h"
 #ifdef HAVE_RDMA
@@ -39,6 +40,14 @@ std::function<void ()> NetworkStack::add_thread(unsigned i)
       char tp_name[16];
       sprintf(tp_name, "msgr-worker-%d", w->id);
       ceph_pthread_setname(pthread_self(), tp_name);
+      if (cct->_conf->ms_async_set_affinity) {
+        int cpuid = get_cpuid(w->id);
+        if (cpuid >= 0) {
+          int r = ceph_thread_set_affinity(cpuid);
+          ldout(cct, 10) << __func__ << " pinned worker " << w->id
+                         << " to cpu " << cpuid << ": " << cpp_strerror(r) << dendl;
+        }
+      }
       const uint64_t EventMaxWaitUs = 30000000;
       w->center.set_owner();
       ldout(cct, 10) << __func__ << " starting" << dendl;
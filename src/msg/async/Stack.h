@@ -30,7 +30,13 @@ class ConnectedSocketImpl {
   virtual int is_connected() = 0;
   virtual ssize_t read(char*, size_t) = 0;
   virtual ssize_t zero_copy_read(bufferptr&) = 0;
+  /// hand out at most len received bytes without copying them
+  virtual ssize_t zero_copy_read_upto(bufferptr&, size_t len) {
+    return -EOPNOTSUPP;
+  }
   virtual ssize_t send(bufferlist &bl, bool more) = 0;
+  /// release data whose zero-copy transmission has completed
+  virtual void reap_send_completions() {}
   virtual void shutdown() = 0;
   virtual void close() = 0;
   virtual int fd() const = 0;
@@ -43,6 +49,8 @@ struct SocketOptions {
   int rcbuf_size = 0;
   int priority = -1;
   entity_addr_t connect_bind_addr;
+  /// send buffers at least this large with MSG_ZEROCOPY, 0 to disable
+  unsigned zerocopy_threshold = 0;
 };
 
 /// \cond internal
@@ -97,12 +105,27 @@ class ConnectedSocket {
   ssize_t zero_copy_read(bufferptr &data) {
     return _csi->zero_copy_read(data);
   }
+  /// Gets at most @p len bytes of the input stream.
+  ///
+  /// Unlike zero_copy_read, never returns data beyond @p len, so the
+  /// caller can stop at a message boundary.
+  ssize_t zero_copy_read_upto(bufferptr &data, size_t len) {
+    return _csi->zero_copy_read_upto(data, len);
+  }
   /// Gets the output stream.
   ///
   /// Gets an object that sends data to the remote endpoint.
   ssize_t send(bufferlist &bl, bool more) {
     return _csi->send(bl, more);
   }
+  /// Releases the data of completed zero-copy sends.
+  ///
+  /// Data sent without copying stays referenced until the kernel is
+  /// done with it.  The completions are signalled as an error
+  /// condition on the socket, so call this whenever it polls readable.
+  void reap_send_completions() {
+    _csi->reap_send_completions();
+  }
   /// Disables output to the socket.
   ///
   /// Current or future writes that have not been successfully flushed
@@ -199,6 +222,11 @@ enum {
   l_msgr_running_recv_time,
   l_msgr_running_fast_dispatch_time,
 
+  l_msgr_send_zerocopy_bytes,
+  l_msgr_send_zerocopy_copied,
+
+  l_msgr_send_batch_messages,
+
   l_msgr_last,
 };
 
@@ -239,6 +267,11 @@ class Worker {
     plb.add_time(l_msgr_running_recv_time, "msgr_running_recv_time", "The total time of message receiving");
     plb.add_time(l_msgr_running_fast_dispatch_time, "msgr_running_fast_dispatch_time", "The total time of fast dispatch");
 
+    plb.add_u64_counter(l_msgr_send_zerocopy_bytes, "msgr_send_zerocopy_bytes", "Network bytes sent with MSG_ZEROCOPY");
+    plb.add_u64_counter(l_msgr_send_zerocopy_copied, "msgr_send_zerocopy_copied", "MSG_ZEROCOPY sends the kernel copied anyway");
+
+    plb.add_u64_avg(l_msgr_send_batch_messages, "msgr_send_batch_messages", "Messages coalesced into each socket send");
+
     perf_logger = plb.create_perf_counters();
     cct->get_perfcounters_collection()->add(perf_logger);
   }
@@ -298,6 +331,11 @@ class NetworkStack : public CephContext::ForkWatcher {
   vector<Worker*> workers;
 
   explicit NetworkStack(CephContext *c, const string &t);
+
+  /// cpu worker @p id should be pinned to, or -1 to leave it alone
+  virtual int get_cpuid(int id) const {
+    return -1;
+  }
  public:
   NetworkStack(const NetworkStack &) = delete;
   NetworkStack& operator=(const NetworkStack &) = delete;
@@ -312,6 +350,7 @@ class NetworkStack : public CephContext::ForkWatcher {
   static Worker* create_worker(
           CephContext *c, const string &t, unsigned i);
   // backend need to override this method if supports zero copy read
+  /// connected sockets implement zero_copy_read and zero_copy_read_upto
   virtual bool support_zero_copy_read() const { return false; }
   // backend need to override this method if backend doesn't support shared
   // listen table.
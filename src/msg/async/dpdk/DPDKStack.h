@@ -125,6 +125,25 @@ class NativeConnectedSocketImpl : public ConnectedSocketImpl {
     assert(data.length());
     return data.length();
   }
+  virtual ssize_t zero_copy_read_upto(bufferptr &data, size_t len) override {
+    if (!_cache_ptr) {
+      _cache_ptr.construct();
+      ssize_t r = zero_copy_read(*_cache_ptr);
+      if (r <= 0) {
+        _cache_ptr.destroy();
+        return r;
+      }
+    }
+    if (_cache_ptr->length() <= len) {
+      data = std::move(*_cache_ptr);
+      _cache_ptr.destroy();
+    } else {
+      data = bufferptr(*_cache_ptr, 0, len);
+      _cache_ptr->set_offset(_cache_ptr->offset() + len);
+      _cache_ptr->set_length(_cache_ptr->length() - len);
+    }
+    return data.length();
+  }
   virtual ssize_t send(bufferlist &bl, bool more) override {
     auto err = _conn.get_errno();
     if (err < 0)
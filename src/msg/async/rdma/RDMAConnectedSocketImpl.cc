@@ -14,7 +14,10 @@
  *
  */
 
+#include <limits>
+
 #include "RDMAStack.h"
+#include "common/deleter.h"
 
 #define dout_subsys ceph_subsys_ms
 #undef dout_prefix
@@ -58,6 +61,9 @@ RDMAConnectedSocketImpl::~RDMAConnectedSocketImpl()
     dispatcher->perf_logger->dec(l_msgr_rdma_inqueue_rx_chunks);
   }
   for (unsigned i=0; i < buffers.size(); ++i) {
+    // a lent chunk goes back to the srq once its last reader is done
+    if (buffers[i] == lent_chunk)
+      continue;
     ret = infiniband->post_chunk(buffers[i]);
     assert(ret == 0);
     dispatcher->perf_logger->dec(l_msgr_rdma_inqueue_rx_chunks);
@@ -334,8 +340,7 @@ ssize_t RDMAConnectedSocketImpl::read_buffers(char* buf, size_t len)
     read += tmp;
     ldout(cct, 25) << __func__ << " this iter read: " << tmp << " bytes." << " offset: " << (*c)->get_offset() << " ,bound: " << (*c)->get_bound()  << ". Chunk:" << *c  << dendl;
     if ((*c)->over()) {
-      assert(infiniband->post_chunk(*c) == 0);
-      dispatcher->perf_logger->dec(l_msgr_rdma_inqueue_rx_chunks);
+      release_rx_chunk(*c);
       ldout(cct, 25) << __func__ << " one chunk over." << dendl;
     }
     if (read == len) {
@@ -350,51 +355,105 @@ ssize_t RDMAConnectedSocketImpl::read_buffers(char* buf, size_t len)
   return read;
 }
 
-ssize_t RDMAConnectedSocketImpl::zero_copy_read(bufferptr &data)
+void RDMAConnectedSocketImpl::release_rx_chunk(Chunk *chunk)
 {
-  if (error)
-    return -error;
-  static const int MAX_COMPLETIONS = 16;
-  ibv_wc wc[MAX_COMPLETIONS];
-  ssize_t size = 0;
-
-  ibv_wc*  response;
-  Chunk* chunk;
-  bool loaded = false;
-  auto iter = buffers.begin();
-  if (iter != buffers.end()) {
-    chunk = *iter;
-    // FIXME need to handle release
-    // auto del = std::bind(&Chunk::post_srq, std::move(chunk), infiniband);
-    buffers.erase(iter);
-    loaded = true;
-    size = chunk->bound;
+  if (chunk == lent_chunk) {
+    // whoever still holds a piece of it reposts it
+    lent_chunk = nullptr;
+    lent_buffer = bufferptr();
+    return;
   }
+  assert(infiniband->post_chunk(chunk) == 0);
+  dispatcher->perf_logger->dec(l_msgr_rdma_inqueue_rx_chunks);
+}
 
-  std::vector<ibv_wc> cqe;
-  get_wc(cqe);
+void RDMAConnectedSocketImpl::queue_rx_completions(std::vector<ibv_wc> &cqe)
+{
   if (cqe.empty())
-    return size == 0 ? -EAGAIN : size;
+    return;
+  ldout(cct, 20) << __func__ << " poll queue got " << cqe.size() << " responses. QP: " << my_msg.qpn << dendl;
+  for (auto& response : cqe) {
+    assert(response.status == IBV_WC_SUCCESS);
+    Chunk* chunk = reinterpret_cast<Chunk *>(response.wr_id);
+    chunk->prepare_read(response.byte_len);
+    worker->perf_logger->inc(l_msgr_rdma_rx_bytes, response.byte_len);
+    if (response.byte_len == 0) {
+      dispatcher->perf_logger->inc(l_msgr_rdma_rx_fin);
+      if (connected) {
+        error = ECONNRESET;
+        ldout(cct, 20) << __func__ << " got remote close msg..." << dendl;
+      }
+      assert(infiniband->post_chunk(chunk) == 0);
+      dispatcher->perf_logger->dec(l_msgr_rdma_inqueue_rx_chunks);
+    } else {
+      buffers.push_back(chunk);
+    }
+  }
+  worker->perf_logger->inc(l_msgr_rdma_rx_chunks, cqe.size());
+  if (is_server && connected == 0) {
+    ldout(cct, 20) << __func__ << " we do not need last handshake, QP: " << my_msg.qpn << " peer QP: " << peer_msg.qpn << dendl;
+    connected = 1; //if so, we don't need the last handshake
+    cleanup();
+    submit(false);
+  }
+}
 
-  ldout(cct, 20) << __func__ << " pool completion queue got " << cqe.size() << " responses."<< dendl;
+ssize_t RDMAConnectedSocketImpl::zero_copy_read(bufferptr &data)
+{
+  return zero_copy_read_upto(data, std::numeric_limits<uint32_t>::max());
+}
 
-  for (size_t i = 0; i < cqe.size(); ++i) {
-    response = &wc[i];
-    chunk = reinterpret_cast<Chunk*>(response->wr_id);
-    chunk->prepare_read(response->byte_len);
-    if (!loaded && i == 0) {
-      // FIXME need to handle release
-      // auto del = std::bind(&Chunk::post_srq, std::move(chunk), infiniband);
-      size = chunk->bound;
-      continue;
+ssize_t RDMAConnectedSocketImpl::zero_copy_read_upto(bufferptr &data, size_t len)
+{
+  uint64_t i = 0;
+  int r = ::read(notify_fd, &i, sizeof(i));
+  ldout(cct, 20) << __func__ << " notify_fd : " << i << " in " << my_msg.qpn << " r = " << r << dendl;
+
+  if (buffers.empty()) {
+    std::vector<ibv_wc> cqe;
+    get_wc(cqe);
+    queue_rx_completions(cqe);
+  }
+  if (buffers.empty())
+    return error ? -error : -EAGAIN;
+
+  Chunk *chunk = buffers.front();
+  uint32_t n = MIN(chunk->get_bound() - chunk->get_offset(), len);
+  // Lent chunks stay off the srq until the message holding them is gone;
+  // keep at least half of the receive buffers posted so that a backlog of
+  // queued messages cannot starve the peers.
+  if (chunk == lent_chunk ||
+      dispatcher->lent_rx_chunks < cct->_conf->ms_async_rdma_receive_buffers / 2) {
+    if (chunk != lent_chunk) {
+      Infiniband *ib = infiniband;
+      RDMADispatcher *d = dispatcher;
+      ++d->lent_rx_chunks;
+      lent_buffer = buffer::claim_buffer(
+        chunk->bytes, chunk->buffer,
+        make_deleter([ib, d, chunk] {
+          assert(ib->post_chunk(chunk) == 0);
+          d->perf_logger->dec(l_msgr_rdma_inqueue_rx_chunks);
+          --d->lent_rx_chunks;
+        }));
+      lent_chunk = chunk;
     }
-    buffers.push_back(chunk);
-    iter++;
+    data = bufferptr(lent_buffer, chunk->get_offset(), n);
+    chunk->set_offset(chunk->get_offset() + n);
+    worker->perf_logger->inc(l_msgr_rdma_rx_zero_copy_bytes, n);
+  } else {
+    data = buffer::create(n);
+    chunk->read(data.c_str(), n);
   }
+  ldout(cct, 25) << __func__ << " got " << n << " bytes from chunk " << chunk
+                 << " " << chunk->get_offset() << ":" << chunk->get_bound() << dendl;
 
-  if (size == 0)
-    return -EAGAIN;
-  return size;
+  if (chunk->over()) {
+    release_rx_chunk(chunk);
+    buffers.erase(buffers.begin());
+  }
+  if (!buffers.empty())
+    notify();
+  return n;
 }
 
 ssize_t RDMAConnectedSocketImpl::send(bufferlist &bl, bool more)
@@ -144,6 +144,8 @@ class RDMADispatcher {
   void post_tx_buffer(std::vector<Chunk*> &chunks);
 
   std::atomic<uint64_t> inflight = {0};
+  /// rx chunks lent out to received messages, off the srq until released
+  std::atomic<uint64_t> lent_rx_chunks = {0};
 };
 
 
@@ -159,6 +161,7 @@ enum {
   l_msgr_rdma_tx_bytes,
   l_msgr_rdma_rx_chunks,
   l_msgr_rdma_rx_bytes,
+  l_msgr_rdma_rx_zero_copy_bytes,
   l_msgr_rdma_pending_sent_conns,
 
   l_msgr_rdma_last,
@@ -222,6 +225,9 @@ class RDMAConnectedSocketImpl : public ConnectedSocketImpl {
   RDMADispatcher* dispatcher;
   RDMAWorker* worker;
   std::vector<Chunk*> buffers;
+  /// buffers.front() if part of it has been lent out by zero_copy_read_upto
+  Chunk *lent_chunk = nullptr;
+  bufferptr lent_buffer;  ///< our reference to lent_chunk
   int notify_fd = -1;
   bufferlist pending_bl;
 
@@ -235,6 +241,8 @@ class RDMAConnectedSocketImpl : public ConnectedSocketImpl {
 
   void notify();
   ssize_t read_buffers(char* buf, size_t len);
+  void queue_rx_completions(std::vector<ibv_wc> &cqe);
+  void release_rx_chunk(Chunk *chunk);
   int post_work_request(std::vector<Chunk*>&);
 
  public:
@@ -248,6 +256,7 @@ class RDMAConnectedSocketImpl : public ConnectedSocketImpl {
 
   virtual ssize_t read(char* buf, size_t len) override;
   virtual ssize_t zero_copy_read(bufferptr &data) override;
+  virtual ssize_t zero_copy_read_upto(bufferptr &data, size_t len) override;
   virtual ssize_t send(bufferlist &bl, bool more) override;
   virtual void shutdown() override;
   virtual void close() override;
@@ -307,7 +316,7 @@ class RDMAStack : public NetworkStack {
  public:
   explicit RDMAStack(CephContext *cct, const string &t);
   virtual ~RDMAStack();
-  virtual bool support_zero_copy_read() const override { return false; }
+  virtual bool support_zero_copy_read() const override { return true; }
   virtual bool nonblock_connect_need_writable_event() const { return false; }
 
   virtual void spawn_worker(unsigned i, std::function<void ()> &&func) override;
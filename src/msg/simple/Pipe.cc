@@ -1925,7 +1925,7 @@ void Pipe::writer()
 			      << " " << m << " " << *m << dendl;
 
 	// encode and copy out of *m
-	m->encode(features, msgr->crcflags);
+	m->encode(features, msgr->get_send_crc_flags(peer_addr));
 
 	// prepare everything
 	const ceph_msg_header& header = m->get_header();
@@ -2152,7 +2152,9 @@ int Pipe::read_message(Message **pm, AuthSessionHandler* auth_handler)
       } else {
 	if (!newbuf.length()) {
 	  ldout(msgr->cct,20) << "reader allocating new rx buffer at offset " << offset << dendl;
-	  alloc_aligned_buffer(newbuf, data_len, data_off);
+	  if (!msgr->ms_fast_alloc_data(connection_state.get(), header, &newbuf))
+	    alloc_aligned_buffer(newbuf, data_len, data_off);
+	  assert(newbuf.length() == data_len);
 	  blp = newbuf.begin();
 	  blp.advance(offset);
 	}
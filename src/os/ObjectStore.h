@@ -1717,6 +1717,30 @@ public:
      return read(c->get_cid(), oid, offset, len, bl, op_flags);
    }
 
+  /**
+   * readahead -- hint that a byte range of an object will be read soon
+   *
+   * Lets the backend start fetching the data without waiting for it.
+   * Backends that cannot do that in the background ignore the hint.
+   *
+   * @param cid collection for object
+   * @param oid oid of object
+   * @param offset location offset of first byte to be read
+   * @param len number of bytes to be read
+   */
+  virtual void readahead(
+    const coll_t& cid,
+    const ghobject_t& oid,
+    uint64_t offset,
+    size_t len) {}
+  virtual void readahead(
+    CollectionHandle &c,
+    const ghobject_t& oid,
+    uint64_t offset,
+    size_t len) {
+    readahead(c->get_cid(), oid, offset, len);
+  }
+
   /**
    * fiemap -- get extent map of data of an object
    *
@@ -3276,6 +3276,25 @@ int FileStore::read(
   }
 }
 
+void FileStore::readahead(
+  const coll_t& _cid,
+  const ghobject_t& oid,
+  uint64_t offset,
+  size_t len)
+{
+#ifdef HAVE_POSIX_FADVISE
+  const coll_t& cid = !_need_temp_object_collection(_cid, oid) ? _cid : _cid.get_temp();
+  dout(15) << __FUNC__ << ": " << cid << "/" << oid << " " << offset << "~" << len << dendl;
+
+  FDRef fd;
+  int r = lfn_open(cid, oid, false, &fd);
+  if (r < 0)
+    return;
+  posix_fadvise(**fd, offset, len, POSIX_FADV_WILLNEED);
+  lfn_close(fd);
+#endif
+}
+
 int FileStore::_do_fiemap(int fd, uint64_t offset, size_t len,
                           map<uint64_t, uint64_t> *m)
 {
@@ -588,6 +588,12 @@ public:
     size_t len,
     bufferlist& bl,
     uint32_t op_flags = 0) override;
+  using ObjectStore::readahead;
+  void readahead(
+    const coll_t& cid,
+    const ghobject_t& oid,
+    uint64_t offset,
+    size_t len) override;
   int _do_fiemap(int fd, uint64_t offset, size_t len,
                  map<uint64_t, uint64_t> *m);
   int _do_seek_hole_data(int fd, uint64_t offset, size_t len,
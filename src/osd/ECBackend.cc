@@ -155,6 +155,8 @@ ostream &operator<<(ostream &lhs, const ECBackend::Op &rhs)
       << " pending_commit=" << rhs.pending_commit
       << " plan.to_read=" << rhs.plan.to_read
       << " plan.will_write=" << rhs.plan.will_write
+      << " plan.parity_delta=" << rhs.plan.parity_delta
+      << " encoding=" << rhs.encode_in_progress()
       << ")";
   return lhs;
 }
@@ -172,6 +174,7 @@ ostream &operator<<(ostream &lhs, const ECBackend::RecoveryOp &rhs)
 	     << " state=" << ECBackend::RecoveryOp::tostr(rhs.state)
 	     << " waiting_on_pushes=" << rhs.waiting_on_pushes
 	     << " extent_requested=" << rhs.extent_requested
+	     << " read_ahead=" << rhs.read_ahead
 	     << ")";
 }
 
@@ -186,6 +189,7 @@ void ECBackend::RecoveryOp::dump(Formatter *f) const
   f->dump_stream("state") << tostr(state);
   f->dump_stream("waiting_on_pushes") << waiting_on_pushes;
   f->dump_stream("extent_requested") << extent_requested;
+  f->dump_bool("read_ahead", read_ahead);
 }
 
 ECBackend::ECBackend(
@@ -609,6 +613,7 @@ void ECBackend::continue_recovery_op(
 	    after_progress.data_recovered_to -
 	    op.recovery_progress.data_recovered_to)
 	  );
+	get_parent()->account_recovery_bytes(pop.data.length());
 	if (pop.data.length())
 	  pop.data_included.insert(
 	    sinfo.aligned_logical_offset_to_chunk_offset(
@@ -629,6 +634,27 @@ void ECBackend::continue_recovery_op(
       op.returned_data.clear();
       op.waiting_on_pushes = op.missing_on;
       op.recovery_progress = after_progress;
+      if (!after_progress.data_complete &&
+	  cct->_conf->osd_ec_recovery_read_ahead) {
+	// read and decode the next extent while this one is pushed
+	set<int> want(op.missing_on_shards.begin(), op.missing_on_shards.end());
+	uint64_t amount = get_recovery_chunk_size();
+	set<pg_shard_t> to_read;
+	if (get_min_avail_to_read_shards(
+	      op.hoid, want, true, false, &to_read) == 0) {
+	  m->read(
+	    this,
+	    op.hoid,
+	    after_progress.data_recovered_to,
+	    amount,
+	    to_read,
+	    false);
+	  op.extent_requested = make_pair(
+	    after_progress.data_recovered_to,
+	    amount);
+	  op.read_ahead = true;
+	}
+      }
       dout(10) << __func__ << ": READING return " << op << dendl;
       return;
     }
@@ -656,6 +682,17 @@ void ECBackend::continue_recovery_op(
 	  dout(10) << __func__ << ": WRITING return " << op << dendl;
 	  recovery_ops.erase(op.hoid);
 	  return;
+	} else if (op.read_ahead) {
+	  op.read_ahead = false;
+	  op.state = RecoveryOp::READING;
+	  if (op.returned_data.empty()) {
+	    dout(10) << __func__ << ": WRITING wait for read ahead " << op
+		     << dendl;
+	    return;
+	  }
+	  dout(10) << __func__ << ": WRITING continue with read ahead " << op
+		   << dendl;
+	  continue;
 	} else {
 	  op.state = RecoveryOp::IDLE;
 	  dout(10) << __func__ << ": WRITING continue " << op << dendl;
@@ -1184,11 +1221,15 @@ void ECBackend::handle_sub_read_reply(
 
   assert(rop.in_progress.count(from));
   rop.in_progress.erase(from);
+  auto sent = rop.sent_time.find(from);
+  if (sent != rop.sent_time.end())
+    note_sub_read_latency(from.osd, sent->second);
   unsigned is_complete = 0;
   // For redundant reads check for completion as each shard comes in,
   // or in a non-recovery read check for completion once all the shards read.
   // TODO: It would be nice if recovery could send more reads too
-  if (rop.do_redundant_reads || (!rop.for_recovery && rop.in_progress.empty())) {
+  if (rop.do_redundant_reads ||
+      (!rop.for_recovery && !rop.for_parity_delta && rop.in_progress.empty())) {
     for (map<hobject_t, read_result_t>::const_iterator iter =
         rop.complete.begin();
       iter != rop.complete.end();
@@ -1208,15 +1249,14 @@ void ECBackend::handle_sub_read_reply(
 	dout(20) << __func__ << " minimum_to_decode failed" << dendl;
         if (rop.in_progress.empty()) {
 	  // If we don't have enough copies and we haven't sent reads for all shards
-	  // we can send the rest of the reads, if any.
-	  if (!rop.do_redundant_reads) {
-	    int r = send_all_remaining_reads(iter->first, rop);
-	    if (r == 0) {
-	      // We added to in_progress and not incrementing is_complete
-	      continue;
-	    }
-	    // Couldn't read any additional shards so handle as completed with errors
+	  // we can send the rest of the reads, if any.  Redundant reads only
+	  // went to every shard with fast_read, then there are none left.
+	  int r = send_all_remaining_reads(iter->first, rop);
+	  if (r == 0) {
+	    // We added to in_progress and not incrementing is_complete
+	    continue;
 	  }
+	  // Couldn't read any additional shards so handle as completed with errors
 	  // We don't want to confuse clients / RBD with objectstore error
 	  // values in particular ENOENT.  We may have different error returns
 	  // from different shards, so we'll return minimum_to_decode() error
@@ -1246,6 +1286,12 @@ void ECBackend::handle_sub_read_reply(
   }
   if (rop.in_progress.empty() || is_complete == rop.complete.size()) {
     dout(20) << __func__ << " Complete: " << rop << dendl;
+    // shards that have not replied yet are at least that slow
+    for (auto &&shard : rop.in_progress) {
+      auto sent = rop.sent_time.find(shard);
+      if (sent != rop.sent_time.end())
+	note_sub_read_latency(shard.osd, sent->second);
+    }
     rop.trace.event("ec read complete");
     complete_read_op(rop, m);
   } else {
@@ -1268,6 +1314,13 @@ void ECBackend::complete_read_op(ReadOp &rop, RecoveryMessages *m)
       reqiter->second.cb = NULL;
     }
   }
+  // a redundant read may complete before every shard replied, forget
+  // the late ones so a later map change does not look for this op
+  for (auto &&shard : rop.in_progress) {
+    auto siter = shard_to_read_map.find(shard);
+    if (siter != shard_to_read_map.end())
+      siter->second.erase(rop.tid);
+  }
   tid_to_read_map.erase(rop.tid);
 }
 
@@ -1377,6 +1430,7 @@ void ECBackend::on_change()
   completed_to = eversion_t();
   committed_to = eversion_t();
   pipeline_state.clear();
+  tail_stripes.clear();
   waiting_reads.clear();
   waiting_state.clear();
   waiting_commit.clear();
@@ -1550,13 +1604,52 @@ int ECBackend::get_min_avail_to_read_shards(
   }
 
   set<int> need;
-  int r = ec_impl->minimum_to_decode(want, have, &need);
+  int r;
+  if (for_recovery) {
+    // spread recovery reads over the sources: a chunk costs the number of
+    // reads already in flight on its shard
+    map<int, int> cost;
+    for (set<int>::iterator i = have.begin(); i != have.end(); ++i) {
+      map<pg_shard_t, set<ceph_tid_t> >::const_iterator p =
+	shard_to_read_map.find(shards[shard_id_t(*i)]);
+      cost[*i] = p == shard_to_read_map.end() ? 0 : p->second.size();
+    }
+    r = ec_impl->minimum_to_decode_with_cost(want, cost, &need);
+  } else {
+    r = ec_impl->minimum_to_decode(want, have, &need);
+  }
   if (r < 0)
     return r;
 
   if (do_redundant_reads) {
       need.swap(have);
-  } 
+  } else if (!for_recovery) {
+    if (cct->_conf->osd_ec_read_slow_shard_ratio > 0) {
+      set<int> fast = have;
+      drop_slow_shards(shards, &fast);
+      set<int> fast_need;
+      if (fast.size() < have.size() &&
+	  ec_impl->minimum_to_decode(want, fast, &fast_need) == 0) {
+	dout(20) << __func__ << ": " << need << " -> " << fast_need
+		 << " avoiding slow shards" << dendl;
+	need.swap(fast_need);
+      }
+    }
+    // speculative reads to the fastest of the remaining shards, the read
+    // completes once any sufficient subset replied
+    unsigned extra = cct->_conf->osd_ec_read_extra_shards;
+    if (extra) {
+      vector<pair<double, int> > spare;
+      for (set<int>::iterator i = have.begin(); i != have.end(); ++i) {
+	if (!need.count(*i))
+	  spare.push_back(
+	    make_pair(get_sub_read_latency(shards[shard_id_t(*i)].osd), *i));
+      }
+      std::sort(spare.begin(), spare.end());
+      for (unsigned i = 0; i < extra && i < spare.size(); ++i)
+	need.insert(spare[i].second);
+    }
+  }
 
   if (!to_read)
     return 0;
@@ -1605,12 +1698,63 @@ int ECBackend::get_remaining_shards(
   return 0;
 }
 
+// a latency sample older than this is not trusted to skip a shard
+static const ceph::timespan SUB_READ_LATENCY_MAX_AGE = std::chrono::seconds(30);
+
+void ECBackend::note_sub_read_latency(int osd, const ceph::mono_time &sent)
+{
+  auto now = ceph::mono_clock::now();
+  double latency = std::chrono::duration<double>(now - sent).count();
+  read_latency_t &l = osd_read_latency[osd];
+  if (l.avg == 0 || now - l.stamp > SUB_READ_LATENCY_MAX_AGE)
+    l.avg = latency;
+  else
+    l.avg = (l.avg * 7 + latency) / 8;
+  l.stamp = now;
+}
+
+double ECBackend::get_sub_read_latency(int osd) const
+{
+  auto p = osd_read_latency.find(osd);
+  if (p == osd_read_latency.end() ||
+      ceph::mono_clock::now() - p->second.stamp > SUB_READ_LATENCY_MAX_AGE)
+    return 0;
+  return p->second.avg;
+}
+
+void ECBackend::drop_slow_shards(
+  const map<shard_id_t, pg_shard_t> &shards,
+  set<int> *have)
+{
+  vector<pair<double, int> > latency;
+  for (set<int>::iterator i = have->begin(); i != have->end(); ++i) {
+    auto p = shards.find(shard_id_t(*i));
+    assert(p != shards.end());
+    double l = get_sub_read_latency(p->second.osd);
+    if (l > 0)
+      latency.push_back(make_pair(l, *i));
+  }
+  if (latency.size() < 2)
+    return;
+  std::sort(latency.begin(), latency.end());
+  double limit = latency[latency.size() / 2].first *
+    cct->_conf->osd_ec_read_slow_shard_ratio;
+  for (auto &&l : latency) {
+    if (l.first > limit) {
+      dout(20) << __func__ << ": shard " << l.second << " latency "
+	       << l.first << " > " << limit << dendl;
+      have->erase(l.second);
+    }
+  }
+}
+
 void ECBackend::start_read_op(
   int priority,
   map<hobject_t, read_request_t> &to_read,
   OpRequestRef _op,
   bool do_redundant_reads,
-  bool for_recovery)
+  bool for_recovery,
+  bool for_parity_delta)
 {
   ceph_tid_t tid = get_parent()->get_tid();
   assert(!tid_to_read_map.count(tid));
@@ -1623,6 +1767,7 @@ void ECBackend::start_read_op(
       for_recovery,
       _op,
       std::move(to_read))).first->second;
+  op.for_parity_delta = for_parity_delta;
   dout(10) << __func__ << ": starting " << op << dendl;
   if (_op) {
     op.trace = _op->pg_trace;
@@ -1631,7 +1776,7 @@ void ECBackend::start_read_op(
   do_read_op(op);
 }
 
-void ECBackend::do_read_op(ReadOp &op)
+void ECBackend::do_read_op(ReadOp &op, const hobject_t *only)
 {
   int priority = op.priority;
   ceph_tid_t tid = op.tid;
@@ -1642,6 +1787,8 @@ void ECBackend::do_read_op(ReadOp &op)
   for (map<hobject_t, read_request_t>::iterator i = op.to_read.begin();
        i != op.to_read.end();
        ++i) {
+    if (only && i->first != *only)
+      continue;
     bool need_attrs = i->second.want_attrs;
     for (set<pg_shard_t>::const_iterator j = i->second.need.begin();
 	 j != i->second.need.end();
@@ -1672,10 +1819,12 @@ void ECBackend::do_read_op(ReadOp &op)
     }
   }
 
+  auto now = ceph::mono_clock::now();
   for (map<pg_shard_t, ECSubRead>::iterator i = messages.begin();
        i != messages.end();
        ++i) {
     op.in_progress.insert(i->first);
+    op.sent_time[i->first] = now;
     shard_to_read_map[i->first].insert(op.tid);
     i->second.tid = tid;
     MOSDECSubOpRead *msg = new MOSDECSubOpRead;
@@ -1773,12 +1922,257 @@ void ECBackend::start_rmw(Op *op, PGTransactionUPtr &&t)
     },
     get_parent()->get_dpp());
 
+  if (cct->_conf->osd_ec_parity_delta_writes &&
+      get_parent()->get_pool().allows_ecoverwrites() &&
+      op->requires_rmw()) {
+    ECTransaction::plan_parity_delta(
+      sinfo, ec_impl, op->plan, get_parent()->get_dpp());
+  }
+
+  start_encode(op);
+
   dout(10) << __func__ << ": " << *op << dendl;
 
   waiting_state.push_back(*op);
   check_ops();
 }
 
+void ECBackend::read_tail_stripes(Op *op)
+{
+  // all or nothing: read_in_progress() tells a started read by a
+  // non empty remote_read_result
+  map<hobject_t,extent_map> results;
+  bool found = tail_stripes.read(
+    op->remote_read,
+    [this, op](const hobject_t &hoid) {
+      for (auto *l : { &waiting_reads, &waiting_commit }) {
+	for (auto &&other: *l) {
+	  if (&other != op &&
+	      (other.plan.will_write.count(hoid) ||
+	       (other.plan.t && other.plan.t->op_map.count(hoid))))
+	    return true;
+	}
+      }
+      return false;
+    },
+    &results);
+  if (!found)
+    return;
+
+  dout(20) << __func__ << ": " << op->remote_read
+	   << " from the tail stripe cache" << dendl;
+  op->remote_read.clear();
+  op->remote_read_result.swap(results);
+}
+
+struct EncodeStripes : public GenContext<ThreadPool::TPHandle&> {
+  ECUtil::stripe_info_t sinfo;
+  ErasureCodeInterfaceRef ec_impl;
+  std::shared_ptr<ECBackend::EncodeJob> job;
+  Context *on_encoded;
+  EncodeStripes(
+    const ECUtil::stripe_info_t &sinfo,
+    ErasureCodeInterfaceRef ec_impl,
+    std::shared_ptr<ECBackend::EncodeJob> job,
+    Context *on_encoded)
+    : sinfo(sinfo), ec_impl(ec_impl), job(job), on_encoded(on_encoded) {}
+  void finish(ThreadPool::TPHandle &handle) override {
+    ECTransaction::pre_encode(sinfo, ec_impl, job->to_encode, &job->encoded);
+    job->to_encode.clear();
+    on_encoded->complete(0);
+  }
+};
+
+struct EncodeFinished : public Context {
+  ECBackend *pg;
+  ceph_tid_t tid;
+  std::shared_ptr<ECBackend::EncodeJob> job;
+  EncodeFinished(
+    ECBackend *pg, ceph_tid_t tid, std::shared_ptr<ECBackend::EncodeJob> job)
+    : pg(pg), tid(tid), job(job) {}
+  void finish(int) override {
+    pg->handle_encode_finished(tid, job);
+  }
+};
+
+void ECBackend::start_encode(Op *op)
+{
+  uint64_t min_bytes = cct->_conf->osd_ec_encode_min_bytes;
+  if (!min_bytes || !op->plan.t)
+    return;
+
+  std::shared_ptr<EncodeJob> job(new EncodeJob);
+  uint64_t bytes = ECTransaction::get_full_stripe_writes(
+    sinfo, op->plan, &job->to_encode);
+  if (bytes < min_bytes)
+    return;
+
+  /* The plan and the transaction stay with the op: the pool only sees
+   * its own references to the write buffers, and the hash info and
+   * the rest of the transaction are still generated under the pg lock
+   * in try_reads_to_commit, which waits for the chunks. */
+  EncodeStripes *c = new EncodeStripes(
+    sinfo, ec_impl, job,
+    get_parent()->bless_context(new EncodeFinished(this, op->tid, job)));
+  if (!get_parent()->schedule_encode_work(c)) {
+    delete c->on_encoded;
+    delete c;
+    return;
+  }
+  dout(20) << __func__ << ": encoding " << bytes << " bytes of tid "
+	   << op->tid << " on the encode thread pool" << dendl;
+  op->encode_job = job;
+}
+
+void ECBackend::handle_encode_finished(
+  ceph_tid_t tid, std::shared_ptr<EncodeJob> job)
+{
+  auto i = tid_to_op_map.find(tid);
+  if (i == tid_to_op_map.end() || i->second.encode_job != job) {
+    dout(10) << __func__ << ": tid " << tid << " is gone, ignoring" << dendl;
+    return;
+  }
+  Op &op = i->second;
+  dout(20) << __func__ << ": " << op << dendl;
+  op.pre_encoded.swap(job->encoded);
+  op.encode_job.reset();
+  check_ops();
+}
+
+bool ECBackend::object_write_in_flight(
+  const hobject_t &hoid, bool uncached_only)
+{
+  for (auto *l : { &waiting_reads, &waiting_commit }) {
+    for (auto &&op: *l) {
+      if (uncached_only && op.using_cache)
+	continue;
+      if (op.plan.will_write.count(hoid) ||
+	  (op.plan.t && op.plan.t->op_map.count(hoid)))
+	return true;
+    }
+  }
+  return false;
+}
+
+bool ECBackend::can_parity_delta(Op *op)
+{
+  for (auto &&i: op->plan.parity_delta) {
+    // without the extent cache, the shards must already hold every
+    // earlier write to the object
+    if (object_write_in_flight(i.first, false))
+      return false;
+    set<int> have;
+    for (auto &&s: get_parent()->get_acting_shards()) {
+      if (!get_parent()->get_shard_missing(s).is_missing(i.first))
+	have.insert(s.shard);
+    }
+    for (auto &&shard: i.second) {
+      if (!have.count(shard))
+	return false;
+    }
+  }
+  return true;
+}
+
+struct CallParityDeltaRead :
+  public GenContext<pair<RecoveryMessages*, ECBackend::read_result_t& > &> {
+  ECBackend *ec;
+  ECBackend::Op *op;
+  hobject_t hoid;
+  CallParityDeltaRead(ECBackend *ec, ECBackend::Op *op, const hobject_t &hoid)
+    : ec(ec), op(op), hoid(hoid) {}
+  void finish(pair<RecoveryMessages *, ECBackend::read_result_t &> &in) override {
+    ec->handle_parity_delta_read(op, hoid, in.second);
+  }
+};
+
+void ECBackend::start_parity_delta_read(Op *op)
+{
+  map<hobject_t, read_request_t> for_read_op;
+  for (auto &&i: op->plan.parity_delta) {
+    set<pg_shard_t> need;
+    for (auto &&s: get_parent()->get_acting_shards()) {
+      if (i.second.count(s.shard))
+	need.insert(s);
+    }
+    assert(need.size() == i.second.size());
+    list<boost::tuple<uint64_t, uint64_t, uint32_t> > to_read;
+    const extent_set &es = op->plan.to_read[i.first];
+    for (auto extent = es.begin(); extent != es.end(); ++extent) {
+      to_read.push_back(
+	boost::make_tuple(extent.get_start(), extent.get_len(), 0));
+    }
+    for_read_op.insert(
+      make_pair(
+	i.first,
+	read_request_t(
+	  to_read,
+	  need,
+	  false,
+	  new CallParityDeltaRead(this, op, i.first))));
+  }
+  op->delta_reads_pending = for_read_op.size();
+  // read exactly the shards asked for; don't reconstruct
+  start_read_op(
+    CEPH_MSG_PRIO_DEFAULT,
+    for_read_op,
+    OpRequestRef(),
+    false, false, true);
+}
+
+void ECBackend::handle_parity_delta_read(
+  Op *op, const hobject_t &hoid, read_result_t &res)
+{
+  assert(op->delta_reads_pending > 0);
+  const set<int> &want = op->plan.parity_delta[hoid];
+  auto &chunks = op->delta_chunks[hoid];
+  bool ok = res.r == 0 && res.errors.empty();
+  for (auto &&extent: res.returned) {
+    if (!ok)
+      break;
+    uint64_t off = extent.get<0>();
+    uint64_t len = extent.get<1>();
+    if (extent.get<2>().size() != want.size()) {
+      ok = false;
+      break;
+    }
+    for (auto &&j: extent.get<2>()) {
+      if (!want.count(j.first.shard) ||
+	  j.second.length() != sinfo.aligned_logical_offset_to_chunk_offset(len)) {
+	ok = false;
+	break;
+      }
+      for (uint64_t s = 0; s < len; s += sinfo.get_stripe_width()) {
+	chunks[off + s][j.first.shard].substr_of(
+	  j.second,
+	  sinfo.aligned_logical_offset_to_chunk_offset(s),
+	  sinfo.get_chunk_size());
+      }
+    }
+  }
+  --op->delta_reads_pending;
+
+  if (!ok) {
+    dout(10) << __func__ << ": " << hoid << " read failed (r=" << res.r
+	     << " errors=" << res.errors << "), falling back to a full"
+	     << " stripe rmw" << dendl;
+    op->plan.parity_delta.erase(hoid);
+    op->delta_chunks.erase(hoid);
+    extent_set &to_read = op->plan.to_read[hoid];
+    op->remote_read[hoid] = to_read;
+    objects_read_async_no_cache(
+      map<hobject_t,extent_set>{{hoid, to_read}},
+      [this, op](map<hobject_t,pair<int, extent_map> > &&results) {
+	for (auto &&i: results) {
+	  op->remote_read_result.emplace(i.first, i.second.second);
+	}
+	check_ops();
+      });
+    return;
+  }
+  check_ops();
+}
+
 bool ECBackend::try_state_to_reads()
 {
   if (waiting_state.empty())
@@ -1794,6 +2188,25 @@ bool ECBackend::try_state_to_reads()
     return false;
   }
 
+  if (op->requires_rmw() && pipeline_state.caching_enabled()) {
+    // a parity delta overwrite does not populate the cache, so its
+    // stripes must be read back from the shards once it is applied
+    for (auto &&hpair: op->plan.to_read) {
+      if (object_write_in_flight(hpair.first, true)) {
+	dout(20) << __func__ << ": blocking " << *op
+		 << " behind a parity delta overwrite of " << hpair.first
+		 << dendl;
+	return false;
+      }
+    }
+  }
+
+  if (!op->plan.parity_delta.empty() && !can_parity_delta(op)) {
+    dout(20) << __func__ << ": " << *op
+	     << " falling back to a full stripe rmw" << dendl;
+    op->plan.parity_delta.clear();
+  }
+
   if (op->invalidates_cache()) {
     dout(20) << __func__ << ": invalidating cache after this op"
 	     << dendl;
@@ -1806,7 +2219,10 @@ bool ECBackend::try_state_to_reads()
   waiting_state.pop_front();
   waiting_reads.push_back(*op);
 
-  if (op->using_cache) {
+  if (!op->plan.parity_delta.empty()) {
+    op->using_cache = false;
+    start_parity_delta_read(op);
+  } else if (op->using_cache) {
     cache.open_write_pin(op->pin);
 
     extent_set empty;
@@ -1837,6 +2253,8 @@ bool ECBackend::try_state_to_reads()
     op->remote_read = op->plan.to_read;
   }
 
+  read_tail_stripes(op);
+
   dout(10) << __func__ << ": " << *op << dendl;
 
   if (!op->remote_read.empty()) {
@@ -1859,7 +2277,7 @@ bool ECBackend::try_reads_to_commit()
   if (waiting_reads.empty())
     return false;
   Op *op = &(waiting_reads.front());
-  if (op->read_in_progress())
+  if (op->read_in_progress() || op->encode_in_progress())
     return false;
   waiting_reads.pop_front();
   waiting_commit.push_back(*op);
@@ -1903,6 +2321,8 @@ bool ECBackend::try_reads_to_commit()
       (get_osdmap()->require_osd_release < CEPH_RELEASE_KRAKEN),
       sinfo,
       op->remote_read_result,
+      op->delta_chunks,
+      op->pre_encoded,
       op->log_entries,
       &written,
       &trans,
@@ -1930,7 +2350,13 @@ bool ECBackend::try_reads_to_commit()
     written_set[i.first] = i.second.get_interval_set();
   }
   dout(20) << __func__ << ": written_set: " << written_set << dendl;
-  assert(written_set == op->plan.will_write);
+  {
+    // parity delta overwrites never hold whole stripes
+    map<hobject_t,extent_set> expected = op->plan.will_write;
+    for (auto &&i: op->plan.parity_delta)
+      expected[i.first].clear();
+    assert(written_set == expected);
+  }
 
   if (op->using_cache) {
     for (auto &&hpair: written) {
@@ -1938,8 +2364,14 @@ bool ECBackend::try_reads_to_commit()
       cache.present_rmw_update(hpair.first, op->pin, hpair.second);
     }
   }
+  tail_stripes.update(
+    sinfo, op->plan.hash_infos, written,
+    cct->_conf->osd_ec_tail_stripe_cache_size);
+
   op->remote_read.clear();
   op->remote_read_result.clear();
+  op->delta_chunks.clear();
+  op->pre_encoded.clear();
 
   dout(10) << "onreadable_sync: " << op->on_local_applied_sync << dendl;
   ObjectStore::Transaction empty;
@@ -2274,6 +2706,7 @@ void ECBackend::objects_read_and_reconstruct(
   get_want_to_read_shards(&want_to_read);
     
   map<hobject_t, read_request_t> for_read_op;
+  bool redundant = fast_read;
   for (auto &&to_read: reads) {
     set<pg_shard_t> shards;
     int r = get_min_avail_to_read_shards(
@@ -2289,6 +2722,8 @@ void ECBackend::objects_read_and_reconstruct(
       this,
       &(in_progress_client_reads.back()),
       to_read.second);
+    if (shards.size() > ec_impl->get_data_chunk_count())
+      redundant = true;
     for_read_op.insert(
       make_pair(
 	to_read.first,
@@ -2303,7 +2738,7 @@ void ECBackend::objects_read_and_reconstruct(
     CEPH_MSG_PRIO_DEFAULT,
     for_read_op,
     OpRequestRef(),
-    fast_read, false);
+    redundant, false);
   return;
 }
 
@@ -2332,8 +2767,10 @@ int ECBackend::send_all_remaining_reads(
   GenContext<pair<RecoveryMessages *, read_result_t& > &> *c =
     rop.to_read.find(hoid)->second.cb;
 
-  map<hobject_t, read_request_t> for_read_op;
-  for_read_op.insert(
+  // replace only this object's request, the others may still be in
+  // flight or complete already
+  rop.to_read.erase(hoid);
+  rop.to_read.insert(
     make_pair(
       hoid,
       read_request_t(
@@ -2341,9 +2778,7 @@ int ECBackend::send_all_remaining_reads(
 	shards,
 	false,
 	c)));
-
-  rop.to_read.swap(for_read_op);
-  do_read_op(rop);
+  do_read_op(rop, &hoid);
   return 0;
 }
 
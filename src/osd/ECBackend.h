@@ -24,6 +24,7 @@
 #include "ECUtil.h"
 #include "ECTransaction.h"
 #include "ExtentCache.h"
+#include "ECTailStripeCache.h"
 
 //forward declaration
 struct ECSubWrite;
@@ -296,9 +297,13 @@ private:
     // valid in state READING
     pair<uint64_t, uint64_t> extent_requested;
 
+    // extent_requested was read while pushing the previous extent, its
+    // data is in returned_data once the read completes
+    bool read_ahead;
+
     void dump(Formatter *f) const;
 
-    RecoveryOp() : state(IDLE) {}
+    RecoveryOp() : state(IDLE), read_ahead(false) {}
   };
   friend ostream &operator<<(ostream &lhs, const RecoveryOp &rhs);
   map<hobject_t, RecoveryOp> recovery_ops;
@@ -378,6 +383,9 @@ public:
     // True if reading for recovery which could possibly reading only a subset
     // of the available shards.
     bool for_recovery;
+    // True if reading exactly the shards asked for, for a parity delta
+    // write: complete once they all replied, never widen the read.
+    bool for_parity_delta = false;
 
     ZTracer::Trace trace;
 
@@ -390,6 +398,7 @@ public:
     void dump(Formatter *f) const;
 
     set<pg_shard_t> in_progress;
+    map<pg_shard_t, ceph::mono_time> sent_time;
 
     ReadOp(
       int priority,
@@ -427,9 +436,11 @@ public:
     int priority,
     map<hobject_t, read_request_t> &to_read,
     OpRequestRef op,
-    bool do_redundant_reads, bool for_recovery);
+    bool do_redundant_reads, bool for_recovery,
+    bool for_parity_delta = false);
 
-  void do_read_op(ReadOp &rop);
+  /// send the sub reads of every object in rop, or only of @p only
+  void do_read_op(ReadOp &rop, const hobject_t *only = nullptr);
   int send_all_remaining_reads(
     const hobject_t &hoid,
     ReadOp &rop);
@@ -448,6 +459,12 @@ public:
    * completions. Thus, callbacks and completion are called in order
    * on the writing list.
    */
+  /// data handed to the encode thread pool and the chunks it produces
+  struct EncodeJob {
+    ECTransaction::full_stripe_writes_t to_encode;
+    ECTransaction::pre_encoded_t encoded;
+  };
+
   struct Op : boost::intrusive::list_base_hook<> {
     /// From submit_transaction caller, decribes operation
     hobject_t hoid;
@@ -483,8 +500,20 @@ public:
     map<hobject_t,extent_set> pending_read; // subset already being read
     map<hobject_t,extent_set> remote_read;  // subset we must read
     map<hobject_t,extent_map> remote_read_result;
+    /// parity delta overwrite: old chunks still being read, and read so far
+    unsigned delta_reads_pending = 0;
+    map<hobject_t,ECTransaction::stripe_chunks_t> delta_chunks;
     bool read_in_progress() const {
-      return !remote_read.empty() && remote_read_result.empty();
+      return (!remote_read.empty() && remote_read_result.empty()) ||
+	delta_reads_pending > 0;
+    }
+
+    /// full stripe writes being encoded on the encode thread pool, and
+    /// their chunks once that is done
+    std::shared_ptr<EncodeJob> encode_job;
+    ECTransaction::pre_encoded_t pre_encoded;
+    bool encode_in_progress() const {
+      return !!encode_job;
     }
 
     /// In progress write state
@@ -569,6 +598,23 @@ public:
   bool try_finish_rmw();
   void check_ops();
 
+  /// true if an op past waiting_state writes hoid; with uncached_only,
+  /// only consider ops that bypass the extent cache
+  bool object_write_in_flight(const hobject_t &hoid, bool uncached_only);
+  bool can_parity_delta(Op *op);
+  void start_parity_delta_read(Op *op);
+  void handle_parity_delta_read(
+    Op *op, const hobject_t &hoid, read_result_t &res);
+  friend struct CallParityDeltaRead;
+  /// last stripes of recently appended objects, see ECTailStripeCache
+  ECTailStripeCache tail_stripes;
+  void read_tail_stripes(Op *op);
+
+  void start_encode(Op *op);
+  void handle_encode_finished(
+    ceph_tid_t tid, std::shared_ptr<EncodeJob> job);
+  friend struct EncodeFinished;
+
   ErasureCodeInterfaceRef ec_impl;
 
 
@@ -623,6 +669,23 @@ public:
 
 
   const ECUtil::stripe_info_t sinfo;
+
+  /**
+   * Moving average of the sub read latency of each OSD, in seconds,
+   * used to pick the shards of client reads
+   * (@see osd_ec_read_slow_shard_ratio, osd_ec_read_extra_shards)
+   */
+  struct read_latency_t {
+    double avg = 0;
+    ceph::mono_time stamp;
+  };
+  map<int, read_latency_t> osd_read_latency;
+  void note_sub_read_latency(int osd, const ceph::mono_time &sent);
+  double get_sub_read_latency(int osd) const; ///< 0 if unknown or stale
+  void drop_slow_shards(
+    const map<shard_id_t, pg_shard_t> &shards,
+    set<int> *have);
+
   /// If modified, ensure that the ref is held until the update is applied
   SharedPtrRegistry<hobject_t, ECUtil::HashInfo> unstable_hashinfo_registry;
   ECUtil::HashInfoRef get_hash_info(const hobject_t &hoid, bool checks = true,
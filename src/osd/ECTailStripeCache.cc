@@ -0,0 +1,83 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t -*-
+// vim: ts=8 sw=2 smarttab
+/*
+ * Ceph - scalable distributed file system
+ *
+ * This is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License version 2.1, as published by the Free Software
+ * Foundation.  See file COPYING.
+ *
+ */
+
+#include "ECTailStripeCache.h"
+
+void ECTailStripeCache::erase(const hobject_t &hoid)
+{
+  auto i = tail_stripes.find(hoid);
+  if (i == tail_stripes.end())
+    return;
+  bytes -= i->second.bl.length();
+  lru.erase(i->second.lru);
+  tail_stripes.erase(i);
+}
+
+bool ECTailStripeCache::read_one(
+  const hobject_t &hoid,
+  const extent_set &to_read,
+  std::map<hobject_t, extent_map> *results) const
+{
+  auto ts = tail_stripes.find(hoid);
+  assert(ts != tail_stripes.end());
+  const uint64_t start = ts->second.offset;
+  const uint64_t end = start + ts->second.bl.length();
+  if (to_read.range_start() < start || to_read.range_end() > end)
+    return false;
+  for (auto j = to_read.begin(); j != to_read.end(); ++j) {
+    bufferlist bl;
+    bl.substr_of(ts->second.bl, j.get_start() - start, j.get_len());
+    (*results)[hoid].insert(j.get_start(), j.get_len(), std::move(bl));
+  }
+  return true;
+}
+
+void ECTailStripeCache::update(
+  const ECUtil::stripe_info_t &sinfo,
+  const std::map<hobject_t, ECUtil::HashInfoRef> &hash_infos,
+  const std::map<hobject_t, extent_map> &written,
+  uint64_t max_bytes)
+{
+  // anything the write changed is stale, including rename sources
+  for (auto &&i: hash_infos)
+    erase(i.first);
+
+  if (max_bytes < sinfo.get_stripe_width()) {
+    clear();
+    return;
+  }
+  for (auto &&i: written) {
+    auto hinfo = hash_infos.find(i.first);
+    if (i.second.empty() || hinfo == hash_infos.end())
+      continue;
+    uint64_t size = hinfo->second->get_total_logical_size(sinfo);
+    if (size == 0)
+      continue;
+    uint64_t offset = size - sinfo.get_stripe_width();
+    extent_map tail = i.second.intersect(offset, sinfo.get_stripe_width());
+    if (tail.empty() ||
+	tail.begin().get_off() != offset ||
+	tail.begin().get_len() != sinfo.get_stripe_width())
+      continue;
+
+    TailStripe &ts = tail_stripes[i.first];
+    ts.offset = offset;
+    ts.bl = tail.begin().get_val();
+    // do not pin the whole client buffer
+    ts.bl.rebuild();
+    bytes += ts.bl.length();
+    lru.push_front(i.first);
+    ts.lru = lru.begin();
+  }
+  while (bytes > max_bytes)
+    erase(lru.back());
+}
@@ -0,0 +1,119 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t -*-
+// vim: ts=8 sw=2 smarttab
+/*
+ * Ceph - scalable distributed file system
+ *
+ * This is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License version 2.1, as published by the Free Software
+ * Foundation.  See file COPYING.
+ *
+ */
+
+#ifndef EC_TAIL_STRIPE_CACHE_H
+#define EC_TAIL_STRIPE_CACHE_H
+
+#include <map>
+#include <list>
+#include "include/buffer.h"
+#include "common/hobject.h"
+#include "ECUtil.h"
+#include "ExtentCache.h"
+
+/**
+   ECTailStripeCache
+
+   Last stripe of the objects most recently written up to their end, so
+   that the next small append to one of them, which must rewrite that
+   stripe, does not read it back from the shards first.
+
+   Every write is handed to update() once its transactions are
+   generated: any object it touches (including rename sources, removed
+   and truncated objects) is dropped, and written back if the write
+   leaves the whole of its new last stripe in memory.  The owner clears
+   the cache on interval change.
+
+   read() is all or nothing and refuses objects that another in flight
+   write is about to change, since the cached stripe only reflects the
+   writes update() has seen so far.
+
+   Bounded by max_bytes, least recently written objects go first.
+ */
+class ECTailStripeCache {
+  struct TailStripe {
+    uint64_t offset = 0;
+    bufferlist bl;
+    std::list<hobject_t>::iterator lru;
+  };
+  std::map<hobject_t, TailStripe> tail_stripes;
+  std::list<hobject_t> lru;
+  uint64_t bytes = 0;
+
+  void erase(const hobject_t &hoid);
+  bool read_one(
+    const hobject_t &hoid,
+    const extent_set &to_read,
+    std::map<hobject_t, extent_map> *results) const;
+
+public:
+  /**
+   * Account for a write
+   *
+   * @param sinfo [in] stripe layout of the pool
+   * @param hash_infos [in] every object the write touches, with its size
+   *                        after the write
+   * @param written [in] data the write sends to the shards, by object
+   * @param max_bytes [in] bound on the cache, 0 disables it
+   */
+  void update(
+    const ECUtil::stripe_info_t &sinfo,
+    const std::map<hobject_t, ECUtil::HashInfoRef> &hash_infos,
+    const std::map<hobject_t, extent_map> &written,
+    uint64_t max_bytes);
+
+  /**
+   * Serve the reads of an rmw from the cache
+   *
+   * @param to_read [in] extents to read, by object
+   * @param write_in_flight [in] true for objects another pipelined
+   *                             write has yet to change
+   * @param results [out] data for every extent of to_read
+   * @return true if all of to_read was found, results untouched otherwise
+   */
+  template <typename F>
+  bool read(
+    const std::map<hobject_t, extent_set> &to_read,
+    F &&write_in_flight,
+    std::map<hobject_t, extent_map> *results) const {
+    if (to_read.empty() || tail_stripes.empty())
+      return false;
+    for (auto &&i: to_read) {
+      if (!tail_stripes.count(i.first) || write_in_flight(i.first))
+	return false;
+    }
+    std::map<hobject_t, extent_map> out;
+    for (auto &&i: to_read) {
+      if (!read_one(i.first, i.second, &out))
+	return false;
+    }
+    results->swap(out);
+    return true;
+  }
+
+  void clear() {
+    tail_stripes.clear();
+    lru.clear();
+    bytes = 0;
+  }
+  bool empty() const {
+    return tail_stripes.empty();
+  }
+  bool contains(const hobject_t &hoid) const {
+    return tail_stripes.count(hoid);
+  }
+  uint64_t get_bytes() const {
+    return bytes;
+  }
+};
+
+#endif
@@ -23,12 +23,65 @@
 #include "common/inline_variant.h"
 
 
+/* Encode bl, the data at logical offset, taking the chunks of the
+ * writes encoded ahead of time where one starts in the extent and fits
+ * in it, and encoding the rest here. */
+static void encode_extent(
+  const ECUtil::stripe_info_t &sinfo,
+  ErasureCodeInterfaceRef &ecimpl,
+  const set<int> &want,
+  const ECTransaction::stripe_chunks_t *pre_encoded,
+  uint64_t offset,
+  bufferlist &bl,
+  map<int, bufferlist> *buffers) {
+  if (!pre_encoded || pre_encoded->empty()) {
+    int r = ECUtil::encode(
+      sinfo, ecimpl, bl, want, buffers);
+    assert(r == 0);
+    return;
+  }
+
+  const uint64_t end = offset + bl.length();
+  uint64_t pos = offset;
+  while (pos < end) {
+    auto i = pre_encoded->lower_bound(pos);
+    if (i != pre_encoded->end() && i->first == pos) {
+      assert(!i->second.empty());
+      uint64_t len = sinfo.aligned_chunk_offset_to_logical_offset(
+	i->second.begin()->second.length());
+      if (pos + len <= end) {
+	for (auto &&j : i->second) {
+	  assert(want.count(j.first));
+	  (*buffers)[j.first].append(j.second);
+	}
+	pos += len;
+	continue;
+      }
+      ++i;
+    }
+    uint64_t next = end;
+    if (i != pre_encoded->end() && i->first < end)
+      next = i->first;
+    bufferlist piece;
+    piece.substr_of(bl, pos - offset, next - pos);
+    map<int, bufferlist> encoded;
+    int r = ECUtil::encode(
+      sinfo, ecimpl, piece, want, &encoded);
+    assert(r == 0);
+    for (auto &&j : encoded) {
+      (*buffers)[j.first].claim_append(j.second);
+    }
+    pos = next;
+  }
+}
+
 void encode_and_write(
   pg_t pgid,
   const hobject_t &oid,
   const ECUtil::stripe_info_t &sinfo,
   ErasureCodeInterfaceRef &ecimpl,
   const set<int> &want,
+  const ECTransaction::stripe_chunks_t *pre_encoded,
   uint64_t offset,
   bufferlist bl,
   uint32_t flags,
@@ -42,9 +95,7 @@ void encode_and_write(
   assert(bl.length());
 
   map<int, bufferlist> buffers;
-  int r = ECUtil::encode(
-    sinfo, ecimpl, bl, want, &buffers);
-  assert(r == 0);
+  encode_extent(sinfo, ecimpl, want, pre_encoded, offset, bl, &buffers);
 
   written.insert(offset, bl.length(), bl);
 
@@ -95,6 +146,105 @@ bool ECTransaction::requires_overwrite(
       (op.truncate->first < prev_size)));
 }
 
+void ECTransaction::plan_parity_delta(
+  const ECUtil::stripe_info_t &sinfo,
+  ErasureCodeInterfaceRef &ecimpl,
+  WritePlan &plan,
+  DoutPrefixProvider *dpp)
+{
+  if (!ecimpl->supports_parity_delta() ||
+      plan.invalidates_cache ||
+      plan.to_read.size() != 1 ||
+      plan.t->op_map.size() != 1)
+    return;
+
+  const hobject_t &oid = plan.to_read.begin()->first;
+  auto &op = plan.t->op_map.begin()->second;
+  if (plan.t->op_map.begin()->first != oid ||
+      !op.is_none() ||
+      op.truncate ||
+      op.buffer_updates.empty() ||
+      !(plan.to_read[oid] == plan.will_write[oid])) {
+    // some stripe is (re)written in full, or the object changes shape
+    return;
+  }
+
+  const uint64_t size = plan.hash_infos[oid]->get_total_logical_size(sinfo);
+  const uint64_t chunk_size = sinfo.get_chunk_size();
+  const unsigned k = ecimpl->get_data_chunk_count();
+  const unsigned m = ecimpl->get_coding_chunk_count();
+  set<unsigned> changed; // data chunk positions within the stripe
+  for (auto &&extent: op.buffer_updates) {
+    using BufferUpdate = PGTransaction::ObjectOperation::BufferUpdate;
+    if (boost::get<BufferUpdate::CloneRange>(&(extent.get_val())))
+      return;
+    uint64_t end = extent.get_off() + extent.get_len();
+    if (end > size)
+      return;
+    for (uint64_t c = extent.get_off() / chunk_size; c * chunk_size < end; ++c) {
+      changed.insert(c % k);
+      if (changed.size() + m > k)
+	return;
+    }
+  }
+
+  const vector<int> &mapping = ecimpl->get_chunk_mapping();
+  set<int> &shards = plan.parity_delta[oid];
+  for (unsigned i = 0; i < k + m; ++i) {
+    if (i < k && !changed.count(i))
+      continue;
+    shards.insert(mapping.size() > i ? mapping[i] : i);
+  }
+  ldpp_dout(dpp, 20) << __func__ << ": " << oid
+		     << " reading shards " << shards << dendl;
+}
+
+uint64_t ECTransaction::get_full_stripe_writes(
+  const ECUtil::stripe_info_t &sinfo,
+  const WritePlan &plan,
+  full_stripe_writes_t *to_encode)
+{
+  assert(plan.t);
+  assert(to_encode);
+  uint64_t bytes = 0;
+  for (auto &&i : plan.t->op_map) {
+    if (plan.parity_delta.count(i.first))
+      continue;
+    for (auto &&extent : i.second.buffer_updates) {
+      using BufferUpdate = PGTransaction::ObjectOperation::BufferUpdate;
+      auto *w = boost::get<BufferUpdate::Write>(&(extent.get_val()));
+      if (!w ||
+	  !sinfo.logical_offset_is_stripe_aligned(extent.get_off()) ||
+	  !sinfo.logical_offset_is_stripe_aligned(extent.get_len()))
+	continue;
+      (*to_encode)[i.first][extent.get_off()] = w->buffer;
+      bytes += extent.get_len();
+    }
+  }
+  return bytes;
+}
+
+void ECTransaction::pre_encode(
+  const ECUtil::stripe_info_t &sinfo,
+  ErasureCodeInterfaceRef &ecimpl,
+  full_stripe_writes_t &to_encode,
+  pre_encoded_t *encoded)
+{
+  assert(encoded);
+  set<int> want;
+  for (unsigned i = 0; i < ecimpl->get_chunk_count(); ++i) {
+    want.insert(i);
+  }
+  for (auto &&i : to_encode) {
+    auto &obj = (*encoded)[i.first];
+    for (auto &&j : i.second) {
+      int r = ECUtil::encode(
+	sinfo, ecimpl, j.second, want, &obj[j.first]);
+      assert(r == 0);
+    }
+  }
+}
+
 void ECTransaction::generate_transactions(
   WritePlan &plan,
   ErasureCodeInterfaceRef &ecimpl,
@@ -102,6 +252,8 @@ void ECTransaction::generate_transactions(
   bool legacy_log_entries,
   const ECUtil::stripe_info_t &sinfo,
   const map<hobject_t,extent_map> &partial_extents,
+  const map<hobject_t,stripe_chunks_t> &delta_chunks,
+  const pre_encoded_t &pre_encoded,
   vector<pg_log_entry_t> &entries,
   map<hobject_t,extent_map> *written_map,
   map<shard_id_t, ObjectStore::Transaction> *transactions,
@@ -537,10 +689,88 @@ void ECTransaction::generate_transactions(
 			   << dendl;
       }
 
+      auto dciter = delta_chunks.find(oid);
+      if (dciter != delta_chunks.end()) {
+	/* Parity delta overwrite: to_write holds only the new bytes.  Patch
+	 * them into the old data chunks and update the coding chunks by the
+	 * difference; the other data shards are not written. */
+	assert(entry);
+	assert(new_size == orig_size && append_after == orig_size);
+	const vector<int> &mapping = ecimpl->get_chunk_mapping();
+	const uint64_t chunk_size = sinfo.get_chunk_size();
+	const unsigned k = ecimpl->get_data_chunk_count();
+	for (auto &&stripe: dciter->second) {
+	  map<int, bufferlist> new_data;
+	  for (unsigned i = 0; i < k; ++i) {
+	    int shard = mapping.size() > i ? mapping[i] : i;
+	    auto old = stripe.second.find(shard);
+	    if (old == stripe.second.end())
+	      continue;
+	    uint64_t chunk_start = stripe.first + i * chunk_size;
+	    bufferptr bp(chunk_size);
+	    old->second.copy(0, chunk_size, bp.c_str());
+	    for (auto &&extent: to_write.intersect(chunk_start, chunk_size)) {
+	      extent.get_val().copy(
+		0, extent.get_len(),
+		bp.c_str() + (extent.get_off() - chunk_start));
+	    }
+	    new_data[shard].push_back(std::move(bp));
+	  }
+
+	  map<int, bufferlist> buffers;
+	  int r = ECUtil::encode_parity_delta(
+	    sinfo, ecimpl, stripe.second, new_data, &buffers);
+	  assert(r == 0);
+
+	  uint64_t restore_from =
+	    sinfo.aligned_logical_offset_to_chunk_offset(stripe.first);
+	  ldpp_dout(dpp, 20) << __func__ << ": parity delta overwriting "
+			     << restore_from << "~" << chunk_size
+			     << " on shards " << buffers.size() << dendl;
+	  // rollback state is per log entry, not per shard, so every shard
+	  // still stashes the old stripe
+	  if (rollback_extents.empty()) {
+	    for (auto &&st : *transactions) {
+	      st.second.touch(
+		coll_t(spg_t(pgid, st.first)),
+		ghobject_t(oid, entry->version.version, st.first));
+	    }
+	  }
+	  rollback_extents.emplace_back(make_pair(restore_from, chunk_size));
+	  for (auto &&st : *transactions) {
+	    st.second.clone_range(
+	      coll_t(spg_t(pgid, st.first)),
+	      ghobject_t(oid, ghobject_t::NO_GEN, st.first),
+	      ghobject_t(oid, entry->version.version, st.first),
+	      restore_from,
+	      chunk_size,
+	      restore_from);
+	  }
+	  for (auto &&b : buffers) {
+	    auto st = transactions->find(shard_id_t(b.first));
+	    if (st == transactions->end())
+	      continue;
+	    st->second.write(
+	      coll_t(spg_t(pgid, st->first)),
+	      ghobject_t(oid, ghobject_t::NO_GEN, st->first),
+	      restore_from,
+	      b.second.length(),
+	      b.second,
+	      fadvise_flags);
+	  }
+	}
+	to_write.clear();
+      }
+
       set<int> want;
       for (unsigned i = 0; i < ecimpl->get_chunk_count(); ++i) {
 	want.insert(i);
       }
+      const stripe_chunks_t *obj_pre_encoded = nullptr;
+      auto peiter = pre_encoded.find(oid);
+      if (peiter != pre_encoded.end()) {
+	obj_pre_encoded = &(peiter->second);
+      }
       auto to_overwrite = to_write.intersect(0, append_after);
       ldpp_dout(dpp, 20) << __func__ << ": to_overwrite: "
 			 << to_overwrite
@@ -581,6 +811,7 @@ void ECTransaction::generate_transactions(
 	  sinfo,
 	  ecimpl,
 	  want,
+	  obj_pre_encoded,
 	  extent.get_off(),
 	  extent.get_val(),
 	  fadvise_flags,
@@ -608,6 +839,7 @@ void ECTransaction::generate_transactions(
 	  sinfo,
 	  ecimpl,
 	  want,
+	  obj_pre_encoded,
 	  extent.get_off(),
 	  extent.get_val(),
 	  fadvise_flags,
@@ -30,8 +30,23 @@ namespace ECTransaction {
     map<hobject_t,extent_set> will_write; // superset of to_read
 
     map<hobject_t,ECUtil::HashInfoRef> hash_infos;
+
+    /// objects overwritten by parity delta, with the shards whose old
+    /// chunks must be read (changed data shards and all coding shards)
+    map<hobject_t,set<int>> parity_delta;
   };
 
+  /// old chunks read for a parity delta overwrite, by stripe-aligned
+  /// logical offset and shard
+  typedef map<uint64_t, map<int, bufferlist>> stripe_chunks_t;
+
+  /// data of stripe aligned writes, by object and logical offset
+  typedef map<hobject_t, map<uint64_t, bufferlist>> full_stripe_writes_t;
+
+  /// the same writes encoded ahead of generate_transactions, by object,
+  /// logical offset and shard
+  typedef map<hobject_t, stripe_chunks_t> pre_encoded_t;
+
   bool requires_overwrite(
     uint64_t prev_size,
     const PGTransaction::ObjectOperation &op);
@@ -182,6 +197,36 @@ namespace ECTransaction {
     return plan;
   }
 
+  /**
+   * Decide whether a planned partial stripe overwrite can update parity
+   * from the changed data chunks alone, and if so fill in
+   * plan.parity_delta.  Only a plain overwrite of a single object within
+   * its current size qualifies, and only when reading the changed data
+   * chunks and the coding chunks costs no more than reading the stripe.
+   */
+  void plan_parity_delta(
+    const ECUtil::stripe_info_t &sinfo,
+    ErasureCodeInterfaceRef &ecimpl,
+    WritePlan &plan,
+    DoutPrefixProvider *dpp);
+
+  /**
+   * Collect the writes of plan that generate_transactions encodes as
+   * they are: stripe aligned in offset and length, and not part of a
+   * parity delta overwrite.  Returns the number of bytes collected.
+   */
+  uint64_t get_full_stripe_writes(
+    const ECUtil::stripe_info_t &sinfo,
+    const WritePlan &plan,
+    full_stripe_writes_t *to_encode);
+
+  /// encode every write of to_encode into all the chunks
+  void pre_encode(
+    const ECUtil::stripe_info_t &sinfo,
+    ErasureCodeInterfaceRef &ecimpl,
+    full_stripe_writes_t &to_encode,
+    pre_encoded_t *encoded);
+
   void generate_transactions(
     WritePlan &plan,
     ErasureCodeInterfaceRef &ecimpl,
@@ -189,6 +234,8 @@ namespace ECTransaction {
     bool legacy_log_entries,
     const ECUtil::stripe_info_t &sinfo,
     const map<hobject_t,extent_map> &partial_extents,
+    const map<hobject_t,stripe_chunks_t> &delta_chunks,
+    const pre_encoded_t &pre_encoded,
     vector<pg_log_entry_t> &entries,
     map<hobject_t,extent_map> *written,
     map<shard_id_t, ObjectStore::Transaction> *transactions,
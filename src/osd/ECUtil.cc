@@ -1,6 +1,7 @@
 // -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t -*-
 
 #include <errno.h>
+#include <string.h>
 #include "include/encoding.h"
 #include "ECUtil.h"
 using namespace std;
@@ -27,19 +28,33 @@ int ECUtil::decode(
   if (total_data_size == 0)
     return 0;
 
-  for (uint64_t i = 0; i < total_data_size; i += sinfo.get_chunk_size()) {
-    map<int, bufferlist> chunks;
-    for (map<int, bufferlist>::iterator j = to_decode.begin();
-	 j != to_decode.end();
-	 ++j) {
-      chunks[j->first].substr_of(j->second, i, sinfo.get_chunk_size());
+  unsigned k = ec_impl->get_data_chunk_count();
+  set<int> want;
+  const vector<int> &mapping = ec_impl->get_chunk_mapping();
+  for (unsigned i = 0; i < k; ++i)
+    want.insert(mapping.size() > i ? mapping[i] : i);
+  map<int, bufferlist> decoded;
+  int r = ec_impl->decode_stripes(want, to_decode, sinfo.get_chunk_size(),
+				  &decoded);
+  assert(r == 0);
+  // interleave the data chunks back into one logical buffer
+  bufferptr buf(buffer::create_aligned(
+		  sinfo.aligned_chunk_offset_to_logical_offset(total_data_size),
+		  CHUNK_ALIGNMENT));
+  char *dest = buf.c_str();
+  for (unsigned j = 0; j < k; ++j) {
+    bufferlist &chunk = decoded[mapping.size() > j ? mapping[j] : j];
+    assert(chunk.length() == total_data_size);
+    const char *src = chunk.c_str();
+    for (uint64_t i = 0; i < total_data_size; i += sinfo.get_chunk_size()) {
+      memcpy(dest + (i / sinfo.get_chunk_size()) * sinfo.get_stripe_width() +
+	     j * sinfo.get_chunk_size(),
+	     src + i, sinfo.get_chunk_size());
     }
-    bufferlist bl;
-    int r = ec_impl->decode_concat(chunks, &bl);
-    assert(bl.length() == sinfo.get_stripe_width());
-    assert(r == 0);
-    out->claim_append(bl);
   }
+  out->push_back(std::move(buf));
+  assert(out->length() ==
+	 sinfo.aligned_chunk_offset_to_logical_offset(total_data_size));
   return 0;
 }
 
@@ -71,23 +86,15 @@ int ECUtil::decode(
     need.insert(i->first);
   }
 
-  for (uint64_t i = 0; i < total_data_size; i += sinfo.get_chunk_size()) {
-    map<int, bufferlist> chunks;
-    for (map<int, bufferlist>::iterator j = to_decode.begin();
-	 j != to_decode.end();
-	 ++j) {
-      chunks[j->first].substr_of(j->second, i, sinfo.get_chunk_size());
-    }
-    map<int, bufferlist> out_bls;
-    int r = ec_impl->decode(need, chunks, &out_bls);
-    assert(r == 0);
-    for (map<int, bufferlist*>::iterator j = out.begin();
-	 j != out.end();
-	 ++j) {
-      assert(out_bls.count(j->first));
-      assert(out_bls[j->first].length() == sinfo.get_chunk_size());
-      j->second->claim_append(out_bls[j->first]);
-    }
+  map<int, bufferlist> out_bls;
+  int r = ec_impl->decode_stripes(need, to_decode, sinfo.get_chunk_size(),
+				  &out_bls);
+  assert(r == 0);
+  for (map<int, bufferlist*>::iterator i = out.begin();
+       i != out.end();
+       ++i) {
+    assert(out_bls.count(i->first));
+    i->second->claim_append(out_bls[i->first]);
   }
   for (map<int, bufferlist*>::iterator i = out.begin();
        i != out.end();
@@ -113,19 +120,8 @@ int ECUtil::encode(
   if (logical_size == 0)
     return 0;
 
-  for (uint64_t i = 0; i < logical_size; i += sinfo.get_stripe_width()) {
-    map<int, bufferlist> encoded;
-    bufferlist buf;
-    buf.substr_of(in, i, sinfo.get_stripe_width());
-    int r = ec_impl->encode(want, buf, &encoded);
-    assert(r == 0);
-    for (map<int, bufferlist>::iterator i = encoded.begin();
-	 i != encoded.end();
-	 ++i) {
-      assert(i->second.length() == sinfo.get_chunk_size());
-      (*out)[i->first].claim_append(i->second);
-    }
-  }
+  int r = ec_impl->encode_stripes(want, in, sinfo.get_chunk_size(), out);
+  assert(r == 0);
 
   for (map<int, bufferlist>::iterator i = out->begin();
        i != out->end();
@@ -138,6 +134,68 @@ int ECUtil::encode(
   return 0;
 }
 
+// dst ^= src, a machine word at a time
+static void xor_region(char *dst, const char *src, unsigned len)
+{
+  unsigned off = 0;
+  for (; off + sizeof(uint64_t) <= len; off += sizeof(uint64_t)) {
+    uint64_t a, b;
+    memcpy(&a, dst + off, sizeof(a));
+    memcpy(&b, src + off, sizeof(b));
+    a ^= b;
+    memcpy(dst + off, &a, sizeof(a));
+  }
+  for (; off < len; ++off)
+    dst[off] ^= src[off];
+}
+
+int ECUtil::encode_parity_delta(
+  const stripe_info_t &sinfo,
+  ErasureCodeInterfaceRef &ec_impl,
+  const map<int, bufferlist> &chunks,
+  const map<int, bufferlist> &new_data,
+  map<int, bufferlist> *out) {
+  assert(out);
+  assert(out->empty());
+
+  map<int, bufferlist> delta;
+  for (map<int, bufferlist>::const_iterator i = new_data.begin();
+       i != new_data.end();
+       ++i) {
+    map<int, bufferlist>::const_iterator old = chunks.find(i->first);
+    assert(old != chunks.end());
+    assert(old->second.length() == sinfo.get_chunk_size());
+    assert(i->second.length() == sinfo.get_chunk_size());
+    bufferptr d(buffer::create_aligned(sinfo.get_chunk_size(),
+				       CHUNK_ALIGNMENT));
+    i->second.copy(0, d.length(), d.c_str());
+    bufferlist o(old->second);  // c_str() only copies a fragmented chunk
+    xor_region(d.c_str(), o.c_str(), d.length());
+    delta[i->first].push_back(std::move(d));
+    (*out)[i->first] = i->second;
+  }
+
+  map<int, bufferlist> parity_delta;
+  int r = ec_impl->encode_delta(delta, &parity_delta);
+  if (r < 0)
+    return r;
+
+  for (map<int, bufferlist>::iterator i = parity_delta.begin();
+       i != parity_delta.end();
+       ++i) {
+    map<int, bufferlist>::const_iterator old = chunks.find(i->first);
+    assert(old != chunks.end());
+    assert(old->second.length() == sinfo.get_chunk_size());
+    bufferptr parity(buffer::create_aligned(sinfo.get_chunk_size(),
+					    CHUNK_ALIGNMENT));
+    old->second.copy(0, parity.length(), parity.c_str());
+    assert(i->second.length() == parity.length());
+    xor_region(parity.c_str(), i->second.c_str(), parity.length());
+    (*out)[i->first].push_back(std::move(parity));
+  }
+  return 0;
+}
+
 void ECUtil::HashInfo::append(uint64_t old_size,
 			      map<int, bufferlist> &to_append) {
   assert(old_size == total_chunk_size);
@@ -102,6 +102,19 @@ int encode(
   const std::set<int> &want,
   std::map<int, bufferlist> *out);
 
+/**
+ * Update one stripe in place of a full re-encode: **chunks** holds the
+ * old content of the changed data chunks and of every coding chunk;
+ * **new_data** the new content of the changed data chunks.  On success
+ * **out** holds the new content of all the chunks in **chunks**.
+ */
+int encode_parity_delta(
+  const stripe_info_t &sinfo,
+  ErasureCodeInterfaceRef &ec_impl,
+  const std::map<int, bufferlist> &chunks,
+  const std::map<int, bufferlist> &new_data,
+  std::map<int, bufferlist> *out);
+
 class HashInfo {
   uint64_t total_chunk_size = 0;
   std::vector<uint32_t> cumulative_shard_hashes;
@@ -140,6 +140,7 @@
 
 #include "common/cmdparse.h"
 #include "include/str_list.h"
+#include "common/strtol.h"
 #include "include/util.h"
 
 #include "include/assert.h"
@@ -216,6 +217,9 @@ OSDService::OSDService(OSD *osd) :
   peering_wq(osd->peering_wq),
   recovery_gen_wq("recovery_gen_wq", cct->_conf->osd_recovery_thread_timeout,
 		  &osd->disk_tp),
+  ec_encode_threads(cct->_conf->osd_ec_encode_threads),
+  ec_encode_gen_wq("ec_encode_gen_wq", cct->_conf->osd_op_thread_timeout,
+		   &osd->ec_encode_tp),
   class_handler(osd->class_handler),
   pg_epoch_lock("OSDService::pg_epoch_lock"),
   publish_lock("OSDService::publish_lock"),
@@ -1307,6 +1311,42 @@ void OSDService::dec_scrubs_active()
   sched_scrub_lock.Unlock();
 }
 
+void OSDService::account_scrub_bytes(uint64_t bytes)
+{
+  logger->inc(l_osd_scrub_bytes, bytes);
+  uint64_t rate = cct->_conf->osd_scrub_max_bytes_per_sec;
+  Mutex::Locker l(sched_scrub_lock);
+  if (!rate) {
+    scrub_bytes_avail = 0;
+    return;
+  }
+  utime_t now = ceph_clock_now();
+  if (scrub_bytes_stamp == utime_t()) {
+    scrub_bytes_avail = rate;
+  } else if (now > scrub_bytes_stamp) {
+    // allow at most one second worth of burst
+    scrub_bytes_avail = MIN(
+      scrub_bytes_avail + rate * (double)(now - scrub_bytes_stamp),
+      (double)rate);
+  }
+  scrub_bytes_stamp = now;
+  scrub_bytes_avail -= bytes;
+}
+
+double OSDService::get_scrub_budget_delay()
+{
+  uint64_t rate = cct->_conf->osd_scrub_max_bytes_per_sec;
+  if (!rate)
+    return 0;
+  Mutex::Locker l(sched_scrub_lock);
+  double avail = scrub_bytes_avail +
+    rate * (double)(ceph_clock_now() - scrub_bytes_stamp);
+  if (avail >= 0)
+    return 0;
+  logger->inc(l_osd_scrub_throttled);
+  return -avail / rate;
+}
+
 void OSDService::retrieve_epochs(epoch_t *_boot_epoch, epoch_t *_up_epoch,
                                  epoch_t *_bind_epoch) const
 {
@@ -1537,7 +1577,12 @@ OSDMapRef OSDService::_add_map(OSDMap *o)
     // Dedup against an existing map at a nearby epoch
     OSDMapRef for_dedup = map_cache.lower_bound(e);
     if (for_dedup) {
-      OSDMap::dedup(for_dedup.get(), o);
+      int shared = OSDMap::dedup(for_dedup.get(), o);
+      dout(20) << __func__ << " e" << e << " shares " << shared
+	       << " sub-structures with e" << for_dedup->get_epoch() << dendl;
+      if (logger) {
+	logger->inc(l_osd_map_dedup_shared, shared);
+      }
     }
   }
   bool existed;
@@ -1545,6 +1590,9 @@ OSDMapRef OSDService::_add_map(OSDMap *o)
   if (existed) {
     delete o;
   }
+  if (logger) {
+    logger->set(l_osd_map_cache_bytes, mempool::osdmap::allocated_bytes());
+  }
   return l;
 }
 
@@ -1900,6 +1948,8 @@ OSD::OSD(CephContext *cct_, ObjectStore *store_,
   dev_path(dev), journal_path(jdev),
   store_is_rotational(store->is_rotational()),
   trace_endpoint("0.0.0.0", 0, "osd"),
+  rx_buffer_pool(cct->_conf->osd_rx_buffer_pool_align,
+		 cct->_conf->osd_rx_buffer_pool_size),
   asok_hook(NULL),
   osd_compat(get_osd_compat_set()),
   peering_tp(cct, "OSD::peering_tp", "tp_peering",
@@ -1909,6 +1959,8 @@ OSD::OSD(CephContext *cct_, ObjectStore *store_,
 	    get_num_op_threads()),
   disk_tp(cct, "OSD::disk_tp", "tp_osd_disk", cct->_conf->osd_disk_threads, "osd_disk_threads"),
   command_tp(cct, "OSD::command_tp", "tp_osd_cmd",  1),
+  ec_encode_tp(cct, "OSD::ec_encode_tp", "tp_osd_ec_enc",
+	       cct->_conf->osd_ec_encode_threads),
   session_waiting_lock("OSD::session_waiting_lock"),
   heartbeat_lock("OSD::heartbeat_lock"),
   heartbeat_stop(false),
@@ -2218,6 +2270,8 @@ will start to track new ops received afterwards.";
     store->get_db_statistics(f);
   } else if (admin_command == "dump_scrubs") {
     service.dumps_scrub(f);
+  } else if (admin_command == "dump_recovery_scheduler") {
+    service.dump_recovery_scheduler(f);
   } else if (admin_command == "calc_objectstore_db_histogram") {
     store->generate_db_histogram(f);
   } else if (admin_command == "flush_store_cache") {
@@ -2595,6 +2649,7 @@ int OSD::init()
   osd_op_tp.start();
   disk_tp.start();
   command_tp.start();
+  ec_encode_tp.start();
 
   set_disk_tp_priority();
 
@@ -2800,6 +2855,12 @@ void OSD::final_init()
 				     "print scheduled scrubs");
   assert(r == 0);
 
+  r = admin_socket->register_command("dump_recovery_scheduler",
+				     "dump_recovery_scheduler",
+				     asok_hook,
+				     "show recovery throttle and queued pgs");
+  assert(r == 0);
+
   r = admin_socket->register_command("calc_objectstore_db_histogram",
                                      "calc_objectstore_db_histogram",
                                      asok_hook,
@@ -3059,6 +3120,22 @@ void OSD::create_logger()
   osd_plb.add_u64_counter(l_osd_push, "push", "Push messages sent");
   osd_plb.add_u64_counter(l_osd_push_outb, "push_out_bytes", "Pushed size");
 
+  osd_plb.add_u64_counter(
+    l_osd_recovery_bytes, "recovery_bytes",
+    "Bytes read and pushed for recovery");
+  osd_plb.add_u64(
+    l_osd_recovery_bytes_budget, "recovery_bytes_budget",
+    "Current recovery byte budget per second");
+  osd_plb.add_u64_counter(
+    l_osd_recovery_throttled, "recovery_throttled",
+    "Recovery starts deferred by the byte budget");
+
+  osd_plb.add_u64_counter(
+    l_osd_scrub_bytes, "scrub_bytes", "Bytes read by deep scrub");
+  osd_plb.add_u64_counter(
+    l_osd_scrub_throttled, "scrub_throttled",
+    "Scrub chunks delayed by the scrub byte budget");
+
   osd_plb.add_u64_counter(
     l_osd_rop, "recovery_ops",
     "Started recovery operations",
@@ -3113,6 +3190,15 @@ void OSD::create_logger()
   osd_plb.add_u64_counter(
     l_osd_map_bl_cache_miss, "osd_map_bl_cache_miss",
     "OSDMap buffer cache misses");
+  osd_plb.add_u64(
+    l_osd_map_cache_bytes, "osd_map_cache_bytes",
+    "Memory used by decoded OSDMaps (osdmap mempool)");
+  osd_plb.add_u64_avg(
+    l_osd_map_epoch_bytes, "osd_map_epoch_bytes",
+    "Memory added per OSDMap epoch received (osdmap mempool)");
+  osd_plb.add_u64_counter(
+    l_osd_map_dedup_shared, "osd_map_dedup_shared",
+    "OSDMap sub-structures shared with the previous cached epoch");
 
   osd_plb.add_u64(l_osd_stat_bytes, "stat_bytes", "OSD size");
   osd_plb.add_u64(l_osd_stat_bytes_used, "stat_bytes_used", "Used space");
@@ -3292,6 +3378,7 @@ int OSD::shutdown()
   cct->get_admin_socket()->unregister_command("get_heap_property");
   cct->get_admin_socket()->unregister_command("dump_objectstore_kv_stats");
   cct->get_admin_socket()->unregister_command("dump_scrubs");
+  cct->get_admin_socket()->unregister_command("dump_recovery_scheduler");
   cct->get_admin_socket()->unregister_command("calc_objectstore_db_histogram");
   cct->get_admin_socket()->unregister_command("flush_store_cache");
   cct->get_admin_socket()->unregister_command("dump_pgstate_history");
@@ -3337,6 +3424,10 @@ int OSD::shutdown()
   disk_tp.stop();
   dout(10) << "disk tp paused (new)" << dendl;
 
+  ec_encode_tp.drain();
+  ec_encode_tp.stop();
+  dout(10) << "ec encode tp stopped" << dendl;
+
   dout(10) << "stopping agent" << dendl;
   service.agent_stop();
 
@@ -5103,6 +5194,8 @@ void OSD::tick_without_osd_lock()
   logger->set(l_osd_cached_crc_adjusted, buffer::get_cached_crc_adjusted());
   logger->set(l_osd_missed_crc, buffer::get_missed_crc());
 
+  service.adjust_recovery_budget();
+
   // osd_lock is not being held, which means the OSD state
   // might change when doing the monitor report
   if (is_active() || is_waiting_for_healthy()) {
@@ -6965,6 +7058,27 @@ void OSD::ms_fast_preprocess(Message *m)
   }
 }
 
+bool OSD::ms_fast_alloc_data(Connection *con, const ceph_msg_header& header,
+			     bufferlist *data)
+{
+  // Only write payloads are worth it: they end up in the ObjectStore, which
+  // can submit block-aligned buffers for direct I/O without copying them.
+  switch (le16_to_cpu(header.type)) {
+  case CEPH_MSG_OSD_OP:
+  case MSG_OSD_REPOP:
+  case MSG_OSD_EC_WRITE:
+    break;
+  default:
+    return false;
+  }
+  unsigned data_len = le32_to_cpu(header.data_len);
+  if (!cct->_conf->osd_rx_buffer_pool_size ||
+      data_len < cct->_conf->osd_rx_buffer_pool_min_alloc)
+    return false;
+  rx_buffer_pool.alloc(data_len, le16_to_cpu(header.data_off), data);
+  return true;
+}
+
 bool OSD::ms_get_authorizer(int dest_type, AuthAuthorizer **authorizer, bool force_new)
 {
   dout(10) << "OSD::ms_get_authorizer type=" << ceph_entity_type_name(dest_type) << dendl;
@@ -7635,8 +7749,17 @@ void OSD::handle_osd_map(MOSDMap *m)
       t.write(coll_t::meta(), oid, 0, bl.length(), bl);
       pin_map_inc_bl(e, bl);
 
+      int64_t before = mempool::osdmap::allocated_bytes();
       OSDMap *o = new OSDMap;
-      if (e > 1) {
+      OSDMapRef prev;
+      if (e > 1 && cct->_conf->osd_map_dedup) {
+	prev = service.lookup_map(e - 1);
+      }
+      if (prev) {
+	// start from the cached map; apply_incremental copies only the
+	// parts this epoch changes and shares the rest.
+	o->cow_copy_from(*prev);
+      } else if (e > 1) {
 	bufferlist obl;
         bool got = get_map_bl(e - 1, obl);
         assert(got);
@@ -7680,6 +7803,12 @@ void OSD::handle_osd_map(MOSDMap *m)
       t.write(coll_t::meta(), fulloid, 0, fbl.length(), fbl);
       pin_map_bl(e, fbl);
       pinned_maps.push_back(add_map(o));
+      int64_t added = (int64_t)mempool::osdmap::allocated_bytes() - before;
+      dout(20) << "handle_osd_map  inc map for epoch " << e << " added "
+	       << added << " bytes to the osdmap mempool" << dendl;
+      if (added > 0) {
+	logger->inc(l_osd_map_epoch_bytes, added);
+      }
       continue;
     }
 
@@ -9207,12 +9336,61 @@ void OSDService::_maybe_queue_recovery() {
     uint64_t to_start = MIN(
       available_pushes,
       cct->_conf->osd_recovery_max_single_start);
-    _queue_for_recovery(awaiting_throttle.front(), to_start);
-    awaiting_throttle.pop_front();
+    _queue_for_recovery(awaiting_throttle.begin()->second, to_start);
+    awaiting_throttle.erase(awaiting_throttle.begin());
     recovery_ops_reserved += to_start;
   }
 }
 
+void OSDService::account_recovery_bytes(uint64_t bytes)
+{
+  logger->inc(l_osd_recovery_bytes, bytes);
+  Mutex::Locker l(recovery_lock);
+  recovery_bytes.charge(bytes);
+}
+
+void OSDService::adjust_recovery_budget()
+{
+  uint64_t max_rate = cct->_conf->osd_recovery_max_bytes_per_sec;
+  double target = cct->_conf->osd_recovery_client_latency_target;
+  client_op_lat_ms.consume_next(logger->get_tavg_ms(l_osd_op_lat));
+  uint64_t lat_ms = client_op_lat_ms.current_avg();
+
+  Mutex::Locker l(recovery_lock);
+  recovery_bytes.adjust(max_rate, target, lat_ms, ceph_clock_now());
+  if (max_rate) {
+    dout(20) << __func__ << " client op latency " << lat_ms << "ms"
+	     << " recovery budget " << recovery_bytes.get_rate()
+	     << " bytes/sec" << dendl;
+  }
+  logger->set(l_osd_recovery_bytes_budget, recovery_bytes.get_rate());
+  _maybe_queue_recovery();
+}
+
+void OSDService::dump_recovery_scheduler(Formatter *f)
+{
+  Mutex::Locker l(recovery_lock);
+  f->open_object_section("recovery_scheduler");
+  f->dump_bool("paused", recovery_paused);
+  f->dump_stream("defer_until") << defer_recovery_until;
+  f->dump_unsigned("ops_active", recovery_ops_active);
+  f->dump_unsigned("ops_reserved", recovery_ops_reserved);
+  f->dump_unsigned("max_active", cct->_conf->osd_recovery_max_active);
+  f->dump_float("bytes_rate", recovery_bytes.get_rate());
+  f->dump_float("bytes_avail", recovery_bytes.get_avail());
+  f->dump_unsigned("client_op_latency_ms", client_op_lat_ms.current_avg());
+  f->open_array_section("awaiting_throttle");
+  for (auto& i : awaiting_throttle) {
+    f->open_object_section("pg");
+    f->dump_stream("pgid") << i.second.second->info.pgid;
+    f->dump_unsigned("priority", i.first);
+    f->dump_unsigned("epoch", i.second.first);
+    f->close_section();
+  }
+  f->close_section();
+  f->close_section();
+}
+
 bool OSDService::_recover_now(uint64_t *available_pushes)
 {
   if (available_pushes)
@@ -9236,6 +9414,15 @@ bool OSDService::_recover_now(uint64_t *available_pushes)
     return false;
   }
 
+  if (!recovery_bytes.allows_start(
+	cct->_conf->osd_recovery_max_bytes_per_sec, ceph_clock_now())) {
+    dout(15) << __func__ << " byte budget exhausted ("
+	     << recovery_bytes.get_avail() << " of "
+	     << recovery_bytes.get_rate() << " bytes/sec)" << dendl;
+    logger->inc(l_osd_recovery_throttled);
+    return false;
+  }
+
   if (available_pushes)
     *available_pushes = max - recovery_ops_active - recovery_ops_reserved;
 
@@ -10002,6 +10189,21 @@ void OSD::PeeringWQ::_dequeue(list<PG*> *out) {
 #undef dout_prefix
 #define dout_prefix *_dout << "osd." << osd->whoami << " op_wq "
 
+void OSD::ShardedOpWQ::init_shard_cpus()
+{
+  vector<string> corestrs;
+  get_str_vec(osd->cct->_conf->osd_op_shard_affinity_cores, corestrs);
+  for (auto& corestr : corestrs) {
+    string err;
+    int coreid = strict_strtol(corestr.c_str(), 10, &err);
+    if (err == "")
+      shard_cpus.push_back(coreid);
+    else
+      derr << __func__ << " failed to parse " << corestr << " in "
+	   << osd->cct->_conf->osd_op_shard_affinity_cores << dendl;
+  }
+}
+
 void OSD::ShardedOpWQ::wake_pg_waiters(spg_t pgid)
 {
   uint32_t shard_index = pgid.hash_to_shard(shard_list.size());
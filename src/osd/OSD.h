@@ -23,6 +23,7 @@
 #include "common/RWLock.h"
 #include "common/Timer.h"
 #include "common/WorkQueue.h"
+#include "common/AlignedBufferPool.h"
 #include "common/AsyncReserver.h"
 #include "common/ceph_context.h"
 #include "common/zipkin_trace.h"
@@ -41,6 +42,7 @@
 #include "Session.h"
 
 #include "osd/PGQueueable.h"
+#include "osd/RecoveryThrottle.h"
 
 #include <atomic>
 #include <map>
@@ -140,6 +142,9 @@ enum {
   l_osd_map_cache_miss_low_avg,
   l_osd_map_bl_cache_hit,
   l_osd_map_bl_cache_miss,
+  l_osd_map_cache_bytes,
+  l_osd_map_epoch_bytes,
+  l_osd_map_dedup_shared,
 
   l_osd_stat_bytes,
   l_osd_stat_bytes_used,
@@ -177,6 +182,13 @@ enum {
   l_osd_pg_fastinfo,
   l_osd_pg_biginfo,
 
+  l_osd_recovery_bytes,
+  l_osd_recovery_bytes_budget,
+  l_osd_recovery_throttled,
+
+  l_osd_scrub_bytes,
+  l_osd_scrub_throttled,
+
   l_osd_last,
 };
 
@@ -365,6 +377,8 @@ public:
   MonClient   *&monc;
   ThreadPool::BatchWorkQueue<PG> &peering_wq;
   GenContextWQ recovery_gen_wq;
+  const int ec_encode_threads;
+  GenContextWQ ec_encode_gen_wq;
   ClassHandler  *&class_handler;
 
   void enqueue_back(spg_t pgid, PGQueueable qi);
@@ -562,6 +576,9 @@ private:
   Mutex sched_scrub_lock;
   int scrubs_pending;
   int scrubs_active;
+  // deep scrub byte budget (osd_scrub_max_bytes_per_sec)
+  double scrub_bytes_avail = 0;  ///< budget left; may go negative
+  utime_t scrub_bytes_stamp;     ///< last refill of scrub_bytes_avail
 
 public:
   struct ScrubJob {
@@ -641,6 +658,10 @@ public:
   void inc_scrubs_active(bool reserved);
   void dec_scrubs_pending();
   void dec_scrubs_active();
+  /// charge bytes read by (deep) scrub against the scrub byte budget
+  void account_scrub_bytes(uint64_t bytes);
+  /// @returns seconds until the scrub byte budget is no longer spent
+  double get_scrub_budget_delay();
 
   void reply_op_error(OpRequestRef op, int err);
   void reply_op_error(OpRequestRef op, int err, eversion_t v, version_t uv);
@@ -878,12 +899,18 @@ public:
 private:
   // -- pg recovery and associated throttling --
   Mutex recovery_lock;
-  list<pair<epoch_t, PGRef> > awaiting_throttle;
+  /// PGs waiting for recovery pushes
+  RecoveryQueue<pair<epoch_t, PGRef> > awaiting_throttle;
 
   utime_t defer_recovery_until;
   uint64_t recovery_ops_active;
   uint64_t recovery_ops_reserved;
   bool recovery_paused;
+
+  // recovery byte budget (osd_recovery_max_bytes_per_sec), shrunk while
+  // client op latency is above osd_recovery_client_latency_target
+  RecoveryByteBudget recovery_bytes;
+  PerfCounters::avg_tracker<uint64_t> client_op_lat_ms;
 #ifdef DEBUG_RECOVERY_OIDS
   map<spg_t, set<hobject_t> > recovery_oids;
 #endif
@@ -906,6 +933,11 @@ public:
   void start_recovery_op(PG *pg, const hobject_t& soid);
   void finish_recovery_op(PG *pg, const hobject_t& soid, bool dequeue);
   bool is_recovery_active();
+  /// charge bytes read/pushed for recovery against the byte budget
+  void account_recovery_bytes(uint64_t bytes);
+  /// adapt the byte budget to client latency; called from the tick
+  void adjust_recovery_budget();
+  void dump_recovery_scheduler(Formatter *f);
   void release_reserved_pushes(uint64_t pushes) {
     Mutex::Locker l(recovery_lock);
     assert(recovery_ops_reserved >= pushes);
@@ -935,10 +967,10 @@ public:
   }
   void clear_queued_recovery(PG *pg) {
     Mutex::Locker l(recovery_lock);
-    for (list<pair<epoch_t, PGRef> >::iterator i = awaiting_throttle.begin();
+    for (auto i = awaiting_throttle.begin();
 	 i != awaiting_throttle.end();
       ) {
-      if (i->second.get() == pg) {
+      if (i->second.second.get() == pg) {
 	awaiting_throttle.erase(i);
 	return;
       } else {
@@ -948,13 +980,15 @@ public:
   }
   // delayed pg activation
   void queue_for_recovery(PG *pg) {
+    // forced PGs first, then those with the fewest remaining replicas;
+    // FIFO among equals
+    unsigned priority = get_recovery_queue_priority(
+      pg->get_state(),
+      pg->get_recovery_priority(),
+      pg->get_backfill_priority());
     Mutex::Locker l(recovery_lock);
-
-    if (pg->get_state() & (PG_STATE_FORCED_RECOVERY | PG_STATE_FORCED_BACKFILL)) {
-      awaiting_throttle.push_front(make_pair(pg->get_osdmap()->get_epoch(), pg));
-    } else {
-      awaiting_throttle.push_back(make_pair(pg->get_osdmap()->get_epoch(), pg));
-    }
+    awaiting_throttle.insert(
+      make_pair(priority, make_pair(pg->get_osdmap()->get_epoch(), pg)));
     _maybe_queue_recovery();
   }
   void queue_recovery_after_sleep(PG *pg, epoch_t queued, uint64_t reserved_pushes) {
@@ -981,6 +1015,11 @@ public:
     return _add_map(o);
   }
   OSDMapRef _add_map(OSDMap *o);
+  /// return a cached map, without loading it from disk on a miss
+  OSDMapRef lookup_map(epoch_t e) {
+    Mutex::Locker l(map_cache_lock);
+    return map_cache.lookup(e);
+  }
 
   void add_map_bl(epoch_t e, bufferlist& bl) {
     Mutex::Locker l(map_cache_lock);
@@ -1224,6 +1263,10 @@ protected:
   bool store_is_rotational = true;
 
   ZTracer::Endpoint trace_endpoint;
+
+  /// aligned buffers that large write payloads are received into
+  AlignedBufferPool rx_buffer_pool;
+
   void create_logger();
   void create_recoverystate_perf();
   void tick();
@@ -1378,6 +1421,7 @@ private:
   ShardedThreadPool osd_op_tp;
   ThreadPool disk_tp;
   ThreadPool command_tp;
+  ThreadPool ec_encode_tp;
 
   void set_disk_tp_priority();
   void get_latest_osdmap();
@@ -1697,6 +1741,8 @@ private:
     vector<ShardData*> shard_list;
     OSD *osd;
     uint32_t num_shards;
+    vector<int> shard_cpus;  ///< from osd_op_shard_affinity_cores
+    void init_shard_cpus();
 
   public:
     ShardedOpWQ(uint32_t pnum_shards,
@@ -1719,6 +1765,7 @@ private:
 	  osd->cct->_conf->osd_op_pq_min_cost, osd->cct, osd->op_queue);
 	shard_list.push_back(one_shard);
       }
+      init_shard_cpus();
     }
     ~ShardedOpWQ() override {
       while (!shard_list.empty()) {
@@ -1800,6 +1847,12 @@ private:
       }
     };
 
+    int get_thread_cpu(uint32_t thread_index) override {
+      if (shard_cpus.empty())
+	return -1;
+      return shard_cpus[(thread_index % num_shards) % shard_cpus.size()];
+    }
+
     bool is_shard_empty(uint32_t thread_index) override {
       uint32_t shard_index = thread_index % num_shards; 
       ShardData* sdata = shard_list[shard_index];
@@ -2314,6 +2367,13 @@ private:
   }
   void ms_fast_dispatch(Message *m) override;
   void ms_fast_preprocess(Message *m) override;
+  bool ms_fast_alloc_data(Connection *con, const ceph_msg_header& header,
+			  bufferlist *data) override;
+  bool ms_can_zero_copy_rx(Connection *con,
+			   const ceph_msg_header& header) override {
+    // message data is released before the messengers are shut down
+    return true;
+  }
   bool ms_dispatch(Message *m) override;
   bool ms_get_authorizer(int dest_type, AuthAuthorizer **authorizer, bool force_new) override;
   bool ms_verify_authorizer(Connection *con, int peer_type,
@@ -1065,7 +1065,8 @@ void OSDMap::Incremental::generate_test_instances(list<Incremental*>& o)
 void OSDMap::set_epoch(epoch_t e)
 {
   epoch = e;
-  for (auto &pool : pools)
+  _unshare(pools);
+  for (auto &pool : *pools)
     pool.second.last_change = e;
 }
 
@@ -1114,12 +1115,16 @@ void OSDMap::set_max_osd(int m)
     osd_weight[o] = CEPH_OSD_OUT;
   }
   osd_info.resize(m);
-  osd_xinfo.resize(m);
+  _unshare(osd_xinfo);
+  osd_xinfo->resize(m);
+  _unshare(osd_addrs);
   osd_addrs->client_addr.resize(m);
   osd_addrs->cluster_addr.resize(m);
   osd_addrs->hb_back_addr.resize(m);
   osd_addrs->hb_front_addr.resize(m);
+  _unshare(osd_uuid);
   osd_uuid->resize(m);
+  _unshare(osd_primary_affinity);
   if (osd_primary_affinity)
     osd_primary_affinity->resize(m, CEPH_OSD_DEFAULT_PRIMARY_AFFINITY);
 
@@ -1322,7 +1327,7 @@ uint64_t OSDMap::get_features(int entity_type, uint64_t *pmask) const
     features |= CEPH_FEATUREMASK_OSDMAP_PG_UPMAP;
   mask |= CEPH_FEATUREMASK_OSDMAP_PG_UPMAP;
 
-  for (auto &pool: pools) {
+  for (auto &pool: *pools) {
     if (pool.second.has_flag(pg_pool_t::FLAG_HASHPSPOOL)) {
       features |= CEPH_FEATURE_OSDHASHPSPOOL;
     }
@@ -1444,65 +1449,106 @@ uint64_t OSDMap::get_up_osd_features() const
   return cached_up_osd_features;
 }
 
-void OSDMap::dedup(const OSDMap *o, OSDMap *n)
+int OSDMap::dedup(const OSDMap *o, OSDMap *n)
 {
   if (o->epoch == n->epoch)
-    return;
+    return 0;
 
-  int diff = 0;
+  int shared = 0;
 
   // do addrs match?
-  if (o->max_osd != n->max_osd)
-    diff++;
-  for (int i = 0; i < o->max_osd && i < n->max_osd; i++) {
-    if ( n->osd_addrs->client_addr[i] &&  o->osd_addrs->client_addr[i] &&
-	*n->osd_addrs->client_addr[i] == *o->osd_addrs->client_addr[i])
-      n->osd_addrs->client_addr[i] = o->osd_addrs->client_addr[i];
-    else
-      diff++;
-    if ( n->osd_addrs->cluster_addr[i] &&  o->osd_addrs->cluster_addr[i] &&
-	*n->osd_addrs->cluster_addr[i] == *o->osd_addrs->cluster_addr[i])
-      n->osd_addrs->cluster_addr[i] = o->osd_addrs->cluster_addr[i];
-    else
-      diff++;
-    if ( n->osd_addrs->hb_back_addr[i] &&  o->osd_addrs->hb_back_addr[i] &&
-	*n->osd_addrs->hb_back_addr[i] == *o->osd_addrs->hb_back_addr[i])
-      n->osd_addrs->hb_back_addr[i] = o->osd_addrs->hb_back_addr[i];
-    else
-      diff++;
-    if ( n->osd_addrs->hb_front_addr[i] &&  o->osd_addrs->hb_front_addr[i] &&
-	*n->osd_addrs->hb_front_addr[i] == *o->osd_addrs->hb_front_addr[i])
-      n->osd_addrs->hb_front_addr[i] = o->osd_addrs->hb_front_addr[i];
-    else
+  if (o->osd_addrs == n->osd_addrs) {
+    shared++;
+  } else {
+    int diff = 0;
+    if (o->max_osd != n->max_osd)
       diff++;
-  }
-  if (diff == 0) {
-    // zoinks, no differences at all!
-    n->osd_addrs = o->osd_addrs;
+    for (int i = 0; i < o->max_osd && i < n->max_osd; i++) {
+      if ( n->osd_addrs->client_addr[i] &&  o->osd_addrs->client_addr[i] &&
+	  *n->osd_addrs->client_addr[i] == *o->osd_addrs->client_addr[i])
+	n->osd_addrs->client_addr[i] = o->osd_addrs->client_addr[i];
+      else
+	diff++;
+      if ( n->osd_addrs->cluster_addr[i] &&  o->osd_addrs->cluster_addr[i] &&
+	  *n->osd_addrs->cluster_addr[i] == *o->osd_addrs->cluster_addr[i])
+	n->osd_addrs->cluster_addr[i] = o->osd_addrs->cluster_addr[i];
+      else
+	diff++;
+      if ( n->osd_addrs->hb_back_addr[i] &&  o->osd_addrs->hb_back_addr[i] &&
+	  *n->osd_addrs->hb_back_addr[i] == *o->osd_addrs->hb_back_addr[i])
+	n->osd_addrs->hb_back_addr[i] = o->osd_addrs->hb_back_addr[i];
+      else
+	diff++;
+      if ( n->osd_addrs->hb_front_addr[i] &&  o->osd_addrs->hb_front_addr[i] &&
+	  *n->osd_addrs->hb_front_addr[i] == *o->osd_addrs->hb_front_addr[i])
+	n->osd_addrs->hb_front_addr[i] = o->osd_addrs->hb_front_addr[i];
+      else
+	diff++;
+    }
+    if (diff == 0) {
+      // zoinks, no differences at all!
+      n->osd_addrs = o->osd_addrs;
+      shared++;
+    }
   }
 
   // does crush match?
-  bufferlist oc, nc;
-  ::encode(*o->crush, oc, CEPH_FEATURES_SUPPORTED_DEFAULT);
-  ::encode(*n->crush, nc, CEPH_FEATURES_SUPPORTED_DEFAULT);
-  if (oc.contents_equal(nc)) {
-    n->crush = o->crush;
+  if (o->crush != n->crush) {
+    bufferlist oc, nc;
+    ::encode(*o->crush, oc, CEPH_FEATURES_SUPPORTED_DEFAULT);
+    ::encode(*n->crush, nc, CEPH_FEATURES_SUPPORTED_DEFAULT);
+    if (oc.contents_equal(nc))
+      n->crush = o->crush;
   }
+  if (o->crush == n->crush)
+    shared++;
 
   // does pg_temp match?
-  if (*o->pg_temp == *n->pg_temp)
+  if (o->pg_temp != n->pg_temp &&
+      *o->pg_temp == *n->pg_temp)
     n->pg_temp = o->pg_temp;
+  if (o->pg_temp == n->pg_temp)
+    shared++;
 
   // does primary_temp match?
-  if (o->primary_temp->size() == n->primary_temp->size()) {
-    if (*o->primary_temp == *n->primary_temp)
-      n->primary_temp = o->primary_temp;
-  }
+  if (o->primary_temp != n->primary_temp &&
+      o->primary_temp->size() == n->primary_temp->size() &&
+      *o->primary_temp == *n->primary_temp)
+    n->primary_temp = o->primary_temp;
+  if (o->primary_temp == n->primary_temp)
+    shared++;
 
   // do uuids match?
-  if (o->osd_uuid->size() == n->osd_uuid->size() &&
+  if (o->osd_uuid != n->osd_uuid &&
+      o->osd_uuid->size() == n->osd_uuid->size() &&
       *o->osd_uuid == *n->osd_uuid)
     n->osd_uuid = o->osd_uuid;
+  if (o->osd_uuid == n->osd_uuid)
+    shared++;
+
+  // do xinfos match?
+  if (o->osd_xinfo != n->osd_xinfo &&
+      o->osd_xinfo->size() == n->osd_xinfo->size() &&
+      *o->osd_xinfo == *n->osd_xinfo)
+    n->osd_xinfo = o->osd_xinfo;
+  if (o->osd_xinfo == n->osd_xinfo)
+    shared++;
+
+  // do pools match?  pg_pool_t has no operator==, so compare the
+  // encodings; last_change is part of it, so this only matches if no
+  // pool was touched.
+  if (o->pools != n->pools &&
+      o->pools->size() == n->pools->size()) {
+    bufferlist op, np;
+    ::encode(*o->pools, op, CEPH_FEATURES_SUPPORTED_DEFAULT);
+    ::encode(*n->pools, np, CEPH_FEATURES_SUPPORTED_DEFAULT);
+    if (op.contents_equal(np))
+      n->pools = o->pools;
+  }
+  if (o->pools == n->pools)
+    shared++;
+
+  return shared;
 }
 
 void OSDMap::clean_temps(CephContext *cct,
@@ -1597,7 +1643,23 @@ int OSDMap::apply_incremental(const Incremental &inc)
     return 0;
   }
 
-  // nope, incremental.
+  // nope, incremental.  anything we may share with the previous epoch
+  // (see dedup()) is copied before it is modified below.
+  if (!inc.new_pools.empty() || !inc.old_pools.empty())
+    _unshare(pools);
+  if (!inc.new_weight.empty() || !inc.new_state.empty() ||
+      !inc.new_xinfo.empty())
+    _unshare(osd_xinfo);
+  if (!inc.new_state.empty() || !inc.new_up_client.empty() ||
+      !inc.new_up_cluster.empty())
+    _unshare(osd_addrs);
+  if (!inc.new_state.empty() || !inc.new_uuid.empty())
+    _unshare(osd_uuid);
+  if (!inc.new_pg_temp.empty())
+    _unshare(pg_temp);
+  if (!inc.new_primary_temp.empty())
+    _unshare(primary_temp);
+
   if (inc.new_flags >= 0) {
     flags = inc.new_flags;
     // the below is just to cover a newly-upgraded luminous mon
@@ -1622,8 +1684,8 @@ int OSDMap::apply_incremental(const Incremental &inc)
     pool_max = inc.new_pool_max;
 
   for (const auto &pool : inc.new_pools) {
-    pools[pool.first] = pool.second;
-    pools[pool.first].last_change = epoch;
+    (*pools)[pool.first] = pool.second;
+    (*pools)[pool.first].last_change = epoch;
   }
 
   for (const auto &pname : inc.new_pool_names) {
@@ -1638,7 +1700,7 @@ int OSDMap::apply_incremental(const Incremental &inc)
   }
   
   for (const auto &pool : inc.old_pools) {
-    pools.erase(pool);
+    pools->erase(pool);
     name_pool.erase(pool_name[pool]);
     pool_name.erase(pool);
   }
@@ -1650,7 +1712,7 @@ int OSDMap::apply_incremental(const Incremental &inc)
     // xinfo old_weight.
     if (weight.second) {
       osd_state[weight.first] &= ~(CEPH_OSD_AUTOOUT | CEPH_OSD_NEW);
-      osd_xinfo[weight.first].old_weight = 0;
+      (*osd_xinfo)[weight.first].old_weight = 0;
     }
   }
 
@@ -1673,14 +1735,14 @@ int OSDMap::apply_incremental(const Incremental &inc)
     if ((osd_state[osd] & CEPH_OSD_UP) &&
 	(s & CEPH_OSD_UP)) {
       osd_info[osd].down_at = epoch;
-      osd_xinfo[osd].down_stamp = modified;
+      (*osd_xinfo)[osd].down_stamp = modified;
     }
     if ((osd_state[osd] & CEPH_OSD_EXISTS) &&
 	(s & CEPH_OSD_EXISTS)) {
       // osd is destroyed; clear out anything interesting.
       (*osd_uuid)[osd] = uuid_d();
       osd_info[osd] = osd_info_t();
-      osd_xinfo[osd] = osd_xinfo_t();
+      (*osd_xinfo)[osd] = osd_xinfo_t();
       set_primary_affinity(osd, CEPH_OSD_DEFAULT_PRIMARY_AFFINITY);
       osd_addrs->client_addr[osd].reset(new entity_addr_t());
       osd_addrs->cluster_addr[osd].reset(new entity_addr_t());
@@ -1726,7 +1788,7 @@ int OSDMap::apply_incremental(const Incremental &inc)
 
   // xinfo
   for (const auto &xinfo : inc.new_xinfo)
-    osd_xinfo[xinfo.first] = xinfo.second;
+    (*osd_xinfo)[xinfo.first] = xinfo.second;
 
   // uuid
   for (const auto &uuid : inc.new_uuid)
@@ -2150,6 +2212,136 @@ void OSDMap::_pg_to_up_acting_osds(
     *acting_primary = _acting_primary;
 }
 
+void OSDMap::pg_range_to_up_acting_osds(
+  int64_t pool, unsigned pg_begin, unsigned pg_end,
+  vector<vector<int>> *raw,
+  vector<vector<int>> *up, vector<int> *up_primary,
+  vector<vector<int>> *acting, vector<int> *acting_primary) const
+{
+  const pg_pool_t *pi = get_pg_pool(pool);
+  assert(pi);
+  assert(pg_begin <= pg_end);
+  unsigned n = pg_end - pg_begin;
+  vector<int> pps(n);
+  for (unsigned i = 0; i < n; ++i)
+    pps[i] = pi->raw_pg_to_pps(pg_t(pg_begin + i, pool));
+
+  raw->clear();
+  raw->resize(n);
+  int ruleno = crush->find_rule(pi->get_crush_rule(), pi->get_type(),
+				pi->get_size());
+  if (ruleno >= 0)
+    crush->do_rule_batch(ruleno, pps, raw, pi->get_size(), osd_weight,
+			 pool);
+
+  up->resize(n);
+  up_primary->resize(n);
+  acting->resize(n);
+  acting_primary->resize(n);
+  for (unsigned i = 0; i < n; ++i) {
+    pg_t pg(pg_begin + i, pool);
+    _remove_nonexistent_osds(*pi, (*raw)[i]);
+    vector<int> mapped = (*raw)[i];
+    _apply_upmap(*pi, pg, &mapped);
+    _raw_to_up_osds(*pi, mapped, &(*up)[i]);
+    (*up_primary)[i] = _pick_primary((*up)[i]);
+    _apply_primary_affinity(pps[i], *pi, &(*up)[i], &(*up_primary)[i]);
+    _get_temp_osds(*pi, pg, &(*acting)[i], &(*acting_primary)[i]);
+    if ((*acting)[i].empty()) {
+      (*acting)[i] = (*up)[i];
+      if ((*acting_primary)[i] == -1) {
+	(*acting_primary)[i] = (*up_primary)[i];
+      }
+    }
+  }
+}
+
+void OSDMap::_get_explicit_mappings(map<pg_t,vector<int32_t>> *m) const
+{
+  for (const auto& p : *pg_temp) {
+    auto& v = (*m)[p.first];
+    v.insert(v.end(), p.second.begin(), p.second.end());
+  }
+  for (auto& p : *primary_temp) {
+    (*m)[p.first].push_back(p.second);
+  }
+  for (auto& p : pg_upmap) {
+    auto& v = (*m)[p.first];
+    v.insert(v.end(), p.second.begin(), p.second.end());
+  }
+  for (auto& p : pg_upmap_items) {
+    auto& v = (*m)[p.first];
+    for (auto& q : p.second) {
+      v.push_back(q.first);
+      v.push_back(q.second);
+    }
+  }
+}
+
+bool OSDMap::get_mapping_changes(const OSDMap& prev,
+				 set<int> *changed_osds,
+				 set<pg_t> *changed_pgs,
+				 set<int64_t> *changed_pools) const
+{
+  if (crush != prev.crush || max_osd != prev.max_osd) {
+    return false;
+  }
+  for (int o = 0; o < max_osd; ++o) {
+    if (exists(o) != prev.exists(o)) {
+      return false;
+    }
+    if (!exists(o)) {
+      continue;
+    }
+    // is_out() only gets more likely to reject an osd whose weight
+    // drops, so only the pgs it was mapped to can move
+    if (get_weight(o) > prev.get_weight(o)) {
+      return false;
+    }
+    if (get_weight(o) < prev.get_weight(o) ||
+	is_up(o) != prev.is_up(o) ||
+	get_primary_affinity(o) != prev.get_primary_affinity(o)) {
+      changed_osds->insert(o);
+    }
+  }
+
+  for (auto& p : *pools) {
+    auto q = prev.pools->find(p.first);
+    if (q == prev.pools->end() ||
+	q->second.get_type() != p.second.get_type() ||
+	q->second.get_size() != p.second.get_size() ||
+	q->second.get_pg_num() != p.second.get_pg_num() ||
+	q->second.get_pgp_num() != p.second.get_pgp_num() ||
+	q->second.get_crush_rule() != p.second.get_crush_rule() ||
+	q->second.get_flags() != p.second.get_flags()) {
+      changed_pools->insert(p.first);
+    }
+  }
+
+  map<pg_t,vector<int32_t>> cur, old;
+  _get_explicit_mappings(&cur);
+  prev._get_explicit_mappings(&old);
+  for (auto& p : cur) {
+    auto q = old.find(p.first);
+    if (q == old.end() || q->second != p.second) {
+      changed_pgs->insert(p.first);
+      continue;
+    }
+    for (auto o : p.second) {
+      if (changed_osds->count(o)) {
+	changed_pgs->insert(p.first);
+	break;
+      }
+    }
+  }
+  for (auto& p : old) {
+    if (!cur.count(p.first)) {
+      changed_pgs->insert(p.first);
+    }
+  }
+  return true;
+}
+
 int OSDMap::calc_pg_rank(int osd, const vector<int>& acting, int nrep)
 {
   if (!nrep)
@@ -2197,10 +2389,10 @@ void OSDMap::encode_client_old(bufferlist& bl) const
   ::encode(modified, bl);
 
   // for ::encode(pools, bl);
-  __u32 n = pools.size();
+  __u32 n = pools->size();
   ::encode(n, bl);
 
-  for (const auto &pool : pools) {
+  for (const auto &pool : *pools) {
     n = pool.first;
     ::encode(n, bl);
     ::encode(pool.second, bl, 0);
@@ -2261,7 +2453,7 @@ void OSDMap::encode_classic(bufferlist& bl, uint64_t features) const
   ::encode(created, bl);
   ::encode(modified, bl);
 
-  ::encode(pools, bl, features);
+  ::encode(*pools, bl, features);
   ::encode(pool_name, bl);
   ::encode(pool_max, bl);
 
@@ -2295,7 +2487,7 @@ void OSDMap::encode_classic(bufferlist& bl, uint64_t features) const
   ::encode(cluster_snapshot_epoch, bl);
   ::encode(cluster_snapshot, bl);
   ::encode(*osd_uuid, bl);
-  ::encode(osd_xinfo, bl);
+  ::encode(*osd_xinfo, bl);
   ::encode(osd_addrs->hb_front_addr, bl, features);
 }
 
@@ -2332,7 +2524,7 @@ void OSDMap::encode(bufferlist& bl, uint64_t features) const
     ::encode(created, bl);
     ::encode(modified, bl);
 
-    ::encode(pools, bl, features);
+    ::encode(*pools, bl, features);
     ::encode(pool_name, bl);
     ::encode(pool_max, bl);
 
@@ -2410,7 +2602,7 @@ void OSDMap::encode(bufferlist& bl, uint64_t features) const
     ::encode(cluster_snapshot_epoch, bl);
     ::encode(cluster_snapshot, bl);
     ::encode(*osd_uuid, bl);
-    ::encode(osd_xinfo, bl);
+    ::encode(*osd_xinfo, bl);
     ::encode(osd_addrs->hb_front_addr, bl, features);
     if (target_v >= 2) {
       ::encode(nearfull_ratio, bl);
@@ -2471,11 +2663,11 @@ void OSDMap::decode_classic(bufferlist::iterator& p)
       ::decode(max_pools, p);
       pool_max = max_pools;
     }
-    pools.clear();
+    pools->clear();
     ::decode(n, p);
     while (n--) {
       ::decode(t, p);
-      ::decode(pools[t], p);
+      ::decode((*pools)[t], p);
     }
     if (v == 4) {
       ::decode(n, p);
@@ -2491,13 +2683,13 @@ void OSDMap::decode_classic(bufferlist::iterator& p)
       pool_max = n;
     }
   } else {
-    ::decode(pools, p);
+    ::decode(*pools, p);
     ::decode(pool_name, p);
     ::decode(pool_max, p);
   }
   // kludge around some old bug that zeroed out pool_max (#2307)
-  if (pools.size() && pool_max < pools.rbegin()->first) {
-    pool_max = pools.rbegin()->first;
+  if (pools->size() && pool_max < pools->rbegin()->first) {
+    pool_max = pools->rbegin()->first;
   }
 
   ::decode(flags, p);
@@ -2559,9 +2751,9 @@ void OSDMap::decode_classic(bufferlist::iterator& p)
     osd_uuid->resize(max_osd);
   }
   if (ev >= 9)
-    ::decode(osd_xinfo, p);
+    ::decode(*osd_xinfo, p);
   else
-    osd_xinfo.resize(max_osd);
+    osd_xinfo->resize(max_osd);
 
   if (ev >= 10)
     ::decode(osd_addrs->hb_front_addr, p);
@@ -2586,6 +2778,16 @@ void OSDMap::decode(bufferlist::iterator& bl)
   size_t tail_offset = 0;
   bufferlist crc_front, crc_tail;
 
+  // we decode over everything below; do not scribble on sub-structures
+  // that dedup() shares with other epochs.
+  _unshare_for_overwrite(osd_addrs);
+  _unshare_for_overwrite(pg_temp);
+  _unshare_for_overwrite(primary_temp);
+  _unshare_for_overwrite(pools);
+  _unshare_for_overwrite(osd_uuid);
+  _unshare_for_overwrite(osd_xinfo);
+  _unshare_for_overwrite(crush);
+
   DECODE_START_LEGACY_COMPAT_LEN(8, 7, 7, bl); // wrapper
   if (struct_v < 7) {
     int struct_v_size = sizeof(struct_v);
@@ -2604,7 +2806,7 @@ void OSDMap::decode(bufferlist::iterator& bl)
     ::decode(created, bl);
     ::decode(modified, bl);
 
-    ::decode(pools, bl);
+    ::decode(*pools, bl);
     ::decode(pool_name, bl);
     ::decode(pool_max, bl);
 
@@ -2667,7 +2869,7 @@ void OSDMap::decode(bufferlist::iterator& bl)
     ::decode(cluster_snapshot_epoch, bl);
     ::decode(cluster_snapshot, bl);
     ::decode(*osd_uuid, bl);
-    ::decode(osd_xinfo, bl);
+    ::decode(*osd_xinfo, bl);
     ::decode(osd_addrs->hb_front_addr, bl);
     if (struct_v >= 2) {
       ::decode(nearfull_ratio, bl);
@@ -2791,7 +2993,7 @@ void OSDMap::dump(Formatter *f) const
 		 ceph_release_name(require_osd_release));
 
   f->open_array_section("pools");
-  for (const auto &pool : pools) {
+  for (const auto &pool : *pools) {
     std::string name("<unknown>");
     const auto &pni = pool_name.find(pool.first);
     if (pni != pool_name.end())
@@ -2836,7 +3038,7 @@ void OSDMap::dump(Formatter *f) const
     if (exists(i)) {
       f->open_object_section("xinfo");
       f->dump_int("osd", i);
-      osd_xinfo[i].dump(f);
+      (*osd_xinfo)[i].dump(f);
       f->close_section();
     }
   }
@@ -2959,7 +3161,7 @@ string OSDMap::get_flag_string() const
 
 void OSDMap::print_pools(ostream& out) const
 {
-  for (const auto &pool : pools) {
+  for (const auto &pool : *pools) {
     std::string name("<unknown>");
     const auto &pni = pool_name.find(pool.first);
     if (pni != pool_name.end())
@@ -3252,7 +3454,7 @@ void OSDMap::print_oneline_summary(ostream& out) const
 
 bool OSDMap::crush_ruleset_in_use(int ruleset) const
 {
-  for (const auto &pool : pools) {
+  for (const auto &pool : *pools) {
     if (pool.second.crush_rule == ruleset)
       return true;
   }
@@ -3323,24 +3525,24 @@ int OSDMap::build_simple_optioned(CephContext *cct, epoch_t e, uuid_d &fsid,
     pool_names.push_back("rbd");
     for (auto &plname : pool_names) {
       int64_t pool = ++pool_max;
-      pools[pool].type = pg_pool_t::TYPE_REPLICATED;
-      pools[pool].flags = cct->_conf->osd_pool_default_flags;
+      (*pools)[pool].type = pg_pool_t::TYPE_REPLICATED;
+      (*pools)[pool].flags = cct->_conf->osd_pool_default_flags;
       if (cct->_conf->osd_pool_default_flag_hashpspool)
-	pools[pool].set_flag(pg_pool_t::FLAG_HASHPSPOOL);
+	(*pools)[pool].set_flag(pg_pool_t::FLAG_HASHPSPOOL);
       if (cct->_conf->osd_pool_default_flag_nodelete)
-	pools[pool].set_flag(pg_pool_t::FLAG_NODELETE);
+	(*pools)[pool].set_flag(pg_pool_t::FLAG_NODELETE);
       if (cct->_conf->osd_pool_default_flag_nopgchange)
-	pools[pool].set_flag(pg_pool_t::FLAG_NOPGCHANGE);
+	(*pools)[pool].set_flag(pg_pool_t::FLAG_NOPGCHANGE);
       if (cct->_conf->osd_pool_default_flag_nosizechange)
-	pools[pool].set_flag(pg_pool_t::FLAG_NOSIZECHANGE);
-      pools[pool].size = cct->_conf->osd_pool_default_size;
-      pools[pool].min_size = cct->_conf->get_osd_pool_default_min_size();
-      pools[pool].crush_rule = default_replicated_rule;
-      pools[pool].object_hash = CEPH_STR_HASH_RJENKINS;
-      pools[pool].set_pg_num(poolbase << pg_bits);
-      pools[pool].set_pgp_num(poolbase << pgp_bits);
-      pools[pool].last_change = epoch;
-      pools[pool].application_metadata.insert(
+	(*pools)[pool].set_flag(pg_pool_t::FLAG_NOSIZECHANGE);
+      (*pools)[pool].size = cct->_conf->osd_pool_default_size;
+      (*pools)[pool].min_size = cct->_conf->get_osd_pool_default_min_size();
+      (*pools)[pool].crush_rule = default_replicated_rule;
+      (*pools)[pool].object_hash = CEPH_STR_HASH_RJENKINS;
+      (*pools)[pool].set_pg_num(poolbase << pg_bits);
+      (*pools)[pool].set_pgp_num(poolbase << pgp_bits);
+      (*pools)[pool].last_change = epoch;
+      (*pools)[pool].application_metadata.insert(
         {pg_pool_t::APPLICATION_NAME_RBD, {}});
       pool_name[pool] = plname;
       name_pool[plname] = pool;
@@ -3767,7 +3969,7 @@ int OSDMap::calc_pg_upmaps(
 {
   set<int64_t> only_pools;
   if (only_pools_orig.empty()) {
-    for (auto& i : pools) {
+    for (auto& i : *pools) {
       only_pools.insert(i.first);
     }
   } else {
@@ -3783,7 +3985,7 @@ int OSDMap::calc_pg_upmaps(
     int total_pgs = 0;
     float osd_weight_total = 0;
     map<int,float> osd_weight;
-    for (auto& i : pools) {
+    for (auto& i : *pools) {
       if (!only_pools.empty() && !only_pools.count(i.first))
 	continue;
       for (unsigned ps = 0; ps < i.second.get_pg_num(); ++ps) {
@@ -3955,6 +4157,253 @@ int OSDMap::calc_pg_upmaps(
   return num_changed;
 }
 
+int OSDMap::calc_choose_args(
+  CephContext *cct,
+  float max_deviation,
+  int max_iterations,
+  unsigned max_moved,
+  bool per_pool,
+  const set<int64_t>& only_pools_orig,
+  const map<pg_t,uint64_t>& pg_bytes,
+  map<int64_t,map<int,float>> *weights,
+  OSDMap::Incremental *pending_inc) const
+{
+  set<int64_t> only_pools;
+  for (auto& i : *pools) {
+    if (only_pools_orig.empty() || only_pools_orig.count(i.first)) {
+      only_pools.insert(i.first);
+    }
+  }
+  if (only_pools.empty() || max_iterations <= 0) {
+    return -EINVAL;
+  }
+
+  // work on a copy of the crush map
+  OSDMap tmp;
+  tmp.deepish_copy_from(*this);
+  {
+    bufferlist bl;
+    crush->encode(bl, CEPH_FEATURES_SUPPORTED_DEFAULT);
+    bufferlist::iterator p = bl.begin();
+    tmp.crush.reset(new CrushWrapper);
+    tmp.crush->decode(p);
+  }
+
+  auto pg_units = [&pg_bytes](pg_t pg) -> float {
+    if (pg_bytes.empty()) {
+      return 1;
+    }
+    auto p = pg_bytes.find(pg);
+    return p == pg_bytes.end() ? 0 : p->second;
+  };
+
+  // the weight-set only changes what CRUSH maps pgs to, so balance the
+  // raw mappings.  the pgs moved are counted with the up sets.
+  typedef map<int64_t,vector<vector<int>>> up_map_t;
+  auto map_pools = [&](const set<int64_t>& ps, up_map_t *ups,
+		       map<int,float> *actual) {
+    actual->clear();
+    for (auto pool : ps) {
+      const pg_pool_t *pi = tmp.get_pg_pool(pool);
+      vector<vector<int>> raw, acting;
+      vector<int> up_primary, acting_primary;
+      tmp.pg_range_to_up_acting_osds(pool, 0, pi->get_pg_num(), &raw,
+				     &(*ups)[pool], &up_primary,
+				     &acting, &acting_primary);
+      for (unsigned ps = 0; ps < raw.size(); ++ps) {
+	float units = pg_units(pg_t(ps, pool));
+	for (auto osd : raw[ps]) {
+	  if (osd != CRUSH_ITEM_NONE) {
+	    (*actual)[osd] += units;
+	  }
+	}
+      }
+    }
+  };
+  auto count_moved = [](const up_map_t& a, const up_map_t& b) {
+    unsigned moved = 0;
+    for (auto& p : a) {
+      auto q = b.find(p.first);
+      assert(q != b.end());
+      for (unsigned ps = 0; ps < p.second.size(); ++ps) {
+	if (p.second[ps] != q->second[ps]) {
+	  ++moved;
+	}
+      }
+    }
+    return moved;
+  };
+  auto get_deviation = [](const map<int,float>& target,
+			  const map<int,float>& actual,
+			  float total) {
+    float deviation = 0;
+    for (auto& p : target) {
+      auto q = actual.find(p.first);
+      deviation += abs((q == actual.end() ? 0 : q->second) - p.second);
+    }
+    for (auto& p : actual) {
+      if (!target.count(p.first)) {
+	deviation += p.second;
+      }
+    }
+    return deviation / total;
+  };
+
+  up_map_t orig_ups;
+  {
+    map<int,float> actual;
+    map_pools(only_pools, &orig_ups, &actual);
+  }
+
+  // one compat weight-set for all the pools, or one per pool
+  map<int64_t,set<int64_t>> groups;
+  if (per_pool) {
+    for (auto pool : only_pools) {
+      groups[pool].insert(pool);
+    }
+  } else {
+    groups[CrushWrapper::DEFAULT_CHOOSE_ARGS] = only_pools;
+  }
+
+  unsigned moved = 0;
+  bool changed = false;
+  for (auto& g : groups) {
+    int64_t index = g.first;
+    const set<int64_t>& group_pools = g.second;
+
+    // the share of the pgs (or bytes) each osd should get
+    map<int,float> target;
+    float total = 0;
+    for (auto pool : group_pools) {
+      const pg_pool_t *pi = tmp.get_pg_pool(pool);
+      float units = 0;
+      for (unsigned ps = 0; ps < pi->get_pg_num(); ++ps) {
+	units += pg_units(pg_t(ps, pool));
+      }
+      units *= pi->get_size();
+      int ruleno = tmp.crush->find_rule(pi->get_crush_rule(),
+					pi->get_type(),
+					pi->get_size());
+      map<int,float> pmap;
+      if (ruleno < 0 || tmp.crush->get_rule_weight_osd_map(ruleno, &pmap) < 0) {
+	continue;
+      }
+      float sum = 0;
+      for (auto& p : pmap) {
+	p.second *= get_weightf(p.first);
+	sum += p.second;
+      }
+      if (sum == 0) {
+	continue;
+      }
+      for (auto& p : pmap) {
+	target[p.first] += p.second / sum * units;
+      }
+      total += units;
+    }
+    if (total == 0) {
+      ldout(cct, 10) << __func__ << " nothing to balance for " << group_pools
+		     << dendl;
+      continue;
+    }
+
+    // start from the weight-set in use, if any
+    crush_choose_arg_map fallback = tmp.crush->choose_args_get_with_fallback(
+      index);
+    map<int,int> w;
+    for (auto& p : target) {
+      int weight = -1;
+      if (fallback.args) {
+	weight = tmp.crush->choose_args_get_item_weight(fallback, p.first);
+      }
+      if (weight < 0) {
+	weight = tmp.crush->get_item_weight(p.first);
+      }
+      w[p.first] = weight;
+    }
+    if (!tmp.crush->have_choose_args(index)) {
+      tmp.crush->create_choose_args(index, 1);
+      crush_choose_arg_map cmap = tmp.crush->choose_args_get(index);
+      for (auto& p : w) {
+	tmp.crush->choose_args_adjust_item_weight(cct, cmap, p.first,
+						  { p.second }, nullptr);
+      }
+    }
+    crush_choose_arg_map cmap = tmp.crush->choose_args_get(index);
+    int positions = tmp.crush->get_choose_args_positions(cmap);
+    auto set_weights = [&](const map<int,int>& ws) {
+      for (auto& p : ws) {
+	tmp.crush->choose_args_adjust_item_weight(
+	  cct, cmap, p.first, vector<int>(positions, p.second), nullptr);
+      }
+    };
+
+    up_map_t ups;
+    map<int,float> actual;
+    map_pools(group_pools, &ups, &actual);
+    float deviation = get_deviation(target, actual, total);
+    unsigned group_moved = count_moved(ups, orig_ups);
+    ldout(cct, 10) << __func__ << " weight-set " << index
+		   << " pools " << group_pools
+		   << " start deviation " << deviation << dendl;
+
+    // move each weight part of the way to what would give the osd its
+    // target, backing off when that makes things worse or moves too
+    // many pgs
+    float step = .5;
+    for (int i = 0; i < max_iterations && deviation > max_deviation; ++i) {
+      map<int,int> nw;
+      for (auto& p : w) {
+	float t = target[p.first];
+	float a = actual[p.first];
+	if (t <= 0) {
+	  continue;
+	}
+	float ratio = a > 0 ? t / a : 2;
+	nw[p.first] = MAX(1, (int)((float)p.second * (1 + step * (ratio - 1))));
+      }
+      set_weights(nw);
+      up_map_t new_ups;
+      map<int,float> new_actual;
+      map_pools(group_pools, &new_ups, &new_actual);
+      float new_deviation = get_deviation(target, new_actual, total);
+      unsigned new_moved = count_moved(new_ups, orig_ups);
+      ldout(cct, 20) << __func__ << " step " << step
+		     << " deviation " << new_deviation
+		     << " moved " << new_moved << dendl;
+      if (new_deviation >= deviation ||
+	  (max_moved && moved + new_moved > max_moved)) {
+	set_weights(w);
+	step /= 2;
+	if (step < .01) {
+	  break;
+	}
+	continue;
+      }
+      for (auto& p : nw) {
+	w[p.first] = p.second;
+      }
+      actual.swap(new_actual);
+      deviation = new_deviation;
+      group_moved = new_moved;
+      changed = true;
+    }
+    ldout(cct, 10) << __func__ << " weight-set " << index
+		   << " end deviation " << deviation
+		   << " moved " << group_moved << dendl;
+    moved += group_moved;
+    for (auto& p : w) {
+      (*weights)[index][p.first] = (float)p.second / (float)0x10000;
+    }
+  }
+
+  if (changed) {
+    pending_inc->crush.clear();
+    tmp.crush->encode(pending_inc->crush, CEPH_FEATURES_SUPPORTED_DEFAULT);
+  }
+  return moved;
+}
+
 int OSDMap::get_osds_by_bucket_name(const string &name, set<int> *osds) const
 {
   return crush->get_leaves(name, osds);
@@ -4588,8 +5037,8 @@ void OSDMap::check_health(health_check_map_t *checks) const
   // CACHE_POOL_NO_HIT_SET
   if (g_conf->mon_warn_on_cache_pools_without_hit_sets) {
     list<string> detail;
-    for (map<int64_t, pg_pool_t>::const_iterator p = pools.begin();
-	 p != pools.end();
+    for (map<int64_t, pg_pool_t>::const_iterator p = pools->begin();
+	 p != pools->end();
 	 ++p) {
       const pg_pool_t& info = p->second;
       if (info.cache_mode_requires_hit_set() &&
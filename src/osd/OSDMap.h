@@ -114,6 +114,17 @@ struct osd_xinfo_t {
 };
 WRITE_CLASS_ENCODER(osd_xinfo_t)
 
+inline bool operator==(const osd_xinfo_t& l, const osd_xinfo_t& r) {
+  return l.down_stamp == r.down_stamp &&
+    l.laggy_probability == r.laggy_probability &&
+    l.laggy_interval == r.laggy_interval &&
+    l.features == r.features &&
+    l.old_weight == r.old_weight;
+}
+inline bool operator!=(const osd_xinfo_t& l, const osd_xinfo_t& r) {
+  return !(l == r);
+}
+
 ostream& operator<<(ostream& out, const osd_xinfo_t& xi);
 
 
@@ -527,13 +538,13 @@ private:
   mempool::osdmap::map<pg_t,mempool::osdmap::vector<int32_t>> pg_upmap; ///< remap pg
   mempool::osdmap::map<pg_t,mempool::osdmap::vector<pair<int32_t,int32_t>>> pg_upmap_items; ///< remap osds in up set
 
-  mempool::osdmap::map<int64_t,pg_pool_t> pools;
+  ceph::shared_ptr< mempool::osdmap::map<int64_t,pg_pool_t> > pools;
   mempool::osdmap::map<int64_t,string> pool_name;
   mempool::osdmap::map<string,map<string,string> > erasure_code_profiles;
   mempool::osdmap::map<string,int64_t> name_pool;
 
   ceph::shared_ptr< mempool::osdmap::vector<uuid_d> > osd_uuid;
-  mempool::osdmap::vector<osd_xinfo_t> osd_xinfo;
+  ceph::shared_ptr< mempool::osdmap::vector<osd_xinfo_t> > osd_xinfo;
 
   mempool::osdmap::unordered_map<entity_addr_t,utime_t> blacklist;
 
@@ -558,6 +569,25 @@ private:
 
   void _calc_up_osd_features();
 
+  /**
+   * make a shared sub-structure private to this map before we modify it
+   *
+   * dedup() lets consecutive epochs share the sub-structures that did
+   * not change between them.  anything that modifies one of them in
+   * place must call this first.
+   */
+  template<typename T>
+  static void _unshare(ceph::shared_ptr<T>& p) {
+    if (p && p.use_count() > 1)
+      p = std::make_shared<T>(*p);
+  }
+  /// like _unshare(), but for callers that are about to overwrite *p
+  template<typename T>
+  static void _unshare_for_overwrite(ceph::shared_ptr<T>& p) {
+    if (p && p.use_count() > 1)
+      p = std::make_shared<T>();
+  }
+
  public:
   bool have_crc() const { return crc_defined; }
   uint32_t get_crc() const { return crc; }
@@ -577,7 +607,9 @@ private:
 	     osd_addrs(std::make_shared<addrs_s>()),
 	     pg_temp(std::make_shared<PGTempMap>()),
 	     primary_temp(std::make_shared<mempool::osdmap::map<pg_t,int32_t>>()),
+	     pools(std::make_shared<mempool::osdmap::map<int64_t,pg_pool_t>>()),
 	     osd_uuid(std::make_shared<mempool::osdmap::vector<uuid_d>>()),
+	     osd_xinfo(std::make_shared<mempool::osdmap::vector<osd_xinfo_t>>()),
 	     cluster_snapshot_epoch(0),
 	     new_blacklist_entries(false),
 	     cached_up_osd_features(0),
@@ -597,6 +629,8 @@ public:
     primary_temp.reset(new mempool::osdmap::map<pg_t,int32_t>(*o.primary_temp));
     pg_temp.reset(new PGTempMap(*o.pg_temp));
     osd_uuid.reset(new mempool::osdmap::vector<uuid_d>(*o.osd_uuid));
+    pools.reset(new mempool::osdmap::map<int64_t,pg_pool_t>(*o.pools));
+    osd_xinfo.reset(new mempool::osdmap::vector<osd_xinfo_t>(*o.osd_xinfo));
 
     if (o.osd_primary_affinity)
       osd_primary_affinity.reset(new mempool::osdmap::vector<__u32>(*o.osd_primary_affinity));
@@ -608,6 +642,18 @@ public:
     // allocate a new CrushWrapper, though.
   }
 
+  /**
+   * make this map a cheap copy of o that shares all of its sub-structures
+   *
+   * apply_incremental(), decode() and the setters copy a shared
+   * sub-structure before they modify it, so o is never affected.  code
+   * that reaches into the members directly (OSDMonitor) must use
+   * deepish_copy_from() instead.
+   */
+  void cow_copy_from(const OSDMap& o) {
+    *this = o;
+  }
+
   // map info
   const uuid_d& get_fsid() const { return fsid; }
   void set_fsid(uuid_d& f) { fsid = f; }
@@ -721,6 +767,7 @@ public:
       osd_primary_affinity.reset(
 	new mempool::osdmap::vector<__u32>(
 	  max_osd, CEPH_OSD_DEFAULT_PRIMARY_AFFINITY));
+    _unshare(osd_primary_affinity);
     (*osd_primary_affinity)[o] = w;
   }
   unsigned get_primary_affinity(int o) const {
@@ -926,7 +973,7 @@ public:
 
   const osd_xinfo_t& get_xinfo(int osd) const {
     assert(osd < max_osd);
-    return osd_xinfo[osd];
+    return (*osd_xinfo)[osd];
   }
   
   int get_next_up_osd_after(int n) const {
@@ -979,8 +1026,17 @@ public:
 
   int apply_incremental(const Incremental &inc);
 
-  /// try to re-use/reference addrs in oldmap from newmap
-  static void dedup(const OSDMap *oldmap, OSDMap *newmap);
+  /**
+   * share the sub-structures newmap has in common with oldmap
+   *
+   * addrs, crush, pg_temp, primary_temp, uuids, xinfo and pools that
+   * are equal in both maps are replaced in newmap with references to
+   * oldmap's copy.  both maps stay usable; whichever is modified later
+   * copies the sub-structure first (see _unshare()).
+   *
+   * @return the number of those sub-structures the maps now share
+   */
+  static int dedup(const OSDMap *oldmap, OSDMap *newmap);
 
   static void clean_temps(CephContext *cct, const OSDMap& osdmap,
 			  Incremental *pending_inc);
@@ -1086,6 +1142,9 @@ private:
   void _get_temp_osds(const pg_pool_t& pool, pg_t pg,
                       vector<int> *temp_pg, int *temp_primary) const;
 
+  /// pg_temp, primary_temp, pg_upmap and pg_upmap_items by pg
+  void _get_explicit_mappings(map<pg_t,vector<int32_t>> *m) const;
+
   /**
    *  map to up and acting. Fills in whatever fields are non-NULL.
    */
@@ -1129,9 +1188,35 @@ public:
     int up_primary, acting_primary;
     pg_to_up_acting_osds(pg, &up, &up_primary, &acting, &acting_primary);
   }
+  /**
+   * map pgs [pg_begin, pg_end) of an existing pool as
+   * pg_to_up_acting_osds() does, with one batched CRUSH mapping for
+   * all of them.  Each vector is indexed by ps - pg_begin.
+   */
+  void pg_range_to_up_acting_osds(
+    int64_t pool, unsigned pg_begin, unsigned pg_end,
+    vector<vector<int>> *raw,
+    vector<vector<int>> *up, vector<int> *up_primary,
+    vector<vector<int>> *acting, vector<int> *acting_primary) const;
+  /**
+   * What may have moved pgs since prev, an earlier epoch of this map:
+   * the osds that went up or down or got a lower weight or another
+   * primary affinity (the pgs CRUSH mapped to them may move), the pgs
+   * with a new or changed pg_temp, primary_temp or upmap, or one that
+   * names one of those osds, and the pools with a new size, pg_num,
+   * pgp_num, rule, type or flags.
+   *
+   * @return false if every pg may have moved: the crush map or
+   *         max_osd changed, an osd was created or removed or an osd
+   *         weight went up, which may win it pgs mapped anywhere
+   */
+  bool get_mapping_changes(const OSDMap& prev,
+			   set<int> *changed_osds,
+			   set<pg_t> *changed_pgs,
+			   set<int64_t> *changed_pools) const;
   bool pg_is_ec(pg_t pg) const {
-    auto i = pools.find(pg.pool());
-    assert(i != pools.end());
+    auto i = pools->find(pg.pool());
+    assert(i != pools->end());
     return i->second.ec_pool();
   }
   bool get_primary_shard(const pg_t& pgid, spg_t *out) const {
@@ -1166,10 +1251,11 @@ public:
     return pool_max;
   }
   const mempool::osdmap::map<int64_t,pg_pool_t>& get_pools() const {
-    return pools;
+    return *pools;
   }
   mempool::osdmap::map<int64_t,pg_pool_t>& get_pools() {
-    return pools;
+    _unshare(pools);
+    return *pools;
   }
   const string& get_pool_name(int64_t p) const {
     auto i = pool_name.find(p);
@@ -1180,29 +1266,29 @@ public:
     return pool_name;
   }
   bool have_pg_pool(int64_t p) const {
-    return pools.count(p);
+    return pools->count(p);
   }
   const pg_pool_t* get_pg_pool(int64_t p) const {
-    auto i = pools.find(p);
-    if (i != pools.end())
+    auto i = pools->find(p);
+    if (i != pools->end())
       return &i->second;
     return NULL;
   }
   unsigned get_pg_size(pg_t pg) const {
-    auto p = pools.find(pg.pool());
-    assert(p != pools.end());
+    auto p = pools->find(pg.pool());
+    assert(p != pools->end());
     return p->second.get_size();
   }
   int get_pg_type(pg_t pg) const {
-    auto p = pools.find(pg.pool());
-    assert(p != pools.end());
+    auto p = pools->find(pg.pool());
+    assert(p != pools->end());
     return p->second.get_type();
   }
 
 
   pg_t raw_pg_to_pg(pg_t pg) const {
-    auto p = pools.find(pg.pool());
-    assert(p != pools.end());
+    auto p = pools->find(pg.pool());
+    assert(p != pools->end());
     return p->second.raw_pg_to_pg(pg);
   }
 
@@ -1287,6 +1373,25 @@ public:
     Incremental *pending_inc
     );
 
+  /**
+   * Balance pgs (or bytes) by CRUSH weight-set instead of upmaps: adjust
+   * the weights of the compat weight-set, or of one weight-set per
+   * pool, simulating the mapping of every pg after each adjustment.
+   * The crush map is put in **pending_inc** if it changed.
+   *
+   * @return the number of pgs that move, or negative error
+   */
+  int calc_choose_args(
+    CephContext *cct,
+    float max_deviation, ///< stop below this ratio of misplaced pgs or bytes
+    int max_iterations,  ///< max iterations to run
+    unsigned max_moved,  ///< [optional] max pgs to move, 0 for no limit
+    bool per_pool,       ///< a weight-set per pool instead of the compat one
+    const set<int64_t>& pools,          ///< [optional] restrict to pool
+    const map<pg_t,uint64_t>& pg_bytes, ///< [optional] balance bytes
+    map<int64_t,map<int,float>> *weights, ///< weight-set -> osd -> weight
+    Incremental *pending_inc) const;
+
   int get_osds_by_bucket_name(const string &name, set<int> *osds) const;
 
   /*
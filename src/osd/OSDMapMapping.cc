@@ -56,13 +56,75 @@ void OSDMapMapping::update(const OSDMap& osdmap, pg_t pgid)
   _update_range(osdmap, pgid.pool(), pgid.ps(), pgid.ps() + 1);
 }
 
+bool OSDMapMapping::_get_changed_pgs(const OSDMap& osdmap,
+				     std::vector<pg_t> *pgs)
+{
+  if (!mapped_osdmap) {
+    return false;
+  }
+  bufferlist crush;
+  osdmap.crush->encode(crush, CEPH_FEATURES_SUPPORTED_DEFAULT);
+  if (!crush.contents_equal(mapped_crush)) {
+    return false;
+  }
+  set<int> osds;
+  set<pg_t> changed;
+  set<int64_t> changed_pools;
+  if (!osdmap.get_mapping_changes(*mapped_osdmap, &osds, &changed,
+				  &changed_pools)) {
+    return false;
+  }
+  for (auto osd : osds) {
+    assert((unsigned)osd < raw_rmap.size());
+    changed.insert(raw_rmap[osd].begin(), raw_rmap[osd].end());
+  }
+  for (auto& pgid : changed) {
+    const pg_pool_t *pi = osdmap.get_pg_pool(pgid.pool());
+    if (pi && pgid.ps() < pi->get_pg_num() &&
+	!changed_pools.count(pgid.pool())) {
+      pgs->push_back(pgid);
+    }
+  }
+  for (auto pool : changed_pools) {
+    unsigned pg_num = osdmap.get_pg_pool(pool)->get_pg_num();
+    for (unsigned ps = 0; ps < pg_num; ++ps) {
+      pgs->push_back(pg_t(ps, pool));
+    }
+  }
+  std::sort(pgs->begin(), pgs->end());
+  return true;
+}
+
+std::unique_ptr<OSDMapMapping::MappingJob> OSDMapMapping::start_update(
+  const OSDMap& osdmap,
+  ParallelPGMapper& mapper,
+  unsigned pgs_per_item)
+{
+  std::vector<pg_t> pgs;
+  bool incremental = _get_changed_pgs(osdmap, &pgs);
+  std::unique_ptr<MappingJob> job(new MappingJob(&osdmap, this));
+  if (!incremental) {
+    mapper.queue(job.get(), pgs_per_item);
+  } else if (!pgs.empty()) {
+    mapper.queue(job.get(), pgs_per_item, pgs);
+  } else {
+    job->finish = ceph_clock_now();
+    job->complete();
+  }
+  return job;
+}
+
 void OSDMapMapping::_build_rmap(const OSDMap& osdmap)
 {
   acting_rmap.resize(osdmap.get_max_osd());
   //up_rmap.resize(osdmap.get_max_osd());
+  raw_rmap.resize(osdmap.get_max_osd());
   for (auto& v : acting_rmap) {
     v.resize(0);
   }
+  for (auto& v : raw_rmap) {
+    v.resize(0);
+  }
   //for (auto& v : up_rmap) {
   //  v.resize(0);
   //}
@@ -76,6 +138,12 @@ void OSDMapMapping::_build_rmap(const OSDMap& osdmap)
 	  acting_rmap[row[4 + i]].push_back(pgid);
 	}
       }
+      int32_t *raw = &row[4 + 2 * p.second.size];
+      for (int i = 0; i < raw[0]; ++i) {
+	if (raw[1 + i] != CRUSH_ITEM_NONE) {
+	  raw_rmap[raw[1 + i]].push_back(pgid);
+	}
+      }
       //for (int i = 0; i < row[3]; ++i) {
       //up_rmap[row[4 + p.second.size + i]].push_back(pgid);
       //}
@@ -87,6 +155,8 @@ void OSDMapMapping::_finish(const OSDMap& osdmap)
 {
   _build_rmap(osdmap);
   epoch = osdmap.get_epoch();
+  mapped_osdmap = std::move(pending_osdmap);
+  mapped_crush.claim(pending_crush);
 }
 
 void OSDMapMapping::_dump()
@@ -111,14 +181,15 @@ void OSDMapMapping::_update_range(
   assert(i != pools.end());
   assert(pg_begin <= pg_end);
   assert(pg_end <= i->second.pg_num);
+  vector<vector<int>> raw, up, acting;
+  vector<int> up_primary, acting_primary;
+  osdmap.pg_range_to_up_acting_osds(
+    pool, pg_begin, pg_end,
+    &raw, &up, &up_primary, &acting, &acting_primary);
   for (unsigned ps = pg_begin; ps < pg_end; ++ps) {
-    vector<int> up, acting;
-    int up_primary, acting_primary;
-    osdmap.pg_to_up_acting_osds(
-      pg_t(ps, pool),
-      &up, &up_primary, &acting, &acting_primary);
-    i->second.set(ps, std::move(up), up_primary,
-		  std::move(acting), acting_primary);
+    unsigned j = ps - pg_begin;
+    i->second.set(ps, raw[j], up[j], up_primary[j],
+		  acting[j], acting_primary[j]);
   }
 }
 
@@ -144,11 +215,31 @@ void ParallelPGMapper::Job::finish_one()
   }
 }
 
+void ParallelPGMapper::Job::process(const std::vector<pg_t>& pgs)
+{
+  for (unsigned i = 0; i < pgs.size(); ) {
+    unsigned n = 1;
+    while (i + n < pgs.size() &&
+	   pgs[i + n].pool() == pgs[i].pool() &&
+	   pgs[i + n].ps() == pgs[i].ps() + n) {
+      ++n;
+    }
+    process(pgs[i].pool(), pgs[i].ps(), pgs[i].ps() + n);
+    i += n;
+  }
+}
+
 void ParallelPGMapper::WQ::_process(Item *i, ThreadPool::TPHandle &h)
 {
-  ldout(m->cct, 20) << __func__ << " " << i->job << " " << i->pool
-		    << " [" << i->begin << "," << i->end << ")" << dendl;
-  i->job->process(i->pool, i->begin, i->end);
+  if (i->pgs.empty()) {
+    ldout(m->cct, 20) << __func__ << " " << i->job << " " << i->pool
+		      << " [" << i->begin << "," << i->end << ")" << dendl;
+    i->job->process(i->pool, i->begin, i->end);
+  } else {
+    ldout(m->cct, 20) << __func__ << " " << i->job << " " << i->pgs.size()
+		      << " pgs from " << i->pgs.front() << dendl;
+    i->job->process(i->pgs);
+  }
   i->job->finish_one();
   delete i;
 }
@@ -170,3 +261,237 @@ void ParallelPGMapper::queue(
   }
   assert(any);
 }
+
+void ParallelPGMapper::queue(
+  Job *job,
+  unsigned pgs_per_item,
+  const std::vector<pg_t>& pgs)
+{
+  assert(!pgs.empty());
+  for (unsigned i = 0; i < pgs.size(); i += pgs_per_item) {
+    unsigned end = MIN(i + pgs_per_item, pgs.size());
+    job->start_one();
+    wq.queue(new Item(job, std::vector<pg_t>(pgs.begin() + i,
+					      pgs.begin() + end)));
+    ldout(cct, 20) << __func__ << " " << job << " " << pgs[i] << " +"
+		   << (end - i) << dendl;
+  }
+}
+
+// ---------------------------
+
+bool OSDMapPlacementCache::get(
+  const OSDMap& osdmap,
+  pg_t pgid,
+  std::vector<int> *up,
+  int *up_primary,
+  std::vector<int> *acting,
+  int *acting_primary)
+{
+  const pg_pool_t *pool = osdmap.get_pg_pool(pgid.pool());
+  assert(pool);
+  pgid = pool->raw_pg_to_pg(pgid);
+  {
+    std::lock_guard<std::mutex> l(lock);
+    if (epoch != osdmap.get_epoch()) {
+      pools.clear();
+      epoch = osdmap.get_epoch();
+    }
+    auto p = pools.find(pgid.pool());
+    if (p != pools.end() && pgid.ps() < p->second.pgs.size()) {
+      const Entry& e = p->second.pgs[pgid.ps()];
+      if (e.valid) {
+	*up = e.up;
+	*up_primary = e.up_primary;
+	*acting = e.acting;
+	*acting_primary = e.acting_primary;
+	return true;
+      }
+    }
+  }
+
+  // map it without the lock; racing lookups of the same pg all get
+  // the same answer.  the raw crush mapping is kept too: a down or
+  // out osd is only found there
+  std::vector<std::vector<int>> raws, ups, actings;
+  std::vector<int> up_primaries, acting_primaries;
+  osdmap.pg_range_to_up_acting_osds(pgid.pool(), pgid.ps(), pgid.ps() + 1,
+				    &raws, &ups, &up_primaries,
+				    &actings, &acting_primaries);
+  up->swap(ups[0]);
+  *up_primary = up_primaries[0];
+  acting->swap(actings[0]);
+  *acting_primary = acting_primaries[0];
+
+  std::lock_guard<std::mutex> l(lock);
+  if (epoch != osdmap.get_epoch()) {
+    return false;
+  }
+  PoolCache& pc = pools[pgid.pool()];
+  if (pc.pgs.size() != pool->get_pg_num()) {
+    pc.pgs.clear();
+    pc.pgs.resize(pool->get_pg_num());
+  }
+  Entry& e = pc.pgs[pgid.ps()];
+  e.valid = true;
+  e.raw.swap(raws[0]);
+  e.up = *up;
+  e.up_primary = *up_primary;
+  e.acting = *acting;
+  e.acting_primary = *acting_primary;
+  pc.osds.insert(e.raw.begin(), e.raw.end());
+  pc.osds.insert(up->begin(), up->end());
+  pc.osds.insert(acting->begin(), acting->end());
+  return false;
+}
+
+void OSDMapPlacementCache::_clear_pg(pg_t pgid)
+{
+  auto p = pools.find(pgid.pool());
+  if (p != pools.end() && pgid.ps() < p->second.pgs.size()) {
+    p->second.pgs[pgid.ps()] = Entry();
+  }
+}
+
+void OSDMapPlacementCache::_clear_osds(const std::set<int>& osds)
+{
+  auto maps_to = [&osds](const std::vector<int>& v) {
+    for (auto o : v) {
+      if (osds.count(o)) {
+	return true;
+      }
+    }
+    return false;
+  };
+  for (auto& p : pools) {
+    bool any = false;
+    for (auto o = osds.begin(); !any && o != osds.end(); ++o) {
+      any = p.second.osds.count(*o);
+    }
+    if (!any) {
+      continue;
+    }
+    for (auto& e : p.second.pgs) {
+      if (e.valid &&
+	  (maps_to(e.raw) || maps_to(e.up) || maps_to(e.acting))) {
+	e = Entry();
+      }
+    }
+  }
+}
+
+void OSDMapPlacementCache::invalidate(
+  const OSDMap& prev,
+  const OSDMap::Incremental& inc)
+{
+  std::lock_guard<std::mutex> l(lock);
+  epoch_t cached = epoch;
+  epoch = inc.epoch;
+
+  // anything that can move a pg anywhere in the cluster
+  if (cached != prev.get_epoch() ||
+      inc.fullmap.length() ||
+      inc.crush.length() ||
+      inc.new_max_osd >= 0) {
+    pools.clear();
+    return;
+  }
+  // is_out() only gets more likely to reject an osd whose weight
+  // drops, so only the pgs CRUSH mapped to it can move
+  std::set<int> osds;
+  for (auto& p : inc.new_weight) {
+    if (p.second > prev.get_weight(p.first)) {
+      pools.clear();
+      return;
+    }
+    if (p.second < prev.get_weight(p.first)) {
+      osds.insert(p.first);
+    }
+  }
+  for (auto& p : inc.new_state) {
+    int s = p.second ? p.second : CEPH_OSD_UP;
+    if (s & CEPH_OSD_EXISTS) {
+      pools.clear();
+      return;
+    }
+    if (s & CEPH_OSD_UP) {
+      if (!prev.is_up(p.first)) {
+	pools.clear();
+	return;
+      }
+      osds.insert(p.first);
+    }
+  }
+  for (auto& p : inc.new_up_client) {
+    if (!prev.is_up(p.first)) {
+      pools.clear();
+      return;
+    }
+  }
+  for (auto& p : inc.new_primary_affinity) {
+    if (p.second != prev.get_primary_affinity(p.first)) {
+      osds.insert(p.first);
+    }
+  }
+
+  for (auto& p : inc.new_pools) {
+    const pg_pool_t *old = prev.get_pg_pool(p.first);
+    if (!old ||
+	old->get_type() != p.second.get_type() ||
+	old->get_size() != p.second.get_size() ||
+	old->get_pg_num() != p.second.get_pg_num() ||
+	old->get_pgp_num() != p.second.get_pgp_num() ||
+	old->get_crush_rule() != p.second.get_crush_rule() ||
+	old->has_flag(pg_pool_t::FLAG_HASHPSPOOL) !=
+	  p.second.has_flag(pg_pool_t::FLAG_HASHPSPOOL)) {
+      pools.erase(p.first);
+    }
+  }
+  for (auto pool : inc.old_pools) {
+    pools.erase(pool);
+  }
+
+  for (auto& p : inc.new_pg_temp) {
+    _clear_pg(p.first);
+  }
+  for (auto& p : inc.new_primary_temp) {
+    _clear_pg(p.first);
+  }
+  for (auto& p : inc.new_pg_upmap) {
+    _clear_pg(p.first);
+  }
+  for (auto& pgid : inc.old_pg_upmap) {
+    _clear_pg(pgid);
+  }
+  for (auto& p : inc.new_pg_upmap_items) {
+    _clear_pg(p.first);
+  }
+  for (auto& pgid : inc.old_pg_upmap_items) {
+    _clear_pg(pgid);
+  }
+
+  if (!osds.empty()) {
+    _clear_osds(osds);
+  }
+}
+
+void OSDMapPlacementCache::clear()
+{
+  std::lock_guard<std::mutex> l(lock);
+  pools.clear();
+  epoch = 0;
+}
+
+size_t OSDMapPlacementCache::size() const
+{
+  std::lock_guard<std::mutex> l(lock);
+  size_t n = 0;
+  for (auto& p : pools) {
+    for (auto& e : p.second.pgs) {
+      if (e.valid) {
+	++n;
+      }
+    }
+  }
+  return n;
+}
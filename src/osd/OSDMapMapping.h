@@ -7,12 +7,13 @@
 
 #include <vector>
 #include <map>
+#include <mutex>
+#include <set>
 
+#include "osd/OSDMap.h"
 #include "osd/osd_types.h"
 #include "common/WorkQueue.h"
 
-class OSDMap;
-
 /// work queue to perform work on batches of pgids on multiple CPUs
 class ParallelPGMapper {
 public:
@@ -33,6 +34,8 @@ public:
 
     // child must implement this
     virtual void process(int64_t poolid, unsigned ps_begin, unsigned ps_end) = 0;
+    /// process a sorted list of pgs, by default a run of pgs at a time
+    virtual void process(const std::vector<pg_t>& pgs);
     virtual void complete() = 0;
 
     void set_finish_event(Context *fin) {
@@ -102,12 +105,19 @@ protected:
     Job *job;
     int64_t pool;
     unsigned begin, end;
+    std::vector<pg_t> pgs;  ///< if not empty, these instead of the range
 
     Item(Job *j, int64_t p, unsigned b, unsigned e)
       : job(j),
 	pool(p),
 	begin(b),
 	end(e) {}
+    Item(Job *j, std::vector<pg_t>&& pgs)
+      : job(j),
+	pool(-1),
+	begin(0),
+	end(0),
+	pgs(std::move(pgs)) {}
   };
   std::deque<Item*> q;
 
@@ -158,6 +168,11 @@ public:
   void queue(
     Job *job,
     unsigned pgs_per_item);
+  /// queue only these pgs, which must be sorted and not empty
+  void queue(
+    Job *job,
+    unsigned pgs_per_item,
+    const std::vector<pg_t>& pgs);
 
   void drain() {
     wq.drain();
@@ -185,7 +200,9 @@ private:
 	1 + // num acting
 	1 + // num up
 	size + // acting
-	size;  // up
+	size + // up
+	1 + // num raw
+	size;  // raw
     }
 
     PoolMapping(int s, int p)
@@ -221,6 +238,7 @@ private:
     }
 
     void set(size_t ps,
+	     const std::vector<int>& raw,
 	     const std::vector<int>& up,
 	     int up_primary,
 	     const std::vector<int>& acting,
@@ -236,6 +254,10 @@ private:
       for (int i = 0; i < row[3]; ++i) {
 	row[4 + size + i] = up[i];
       }
+      row[4 + 2 * size] = raw.size();
+      for (int i = 0; i < row[4 + 2 * size]; ++i) {
+	row[5 + 2 * size + i] = raw[i];
+      }
     }
   };
 
@@ -243,9 +265,20 @@ private:
   mempool::osdmap_mapping::vector<
     mempool::osdmap_mapping::vector<pg_t>> acting_rmap;  // osd -> pg
   //unused: mempool::osdmap_mapping::vector<std::vector<pg_t>> up_rmap;  // osd -> pg
+  /// osd -> pgs CRUSH maps to it, whatever its state and upmaps
+  mempool::osdmap_mapping::vector<
+    mempool::osdmap_mapping::vector<pg_t>> raw_rmap;
   epoch_t epoch;
   uint64_t num_pgs = 0;
 
+  /// the map being mapped, and the last one completely mapped; what
+  /// changed between the two tells which pgs to remap
+  std::unique_ptr<OSDMap> pending_osdmap, mapped_osdmap;
+  /// their crush maps, which a map decoded in place changes under the
+  /// shared CrushWrapper
+  bufferlist pending_crush, mapped_crush;
+  bool _get_changed_pgs(const OSDMap& osdmap, std::vector<pg_t> *pgs);
+
   void _init_mappings(const OSDMap& osdmap);
   void _update_range(
     const OSDMap& map,
@@ -256,6 +289,12 @@ private:
 
   void _start(const OSDMap& osdmap) {
     _init_mappings(osdmap);
+    pending_osdmap.reset(new OSDMap);
+    pending_osdmap->deepish_copy_from(osdmap);
+    pending_crush.clear();
+    osdmap.crush->encode(pending_crush, CEPH_FEATURES_SUPPORTED_DEFAULT);
+    // until this update completes, the mapping is not that of either
+    mapped_osdmap.reset();
   }
   void _finish(const OSDMap& osdmap);
 
@@ -269,6 +308,7 @@ private:
       : Job(osdmap), mapping(m) {
       mapping->_start(*osdmap);
     }
+    using ParallelPGMapper::Job::process;
     void process(int64_t pool, unsigned ps_begin, unsigned ps_end) override {
       mapping->_update_range(*osdmap, pool, ps_begin, ps_end);
     }
@@ -303,14 +343,15 @@ public:
   void update(const OSDMap& map);
   void update(const OSDMap& map, pg_t pgid);
 
+  /**
+   * Update the mapping on the mapper threads.  If the previous update
+   * completed, only remap the pgs that may have moved since the map it
+   * mapped.
+   */
   std::unique_ptr<MappingJob> start_update(
     const OSDMap& map,
     ParallelPGMapper& mapper,
-    unsigned pgs_per_item) {
-    std::unique_ptr<MappingJob> job(new MappingJob(&map, this));
-    mapper.queue(job.get(), pgs_per_item);
-    return job;
-  }
+    unsigned pgs_per_item);
 
   epoch_t get_epoch() const {
     return epoch;
@@ -322,4 +363,59 @@ public:
 };
 
 
+/**
+ * Lazily filled pg -> up/acting cache, for clients
+ *
+ * Unlike OSDMapMapping, which maps every pg of a map up front, a pg is
+ * only mapped the first time it is looked up.  The entries are kept
+ * across epochs: invalidate() is given each Incremental before it is
+ * applied and only drops the entries it may have moved.  A lookup
+ * against a map of another epoch than the last one the cache was
+ * brought up to (e.g. a full map) drops everything.
+ *
+ * Lookups may run concurrently; invalidate() must not run concurrently
+ * with a lookup against the map it modifies.
+ */
+class OSDMapPlacementCache {
+  struct Entry {
+    bool valid = false;
+    int up_primary = -1;
+    int acting_primary = -1;
+    std::vector<int> raw, up, acting;
+  };
+  struct PoolCache {
+    std::vector<Entry> pgs;  ///< by ps, sized to pg_num on first use
+    std::set<int> osds;      ///< osds any entry maps to (or did)
+  };
+
+  mutable std::mutex lock;
+  epoch_t epoch = 0;
+  std::map<int64_t,PoolCache> pools;
+
+  void _clear_pg(pg_t pgid);
+  void _clear_osds(const std::set<int>& osds);
+
+public:
+  /**
+   * Set up/acting of **pgid** (raw or actual) in **osdmap**, whose pool
+   * must exist.
+   *
+   * @return true if it was cached, false if it was mapped
+   */
+  bool get(const OSDMap& osdmap,
+	   pg_t pgid,
+	   std::vector<int> *up,
+	   int *up_primary,
+	   std::vector<int> *acting,
+	   int *acting_primary);
+
+  /// drop what **inc** may move, before it is applied to **prev**
+  void invalidate(const OSDMap& prev, const OSDMap::Incremental& inc);
+
+  void clear();
+
+  size_t size() const;
+};
+
+
 #endif
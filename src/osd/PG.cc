@@ -4143,6 +4143,12 @@ int PG::build_scrub_map_chunk(
 
 
   get_pgbackend()->be_scan_list(map, ls, deep, seed, handle);
+  if (deep) {
+    uint64_t bytes = 0;
+    for (auto& p : map.objects)
+      bytes += p.second.size;
+    osd->account_scrub_bytes(bytes);
+  }
   _scan_rollback_obs(rollback_obs, handle);
   _scan_snaps(map);
   _repair_oinfo_oid(map);
@@ -4297,10 +4303,15 @@ void PG::replica_scrub(
  */
 void PG::scrub(epoch_t queued, ThreadPool::TPHandle &handle)
 {
-  if (cct->_conf->osd_scrub_sleep > 0 &&
-      (scrubber.state == PG::Scrubber::NEW_CHUNK ||
+  double scrub_sleep = 0;
+  if ((scrubber.state == PG::Scrubber::NEW_CHUNK ||
        scrubber.state == PG::Scrubber::INACTIVE) &&
-       scrubber.needs_sleep) {
+      scrubber.needs_sleep) {
+    // also wait out an exhausted osd_scrub_max_bytes_per_sec budget
+    scrub_sleep = MAX(cct->_conf->osd_scrub_sleep,
+		      osd->get_scrub_budget_delay());
+  }
+  if (scrub_sleep > 0) {
     ceph_assert(!scrubber.sleeping);
     dout(20) << __func__ << " state is INACTIVE|NEW_CHUNK, sleeping" << dendl;
 
@@ -4330,7 +4341,7 @@ void PG::scrub(epoch_t queued, ThreadPool::TPHandle &handle)
           pg->unlock();
         });
     Mutex::Locker l(osd->scrub_sleep_lock);
-    osd->scrub_sleep_timer.add_event_after(cct->_conf->osd_scrub_sleep,
+    osd->scrub_sleep_timer.add_event_after(scrub_sleep,
                                            scrub_requeue_callback);
     scrubber.sleeping = true;
     scrubber.sleep_start = ceph_clock_now();
@@ -577,6 +577,7 @@ void PGBackend::be_scan_list(
 {
   dout(10) << __func__ << " scanning " << ls.size() << " objects"
            << (deep ? " deeply" : "") << dendl;
+  vector<pair<hobject_t, ScrubMap::object*>> deep_ls;
   int i = 0;
   for (vector<hobject_t>::const_iterator p = ls.begin();
        p != ls.end();
@@ -601,9 +602,9 @@ void PGBackend::be_scan_list(
 	  poid, ghobject_t::NO_GEN, get_parent()->whoami_shard().shard),
 	o.attrs);
 
-      // calculate the CRC32 on deep scrubs
+      // calculate the CRC32 on deep scrubs, below
       if (deep) {
-	be_deep_scrub(*p, seed, o, handle);
+	deep_ls.push_back(make_pair(poid, &o));
       }
 
       dout(25) << __func__ << "  " << poid << dendl;
@@ -620,6 +621,35 @@ void PGBackend::be_scan_list(
       ceph_abort();
     }
   }
+
+  if (!deep_ls.empty())
+    be_deep_scrub_list(deep_ls, seed, handle);
+}
+
+/*
+ * Hash the objects one after the other, but hint the store to start
+ * reading the next osd_deep_scrub_read_ahead - 1 of them, so the disk is
+ * not idle while the current object is checksummed.
+ */
+void PGBackend::be_deep_scrub_list(
+  const vector<pair<hobject_t, ScrubMap::object*>> &ls, uint32_t seed,
+  ThreadPool::TPHandle &handle)
+{
+  for_each_read_ahead(
+    ls.size(), cct->_conf->osd_deep_scrub_read_ahead,
+    [&](size_t i) {
+      if (!ls[i].second->size)
+	return;
+      store->readahead(
+	ch,
+	ghobject_t(
+	  ls[i].first, ghobject_t::NO_GEN,
+	  get_parent()->whoami_shard().shard),
+	0, ls[i].second->size);
+    },
+    [&](size_t i) {
+      be_deep_scrub(ls[i].first, seed, *ls[i].second, handle);
+    });
 }
 
 bool PGBackend::be_compare_scrub_objects(
@@ -245,6 +245,11 @@ typedef ceph::shared_ptr<const OSDMap> OSDMapRef;
 
      virtual void schedule_recovery_work(
        GenContext<ThreadPool::TPHandle&> *c) = 0;
+     /// queue c on the erasure code encode thread pool; false, without
+     /// taking c, if there is none
+     virtual bool schedule_encode_work(
+       GenContext<ThreadPool::TPHandle&> *c) = 0;
+     virtual void account_recovery_bytes(uint64_t bytes) = 0;
 
      virtual pg_shard_t whoami_shard() const = 0;
      int whoami() const {
@@ -555,6 +560,22 @@ typedef ceph::shared_ptr<const OSDMap> OSDMapRef;
    void be_scan_list(
      ScrubMap &map, const vector<hobject_t> &ls, bool deep, uint32_t seed,
      ThreadPool::TPHandle &handle);
+   void be_deep_scrub_list(
+     const vector<pair<hobject_t, ScrubMap::object*>> &ls, uint32_t seed,
+     ThreadPool::TPHandle &handle);
+   /// call scrub(i) for objects 0 to n - 1 in order, each after
+   /// read_ahead(j) for those of the next window - 1 not yet hinted
+   template <typename ReadAhead, typename Scrub>
+   static void for_each_read_ahead(
+     size_t n, uint64_t window, ReadAhead &&read_ahead, Scrub &&scrub) {
+     size_t hinted = 0;
+     for (size_t i = 0; i < n; ++i) {
+       for (hinted = MAX(hinted, i + 1); hinted < n && hinted < i + window;
+	    ++hinted)
+	 read_ahead(hinted);
+       scrub(i);
+     }
+   }
    bool be_compare_scrub_objects(
      pg_shard_t auth_shard,
      const ScrubMap::object &auth,
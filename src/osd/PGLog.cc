@@ -48,7 +48,8 @@ void PGLog::IndexedLog::trim(
   eversion_t s,
   set<eversion_t> *trimmed,
   set<string>* trimmed_dups,
-  bool* dirty_dups)
+  bool* dirty_dups,
+  eversion_t *write_from_dups)
 {
   if (complete_to != log.end() &&
       complete_to->version <= s) {
@@ -77,6 +78,8 @@ void PGLog::IndexedLog::trim(
     // add to dup list
     if (e.version.version >= earliest_dup_version) {
       if (dirty_dups) *dirty_dups = true;
+      if (write_from_dups && e.version < *write_from_dups)
+	*write_from_dups = e.version;
       dups.push_back(pg_log_dup_t(e));
       index(dups.back());
       for (const auto& extra : e.extra_reqids) {
@@ -166,7 +169,7 @@ void PGLog::trim(
     assert(trim_to <= info.last_complete);
 
     dout(10) << "trim " << log << " to " << trim_to << dendl;
-    log.trim(cct, trim_to, &trimmed, &trimmed_dups, &dirty_dups);
+    log.trim(cct, trim_to, &trimmed, &trimmed_dups, nullptr, &write_from_dups);
     info.log_tail = log.tail;
   }
 }
@@ -574,6 +577,7 @@ void PGLog::write_log_and_missing(
 	     << ", writeout_from: " << writeout_from
 	     << ", trimmed: " << trimmed
 	     << ", trimmed_dups: " << trimmed_dups
+	     << ", write_from_dups: " << write_from_dups
 	     << ", clear_divergent_priors: " << clear_divergent_priors
 	     << dendl;
     _write_log_and_missing(
@@ -588,6 +592,7 @@ void PGLog::write_log_and_missing(
       require_rollback,
       clear_divergent_priors,
       dirty_dups,
+      write_from_dups,
       &rebuilt_missing_with_deletes,
       (pg_log_debug ? &log_keys_debug : nullptr));
     undirty();
@@ -634,7 +639,8 @@ void PGLog::write_log_and_missing(
     set<eversion_t>(),
     set<string>(),
     missing,
-    true, require_rollback, false, dirty_dups, rebuilt_missing_with_deletes, nullptr);
+    true, require_rollback, false, dirty_dups, eversion_t::max(),
+    rebuilt_missing_with_deletes, nullptr);
 }
 
 // static
@@ -760,15 +766,15 @@ void PGLog::_write_log_and_missing(
   bool require_rollback,
   bool clear_divergent_priors,
   bool dirty_dups,
+  eversion_t write_from_dups,
   bool *rebuilt_missing_with_deletes, // in/out param
   set<string> *log_keys_debug
   ) {
-  set<string> to_remove(trimmed_dups);
-  for (set<eversion_t>::const_iterator i = trimmed.begin();
-       i != trimmed.end();
-       ++i) {
-    to_remove.insert(i->get_key_name());
-    if (log_keys_debug) {
+  set<string> to_remove;
+  if (log_keys_debug) {
+    for (set<eversion_t>::const_iterator i = trimmed.begin();
+	 i != trimmed.end();
+	 ++i) {
       assert(log_keys_debug->count(i->get_key_name()));
       log_keys_debug->erase(i->get_key_name());
     }
@@ -776,6 +782,22 @@ void PGLog::_write_log_and_missing(
 
   if (touch_log)
     t.touch(coll, log_oid);
+
+  // trimming only ever removes the oldest entries (and dups), so the
+  // trimmed keys form a prefix of their key range: drop them with one
+  // range delete rather than naming every key in the transaction.
+  // Appending '\0' makes the bound sort just after the last trimmed key.
+  if (!trimmed.empty()) {
+    t.omap_rmkeyrange(
+      coll, log_oid,
+      eversion_t().get_key_name(), trimmed.rbegin()->get_key_name() + '\0');
+  }
+  if (!trimmed_dups.empty()) {
+    pg_log_dup_t min;
+    t.omap_rmkeyrange(
+      coll, log_oid,
+      min.get_key_name(), *trimmed_dups.rbegin() + '\0');
+  }
   if (dirty_to != eversion_t()) {
     t.omap_rmkeyrange(
       coll, log_oid,
@@ -831,6 +853,15 @@ void PGLog::_write_log_and_missing(
       ::encode(entry, bl);
       (*km)[entry.get_key_name()].claim(bl);
     }
+  } else if (write_from_dups != eversion_t::max()) {
+    // only the dups appended by trim since the last write are new
+    for (auto p = log.dups.rbegin();
+	 p != log.dups.rend() && p->version >= write_from_dups;
+	 ++p) {
+      bufferlist bl;
+      ::encode(*p, bl);
+      (*km)[p->get_key_name()].claim(bl);
+    }
   }
 
   if (clear_divergent_priors) {
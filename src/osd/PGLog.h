@@ -34,6 +34,132 @@ using namespace std;
 
 class CephContext;
 
+/**
+ * pg_log_reqid_index_t - compact index of log entries by reqid
+ *
+ * Maps an osd_reqid_t to the entry (pg_log_entry_t or pg_log_dup_t)
+ * whose ->reqid it is.  The key is not stored; each slot holds only
+ * a 64-bit hash and the entry pointer in one flat, open-addressed
+ * (linear probing) array, and the entry's reqid is compared only when
+ * the hashes match.  That is 16 bytes per slot against ~64 bytes plus
+ * a separate allocation per element for a node-based unordered_map,
+ * and a lookup usually touches a single cache line.
+ */
+template <typename T>
+class pg_log_reqid_index_t {
+  struct slot_t {
+    uint64_t hash = 0;
+    T *item = nullptr;
+  };
+  mempool::osd_pglog::vector<slot_t> slots;  ///< empty or a power of 2
+  size_t num = 0;
+
+  static uint64_t mix(uint64_t h) {
+    // murmur3 fmix64; std::hash<uint64_t> is the identity
+    h ^= h >> 33;
+    h *= 0xff51afd7ed558ccdull;
+    h ^= h >> 33;
+    h *= 0xc4ceb9fe1a85ec53ull;
+    h ^= h >> 33;
+    return h;
+  }
+  static uint64_t hash_reqid(const osd_reqid_t &r) {
+    uint64_t h = mix(r.name.num() ^ ((uint64_t)r.name.type() << 56));
+    h = mix(h ^ r.tid);
+    return mix(h ^ (uint32_t)r.inc);
+  }
+  size_t mask() const {
+    return slots.size() - 1;
+  }
+  /// slot holding r, or the empty slot that terminates its probe
+  size_t find_slot(const osd_reqid_t &r, uint64_t h) const {
+    size_t i = h & mask();
+    while (slots[i].item &&
+	   (slots[i].hash != h || !(slots[i].item->reqid == r)))
+      i = (i + 1) & mask();
+    return i;
+  }
+  void rehash(size_t nslots) {
+    mempool::osd_pglog::vector<slot_t> old(nslots);
+    old.swap(slots);
+    for (auto &s : old) {
+      if (!s.item)
+	continue;
+      size_t i = s.hash & mask();
+      while (slots[i].item)
+	i = (i + 1) & mask();
+      slots[i] = s;
+    }
+  }
+
+public:
+  size_t size() const {
+    return num;
+  }
+  bool empty() const {
+    return num == 0;
+  }
+  size_t count(const osd_reqid_t &r) const {
+    return lookup(r) ? 1 : 0;
+  }
+  T *lookup(const osd_reqid_t &r) const {
+    if (!num)
+      return nullptr;
+    return slots[find_slot(r, hash_reqid(r))].item;
+  }
+
+  /// size the table for n entries (load factor <= 3/4)
+  void reserve(size_t n) {
+    size_t want = 16;
+    while (want * 3 < n * 4)
+      want <<= 1;
+    if (want > slots.size())
+      rehash(want);
+  }
+
+  /// index item under item->reqid, replacing any previous mapping
+  void insert(T *item) {
+    if ((num + 1) * 4 > slots.size() * 3)
+      rehash(slots.empty() ? 16 : slots.size() * 2);
+    uint64_t h = hash_reqid(item->reqid);
+    slot_t &s = slots[find_slot(item->reqid, h)];
+    if (!s.item)
+      ++num;
+    s.hash = h;
+    s.item = item;
+  }
+
+  /// remove r; if item is non-null, only if r currently maps to item
+  bool erase(const osd_reqid_t &r, const T *item = nullptr) {
+    if (!num)
+      return false;
+    size_t i = find_slot(r, hash_reqid(r));
+    if (!slots[i].item || (item && slots[i].item != item))
+      return false;
+    // backward-shift deletion: pull later members of the probe run
+    // into the hole so that no tombstones are needed
+    for (size_t j = (i + 1) & mask(); slots[j].item; j = (j + 1) & mask()) {
+      size_t home = slots[j].hash & mask();
+      if (((j - home) & mask()) >= ((j - i) & mask())) {
+	slots[i] = slots[j];
+	i = j;
+      }
+    }
+    slots[i] = slot_t();
+    --num;
+    return true;
+  }
+
+  void clear() {
+    mempool::osd_pglog::vector<slot_t>().swap(slots);
+    num = 0;
+  }
+
+  size_t get_bytes() const {
+    return slots.capacity() * sizeof(slot_t);
+  }
+};
+
 struct PGLog : DoutPrefixProvider {
   DoutPrefixProvider *prefix_provider;
   string gen_prefix() const override {
@@ -82,10 +208,10 @@ public:
    * plus some methods to manipulate it all.
    */
   struct IndexedLog : public pg_log_t {
-    mutable ceph::unordered_map<hobject_t,pg_log_entry_t*> objects;  // ptrs into log.  be careful!
-    mutable ceph::unordered_map<osd_reqid_t,pg_log_entry_t*> caller_ops;
-    mutable ceph::unordered_multimap<osd_reqid_t,pg_log_entry_t*> extra_caller_ops;
-    mutable ceph::unordered_map<osd_reqid_t,pg_log_dup_t*> dup_index;
+    mutable mempool::osd_pglog::unordered_map<hobject_t,pg_log_entry_t*> objects;  // ptrs into log.  be careful!
+    mutable pg_log_reqid_index_t<pg_log_entry_t> caller_ops;
+    mutable mempool::osd_pglog::unordered_multimap<osd_reqid_t,pg_log_entry_t*> extra_caller_ops;
+    mutable pg_log_reqid_index_t<pg_log_dup_t> dup_index;
 
     // recovery pointers
     list<pg_log_entry_t>::iterator complete_to; // not inclusive of referenced item
@@ -273,15 +399,14 @@ public:
       assert(version);
       assert(user_version);
       assert(return_code);
-      ceph::unordered_map<osd_reqid_t,pg_log_entry_t*>::const_iterator p;
       if (!(indexed_data & PGLOG_INDEXED_CALLER_OPS)) {
         index_caller_ops();
       }
-      p = caller_ops.find(r);
-      if (p != caller_ops.end()) {
-	*version = p->second->version;
-	*user_version = p->second->user_version;
-	*return_code = p->second->return_code;
+      const pg_log_entry_t *e = caller_ops.lookup(r);
+      if (e) {
+	*version = e->version;
+	*user_version = e->user_version;
+	*return_code = e->return_code;
 	return true;
       }
 
@@ -290,7 +415,7 @@ public:
       if (!(indexed_data & PGLOG_INDEXED_EXTRA_CALLER_OPS)) {
         index_extra_caller_ops();
       }
-      p = extra_caller_ops.find(r);
+      auto p = extra_caller_ops.find(r);
       if (p != extra_caller_ops.end()) {
 	for (auto i = p->second->extra_reqids.begin();
 	     i != p->second->extra_reqids.end();
@@ -308,11 +433,11 @@ public:
       if (!(indexed_data & PGLOG_INDEXED_DUPS)) {
         index_dups();
       }
-      auto q = dup_index.find(r);
-      if (q != dup_index.end()) {
-	*version = q->second->version;
-	*user_version = q->second->user_version;
-	*return_code = q->second->return_code;
+      const pg_log_dup_t *d = dup_index.lookup(r);
+      if (d) {
+	*version = d->version;
+	*user_version = d->user_version;
+	*return_code = d->return_code;
 	return true;
       }
 
@@ -354,14 +479,17 @@ public:
 
       if (to_index & PGLOG_INDEXED_OBJECTS)
 	objects.clear();
-      if (to_index & PGLOG_INDEXED_CALLER_OPS)
+      if (to_index & PGLOG_INDEXED_CALLER_OPS) {
 	caller_ops.clear();
+	caller_ops.reserve(log.size());
+      }
       if (to_index & PGLOG_INDEXED_EXTRA_CALLER_OPS)
 	extra_caller_ops.clear();
       if (to_index & PGLOG_INDEXED_DUPS) {
 	dup_index.clear();
+	dup_index.reserve(dups.size());
 	for (auto& i : dups) {
-	  dup_index[i.reqid] = const_cast<pg_log_dup_t*>(&i);
+	  dup_index.insert(const_cast<pg_log_dup_t*>(&i));
 	}
       }
 
@@ -382,7 +510,7 @@ public:
 
 	  if (to_index & PGLOG_INDEXED_CALLER_OPS) {
 	    if (i->reqid_is_indexed()) {
-	      caller_ops[i->reqid] = const_cast<pg_log_entry_t*>(&(*i));
+	      caller_ops.insert(const_cast<pg_log_entry_t*>(&(*i)));
 	    }
 	  }
 
@@ -425,7 +553,7 @@ public:
       if (indexed_data & PGLOG_INDEXED_CALLER_OPS) {
 	// divergent merge_log indexes new before unindexing old
         if (e.reqid_is_indexed()) {
-	  caller_ops[e.reqid] = &e;
+	  caller_ops.insert(&e);
         }
       }
       if (indexed_data & PGLOG_INDEXED_EXTRA_CALLER_OPS) {
@@ -454,16 +582,14 @@ public:
       if (e.reqid_is_indexed()) {
         if (indexed_data & PGLOG_INDEXED_CALLER_OPS) {
 	  // divergent merge_log indexes new before unindexing old
-          if (caller_ops.count(e.reqid) && caller_ops[e.reqid] == &e)
-            caller_ops.erase(e.reqid);
+          caller_ops.erase(e.reqid, &e);
         }
       }
       if (indexed_data & PGLOG_INDEXED_EXTRA_CALLER_OPS) {
         for (auto j = e.extra_reqids.begin();
              j != e.extra_reqids.end();
              ++j) {
-          for (ceph::unordered_multimap<osd_reqid_t,pg_log_entry_t*>::iterator k =
-		 extra_caller_ops.find(j->first);
+          for (auto k = extra_caller_ops.find(j->first);
                k != extra_caller_ops.end() && k->first == j->first;
                ++k) {
             if (k->second == &e) {
@@ -477,16 +603,13 @@ public:
 
     void index(pg_log_dup_t& e) {
       if (PGLOG_INDEXED_DUPS) {
-	dup_index[e.reqid] = &e;
+	dup_index.insert(&e);
       }
     }
 
     void unindex(const pg_log_dup_t& e) {
       if (PGLOG_INDEXED_DUPS) {
-	auto i = dup_index.find(e.reqid);
-	if (i != dup_index.end()) {
-	  dup_index.erase(i);
-	}
+	dup_index.erase(e.reqid);
       }
     }
 
@@ -516,7 +639,7 @@ public:
       }
       if (indexed_data & PGLOG_INDEXED_CALLER_OPS) {
         if (e.reqid_is_indexed()) {
-	  caller_ops[e.reqid] = &(log.back());
+	  caller_ops.insert(&(log.back()));
         }
       }
 
@@ -538,7 +661,8 @@ public:
       eversion_t s,
       set<eversion_t> *trimmed,
       set<string>* trimmed_dups,
-      bool* dirty_dups);
+      bool* dirty_dups,
+      eversion_t *write_from_dups = nullptr);
 
     ostream& print(ostream& out) const;
   }; // IndexedLog
@@ -561,6 +685,7 @@ protected:
   bool touched_log;
   bool clear_divergent_priors;
   bool dirty_dups; /// log.dups is updated
+  eversion_t write_from_dups;  ///< must write out dups >= write_from_dups
   bool rebuilt_missing_with_deletes = false;
 
   void mark_dirty_to(eversion_t to) {
@@ -585,6 +710,7 @@ public:
       !missing.is_clean() ||
       !(trimmed_dups.empty()) ||
       dirty_dups ||
+      (write_from_dups != eversion_t::max()) ||
       rebuilt_missing_with_deletes;
   }
   void mark_log_for_rewrite() {
@@ -625,6 +751,7 @@ protected:
     check();
     missing.flush();
     dirty_dups = false;
+    write_from_dups = eversion_t::max();
   }
 public:
 
@@ -637,7 +764,8 @@ public:
     pg_log_debug(!(cct && !(cct->_conf->osd_debug_pg_log_writeout))),
     touched_log(false),
     clear_divergent_priors(false),
-    dirty_dups(false)
+    dirty_dups(false),
+    write_from_dups(eversion_t::max())
   { }
 
   void reset_backfill();
@@ -1227,6 +1355,7 @@ public:
     bool require_rollback,
     bool clear_divergent_priors,
     bool dirty_dups,
+    eversion_t write_from_dups,
     bool *rebuilt_missing_with_deletes,
     set<string> *log_keys_debug
     );
@@ -510,6 +510,15 @@ void PrimaryLogPG::schedule_recovery_work(
   osd->recovery_gen_wq.queue(c);
 }
 
+bool PrimaryLogPG::schedule_encode_work(
+  GenContext<ThreadPool::TPHandle&> *c)
+{
+  if (!osd->ec_encode_threads)
+    return false;
+  osd->ec_encode_gen_wq.queue(c);
+  return true;
+}
+
 void PrimaryLogPG::send_message_osd_cluster(
   int peer, Message *m, epoch_t from_epoch)
 {
@@ -5037,6 +5046,33 @@ int PrimaryLogPG::do_osd_ops(OpContext *ctx, vector<OSDOp>& ops)
 
     bufferlist::iterator bp = osd_op.indata.begin();
 
+    // writes that are not tracked below may change any part of the
+    // object's data; ops listed here only touch the ranges they record
+    // or no data at all
+    if (ceph_osd_op_mode_modify(op.op)) {
+      switch (op.op) {
+      case CEPH_OSD_OP_WRITE:
+      case CEPH_OSD_OP_APPEND:
+      case CEPH_OSD_OP_WRITEFULL:
+      case CEPH_OSD_OP_ZERO:
+      case CEPH_OSD_OP_TRUNCATE:
+      case CEPH_OSD_OP_TRIMTRUNC:
+      case CEPH_OSD_OP_CREATE:
+      case CEPH_OSD_OP_SETXATTR:
+      case CEPH_OSD_OP_RMXATTR:
+      case CEPH_OSD_OP_OMAPSETVALS:
+      case CEPH_OSD_OP_OMAPSETHEADER:
+      case CEPH_OSD_OP_OMAPCLEAR:
+      case CEPH_OSD_OP_OMAPRMKEYS:
+      case CEPH_OSD_OP_SETALLOCHINT:
+      case CEPH_OSD_OP_WATCH:
+      case CEPH_OSD_OP_STARTSYNC:
+	break;
+      default:
+	ctx->dirty_extents.mark_all();
+      }
+    }
+
     // user-visible modifcation?
     switch (op.op) {
       // non user-visible modifications
@@ -5792,6 +5828,12 @@ int PrimaryLogPG::do_osd_ops(OpContext *ctx, vector<OSDOp>& ops)
 	    t->truncate(soid, op.extent.truncate_size);
 	    oi.truncate_seq = op.extent.truncate_seq;
 	    oi.truncate_size = op.extent.truncate_size;
+	    // truncating up leaves a hole the peer's copy may not have
+	    ctx->dirty_extents.mark(
+	      MIN(op.extent.truncate_size, oi.size),
+	      MAX(op.extent.truncate_size, oi.size) -
+	      MIN(op.extent.truncate_size, oi.size),
+	      cct->_conf->osd_pg_log_max_dirty_extents);
 	    if (op.extent.truncate_size != oi.size) {
 	      ctx->delta_stats.num_bytes -= oi.size;
 	      ctx->delta_stats.num_bytes += op.extent.truncate_size;
@@ -5828,6 +5870,12 @@ int PrimaryLogPG::do_osd_ops(OpContext *ctx, vector<OSDOp>& ops)
 	  obs.oi.set_data_digest(osd_op.indata.crc32c(obs.oi.data_digest));
 	else
 	  obs.oi.clear_data_digest();
+	// a write past EOF also dirties the hole it leaves behind
+	if (op.extent.offset > oi.size)
+	  ctx->dirty_extents.mark(oi.size, op.extent.offset - oi.size,
+				  cct->_conf->osd_pg_log_max_dirty_extents);
+	ctx->dirty_extents.mark(op.extent.offset, op.extent.length,
+				cct->_conf->osd_pg_log_max_dirty_extents);
 	write_update_size_and_usage(ctx->delta_stats, oi, ctx->modified_ranges,
 				    op.extent.offset, op.extent.length);
 
@@ -5861,6 +5909,8 @@ int PrimaryLogPG::do_osd_ops(OpContext *ctx, vector<OSDOp>& ops)
 	}
 	obs.oi.set_data_digest(osd_op.indata.crc32c(-1));
 
+	ctx->dirty_extents.mark(0, MAX(oi.size, (uint64_t)op.extent.length),
+				cct->_conf->osd_pg_log_max_dirty_extents);
 	write_update_size_and_usage(ctx->delta_stats, oi, ctx->modified_ranges,
 	    0, op.extent.length, true);
       }
@@ -5892,6 +5942,8 @@ int PrimaryLogPG::do_osd_ops(OpContext *ctx, vector<OSDOp>& ops)
 	assert(op.extent.length);
 	if (obs.exists && !oi.is_whiteout()) {
 	  t->zero(soid, op.extent.offset, op.extent.length);
+	  ctx->dirty_extents.mark(op.extent.offset, op.extent.length,
+				  cct->_conf->osd_pg_log_max_dirty_extents);
 	  interval_set<uint64_t> ch;
 	  ch.insert(op.extent.offset, op.extent.length);
 	  ctx->modified_ranges.union_of(ch);
@@ -5969,6 +6021,12 @@ int PrimaryLogPG::do_osd_ops(OpContext *ctx, vector<OSDOp>& ops)
 
 	maybe_create_new_object(ctx);
 	t->truncate(soid, op.extent.offset);
+	// both the trimmed tail and a hole left by truncating up differ
+	// from what the peer may hold
+	ctx->dirty_extents.mark(
+	  MIN(op.extent.offset, oi.size),
+	  MAX(op.extent.offset, oi.size) - MIN(op.extent.offset, oi.size),
+	  cct->_conf->osd_pg_log_max_dirty_extents);
 	if (oi.size > op.extent.offset) {
 	  interval_set<uint64_t> trim;
 	  trim.insert(op.extent.offset, oi.size-op.extent.offset);
@@ -7433,7 +7491,12 @@ int PrimaryLogPG::prepare_transaction(OpContext *ctx)
     return -EINVAL;
   }
 
-  // prepare the actual mutation
+  // prepare the actual mutation; only track modified ranges where
+  // delta recovery may use them, other entries stay whole-object dirty
+  if (cct->_conf->osd_recovery_delta_extents && !pool.info.ec_pool())
+    ctx->dirty_extents.clear();
+  else
+    ctx->dirty_extents.mark_all();
   int result = do_osd_ops(ctx, *ctx->ops);
   if (result < 0) {
     if (ctx->op->may_write() &&
@@ -7623,6 +7686,8 @@ void PrimaryLogPG::finish_ctx(OpContext *ctx, int log_op_type, bool maintain_ssc
 				    ctx->obs->oi.version,
 				    ctx->user_at_version, ctx->reqid,
 				    ctx->mtime, 0));
+  if (log_op_type == pg_log_entry_t::MODIFY)
+    ctx->log.back().dirty_extents = ctx->dirty_extents;
   if (soid.snap < CEPH_NOSNAP) {
     switch (log_op_type) {
     case pg_log_entry_t::MODIFY:
@@ -430,6 +430,11 @@ public:
 
   void schedule_recovery_work(
     GenContext<ThreadPool::TPHandle&> *c) override;
+  bool schedule_encode_work(
+    GenContext<ThreadPool::TPHandle&> *c) override;
+  void account_recovery_bytes(uint64_t bytes) override {
+    osd->account_recovery_bytes(bytes);
+  }
 
   pg_shard_t whoami_shard() const override {
     return pg_whoami;
@@ -534,6 +539,7 @@ public:
     boost::optional<pg_hit_set_history_t> updated_hset_history;
 
     interval_set<uint64_t> modified_ranges;
+    object_dirty_extents_t dirty_extents;  // for the head's log entry
     ObjectContextRef obc;
     ObjectContextRef clone_obc;    // if we created a clone
     ObjectContextRef snapset_obc;  // if we created/deleted a snapdir
@@ -0,0 +1,64 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t -*-
+// vim: ts=8 sw=2 smarttab
+/*
+ * Ceph - scalable distributed file system
+ *
+ * This is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License version 2.1, as published by the Free Software
+ * Foundation.  See file COPYING.
+ *
+ */
+
+#include "RecoveryThrottle.h"
+#include "osd_types.h"
+
+unsigned get_recovery_queue_priority(
+  int state,
+  unsigned recovery_priority,
+  unsigned backfill_priority)
+{
+  if (state & (PG_STATE_FORCED_RECOVERY | PG_STATE_FORCED_BACKFILL))
+    return OSD_RECOVERY_PRIORITY_FORCED;
+  if ((state & PG_STATE_RECOVERING) && !(state & PG_STATE_BACKFILL))
+    return recovery_priority;
+  return backfill_priority;
+}
+
+void RecoveryByteBudget::refill(uint64_t max_rate, utime_t now)
+{
+  if (!max_rate) {
+    rate = 0;
+    avail = 0;
+    stamp = now;
+    return;
+  }
+  if (rate <= 0 || rate > max_rate)
+    rate = max_rate;
+  if (stamp == utime_t()) {
+    avail = rate;
+  } else if (now > stamp) {
+    // allow at most one second worth of burst
+    avail = MIN(avail + rate * (double)(now - stamp), rate);
+  }
+  stamp = now;
+}
+
+void RecoveryByteBudget::adjust(
+  uint64_t max_rate,
+  double latency_target,
+  uint64_t lat_ms,
+  utime_t now)
+{
+  refill(max_rate, now);
+  if (!max_rate)
+    return;
+  // AIMD: halve the budget while clients suffer, then probe upward
+  // in 1/16th steps; never starve recovery completely
+  double step = max_rate / 16.0;
+  if (latency_target > 0 && lat_ms > latency_target * 1000.0) {
+    rate = MAX(rate / 2, step);
+  } else {
+    rate = MIN(rate + step, (double)max_rate);
+  }
+}
@@ -0,0 +1,79 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t -*-
+// vim: ts=8 sw=2 smarttab
+/*
+ * Ceph - scalable distributed file system
+ *
+ * This is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License version 2.1, as published by the Free Software
+ * Foundation.  See file COPYING.
+ *
+ */
+
+
+#pragma once
+
+#include <functional>
+#include <map>
+
+#include "include/utime.h"
+
+/// PGs waiting to start recovery: most urgent (highest priority) first,
+/// FIFO among equal priorities
+template <typename T>
+using RecoveryQueue = std::multimap<unsigned, T, std::greater<unsigned> >;
+
+/// priority in the RecoveryQueue of a PG in @p state: forced PGs first,
+/// then recovery and backfill at their own priorities
+unsigned get_recovery_queue_priority(
+  int state,
+  unsigned recovery_priority,
+  unsigned backfill_priority);
+
+/**
+ * Byte budget of recovery (osd_recovery_max_bytes_per_sec)
+ *
+ * A token bucket holding at most one second worth of bytes at the
+ * current rate.  Recovery charges what it reads and pushes, and no new
+ * recovery op starts while the bucket is empty.  adjust() halves the
+ * rate while client op latency is above target and probes upward in
+ * 1/16th steps otherwise, never below one step.
+ *
+ * A max_rate of 0 disables the budget.
+ */
+class RecoveryByteBudget {
+  double rate = 0;   ///< current budget, bytes/sec
+  double avail = 0;  ///< budget left; may go negative
+  utime_t stamp;     ///< last refill of avail
+
+public:
+  void refill(uint64_t max_rate, utime_t now);
+
+  /// charge bytes read/pushed for recovery
+  void charge(uint64_t bytes) {
+    if (rate > 0)
+      avail -= bytes;
+  }
+
+  /// refill and tell whether there is budget left to start an op
+  bool allows_start(uint64_t max_rate, utime_t now) {
+    if (!max_rate)
+      return true;
+    refill(max_rate, now);
+    return avail > 0;
+  }
+
+  /// adapt the rate to the client op latency @p lat_ms
+  void adjust(
+    uint64_t max_rate,
+    double latency_target,
+    uint64_t lat_ms,
+    utime_t now);
+
+  double get_rate() const {
+    return rate;
+  }
+  double get_avail() const {
+    return avail;
+  }
+};
@@ -1282,6 +1282,83 @@ void ReplicatedBackend::calc_head_subsets(
 	   << "  clone_subsets " << clone_subsets << dendl;
 }
 
+/*
+ * If the peer holds an older version of head and every log entry since
+ * then recorded the ranges it modified, the peer can keep the rest of
+ * its own copy: describe that as a clone_subset of the object onto
+ * itself, which the peer applies before writing the pushed data.
+ */
+void ReplicatedBackend::calc_delta_subsets(
+  ObjectContextRef obc, const hobject_t& head,
+  const pg_missing_t& missing,
+  interval_set<uint64_t>& data_subset,
+  map<hobject_t, interval_set<uint64_t>>& clone_subsets)
+{
+  if (!cct->_conf->osd_recovery_delta_extents)
+    return;
+  // an older replica takes a clone_subset of the head onto itself as a
+  // clone from the head it has just removed
+  if (get_osdmap()->require_osd_release < CEPH_RELEASE_MIMIC) {
+    dout(20) << __func__ << " require_osd_release "
+	     << ceph_release_name(get_osdmap()->require_osd_release)
+	     << " < mimic, pushing " << head << " whole" << dendl;
+    return;
+  }
+  pg_missing_item item;
+  if (!missing.is_missing(head, &item) ||
+      item.have == eversion_t() ||
+      item.is_delete())
+    return;
+  // the ranges are only known up to need, and what is pushed is the
+  // object as of its current version
+  if (item.need != obc->obs.oi.version) {
+    dout(20) << __func__ << " " << head << " need " << item.need
+	     << " != version " << obc->obs.oi.version << dendl;
+    return;
+  }
+  const auto &log = get_parent()->get_log().get_log();
+  if (item.have < log.tail) {
+    dout(20) << __func__ << " " << head << " have " << item.have
+	     << " predates log tail " << log.tail << dendl;
+    return;
+  }
+
+  object_dirty_extents_t dirty;
+  dirty.clear();
+  unsigned max = cct->_conf->osd_pg_log_max_dirty_extents;
+  for (auto p = log.log.rbegin();
+       p != log.log.rend() && p->version > item.have;
+       ++p) {
+    if (p->soid != head || p->is_error())
+      continue;
+    if (!p->is_modify())
+      dirty.mark_all();
+    else
+      dirty.merge(p->dirty_extents, max);
+    if (dirty.all) {
+      dout(20) << __func__ << " " << head << " entry " << p->version
+	       << " dirties the whole object" << dendl;
+      return;
+    }
+  }
+
+  interval_set<uint64_t> clean;
+  if (obc->obs.oi.size)
+    clean.insert(0, obc->obs.oi.size);
+  interval_set<uint64_t> dirty_extents;
+  dirty.get_extents(&dirty_extents);
+  clean.subtract(dirty_extents);
+  for (auto &c : clone_subsets)
+    clean.subtract(c.second);
+  if (clean.empty())
+    return;
+  clone_subsets[head] = clean;
+  data_subset.subtract(clean);
+  dout(10) << __func__ << " " << head << " have " << item.have
+	   << " need " << item.need << " reusing " << clean
+	   << " pushing " << data_subset << dendl;
+}
+
 void ReplicatedBackend::calc_clone_subsets(
   SnapSet& snapset, const hobject_t& soid,
   const pg_missing_t& missing,
@@ -1539,6 +1616,9 @@ int ReplicatedBackend::prep_push_to_replica(
       get_parent()->get_shard_info().find(peer)->second.last_backfill,
       data_subset, clone_subsets,
       lock_manager);
+    calc_delta_subsets(
+      obc, soid, get_parent()->get_shard_missing().find(peer)->second,
+      data_subset, clone_subsets);
   }
 
   return prep_push(
@@ -1614,8 +1694,11 @@ void ReplicatedBackend::submit_push_data(
   const map<string, bufferlist> &omap_entries,
   ObjectStore::Transaction *t)
 {
+  // delta recovery starts from our own older copy of the object
+  auto self = recovery_info.clone_subset.find(recovery_info.soid);
+  bool from_self = self != recovery_info.clone_subset.end();
   hobject_t target_oid;
-  if (first && complete) {
+  if (first && complete && !from_self) {
     target_oid = recovery_info.soid;
   } else {
     target_oid = get_parent()->get_temp_recovery_object(recovery_info.soid,
@@ -1640,6 +1723,15 @@ void ReplicatedBackend::submit_push_data(
 		      oi.expected_object_size,
 		      oi.expected_write_size,
 		      oi.alloc_hint_flags);
+    if (from_self) {
+      for (auto q = self->second.begin(); q != self->second.end(); ++q) {
+	dout(15) << " clone_range " << recovery_info.soid << " "
+		 << q.get_start() << "~" << q.get_len() << dendl;
+	t->clone_range(coll, ghobject_t(recovery_info.soid),
+		       ghobject_t(target_oid),
+		       q.get_start(), q.get_len(), q.get_start());
+      }
+    }
   }
   uint64_t off = 0;
   uint32_t fadvise_flags = CEPH_OSD_OP_FLAG_FADVISE_SEQUENTIAL;
@@ -1661,7 +1753,7 @@ void ReplicatedBackend::submit_push_data(
     t->setattrs(coll, ghobject_t(target_oid), attrs);
 
   if (complete) {
-    if (!first) {
+    if (target_oid != recovery_info.soid) {
       dout(10) << __func__ << ": Removing oid "
 	       << target_oid << " from the temp collection" << dendl;
       clear_temp_obj(target_oid);
@@ -1682,6 +1774,8 @@ void ReplicatedBackend::submit_push_complete(
 	 recovery_info.clone_subset.begin();
        p != recovery_info.clone_subset.end();
        ++p) {
+    if (p->first == recovery_info.soid)
+      continue;  // applied up front by submit_push_data
     for (interval_set<uint64_t>::const_iterator q = p->second.begin();
 	 q != p->second.end();
 	 ++q) {
@@ -2077,6 +2171,7 @@ int ReplicatedBackend::build_push_op(const ObjectRecoveryInfo &recovery_info,
 
   get_parent()->get_logger()->inc(l_osd_push);
   get_parent()->get_logger()->inc(l_osd_push_outb, out_op->data.length());
+  get_parent()->account_recovery_bytes(out_op->data.length());
 
   // send
   out_op->version = v;
@@ -3927,6 +3927,58 @@ void ObjectModDesc::decode(bufferlist::iterator &_bl)
   DECODE_FINISH(_bl);
 }
 
+// -- object_dirty_extents_t --
+
+void object_dirty_extents_t::encode(bufferlist &bl) const
+{
+  ENCODE_START(1, 1, bl);
+  ::encode(all, bl);
+  ::encode(extents, bl);
+  ENCODE_FINISH(bl);
+}
+
+void object_dirty_extents_t::decode(bufferlist::iterator &bl)
+{
+  DECODE_START(1, bl);
+  ::decode(all, bl);
+  ::decode(extents, bl);
+  DECODE_FINISH(bl);
+}
+
+void object_dirty_extents_t::dump(Formatter *f) const
+{
+  f->dump_bool("all", all);
+  f->open_array_section("extents");
+  for (auto &e : extents) {
+    f->open_object_section("extent");
+    f->dump_unsigned("offset", e.first);
+    f->dump_unsigned("length", e.second);
+    f->close_section();
+  }
+  f->close_section();
+}
+
+void object_dirty_extents_t::generate_test_instances(
+  list<object_dirty_extents_t*>& o)
+{
+  o.push_back(new object_dirty_extents_t);
+  o.push_back(new object_dirty_extents_t);
+  o.back()->clear();
+  o.push_back(new object_dirty_extents_t);
+  o.back()->clear();
+  o.back()->mark(0, 4096, 16);
+  o.back()->mark(65536, 8192, 16);
+}
+
+ostream& operator<<(ostream& out, const object_dirty_extents_t& de)
+{
+  if (de.all)
+    return out << "all";
+  interval_set<uint64_t> s;
+  de.get_extents(&s);
+  return out << s;
+}
+
 // -- pg_log_entry_t --
 
 string pg_log_entry_t::get_key_name() const
@@ -3957,7 +4009,7 @@ void pg_log_entry_t::decode_with_checksum(bufferlist::iterator& p)
 
 void pg_log_entry_t::encode(bufferlist &bl) const
 {
-  ENCODE_START(11, 4, bl);
+  ENCODE_START(12, 4, bl);
   ::encode(op, bl);
   ::encode(soid, bl);
   ::encode(version, bl);
@@ -3984,12 +4036,13 @@ void pg_log_entry_t::encode(bufferlist &bl) const
   ::encode(extra_reqids, bl);
   if (op == ERROR)
     ::encode(return_code, bl);
+  ::encode(dirty_extents, bl);
   ENCODE_FINISH(bl);
 }
 
 void pg_log_entry_t::decode(bufferlist::iterator &bl)
 {
-  DECODE_START_LEGACY_COMPAT_LEN(11, 4, 4, bl);
+  DECODE_START_LEGACY_COMPAT_LEN(12, 4, 4, bl);
   ::decode(op, bl);
   if (struct_v < 2) {
     sobject_t old_soid;
@@ -4043,6 +4096,10 @@ void pg_log_entry_t::decode(bufferlist::iterator &bl)
     ::decode(extra_reqids, bl);
   if (struct_v >= 11 && op == ERROR)
     ::decode(return_code, bl);
+  if (struct_v >= 12)
+    ::decode(dirty_extents, bl);
+  else
+    dirty_extents.mark_all();
   DECODE_FINISH(bl);
 }
 
@@ -4084,6 +4141,11 @@ void pg_log_entry_t::dump(Formatter *f) const
     mod_desc.dump(f);
     f->close_section();
   }
+  {
+    f->open_object_section("dirty_extents");
+    dirty_extents.dump(f);
+    f->close_section();
+  }
 }
 
 void pg_log_entry_t::generate_test_instances(list<pg_log_entry_t*>& o)
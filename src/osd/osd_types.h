@@ -3273,6 +3273,76 @@ public:
 };
 WRITE_CLASS_ENCODER(ObjectModDesc)
 
+/**
+ * object_dirty_extents_t - object data ranges modified by a log entry
+ *
+ * Lets recovery push only the modified ranges to a peer that holds an
+ * older version of the object.  The set is bounded: an operation whose
+ * effect on the data is not a plain set of ranges, or too many ranges,
+ * marks the whole object dirty.  Entries decoded from older encodings
+ * are whole-object dirty.
+ *
+ * Every pg log entry carries one of these, so the ranges are kept as a
+ * flat, mempool-accounted vector rather than an interval_set; the
+ * encoding is the same as interval_set's.
+ */
+struct object_dirty_extents_t {
+  /// disjoint, non-adjacent (offset, length) pairs in offset order
+  mempool::osd_pglog::vector<pair<uint64_t, uint64_t> > extents;
+  bool all = true;   ///< entire object is (or may be) dirty
+
+  void clear() {
+    extents.clear();
+    all = false;
+  }
+  void mark_all() {
+    extents.clear();
+    all = true;
+  }
+  void get_extents(interval_set<uint64_t> *s) const {
+    for (auto &e : extents)
+      s->insert(e.first, e.second);
+  }
+  void mark(uint64_t off, uint64_t len, unsigned max_intervals) {
+    if (all || !len)
+      return;
+    interval_set<uint64_t> s;
+    get_extents(&s);
+    s.union_insert(off, len);
+    set_extents(s, max_intervals);
+  }
+  void merge(const object_dirty_extents_t &o, unsigned max_intervals) {
+    if (all)
+      return;
+    if (o.all) {
+      mark_all();
+      return;
+    }
+    interval_set<uint64_t> s, os;
+    get_extents(&s);
+    o.get_extents(&os);
+    s.union_of(os);
+    set_extents(s, max_intervals);
+  }
+  void set_extents(const interval_set<uint64_t> &s, unsigned max_intervals) {
+    if (s.num_intervals() > max_intervals) {
+      mark_all();
+      return;
+    }
+    extents.clear();
+    extents.reserve(s.num_intervals());
+    for (auto p = s.begin(); p != s.end(); ++p)
+      extents.push_back(make_pair(p.get_start(), p.get_len()));
+  }
+
+  void encode(bufferlist &bl) const;
+  void decode(bufferlist::iterator &bl);
+  void dump(Formatter *f) const;
+  static void generate_test_instances(list<object_dirty_extents_t*>& o);
+};
+WRITE_CLASS_ENCODER(object_dirty_extents_t)
+ostream& operator<<(ostream& out, const object_dirty_extents_t& de);
+
 
 /**
  * pg_log_entry_t - single entry/event in pg log
@@ -3323,6 +3393,8 @@ struct pg_log_entry_t {
 
   // describes state for a locally-rollbackable entry
   ObjectModDesc mod_desc;
+  // data ranges modified, for delta recovery of MODIFY entries
+  object_dirty_extents_t dirty_extents;
   bufferlist snaps;   // only for clone entries
   hobject_t  soid;
   osd_reqid_t reqid;  // caller+tid to uniquely identify request
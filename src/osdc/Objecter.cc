@@ -133,6 +133,8 @@ enum {
   l_osdc_map_epoch,
   l_osdc_map_full,
   l_osdc_map_inc,
+  l_osdc_placement_cache_hit,
+  l_osdc_placement_cache_miss,
 
   l_osdc_osd_sessions,
   l_osdc_osd_session_open,
@@ -349,6 +351,10 @@ void Objecter::init()
 			"Full OSD maps received");
     pcb.add_u64_counter(l_osdc_map_inc, "map_inc",
 			"Incremental OSD maps received");
+    pcb.add_u64_counter(l_osdc_placement_cache_hit, "placement_cache_hit",
+			"PG mappings found in the placement cache");
+    pcb.add_u64_counter(l_osdc_placement_cache_miss, "placement_cache_miss",
+			"PG mappings computed");
 
     pcb.add_u64(l_osdc_osd_sessions, "osd_sessions",
 		"Open sessions");  // open sessions
@@ -1181,6 +1187,8 @@ void Objecter::handle_osd_map(MOSDMap *m)
 	  ldout(cct, 3) << "handle_osd_map decoding incremental epoch " << e
 			<< dendl;
 	  OSDMap::Incremental inc(m->incremental_maps[e]);
+	  if (use_placement_cache)
+	    placement_cache.invalidate(*osdmap, inc);
 	  osdmap->apply_incremental(inc);
 
           emit_blacklist_events(inc);
@@ -2818,8 +2826,15 @@ int Objecter::_calc_target(op_target_t *t, Connection *con, bool any_change)
   unsigned pg_num = pi->get_pg_num();
   int up_primary, acting_primary;
   vector<int> up, acting;
-  osdmap->pg_to_up_acting_osds(pgid, &up, &up_primary,
-			       &acting, &acting_primary);
+  if (!use_placement_cache) {
+    osdmap->pg_to_up_acting_osds(pgid, &up, &up_primary,
+				 &acting, &acting_primary);
+  } else if (placement_cache.get(*osdmap, pgid, &up, &up_primary,
+				 &acting, &acting_primary)) {
+    logger->inc(l_osdc_placement_cache_hit);
+  } else {
+    logger->inc(l_osdc_placement_cache_miss);
+  }
   bool sort_bitwise = osdmap->test_flag(CEPH_OSDMAP_SORTBITWISE);
   bool recovery_deletes = osdmap->test_flag(CEPH_OSDMAP_RECOVERY_DELETES);
   unsigned prev_seed = ceph_stable_mod(pgid.ps(), t->pg_num, t->pg_num_mask);
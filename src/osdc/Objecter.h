@@ -39,6 +39,7 @@
 
 #include "messages/MOSDOp.h"
 #include "osd/OSDMap.h"
+#include "osd/OSDMapMapping.h"
 
 using namespace std;
 
@@ -1188,6 +1189,8 @@ public:
   ZTracer::Endpoint trace_endpoint;
 private:
   OSDMap    *osdmap;
+  OSDMapPlacementCache placement_cache;
+  bool use_placement_cache;
 public:
   using Dispatcher::cct;
   std::multimap<string,string> crush_location;
@@ -1998,6 +2001,7 @@ private:
     Dispatcher(cct_), messenger(m), monc(mc), finisher(fin),
     trace_endpoint("0.0.0.0", 0, "Objecter"),
     osdmap(new OSDMap),
+    use_placement_cache(cct_->_conf->objecter_placement_cache),
     max_linger_id(0),
     keep_balanced_budget(false), honor_osdmap_full(true), osdmap_full_try(false),
     blacklist_events_enabled(false),
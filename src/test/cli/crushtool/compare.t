@@ -0,0 +1,33 @@
+  $ crushtool -c $TESTDIR/straw2.txt -o straw2
+  $ crushtool -i straw2 --compare straw2 --num-rep 1 --min-x 0 --max-x 99 --num-threads 3 --show-utilization-all
+  rule 0 (replicated_ruleset) num_rep 1: 0/100 mappings changed (0), 0/100 replicas moved (0)
+    device 0:	 before 100	 after 100	 in 0	 out 0
+  $ crushtool -i straw2 --compare straw2 --rule 1
+  crushtool: no rule to compare
+  [1]
+  $ crushtool -i straw2 --compare straw2 --min-x 10 --max-x 9
+  no input to compare: min_x 10 > max_x 9
+  [1]
+  $ rm straw2
+  $ crushtool -c $TESTDIR/compare.txt -o compare
+  $ crushtool -i compare --reweight-item device3 2.0 -o reweighted --compare compare --num-rep 3 --min-x 0 --max-x 999 --show-utilization
+  crushtool reweighting item device3 to 2
+  rule 0 (replicated_rule) num_rep 3: 333/1000 mappings changed (0.333), 366/3000 replicas moved (0.122)
+    device 0:	 before 377	 after 392	 in 32	 out 17
+    device 1:	 before 332	 after 338	 in 25	 out 19
+    device 2:	 before 269	 after 353	 in 136	 out 52
+    device 3:	 before 579	 after 403	 in 20	 out 196
+    device 4:	 before 387	 after 386	 in 27	 out 28
+    device 5:	 before 345	 after 371	 in 43	 out 17
+    device 6:	 before 345	 after 367	 in 38	 out 16
+    device 7:	 before 366	 after 390	 in 45	 out 21
+  rule 1 (erasure_rule) num_rep 3: 361/1000 mappings changed (0.361), 522/3000 replicas moved (0.174)
+    device 0:	 before 380	 after 397	 in 57	 out 40
+    device 1:	 before 352	 after 350	 in 35	 out 37
+    device 2:	 before 247	 after 359	 in 174	 out 62
+    device 3:	 before 574	 after 379	 in 48	 out 243
+    device 4:	 before 363	 after 374	 in 56	 out 45
+    device 5:	 before 370	 after 381	 in 44	 out 33
+    device 6:	 before 375	 after 398	 in 58	 out 35
+    device 7:	 before 339	 after 362	 in 50	 out 27
+  $ rm compare reweighted
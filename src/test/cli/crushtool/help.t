@@ -91,6 +91,15 @@
         [--simulate]       simulate placements using a random
                            number generator in place of the CRUSH
                            algorithm
+        [--benchmark]      time mapping the inputs one at a time
+                           against mapping them in one batch
+     -i mapfn --compare mapfn2
+                           compare the mappings of mapfn, after any
+                           modifications, with those of mapfn2 and
+                           report the data movement per rule (and per
+                           device with --show-utilization[-all]); takes
+                           the --test input, rule and num-rep options
+        [--num-threads n]  map with n threads (default: one per cpu)
      --show-utilization    show OSD usage
      --show-utilization-all
                            include zero weight items
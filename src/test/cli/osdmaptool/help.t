@@ -22,4 +22,16 @@
                              max deviation from target [default: .01]
      --upmap-pool <poolname> restrict upmap balancing to 1 or more pools
      --upmap-save            write modified OSDMap with upmap changes
+     --weight-set <file>     calculate crush weight-set weights to balance pg
+                             layout, writing commands to <file> [default: - for stdout]
+     --weight-set-mode <compat|per-pool>
+                             one weight-set for all pools or one per pool [default: compat]
+     --weight-set-max-moved <max-count>
+                             max pgs to move [default: 0, no limit]
+     --weight-set-iterations <count>
+                             max iterations to run [default: 100]
+     --weight-set-deviation <max-deviation>
+                             ratio of misplaced pgs to stop at [default: .01]
+     --weight-set-pool <poolname> restrict weight-set balancing to 1 or more pools
+     --weight-set-save       write modified OSDMap with weight-set changes
   [1]
@@ -0,0 +1,127 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t -*-
+// vim: ts=8 sw=2 smarttab
+/*
+ * Ceph - scalable distributed file system
+ *
+ * This is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License version 2.1, as published by the Free Software
+ * Foundation.  See file COPYING.
+ *
+ */
+
+#include <gtest/gtest.h>
+
+#include "common/AlignedBufferPool.h"
+#include "include/mempool.h"
+
+TEST(AlignedBufferPool, Layout) {
+  AlignedBufferPool pool(4096, 1 << 20);
+
+  // aligned offset, whole blocks: a single aligned segment
+  {
+    bufferlist bl;
+    pool.alloc(8192, 0, &bl);
+    ASSERT_EQ(8192u, bl.length());
+    ASSERT_EQ(1u, bl.buffers().size());
+    ASSERT_TRUE(bl.is_aligned(4096));
+    ASSERT_TRUE(bl.is_n_align_sized(4096));
+  }
+
+  // unaligned offset: head, aligned middle, tail
+  {
+    bufferlist bl;
+    pool.alloc(10000, 5000, &bl);
+    ASSERT_EQ(10000u, bl.length());
+    ASSERT_EQ(3u, bl.buffers().size());
+    auto p = bl.buffers().begin();
+    ASSERT_EQ(4096u - (5000 % 4096), p->length());
+    ASSERT_EQ(5000u % 4096, (uintptr_t)p->c_str() % 4096);
+    ++p;
+    ASSERT_EQ(4096u, p->length());
+    ASSERT_TRUE(p->is_aligned(4096));
+    ++p;
+    ASSERT_EQ(10000u - 4096 - (4096 - 5000 % 4096), p->length());
+    ASSERT_TRUE(p->is_aligned(4096));
+  }
+
+  // short payload within a block
+  {
+    bufferlist bl;
+    pool.alloc(100, 4000, &bl);
+    ASSERT_EQ(100u, bl.length());
+    ASSERT_EQ(2u, bl.buffers().size());
+  }
+}
+
+TEST(AlignedBufferPool, Recycle) {
+  AlignedBufferPool pool(4096, 64 << 10);
+  auto& anon = mempool::get_pool(mempool::mempool_buffer_anon);
+  size_t anon_bytes = anon.allocated_bytes();
+  const char *first;
+  {
+    bufferlist bl;
+    pool.alloc(20000, 0, &bl);
+    first = bl.buffers().front().c_str();
+    ASSERT_EQ(0u, pool.get_hits());
+    ASSERT_EQ(1u, pool.get_misses());
+  }
+  // 20000 bytes round up to a 20k class, not to 32k
+  ASSERT_EQ(20480u, pool.get_cached_bytes());
+  // idle buffers stay accounted
+  ASSERT_EQ(anon_bytes + 20480u, anon.allocated_bytes());
+  {
+    bufferlist bl;
+    pool.alloc(17000, 0, &bl);
+    ASSERT_EQ(first, bl.buffers().front().c_str());
+    ASSERT_EQ(1u, pool.get_hits());
+    ASSERT_EQ(0u, pool.get_cached_bytes());
+  }
+  ASSERT_EQ(anon_bytes + 20480u, anon.allocated_bytes());
+  {
+    // the next class up does not reuse it
+    bufferlist bl;
+    pool.alloc(30000, 0, &bl);
+    ASSERT_NE(first, bl.buffers().front().c_str());
+    ASSERT_EQ(2u, pool.get_misses());
+  }
+  ASSERT_EQ(20480u + 32768u, pool.get_cached_bytes());
+
+  // nothing beyond max_cached is kept
+  {
+    bufferlist a, b, c;
+    pool.alloc(4096, 0, &a);
+    pool.alloc(8192, 0, &b);
+    pool.alloc(8192, 0, &c);
+  }
+  ASSERT_EQ(65536u, pool.get_cached_bytes());
+}
+
+TEST(AlignedBufferPool, SizeClasses) {
+  AlignedBufferPool pool(4096, 0);
+  auto size_of = [&pool](unsigned len) {
+    bufferlist bl;
+    pool.alloc(len, 0, &bl);
+    return bl.buffers().front().raw_length();
+  };
+  // whole blocks up to 16k
+  ASSERT_EQ(4096u, size_of(1));
+  ASSERT_EQ(12288u, size_of(8193));
+  ASSERT_EQ(16384u, size_of(16384));
+  // then a quarter of the power of two
+  ASSERT_EQ(20480u, size_of(16385));
+  ASSERT_EQ(28672u, size_of(28000));
+  ASSERT_EQ(32768u, size_of(30000));
+  ASSERT_EQ(327680u, size_of(300000));
+  ASSERT_EQ(4u << 20, size_of(4u << 20));
+}
+
+TEST(AlignedBufferPool, OutlivesPool) {
+  bufferlist bl;
+  {
+    AlignedBufferPool pool(4096, 1 << 20);
+    pool.alloc(4096, 0, &bl);
+  }
+  memset(bl.c_str(), 0xaa, bl.length());
+  bl.clear();
+}
@@ -14,8 +14,15 @@
 
 #include "include/stringify.h"
 
+#include "arch/intel.h"
+#include "arch/probe.h"
 #include "crush/CrushWrapper.h"
 #include "osd/osd_types.h"
+#ifdef HAVE_INTEL_AVX2
+extern "C" {
+#include "crush/mapper_avx2.h"
+}
+#endif
 
 #include <set>
 
@@ -637,3 +644,147 @@ TEST(CRUSH, straw2_reweight) {
     cout << "     vs " << estddev << std::endl;
   }
 }
+
+TEST(CRUSH, do_rule_batch) {
+  // buckets bigger and smaller than a group of simd lanes, with zero
+  // weight items in and out of the groups
+  int weights[] = {
+    0x10000, 0x20000, 0, 0x30000, 0x10000, 0x8000, 0x10000, 0x20000,
+    0x10000, 0, 0x50000, 0x10000, 0x10000, 0x20000, 0x10000, 0x10000,
+    0x20000, 0x10000, 0x30000
+  };
+  int n = sizeof(weights) / sizeof(weights[0]);
+
+  std::unique_ptr<CrushWrapper> c(new CrushWrapper);
+  const int ROOT_TYPE = 2;
+  c->set_type_name(ROOT_TYPE, "root");
+  const int HOST_TYPE = 1;
+  c->set_type_name(HOST_TYPE, "host");
+  const int OSD_TYPE = 0;
+  c->set_type_name(OSD_TYPE, "osd");
+
+  int items[n];
+  for (int i=0; i <n; ++i)
+    items[i] = i;
+  c->set_max_devices(n);
+
+  for (int size : { 5, n }) {
+    string root_name = string("root") + stringify(size);
+    int root;
+    crush_bucket *b = crush_make_bucket(c->get_crush_map(),
+					CRUSH_BUCKET_STRAW2,
+					CRUSH_HASH_RJENKINS1,
+					ROOT_TYPE, size, items, weights);
+    EXPECT_EQ(0, crush_add_bucket(c->get_crush_map(), 0, b, &root));
+    EXPECT_EQ(0, c->set_item_name(root, root_name));
+    EXPECT_LE(0, c->add_simple_rule(string("rule") + stringify(size),
+				    root_name, "osd", "",
+				    "firstn", pg_pool_t::TYPE_REPLICATED));
+  }
+  c->finalize();
+
+  vector<unsigned> reweight(n, 0x10000);
+  reweight[4] = 0x8000;
+  reweight[11] = 0;
+
+  vector<int> xs;
+  for (int x = 0; x < 10000; ++x)
+    xs.push_back(x * 2654435761u);
+  for (int rule = 0; rule < 2; ++rule) {
+    vector<vector<int>> batch;
+    c->do_rule_batch(rule, xs, &batch, 3, reweight, 0);
+    ASSERT_EQ(xs.size(), batch.size());
+    for (unsigned i = 0; i < xs.size(); ++i) {
+      vector<int> out;
+      c->do_rule(rule, xs[i], out, 3, reweight, 0);
+      ASSERT_EQ(out, batch[i]) << "rule " << rule << " x " << xs[i];
+    }
+  }
+
+  // an unknown rule maps to nothing
+  vector<vector<int>> batch;
+  c->do_rule_batch(5, xs, &batch, 3, reweight, 0);
+  ASSERT_EQ(xs.size(), batch.size());
+  ASSERT_TRUE(batch[0].empty());
+}
+
+#ifdef HAVE_INTEL_AVX2
+TEST(CRUSH, straw2_ln_avx2) {
+  ceph_arch_probe();
+  if (!ceph_arch_intel_avx2) {
+    std::cout << "SKIP: the cpu does not have avx2" << std::endl;
+    return;
+  }
+  // every 16 bit hash value
+  __u32 u[CRUSH_STRAW2_AVX2_LANES];
+  __s64 ln[CRUSH_STRAW2_AVX2_LANES];
+  for (__u32 base = 0; base <= 0xffff; base += CRUSH_STRAW2_AVX2_LANES) {
+    for (int i = 0; i < CRUSH_STRAW2_AVX2_LANES; ++i)
+      u[i] = base + i;
+    crush_straw2_ln_u_avx2(u, ln);
+    for (int i = 0; i < CRUSH_STRAW2_AVX2_LANES; ++i)
+      ASSERT_EQ(crush_straw2_ln(u[i]), ln[i]) << "u " << u[i];
+  }
+
+  // and the hash in front of it
+  __s32 ids[CRUSH_STRAW2_AVX2_LANES] = {
+    0, 1, -1, -7, 100, 12345, -100000, 0x7fffffff
+  };
+  for (__u32 x = 0; x < 10000; ++x) {
+    for (__u32 r = 0; r < 3; ++r) {
+      crush_straw2_ln_avx2(x * 2654435761u, ids, r, ln);
+      for (int i = 0; i < CRUSH_STRAW2_AVX2_LANES; ++i) {
+	__u32 h = crush_hash32_3(CRUSH_HASH_RJENKINS1, x * 2654435761u,
+				 ids[i], r);
+	ASSERT_EQ(crush_straw2_ln(h & 0xffff), ln[i])
+	  << "x " << x << " id " << ids[i] << " r " << r;
+      }
+    }
+  }
+}
+
+TEST(CRUSH, straw2_avx2_mappings) {
+  ceph_arch_probe();
+  if (!ceph_arch_intel_avx2) {
+    std::cout << "SKIP: the cpu does not have avx2" << std::endl;
+    return;
+  }
+  // 19 items: two groups of simd lanes and a scalar tail
+  int weights[] = {
+    0x10000, 0x20000, 0, 0x30000, 0x10000, 0x8000, 0x10000, 0x20000,
+    0x10000, 0, 0x50000, 0x10000, 0x10000, 0x20000, 0x10000, 0x10000,
+    0x20000, 0x10000, 0x30000
+  };
+  int n = sizeof(weights) / sizeof(weights[0]);
+
+  std::unique_ptr<CrushWrapper> c(new CrushWrapper);
+  c->set_type_name(1, "root");
+  c->set_type_name(0, "osd");
+  int items[n];
+  for (int i = 0; i < n; ++i)
+    items[i] = i;
+  c->set_max_devices(n);
+  int root;
+  crush_bucket *b = crush_make_bucket(c->get_crush_map(),
+				      CRUSH_BUCKET_STRAW2,
+				      CRUSH_HASH_RJENKINS1,
+				      1, n, items, weights);
+  EXPECT_EQ(0, crush_add_bucket(c->get_crush_map(), 0, b, &root));
+  EXPECT_EQ(0, c->set_item_name(root, "root"));
+  int rule = c->add_simple_rule("rule", "root", "osd", "", "indep",
+				pg_pool_t::TYPE_ERASURE);
+  EXPECT_LE(0, rule);
+  c->finalize();
+
+  vector<unsigned> reweight(n, 0x10000);
+  reweight[4] = 0x8000;
+  for (int x = 0; x < 100000; ++x) {
+    vector<int> simd, scalar;
+    c->do_rule(rule, x, simd, 6, reweight, 0);
+    ceph_arch_intel_avx2 = 0;
+    c->do_rule(rule, x, scalar, 6, reweight, 0);
+    ceph_arch_intel_avx2 = 1;
+    ASSERT_EQ(scalar, simd) << "x " << x;
+  }
+}
+#endif
@@ -71,6 +71,7 @@ TYPE_FEATUREFUL(pool_stat_t)
 TYPE(pg_history_t)
 TYPE(pg_info_t)
 TYPE_FEATUREFUL(pg_query_t)
+TYPE(object_dirty_extents_t)
 TYPE(pg_log_entry_t)
 TYPE(pg_log_t)
 TYPE_FEATUREFUL(pg_missing_item)
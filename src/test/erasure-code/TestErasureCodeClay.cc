@@ -0,0 +1,268 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t -*-
+// vim: ts=8 sw=2 smarttab
+/*
+ * Ceph distributed storage system
+ *
+ *  This library is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Lesser General Public
+ *  License as published by the Free Software Foundation; either
+ *  version 2.1 of the License, or (at your option) any later version.
+ *
+ */
+
+#include <errno.h>
+#include <stdlib.h>
+
+#include "include/stringify.h"
+#include "erasure-code/clay/ErasureCodeClay.h"
+#include "global/global_context.h"
+#include "common/config.h"
+#include "gtest/gtest.h"
+
+static void clay_init(ErasureCodeClay *clay, int k, int m, int d)
+{
+  ErasureCodeProfile profile;
+  profile["k"] = stringify(k);
+  profile["m"] = stringify(m);
+  profile["d"] = stringify(d);
+  ASSERT_EQ(0, clay->init(profile, &cerr));
+}
+
+static void clay_encode(ErasureCodeClay *clay, unsigned int seed,
+			map<int, bufferlist> *encoded)
+{
+  unsigned int stripe_width =
+    clay->get_data_chunk_count() * clay->get_chunk_size(1);
+  bufferlist in;
+  for (unsigned int i = 0; i < stripe_width; i++)
+    in.append((char)(rand_r(&seed) & 0xff));
+  set<int> want_to_encode;
+  for (unsigned int i = 0; i < clay->get_chunk_count(); i++)
+    want_to_encode.insert(i);
+  ASSERT_EQ(0, clay->encode(want_to_encode, in, encoded));
+  bufferlist data;
+  for (unsigned int i = 0; i < clay->get_data_chunk_count(); i++)
+    data.append((*encoded)[i]);
+  ASSERT_TRUE(data.contents_equal(in));
+}
+
+TEST(ErasureCodeClay, init)
+{
+  {
+    ErasureCodeClay clay(g_conf->get_val<std::string>("erasure_code_dir"));
+    ErasureCodeProfile profile;
+    EXPECT_EQ(0, clay.init(profile, &cerr));
+    // k=4 m=2 d=5 : q=2 t=3
+    EXPECT_EQ(5, clay.d);
+    EXPECT_EQ(2, clay.q);
+    EXPECT_EQ(3, clay.t);
+    EXPECT_EQ(0, clay.nu);
+    EXPECT_EQ(8U, clay.get_sub_chunk_count());
+  }
+  {
+    // k + m is not a multiple of q : one shortened node
+    ErasureCodeClay clay(g_conf->get_val<std::string>("erasure_code_dir"));
+    clay_init(&clay, 4, 3, 5);
+    EXPECT_EQ(2, clay.q);
+    EXPECT_EQ(1, clay.nu);
+    EXPECT_EQ(4, clay.t);
+    EXPECT_EQ(16U, clay.get_sub_chunk_count());
+  }
+  {
+    ErasureCodeClay clay(g_conf->get_val<std::string>("erasure_code_dir"));
+    ErasureCodeProfile profile;
+    profile["k"] = "4";
+    profile["m"] = "2";
+    profile["d"] = "6";
+    EXPECT_EQ(-EINVAL, clay.init(profile, &cerr));
+  }
+  {
+    ErasureCodeClay clay(g_conf->get_val<std::string>("erasure_code_dir"));
+    ErasureCodeProfile profile;
+    profile["k"] = "4";
+    profile["m"] = "2";
+    profile["d"] = "4";
+    EXPECT_EQ(-EINVAL, clay.init(profile, &cerr));
+  }
+  {
+    ErasureCodeClay clay(g_conf->get_val<std::string>("erasure_code_dir"));
+    ErasureCodeProfile profile;
+    profile["scalar_mds"] = "shec";
+    EXPECT_EQ(-EINVAL, clay.init(profile, &cerr));
+  }
+}
+
+TEST(ErasureCodeClay, get_chunk_size)
+{
+  ErasureCodeClay clay(g_conf->get_val<std::string>("erasure_code_dir"));
+  clay_init(&clay, 4, 2, 5);
+  unsigned int chunk_size = clay.get_chunk_size(1);
+  EXPECT_EQ(0U, chunk_size % clay.get_sub_chunk_count());
+  EXPECT_EQ(chunk_size, clay.get_chunk_size(chunk_size * 4));
+  EXPECT_EQ(2 * chunk_size, clay.get_chunk_size(chunk_size * 4 + 1));
+}
+
+TEST(ErasureCodeClay, encode_decode)
+{
+  const int params[][3] = {
+    { 2, 2, 3 }, { 4, 2, 5 }, { 3, 3, 5 }, { 4, 3, 5 }, { 4, 4, 6 },
+  };
+  for (unsigned int p = 0; p < sizeof(params) / sizeof(params[0]); p++) {
+    int k = params[p][0];
+    int m = params[p][1];
+    ErasureCodeClay clay(g_conf->get_val<std::string>("erasure_code_dir"));
+    clay_init(&clay, k, m, params[p][2]);
+    map<int, bufferlist> encoded;
+    clay_encode(&clay, p, &encoded);
+
+    // every combination of up to m erasures
+    for (unsigned int mask = 1; mask < (1U << (k + m)); mask++) {
+      if (__builtin_popcount(mask) > m)
+	continue;
+      set<int> want_to_read;
+      map<int, bufferlist> chunks;
+      for (int i = 0; i < k + m; i++) {
+	if (mask & (1U << i))
+	  want_to_read.insert(i);
+	else
+	  chunks[i] = encoded[i];
+      }
+      map<int, bufferlist> decoded;
+      EXPECT_EQ(0, clay.decode(want_to_read, chunks, &decoded));
+      for (set<int>::iterator i = want_to_read.begin();
+	   i != want_to_read.end();
+	   ++i) {
+	EXPECT_TRUE(decoded[*i].contents_equal(encoded[*i]))
+	  << "k=" << k << " m=" << m << " lost chunk " << *i;
+      }
+    }
+  }
+}
+
+TEST(ErasureCodeClay, minimum_to_decode_sub_chunks)
+{
+  ErasureCodeClay clay(g_conf->get_val<std::string>("erasure_code_dir"));
+  clay_init(&clay, 4, 2, 5);
+  set<int> available;
+  for (int i = 1; i < 6; i++)
+    available.insert(i);
+  {
+    // chunk 0 is node (0, 0) : the first half of the sub-chunks
+    set<int> want_to_read;
+    want_to_read.insert(0);
+    map<int, vector<pair<int, int> > > minimum;
+    EXPECT_EQ(0, clay.minimum_to_decode_sub_chunks(want_to_read,
+						    available,
+						    &minimum));
+    EXPECT_EQ(5U, minimum.size());
+    for (map<int, vector<pair<int, int> > >::iterator i = minimum.begin();
+	 i != minimum.end();
+	 ++i) {
+      EXPECT_EQ(1U, i->second.size());
+      EXPECT_EQ(make_pair(0, 4), i->second[0]);
+    }
+  }
+  {
+    // chunk 5 is node (1, 2) : every other sub-chunk
+    available.erase(5);
+    available.insert(0);
+    set<int> want_to_read;
+    want_to_read.insert(5);
+    map<int, vector<pair<int, int> > > minimum;
+    EXPECT_EQ(0, clay.minimum_to_decode_sub_chunks(want_to_read,
+						    available,
+						    &minimum));
+    EXPECT_EQ(5U, minimum.size());
+    vector<pair<int, int> > expected;
+    for (int z = 1; z < 8; z += 2)
+      expected.push_back(make_pair(z, 1));
+    EXPECT_EQ(expected, minimum[0]);
+  }
+  {
+    // fewer than d helpers : whole chunks from k of them
+    available.erase(4);
+    set<int> want_to_read;
+    want_to_read.insert(5);
+    map<int, vector<pair<int, int> > > minimum;
+    EXPECT_EQ(0, clay.minimum_to_decode_sub_chunks(want_to_read,
+						    available,
+						    &minimum));
+    EXPECT_EQ(4U, minimum.size());
+    EXPECT_EQ(make_pair(0, 8), minimum.begin()->second[0]);
+  }
+}
+
+TEST(ErasureCodeClay, repair)
+{
+  const int params[][3] = {
+    { 2, 2, 3 }, { 4, 2, 5 }, { 3, 3, 5 }, { 4, 3, 5 }, { 4, 4, 6 },
+    { 8, 4, 11 },
+  };
+  for (unsigned int p = 0; p < sizeof(params) / sizeof(params[0]); p++) {
+    int k = params[p][0];
+    int m = params[p][1];
+    int d = params[p][2];
+    ErasureCodeClay clay(g_conf->get_val<std::string>("erasure_code_dir"));
+    clay_init(&clay, k, m, d);
+    unsigned int chunk_size = clay.get_chunk_size(1);
+    unsigned int sc_size = chunk_size / clay.get_sub_chunk_count();
+
+    // two stripes are repaired in one call
+    map<int, bufferlist> stripes[2];
+    clay_encode(&clay, p, &stripes[0]);
+    clay_encode(&clay, p + 100, &stripes[1]);
+
+    for (int lost = 0; lost < k + m; lost++) {
+      set<int> want_to_read;
+      want_to_read.insert(lost);
+      set<int> available;
+      for (int i = 0; i < k + m; i++)
+	if (i != lost)
+	  available.insert(i);
+      map<int, vector<pair<int, int> > > minimum;
+      ASSERT_EQ(0, clay.minimum_to_decode_sub_chunks(want_to_read,
+						      available,
+						      &minimum));
+      ASSERT_EQ((unsigned)d, minimum.size());
+
+      map<int, bufferlist> chunks;
+      unsigned int read = 0;
+      for (map<int, vector<pair<int, int> > >::iterator i = minimum.begin();
+	   i != minimum.end();
+	   ++i) {
+	for (int s = 0; s < 2; s++) {
+	  for (vector<pair<int, int> >::iterator j = i->second.begin();
+	       j != i->second.end();
+	       ++j) {
+	    bufferlist bl;
+	    bl.substr_of(stripes[s][i->first],
+			 j->first * sc_size, j->second * sc_size);
+	    chunks[i->first].append(bl);
+	  }
+	}
+	read += chunks[i->first].length();
+      }
+      // d / q chunks are read instead of k
+      EXPECT_EQ(2 * chunk_size * d / clay.q, read);
+      EXPECT_GT(2 * chunk_size * k, read);
+
+      map<int, bufferlist> decoded;
+      EXPECT_EQ(0, clay.decode_sub_chunks(want_to_read, chunks,
+					  chunk_size, &decoded));
+      bufferlist expected;
+      expected.append(stripes[0][lost]);
+      expected.append(stripes[1][lost]);
+      EXPECT_TRUE(decoded[lost].contents_equal(expected))
+	<< "k=" << k << " m=" << m << " d=" << d << " lost chunk " << lost;
+    }
+  }
+}
+
+/*
+ * Local Variables:
+ * compile-command: "cd ../.. ;
+ *   make -j4 unittest_erasure_code_clay && valgrind --tool=memcheck \
+ *      ./unittest_erasure_code_clay \
+ *      --gtest_filter=*.* --log-to-stderr=true --debug-osd=20"
+ * End:
+ */
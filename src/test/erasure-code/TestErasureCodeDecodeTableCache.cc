@@ -0,0 +1,164 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t -*-
+// vim: ts=8 sw=2 smarttab
+/*
+ * Ceph distributed storage system
+ *
+ *  This library is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Lesser General Public
+ *  License as published by the Free Software Foundation; either
+ *  version 2.1 of the License, or (at your option) any later version.
+ *
+ */
+
+#include <thread>
+#include <vector>
+
+#include "include/stringify.h"
+#include "erasure-code/ErasureCodeDecodeTableCache.h"
+#include "gtest/gtest.h"
+
+static bufferptr make_table(const std::string &content)
+{
+  bufferptr table(buffer::create(content.size()));
+  memcpy(table.c_str(), content.c_str(), content.size());
+  return table;
+}
+
+TEST(ErasureCodeDecodeTableCache, get_put)
+{
+  ErasureCodeDecodeTableCache cache(10);
+  bufferptr table;
+  EXPECT_FALSE(cache.get("k=2 m=1 - 0", &table));
+  bufferptr cached = cache.put("k=2 m=1 - 0", make_table("first"));
+  EXPECT_EQ(0, memcmp("first", cached.c_str(), 5));
+  EXPECT_EQ(1U, cache.size());
+  EXPECT_TRUE(cache.get("k=2 m=1 - 0", &table));
+  EXPECT_EQ(cached.c_str(), table.c_str());
+
+  // the first table in wins
+  cached = cache.put("k=2 m=1 - 0", make_table("again"));
+  EXPECT_EQ(0, memcmp("first", cached.c_str(), 5));
+  EXPECT_EQ(1U, cache.size());
+
+  EXPECT_FALSE(cache.get("k=2 m=1 - 1", &table));
+}
+
+TEST(ErasureCodeDecodeTableCache, evict)
+{
+  ErasureCodeDecodeTableCache cache(4);
+  for (int i = 0; i < 4; i++)
+    cache.put(stringify(i), make_table(stringify(i)));
+  EXPECT_EQ(4U, cache.size());
+  bufferptr table;
+  // looked up since they were cached: they get a second chance
+  EXPECT_TRUE(cache.get("1", &table));
+  EXPECT_TRUE(cache.get("2", &table));
+
+  bufferptr cached = cache.put("4", make_table("4"));
+  EXPECT_EQ('4', cached.c_str()[0]);
+  EXPECT_EQ(3U, cache.size());
+  EXPECT_FALSE(cache.get("0", &table));
+  EXPECT_FALSE(cache.get("3", &table));
+  EXPECT_TRUE(cache.get("1", &table));
+  EXPECT_EQ('1', table.c_str()[0]);
+  EXPECT_TRUE(cache.get("2", &table));
+  EXPECT_EQ('2', table.c_str()[0]);
+  EXPECT_TRUE(cache.get("4", &table));
+  // still found when full
+  cached = cache.put("5", make_table("5"));
+  EXPECT_EQ(4U, cache.size());
+  cached = cache.put("1", make_table("x"));
+  EXPECT_EQ('1', cached.c_str()[0]);
+
+  // no more than half the capacity survives an eviction
+  cache.put("6", make_table("6"));
+  EXPECT_GE(3U, cache.size());
+  EXPECT_TRUE(cache.get("6", &table));
+
+  ErasureCodeDecodeTableCache none(0);
+  cached = none.put("0", make_table("0"));
+  EXPECT_EQ('0', cached.c_str()[0]);
+  EXPECT_FALSE(none.get("0", &table));
+}
+
+TEST(ErasureCodeDecodeTableCache, evict_more_than_capacity)
+{
+  const int max_tables = 10;
+  ErasureCodeDecodeTableCache cache(max_tables);
+  for (int i = 0; i < 10 * max_tables; i++)
+    cache.put(stringify(i), make_table(stringify(i)));
+  EXPECT_GE((unsigned)max_tables, cache.size());
+  // the newest tables made it in
+  bufferptr table;
+  for (int i = 9 * max_tables; i < 10 * max_tables; i++) {
+    EXPECT_TRUE(cache.get(stringify(i), &table));
+    EXPECT_EQ(stringify(i), std::string(table.c_str(), table.length()));
+  }
+  // and keep being hit when older, unused, tables are pushed out
+  for (int i = 10 * max_tables; i < 20 * max_tables; i++) {
+    cache.put(stringify(i), make_table(stringify(i)));
+    EXPECT_TRUE(cache.get(stringify(10 * max_tables - 1), &table));
+  }
+  EXPECT_TRUE(cache.get(stringify(10 * max_tables - 1), &table));
+  EXPECT_TRUE(cache.get(stringify(20 * max_tables - 1), &table));
+}
+
+TEST(ErasureCodeDecodeTableCache, for_each_erasure)
+{
+  std::vector<std::set<int> > patterns;
+  ErasureCodeDecodeTableCache::for_each_erasure(
+    5, 2,
+    [&](const std::set<int> &erasures) {
+      patterns.push_back(erasures);
+    });
+  // 5 choose 2
+  ASSERT_EQ(10U, patterns.size());
+  EXPECT_EQ(std::set<int>({0, 1}), patterns.front());
+  EXPECT_EQ(std::set<int>({3, 4}), patterns.back());
+  for (unsigned i = 0; i < patterns.size(); i++)
+    EXPECT_EQ(2U, patterns[i].size());
+
+  unsigned count = 0;
+  ErasureCodeDecodeTableCache::for_each_erasure(
+    11, 3, [&](const std::set<int> &) { count++; });
+  EXPECT_EQ(165U, count);
+
+  count = 0;
+  ErasureCodeDecodeTableCache::for_each_erasure(
+    3, 4, [&](const std::set<int> &) { count++; });
+  EXPECT_EQ(0U, count);
+}
+
+TEST(ErasureCodeDecodeTableCache, threads)
+{
+  ErasureCodeDecodeTableCache cache(100);
+  std::vector<std::thread> threads;
+  for (int t = 0; t < 4; t++) {
+    threads.push_back(std::thread([&cache, t]() {
+      for (int i = 0; i < 200; i++) {
+	std::string signature = stringify(i);
+	bufferptr table;
+	if (!cache.get(signature, &table))
+	  table = cache.put(signature, make_table(signature + "/" +
+						  stringify(t)));
+	// a table put by one of the threads
+	EXPECT_EQ(0, memcmp(signature.c_str(), table.c_str(),
+			    signature.size()));
+	EXPECT_EQ('/', table.c_str()[signature.size()]);
+      }
+    }));
+  }
+  for (auto &thread : threads)
+    thread.join();
+  // more signatures than room: the threads evicted concurrently
+  EXPECT_GE(100U, cache.size());
+}
+
+/*
+ * Local Variables:
+ * compile-command: "cd ../.. ;
+ *   make -j4 unittest_erasure_code_decode_table_cache &&
+ *   valgrind --tool=memcheck ./unittest_erasure_code_decode_table_cache \
+ *      --gtest_filter=*.* --log-to-stderr=true --debug-osd=20"
+ * End:
+ */
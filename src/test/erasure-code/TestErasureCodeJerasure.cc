@@ -129,6 +129,111 @@ TYPED_TEST(ErasureCodeTest, encode_decode)
   }
 }
 
+TYPED_TEST(ErasureCodeTest, encode_delta)
+{
+  TypeParam jerasure;
+  ErasureCodeProfile profile;
+  profile["k"] = "2";
+  profile["m"] = "2";
+  profile["packetsize"] = "8";
+  jerasure.init(profile, &cerr);
+  EXPECT_TRUE(jerasure.supports_parity_delta());
+
+  unsigned length = jerasure.get_chunk_size(LARGE_ENOUGH);
+  bufferptr old_ptr(buffer::create_page_aligned(length * 2));
+  bufferptr new_ptr(buffer::create_page_aligned(length * 2));
+  for (unsigned i = 0; i < length * 2; i++) {
+    old_ptr[i] = 'A' + i % 26;
+    // only the second data chunk changes
+    new_ptr[i] = i < length ? old_ptr[i] : (char)('z' - i % 13);
+  }
+  bufferlist old_in, new_in;
+  old_in.push_back(old_ptr);
+  new_in.push_back(new_ptr);
+
+  int want_to_encode[] = { 0, 1, 2, 3 };
+  map<int, bufferlist> old_encoded, new_encoded;
+  EXPECT_EQ(0, jerasure.encode(set<int>(want_to_encode, want_to_encode+4),
+			       old_in, &old_encoded));
+  EXPECT_EQ(0, jerasure.encode(set<int>(want_to_encode, want_to_encode+4),
+			       new_in, &new_encoded));
+
+  bufferptr d(buffer::create_page_aligned(length));
+  for (unsigned i = 0; i < length; i++)
+    d[i] = old_encoded[1][i] ^ new_encoded[1][i];
+  map<int, bufferlist> delta;
+  delta[1].push_back(d);
+  map<int, bufferlist> parity_delta;
+  EXPECT_EQ(0, jerasure.encode_delta(delta, &parity_delta));
+  EXPECT_EQ(2u, parity_delta.size());
+  for (int c = 2; c < 4; c++) {
+    EXPECT_EQ(length, parity_delta[c].length());
+    for (unsigned i = 0; i < length; i++) {
+      ASSERT_EQ((char)(old_encoded[c][i] ^ parity_delta[c][i]),
+		new_encoded[c][i]);
+    }
+  }
+}
+
+TYPED_TEST(ErasureCodeTest, encode_decode_stripes)
+{
+  TypeParam jerasure;
+  ErasureCodeProfile profile;
+  profile["k"] = "2";
+  profile["m"] = "2";
+  profile["packetsize"] = "8";
+  jerasure.init(profile, &cerr);
+
+  unsigned chunk_size = jerasure.get_chunk_size(LARGE_ENOUGH);
+  unsigned stripe_width = chunk_size * 2;
+  unsigned stripes = 3;
+  bufferptr in_ptr(buffer::create_page_aligned(stripe_width * stripes));
+  for (unsigned i = 0; i < in_ptr.length(); i++)
+    in_ptr[i] = 'A' + i % 26 + i / stripe_width;
+  bufferlist in;
+  in.push_back(in_ptr);
+
+  int want_to_encode[] = { 0, 1, 2, 3 };
+  set<int> want(want_to_encode, want_to_encode+4);
+  map<int, bufferlist> encoded;
+  EXPECT_EQ(0, jerasure.encode_stripes(want, in, chunk_size, &encoded));
+  EXPECT_EQ(4u, encoded.size());
+
+  // same as encoding one stripe at a time
+  for (unsigned s = 0; s < stripes; s++) {
+    bufferlist stripe;
+    stripe.substr_of(in, s * stripe_width, stripe_width);
+    map<int, bufferlist> stripe_encoded;
+    EXPECT_EQ(0, jerasure.encode(want, stripe, &stripe_encoded));
+    for (int c = 0; c < 4; c++) {
+      EXPECT_EQ(chunk_size * stripes, encoded[c].length());
+      EXPECT_TRUE(encoded[c].is_contiguous());
+      bufferlist chunk;
+      chunk.substr_of(encoded[c], s * chunk_size, chunk_size);
+      EXPECT_TRUE(chunk.contents_equal(stripe_encoded[c]));
+    }
+  }
+
+  // lose both data chunks and recover every stripe at once
+  map<int, bufferlist> chunks;
+  chunks[2] = encoded[2];
+  chunks[3] = encoded[3];
+  int want_to_decode[] = { 0, 1 };
+  map<int, bufferlist> decoded;
+  EXPECT_EQ(0, jerasure.decode_stripes(set<int>(want_to_decode,
+						want_to_decode+2),
+				       chunks, chunk_size, &decoded));
+  EXPECT_EQ(chunk_size * stripes, decoded[0].length());
+  EXPECT_TRUE(decoded[0].contents_equal(encoded[0]));
+  EXPECT_TRUE(decoded[1].contents_equal(encoded[1]));
+
+  // the stripes must be whole
+  bufferlist partial;
+  partial.substr_of(in, 0, stripe_width + 1);
+  map<int, bufferlist> bad;
+  EXPECT_EQ(-EINVAL, jerasure.encode_stripes(want, partial, chunk_size, &bad));
+}
+
 TYPED_TEST(ErasureCodeTest, minimum_to_decode)
 {
   TypeParam jerasure;
@@ -227,6 +332,58 @@ TYPED_TEST(ErasureCodeTest, minimum_to_decode)
   }
 }
 
+TYPED_TEST(ErasureCodeTest, minimum_to_decode_with_cost)
+{
+  TypeParam jerasure;
+  ErasureCodeProfile profile;
+  profile["k"] = "2";
+  profile["m"] = "2";
+  profile["w"] = "7";
+  profile["packetsize"] = "8";
+  jerasure.init(profile, &cerr);
+
+  set<int> want_to_read;
+  want_to_read.insert(0);
+  map<int, int> available;
+  available[1] = 5;
+  available[2] = 0;
+  available[3] = 1;
+  //
+  // Any two chunks decode, the cheapest are read.
+  //
+  {
+    set<int> minimum;
+    EXPECT_EQ(0, jerasure.minimum_to_decode_with_cost(want_to_read,
+						      available,
+						      &minimum));
+    EXPECT_EQ(2u, minimum.size());
+    EXPECT_EQ(1u, minimum.count(2));
+    EXPECT_EQ(1u, minimum.count(3));
+  }
+  //
+  // The wanted chunk is available, whatever its cost.
+  //
+  {
+    available[0] = 10;
+    set<int> minimum;
+    EXPECT_EQ(0, jerasure.minimum_to_decode_with_cost(want_to_read,
+						      available,
+						      &minimum));
+    EXPECT_EQ(want_to_read, minimum);
+  }
+  //
+  // Not enough chunks.
+  //
+  {
+    available.clear();
+    available[3] = 0;
+    set<int> minimum;
+    EXPECT_EQ(-EIO, jerasure.minimum_to_decode_with_cost(want_to_read,
+							 available,
+							 &minimum));
+  }
+}
+
 TEST(ErasureCodeTest, encode)
 {
   ErasureCodeJerasureReedSolomonVandermonde jerasure;
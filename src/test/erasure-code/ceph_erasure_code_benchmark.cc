@@ -49,7 +49,9 @@ int ErasureCodeBench::setup(int argc, char** argv) {
     ("plugin,p", po::value<string>()->default_value("jerasure"),
      "erasure code plugin name")
     ("workload,w", po::value<string>()->default_value("encode"),
-     "run either encode or decode")
+     "run encode, decode or recover. recover rebuilds the erased chunks "
+     "from the cheapest set of chunks that can decode them, like the OSD "
+     "does after a disk failure, and also reports the KB read")
     ("erasures,e", po::value<int>()->default_value(1),
      "number of erasures when decoding")
     ("erased", po::value<vector<int> >(),
@@ -61,6 +63,12 @@ int ErasureCodeBench::setup(int argc, char** argv) {
      " the first chunk, then the second etc.)")
     ("parameter,P", po::value<vector<string> >(),
      "add a parameter to the erasure code profile")
+    ("stripe-width,S", po::value<int>()->default_value(0),
+     "split the buffer in stripes of this size, rounded up to the chunk "
+     "alignment, and encode/decode them one at a time like the OSD does. "
+     "If 0 the whole buffer is a single stripe")
+    ("batch,b", "with --stripe-width, encode/decode all stripes with a "
+     "single encode_stripes/decode_stripes call")
     ;
 
   po::variables_map vm;
@@ -113,6 +121,8 @@ int ErasureCodeBench::setup(int argc, char** argv) {
   plugin = vm["plugin"].as<string>();
   workload = vm["workload"].as<string>();
   erasures = vm["erasures"].as<int>();
+  stripe_width = vm["stripe-width"].as<int>();
+  batch = vm.count("batch") > 0;
   if (vm.count("erasures-generation") > 0 &&
       vm["erasures-generation"].as<string>() == "exhaustive")
     exhaustive_erasures = true;
@@ -130,7 +140,10 @@ int ErasureCodeBench::setup(int argc, char** argv) {
   } else if ( m < 0 ) {
     cout << "parameter m is " << m << ". But m needs to be >= 0." << endl;
     return -EINVAL;
-  } 
+  } else if (stripe_width < 0) {
+    cout << "stripe-width is " << stripe_width << ". But it needs to be >= 0." << endl;
+    return -EINVAL;
+  }
 
   verbose = vm.count("verbose") > 0 ? true : false;
 
@@ -143,10 +156,83 @@ int ErasureCodeBench::run() {
 
   if (workload == "encode")
     return encode();
+  else if (workload == "recover")
+    return recover();
   else
     return decode();
 }
 
+int ErasureCodeBench::prepare_input(ErasureCodeInterfaceRef erasure_code,
+				    bufferlist *in)
+{
+  unsigned size = in_size;
+  if (stripe_width > 0) {
+    // whole stripes only, as the OSD never encodes a partial stripe
+    unsigned width = k * erasure_code->get_chunk_size(stripe_width);
+    size = std::max(1u, in_size / width) * width;
+  }
+  in->append(string(size, 'X'));
+  in->rebuild_aligned(ErasureCode::SIMD_ALIGN);
+  return size;
+}
+
+int ErasureCodeBench::encode_input(ErasureCodeInterfaceRef erasure_code,
+				   const set<int> &want_to_encode,
+				   const bufferlist &in,
+				   map<int,bufferlist> *encoded)
+{
+  if (stripe_width == 0)
+    return erasure_code->encode(want_to_encode, in, encoded);
+  unsigned chunk_size = erasure_code->get_chunk_size(stripe_width);
+  if (batch)
+    return erasure_code->encode_stripes(want_to_encode, in, chunk_size,
+					encoded);
+  unsigned width = k * chunk_size;
+  for (unsigned off = 0; off < in.length(); off += width) {
+    bufferlist stripe;
+    stripe.substr_of(in, off, width);
+    map<int,bufferlist> stripe_encoded;
+    int code = erasure_code->encode(want_to_encode, stripe, &stripe_encoded);
+    if (code)
+      return code;
+    for (map<int,bufferlist>::iterator i = stripe_encoded.begin();
+	 i != stripe_encoded.end();
+	 ++i)
+      (*encoded)[i->first].claim_append(i->second);
+  }
+  return 0;
+}
+
+int ErasureCodeBench::decode_chunks(ErasureCodeInterfaceRef erasure_code,
+				    const set<int> &want_to_read,
+				    const map<int,bufferlist> &chunks,
+				    map<int,bufferlist> *decoded)
+{
+  if (stripe_width == 0)
+    return erasure_code->decode(want_to_read, chunks, decoded);
+  unsigned chunk_size = erasure_code->get_chunk_size(stripe_width);
+  if (batch)
+    return erasure_code->decode_stripes(want_to_read, chunks, chunk_size,
+					decoded);
+  unsigned length = chunks.begin()->second.length();
+  for (unsigned off = 0; off < length; off += chunk_size) {
+    map<int,bufferlist> stripe;
+    for (map<int,bufferlist>::const_iterator i = chunks.begin();
+	 i != chunks.end();
+	 ++i)
+      stripe[i->first].substr_of(i->second, off, chunk_size);
+    map<int,bufferlist> stripe_decoded;
+    int code = erasure_code->decode(want_to_read, stripe, &stripe_decoded);
+    if (code)
+      return code;
+    for (map<int,bufferlist>::iterator i = stripe_decoded.begin();
+	 i != stripe_decoded.end();
+	 ++i)
+      (*decoded)[i->first].claim_append(i->second);
+  }
+  return 0;
+}
+
 int ErasureCodeBench::encode()
 {
   ErasureCodePluginRegistry &instance = ErasureCodePluginRegistry::instance();
@@ -170,8 +256,7 @@ int ErasureCodeBench::encode()
   }
 
   bufferlist in;
-  in.append(string(in_size, 'X'));
-  in.rebuild_aligned(ErasureCode::SIMD_ALIGN);
+  int size = prepare_input(erasure_code, &in);
   set<int> want_to_encode;
   for (int i = 0; i < k + m; i++) {
     want_to_encode.insert(i);
@@ -179,12 +264,12 @@ int ErasureCodeBench::encode()
   utime_t begin_time = ceph_clock_now();
   for (int i = 0; i < max_iterations; i++) {
     map<int,bufferlist> encoded;
-    code = erasure_code->encode(want_to_encode, in, &encoded);
+    code = encode_input(erasure_code, want_to_encode, in, &encoded);
     if (code)
       return code;
   }
   utime_t end_time = ceph_clock_now();
-  cout << (end_time - begin_time) << "\t" << (max_iterations * (in_size / 1024)) << endl;
+  cout << (end_time - begin_time) << "\t" << (max_iterations * (size / 1024)) << endl;
   return 0;
 }
 
@@ -219,7 +304,7 @@ int ErasureCodeBench::decode_erasures(const map<int,bufferlist> &all_chunks,
 	want_to_read.insert(chunk);
 
     map<int,bufferlist> decoded;
-    code = erasure_code->decode(want_to_read, chunks, &decoded);
+    code = decode_chunks(erasure_code, want_to_read, chunks, &decoded);
     if (code)
       return code;
     for (set<int>::iterator chunk = want_to_read.begin();
@@ -272,8 +357,7 @@ int ErasureCodeBench::decode()
     return -EINVAL;
   }
   bufferlist in;
-  in.append(string(in_size, 'X'));
-  in.rebuild_aligned(ErasureCode::SIMD_ALIGN);
+  int size = prepare_input(erasure_code, &in);
 
   set<int> want_to_encode;
   for (int i = 0; i < k + m; i++) {
@@ -281,7 +365,7 @@ int ErasureCodeBench::decode()
   }
 
   map<int,bufferlist> encoded;
-  code = erasure_code->encode(want_to_encode, in, &encoded);
+  code = encode_input(erasure_code, want_to_encode, in, &encoded);
   if (code)
     return code;
 
@@ -303,7 +387,7 @@ int ErasureCodeBench::decode()
 	return code;
     } else if (erased.size() > 0) {
       map<int,bufferlist> decoded;
-      code = erasure_code->decode(want_to_read, encoded, &decoded);
+      code = decode_chunks(erasure_code, want_to_read, encoded, &decoded);
       if (code)
 	return code;
     } else {
@@ -316,13 +400,86 @@ int ErasureCodeBench::decode()
 	chunks.erase(erasure);
       }
       map<int,bufferlist> decoded;
-      code = erasure_code->decode(want_to_read, chunks, &decoded);
+      code = decode_chunks(erasure_code, want_to_read, chunks, &decoded);
       if (code)
 	return code;
     }
   }
   utime_t end_time = ceph_clock_now();
-  cout << (end_time - begin_time) << "\t" << (max_iterations * (in_size / 1024)) << endl;
+  cout << (end_time - begin_time) << "\t" << (max_iterations * (size / 1024)) << endl;
+  return 0;
+}
+
+int ErasureCodeBench::recover()
+{
+  ErasureCodePluginRegistry &instance = ErasureCodePluginRegistry::instance();
+  ErasureCodeInterfaceRef erasure_code;
+  stringstream messages;
+  int code = instance.factory(plugin,
+			      g_conf->get_val<std::string>("erasure_code_dir"),
+			      profile, &erasure_code, &messages);
+  if (code) {
+    cerr << messages.str() << endl;
+    return code;
+  }
+  if (erasure_code->get_data_chunk_count() != (unsigned int)k ||
+      (erasure_code->get_chunk_count() - erasure_code->get_data_chunk_count()
+       != (unsigned int)m)) {
+    cout << "parameter k is " << k << "/m is " << m << ". But data chunk count is "
+      << erasure_code->get_data_chunk_count() <<"/parity chunk count is "
+      << erasure_code->get_chunk_count() - erasure_code->get_data_chunk_count() << endl;
+    return -EINVAL;
+  }
+  bufferlist in;
+  prepare_input(erasure_code, &in);
+
+  set<int> want_to_encode;
+  for (int i = 0; i < k + m; i++) {
+    want_to_encode.insert(i);
+  }
+  map<int,bufferlist> encoded;
+  code = encode_input(erasure_code, want_to_encode, in, &encoded);
+  if (code)
+    return code;
+
+  // the same chunks are lost for the whole run, as with a failed disk
+  set<int> lost(erased.begin(), erased.end());
+  if (lost.empty()) {
+    if (erasures > k + m) {
+      cerr << "cannot erase " << erasures << " of " << k + m << " chunks" << endl;
+      return -EINVAL;
+    }
+    while (lost.size() < (unsigned)erasures)
+      lost.insert(rand() % (k + m));
+  }
+  map<int,int> available;
+  for (int i = 0; i < k + m; i++) {
+    if (lost.count(i) == 0)
+      available[i] = 0;
+  }
+  set<int> minimum;
+  code = erasure_code->minimum_to_decode_with_cost(lost, available, &minimum);
+  if (code)
+    return code;
+  map<int,bufferlist> chunks;
+  for (set<int>::iterator i = minimum.begin(); i != minimum.end(); ++i)
+    chunks[*i] = encoded[*i];
+  if (verbose)
+    display_chunks(chunks, erasure_code->get_chunk_count());
+
+  unsigned chunk_length = encoded.begin()->second.length();
+  utime_t begin_time = ceph_clock_now();
+  for (int i = 0; i < max_iterations; i++) {
+    map<int,bufferlist> decoded;
+    code = decode_chunks(erasure_code, lost, chunks, &decoded);
+    if (code)
+      return code;
+  }
+  utime_t end_time = ceph_clock_now();
+  cout << (end_time - begin_time) << "\t"
+       << (max_iterations * (uint64_t)lost.size() * chunk_length / 1024) << "\t"
+       << (max_iterations * (uint64_t)minimum.size() * chunk_length / 1024)
+       << endl;
   return 0;
 }
 
@@ -28,6 +28,8 @@ class ErasureCodeBench {
   int erasures;
   int k;
   int m;
+  int stripe_width;
+  bool batch;
 
   string plugin;
 
@@ -42,6 +44,15 @@ class ErasureCodeBench {
 public:
   int setup(int argc, char** argv);
   int run();
+  int prepare_input(ErasureCodeInterfaceRef erasure_code, bufferlist *in);
+  int encode_input(ErasureCodeInterfaceRef erasure_code,
+		   const set<int> &want_to_encode,
+		   const bufferlist &in,
+		   map<int,bufferlist> *encoded);
+  int decode_chunks(ErasureCodeInterfaceRef erasure_code,
+		    const set<int> &want_to_read,
+		    const map<int,bufferlist> &chunks,
+		    map<int,bufferlist> *decoded);
   int decode_erasures(const map<int,bufferlist> &all_chunks,
 		      const map<int,bufferlist> &chunks,
 		      unsigned i,
@@ -49,6 +60,7 @@ public:
 		      ErasureCodeInterfaceRef erasure_code);
   int decode();
   int encode();
+  int recover();
 };
 
 #endif
@@ -40,7 +40,13 @@ class NetworkWorkerTest : public ::testing::TestWithParam<const char*> {
   NetworkWorkerTest() {}
   void SetUp() override {
     cerr << __func__ << " start set up " << GetParam() << std::endl;
-    if (strncmp(GetParam(), "dpdk", 4)) {
+    if (!strcmp(GetParam(), "rdma")) {
+      g_ceph_context->_conf->set_val("ms_type", "async+rdma", false);
+      g_ceph_context->_conf->set_val("ms_async_rdma_device_name",
+                                     getenv("CEPH_TEST_RDMA_DEVICE"), false);
+      addr = "127.0.0.1:15000";
+      port_addr = "127.0.0.1:15001";
+    } else if (strncmp(GetParam(), "dpdk", 4)) {
       g_ceph_context->_conf->set_val("ms_type", "async+posix", false);
       addr = "127.0.0.1:15000";
       port_addr = "127.0.0.1:15001";
@@ -96,6 +102,10 @@ class NetworkWorkerTest : public ::testing::TestWithParam<const char*> {
       }
     }
   };
+  void connect_pair(Worker *worker, const entity_addr_t &bind_addr,
+                    const SocketOptions &options, std::atomic_bool *accepted,
+                    ServerSocket *bind_socket, ConnectedSocket *cli_socket,
+                    ConnectedSocket *srv_socket, bool *is_my_accept);
   template<typename func>
   void exec_events(func &&f) {
     std::vector<C_dispatch<func>*> dis;
@@ -140,6 +150,58 @@ class C_poll : public EventCallback {
   }
 };
 
+// listen on the workers that can, connect from worker 0 and accept on
+// whichever worker the connection lands on; *is_my_accept tells
+// whether that is this one
+void NetworkWorkerTest::connect_pair(
+  Worker *worker, const entity_addr_t &bind_addr,
+  const SocketOptions &options, std::atomic_bool *accepted,
+  ServerSocket *bind_socket, ConnectedSocket *cli_socket,
+  ConnectedSocket *srv_socket, bool *is_my_accept)
+{
+  EventCenter *center = &worker->center;
+  ssize_t r = 0;
+  if (stack->support_local_listen_table() || worker->id == 0)
+    r = worker->listen(bind_addr, options, bind_socket);
+  ASSERT_EQ(0, r);
+
+  if (worker->id == 0) {
+    r = worker->connect(bind_addr, options, cli_socket);
+    ASSERT_EQ(0, r);
+  }
+
+  *is_my_accept = false;
+  if (*bind_socket) {
+    C_poll cb(center);
+    center->create_file_event(bind_socket->fd(), EVENT_READABLE, &cb);
+    if (cb.poll(500)) {
+      *accepted = true;
+      *is_my_accept = true;
+    }
+    ASSERT_TRUE(*accepted);
+    center->delete_file_event(bind_socket->fd(), EVENT_READABLE);
+  }
+
+  if (*is_my_accept) {
+    entity_addr_t cli_addr;
+    r = bind_socket->accept(srv_socket, options, &cli_addr, worker);
+    ASSERT_EQ(0, r);
+    ASSERT_TRUE(srv_socket->fd() > 0);
+  }
+
+  if (worker->id == 0) {
+    C_poll cb(center);
+    center->create_file_event(cli_socket->fd(), EVENT_READABLE, &cb);
+    r = cli_socket->is_connected();
+    if (r == 0) {
+      ASSERT_EQ(true, cb.poll(500));
+      r = cli_socket->is_connected();
+    }
+    ASSERT_EQ(1, r);
+    center->delete_file_event(cli_socket->fd(), EVENT_READABLE);
+  }
+}
+
 TEST_P(NetworkWorkerTest, SimpleTest) {
   entity_addr_t bind_addr;
   ASSERT_TRUE(bind_addr.parse(get_addr().c_str()));
@@ -147,50 +209,16 @@ TEST_P(NetworkWorkerTest, SimpleTest) {
   std::atomic_bool *accepted_p = &accepted;
 
   exec_events([this, accepted_p, bind_addr](Worker *worker) mutable {
-    entity_addr_t cli_addr;
     SocketOptions options;
     ServerSocket bind_socket;
+    ConnectedSocket cli_socket, srv_socket;
+    bool is_my_accept;
+    ASSERT_NO_FATAL_FAILURE(connect_pair(worker, bind_addr, options,
+                                         accepted_p, &bind_socket,
+                                         &cli_socket, &srv_socket,
+                                         &is_my_accept));
     EventCenter *center = &worker->center;
     ssize_t r = 0;
-    if (stack->support_local_listen_table() || worker->id == 0)
-      r = worker->listen(bind_addr, options, &bind_socket);
-    ASSERT_EQ(0, r);
-
-    ConnectedSocket cli_socket, srv_socket;
-    if (worker->id == 0) {
-      r = worker->connect(bind_addr, options, &cli_socket);
-      ASSERT_EQ(0, r);
-    }
-
-    bool is_my_accept = false;
-    if (bind_socket) {
-      C_poll cb(center);
-      center->create_file_event(bind_socket.fd(), EVENT_READABLE, &cb);
-      if (cb.poll(500)) {
-        *accepted_p = true;
-        is_my_accept = true;
-      }
-      ASSERT_TRUE(*accepted_p);
-      center->delete_file_event(bind_socket.fd(), EVENT_READABLE);
-    }
-
-    if (is_my_accept) {
-      r = bind_socket.accept(&srv_socket, options, &cli_addr, worker);
-      ASSERT_EQ(0, r);
-      ASSERT_TRUE(srv_socket.fd() > 0);
-    }
-
-    if (worker->id == 0) {
-      C_poll cb(center);
-      center->create_file_event(cli_socket.fd(), EVENT_READABLE, &cb);
-      r = cli_socket.is_connected();
-      if (r == 0) {
-        ASSERT_EQ(true, cb.poll(500));
-        r = cli_socket.is_connected();
-      }
-      ASSERT_EQ(1, r);
-      center->delete_file_event(cli_socket.fd(), EVENT_READABLE);
-    }
 
     const char *message = "this is a new message";
     int len = strlen(message);
@@ -244,6 +272,143 @@ TEST_P(NetworkWorkerTest, SimpleTest) {
   });
 }
 
+TEST_P(NetworkWorkerTest, ZeroCopySendTest) {
+  entity_addr_t bind_addr;
+  ASSERT_TRUE(bind_addr.parse(get_addr().c_str()));
+  std::atomic_bool accepted(false);
+  std::atomic_bool *accepted_p = &accepted;
+
+  exec_events([this, accepted_p, bind_addr](Worker *worker) mutable {
+    SocketOptions options;
+    // stacks other than posix ignore this
+    options.zerocopy_threshold = 4096;
+    ServerSocket bind_socket;
+    ConnectedSocket cli_socket, srv_socket;
+    bool is_my_accept;
+    ASSERT_NO_FATAL_FAILURE(connect_pair(worker, bind_addr, options,
+                                         accepted_p, &bind_socket,
+                                         &cli_socket, &srv_socket,
+                                         &is_my_accept));
+    ssize_t r = 0;
+
+    // a few large buffers, and small ones around them
+    const unsigned len = 1 << 20;
+    bufferlist bl;
+    bl.append("header", 6);
+    for (unsigned i = 0; i < 4; ++i) {
+      bufferptr bp(len / 4);
+      for (unsigned j = 0; j < bp.length(); ++j)
+        bp.c_str()[j] = (char)(i * 7 + j);
+      bl.append(bp);
+    }
+    bl.append("footer", 6);
+    bufferlist expected = bl;
+    expected.rebuild();
+
+    // the same worker may have to send and receive, so interleave them
+    unsigned got = 0;
+    char buf[65536];
+    while ((worker->id == 0 && bl.length()) ||
+           (is_my_accept && got < expected.length())) {
+      bool progress = false;
+      if (worker->id == 0 && bl.length()) {
+        r = cli_socket.send(bl, false);
+        ASSERT_GE(r, 0);
+        progress = r > 0;
+      }
+      if (is_my_accept && got < expected.length()) {
+        r = srv_socket.read(buf, sizeof(buf));
+        if (r == -EAGAIN) {
+          r = 0;
+        }
+        ASSERT_GE(r, 0);
+        ASSERT_LE(got + r, expected.length());
+        ASSERT_EQ(0, memcmp(buf, expected.c_str() + got, r));
+        got += r;
+        progress = progress || r > 0;
+      }
+      if (!progress)
+        usleep(100);
+    }
+    if (worker->id == 0) {
+      // whatever has completed by now is released; the rest goes with
+      // the socket
+      cli_socket.reap_send_completions();
+      cli_socket.close();
+    }
+    if (is_my_accept) {
+      bind_socket.abort_accept();
+      srv_socket.close();
+    }
+  });
+}
+
+TEST_P(NetworkWorkerTest, ZeroCopyReadTest) {
+  if (!stack->support_zero_copy_read())
+    return;
+
+  entity_addr_t bind_addr;
+  ASSERT_TRUE(bind_addr.parse(get_addr().c_str()));
+  std::atomic_bool accepted(false);
+  std::atomic_bool *accepted_p = &accepted;
+
+  exec_events([this, accepted_p, bind_addr](Worker *worker) mutable {
+    SocketOptions options;
+    ServerSocket bind_socket;
+    ConnectedSocket cli_socket, srv_socket;
+    bool is_my_accept;
+    ASSERT_NO_FATAL_FAILURE(connect_pair(worker, bind_addr, options,
+                                         accepted_p, &bind_socket,
+                                         &cli_socket, &srv_socket,
+                                         &is_my_accept));
+    ssize_t r = 0;
+
+    const unsigned len = 1 << 20;
+    bufferlist bl;
+    bufferptr bp(len);
+    for (unsigned j = 0; j < bp.length(); ++j)
+      bp.c_str()[j] = (char)(j * 13);
+    bl.append(bp);
+    bufferlist expected = bl;
+
+    // read in odd-sized pieces that never line up with the transport's
+    // own buffers, holding on to everything until the end
+    bufferlist received;
+    while ((worker->id == 0 && bl.length()) ||
+           (is_my_accept && received.length() < expected.length())) {
+      bool progress = false;
+      if (worker->id == 0 && bl.length()) {
+        r = cli_socket.send(bl, false);
+        ASSERT_GE(r, 0);
+        progress = r > 0;
+      }
+      if (is_my_accept && received.length() < expected.length()) {
+        bufferptr piece;
+        size_t want = MIN(4000, expected.length() - received.length());
+        r = srv_socket.zero_copy_read_upto(piece, want);
+        if (r == -EAGAIN) {
+          r = 0;
+        } else {
+          ASSERT_GT(r, 0);
+          ASSERT_LE((size_t)r, want);
+          ASSERT_EQ((unsigned)r, piece.length());
+          received.append(std::move(piece));
+        }
+        progress = progress || r > 0;
+      }
+      if (!progress)
+        usleep(100);
+    }
+    if (worker->id == 0)
+      cli_socket.close();
+    if (is_my_accept) {
+      ASSERT_TRUE(received.contents_equal(expected));
+      bind_socket.abort_accept();
+      srv_socket.close();
+    }
+  });
+}
+
 TEST_P(NetworkWorkerTest, ConnectFailedTest) {
   entity_addr_t bind_addr;
   ASSERT_TRUE(bind_addr.parse(get_addr().c_str()));
@@ -1034,15 +1199,27 @@ TEST_P(NetworkWorkerTest, StressTest) {
 }
 
 
+static std::vector<const char*> get_test_stacks()
+{
+  std::vector<const char*> stacks;
+#ifdef HAVE_DPDK
+  stacks.push_back("dpdk");
+#endif
+#ifdef HAVE_RDMA
+  // needs a device, but soft-RoCE will do, e.g.
+  //   rdma link add rxe0 type rxe netdev eth0
+  //   CEPH_TEST_RDMA_DEVICE=rxe0 ceph_test_async_networkstack
+  if (getenv("CEPH_TEST_RDMA_DEVICE"))
+    stacks.push_back("rdma");
+#endif
+  stacks.push_back("posix");
+  return stacks;
+}
+
 INSTANTIATE_TEST_CASE_P(
   NetworkStack,
   NetworkWorkerTest,
-  ::testing::Values(
-#ifdef HAVE_DPDK
-    "dpdk",
-#endif
-    "posix"
-  )
+  ::testing::ValuesIn(get_test_stacks())
 );
 
 #else
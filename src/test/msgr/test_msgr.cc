@@ -19,6 +19,7 @@
 #include <unistd.h>
 #include <stdlib.h>
 #include <time.h>
+#include "acconfig.h"
 #include "common/Mutex.h"
 #include "common/Cond.h"
 #include "common/ceph_argparse.h"
@@ -98,11 +99,17 @@ class FakeDispatcher : public Dispatcher {
   bool got_remote_reset;
   bool got_connect;
   bool loopback;
+  bool zero_copy_rx;     ///< accept data in the transport's receive buffers
+  bufferlist last_data;  ///< data of the last message dispatched
 
   explicit FakeDispatcher(bool s): Dispatcher(g_ceph_context), lock("FakeDispatcher::lock"),
                           is_server(s), got_new(false), got_remote_reset(false),
-                          got_connect(false), loopback(false) {}
+                          got_connect(false), loopback(false), zero_copy_rx(false) {}
   bool ms_can_fast_dispatch_any() const override { return true; }
+  bool ms_can_zero_copy_rx(Connection *con,
+			   const ceph_msg_header& header) override {
+    return zero_copy_rx;
+  }
   bool ms_can_fast_dispatch(const Message *m) const override {
     switch (m->get_type()) {
     case CEPH_MSG_PING:
@@ -148,6 +155,7 @@ class FakeDispatcher : public Dispatcher {
     }
     Mutex::Locker l(lock);
     got_new = true;
+    last_data = m->get_data();
     cond.Signal();
     m->put();
     return true;
@@ -195,9 +203,11 @@ class FakeDispatcher : public Dispatcher {
     } else if (loopback) {
       assert(m->get_source().is_client());
     }
+    bufferlist data = m->get_data();
     m->put();
     Mutex::Locker l(lock);
     got_new = true;
+    last_data.claim(data);
     cond.Signal();
   }
 
@@ -291,6 +301,127 @@ TEST_P(MessengerTest, SimpleTest) {
   server_msgr->wait();
 }
 
+// data whose crc is cached in the buffer but stale, as if it was
+// corrupted after the crc was taken: the sender uses the cached crc, so
+// the footer does not match the data that arrives
+static bufferlist get_stale_crc_data()
+{
+  bufferlist bl;
+  bl.append(buffer::create_page_aligned(256 << 10));
+  bl.zero();
+  bl.crc32c(0);
+  bl.c_str()[1000] ^= 1;
+  return bl;
+}
+
+TEST_P(MessengerTest, DataCrcTest) {
+  FakeDispatcher cli_dispatcher(false), srv_dispatcher(true);
+  entity_addr_t bind_addr;
+  bind_addr.parse("127.0.0.1");
+  server_msgr->bind(bind_addr);
+  server_msgr->add_dispatcher_head(&srv_dispatcher);
+  server_msgr->start();
+
+  client_msgr->add_dispatcher_head(&cli_dispatcher);
+  client_msgr->start();
+
+  // 1. intact data arrives with its crc cached per buffer
+  ConnectionRef conn = client_msgr->get_connection(server_msgr->get_myinst());
+  {
+    bufferlist bl;
+    bl.append(buffer::create_page_aligned(256 << 10));
+    bl.zero();
+    MPing *m = new MPing();
+    m->set_data(bl);
+    ASSERT_EQ(conn->send_message(m), 0);
+    Mutex::Locker l(cli_dispatcher.lock);
+    while (!cli_dispatcher.got_new)
+      cli_dispatcher.cond.Wait(cli_dispatcher.lock);
+    cli_dispatcher.got_new = false;
+  }
+  {
+    Mutex::Locker l(srv_dispatcher.lock);
+    ASSERT_EQ(256u << 10, srv_dispatcher.last_data.length());
+    buffer::track_cached_crc(true);
+    int cached = buffer::get_cached_crc();
+    int missed = buffer::get_missed_crc();
+    srv_dispatcher.last_data.crc32c(0);
+    ASSERT_EQ(missed, buffer::get_missed_crc());
+    ASSERT_EQ(cached + (int)srv_dispatcher.last_data.get_num_buffers(),
+	      buffer::get_cached_crc());
+    buffer::track_cached_crc(false);
+  }
+
+  // 2. a bad data crc fails the connection and the message is dropped
+  srv_dispatcher.got_new = false;
+  {
+    MPing *m = new MPing();
+    m->set_data(get_stale_crc_data());
+    ASSERT_EQ(conn->send_message(m), 0);
+  }
+  CHECK_AND_WAIT_TRUE(!conn->is_connected());
+  ASSERT_FALSE(conn->is_connected());
+  client_msgr->shutdown();
+  client_msgr->wait();
+  server_msgr->shutdown();
+  server_msgr->wait();
+  ASSERT_FALSE(srv_dispatcher.got_new);
+  ASSERT_FALSE(cli_dispatcher.got_new);
+
+  // 3. peers on trusted networks are sent no data crc, and do not check it
+  g_ceph_context->_conf->set_val("ms_crc_data_trusted_networks",
+				 "127.0.0.0/8");
+  Messenger *trusted_server = Messenger::create(
+    g_ceph_context, string(GetParam()), entity_name_t::OSD(0), "server",
+    getpid(), 0);
+  Messenger *trusted_client = Messenger::create(
+    g_ceph_context, string(GetParam()), entity_name_t::CLIENT(-1), "client",
+    getpid(), 0);
+  g_ceph_context->_conf->set_val("ms_crc_data_trusted_networks", "");
+  trusted_server->set_default_policy(Messenger::Policy::stateless_server(0));
+  trusted_client->set_default_policy(Messenger::Policy::lossy_client(0));
+
+  entity_addr_t addr;
+  addr.parse("10.0.0.1:6800");
+  ASSERT_TRUE(trusted_client->get_send_crc_flags(addr) & MSG_CRC_DATA);
+  addr.parse("127.0.0.1:6800");
+  ASSERT_FALSE(trusted_client->get_send_crc_flags(addr) & MSG_CRC_DATA);
+  {
+    MPing *m = new MPing();
+    m->set_data(get_stale_crc_data());
+    m->encode(CEPH_FEATURES_ALL, trusted_client->get_send_crc_flags(addr));
+    ASSERT_TRUE(m->get_footer().flags & CEPH_MSG_FOOTER_NOCRC);
+    m->put();
+  }
+
+  srv_dispatcher.last_data.clear();
+  trusted_server->bind(bind_addr);
+  trusted_server->add_dispatcher_head(&srv_dispatcher);
+  trusted_server->start();
+  trusted_client->add_dispatcher_head(&cli_dispatcher);
+  trusted_client->start();
+  conn = trusted_client->get_connection(trusted_server->get_myinst());
+  {
+    MPing *m = new MPing();
+    m->set_data(get_stale_crc_data());
+    ASSERT_EQ(conn->send_message(m), 0);
+    Mutex::Locker l(cli_dispatcher.lock);
+    while (!cli_dispatcher.got_new)
+      cli_dispatcher.cond.Wait(cli_dispatcher.lock);
+    cli_dispatcher.got_new = false;
+  }
+  {
+    Mutex::Locker l(srv_dispatcher.lock);
+    ASSERT_EQ(1, srv_dispatcher.last_data[1000]);
+  }
+  trusted_client->shutdown();
+  trusted_client->wait();
+  trusted_server->shutdown();
+  trusted_server->wait();
+  delete trusted_client;
+  delete trusted_server;
+}
+
 TEST_P(MessengerTest, NameAddrTest) {
   FakeDispatcher cli_dispatcher(false), srv_dispatcher(true);
   entity_addr_t bind_addr;
@@ -767,6 +898,136 @@ TEST_P(MessengerTest, MessageTest) {
 }
 
 
+// checks that the messages of a burst arrive in the order they were sent
+class BatchDispatcher : public Dispatcher {
+ public:
+  Mutex lock;
+  Cond cond;
+  bool reply;         ///< echo each message back to its sender
+  uint64_t received;  ///< index of the next message expected
+  uint64_t out_of_order;
+
+  explicit BatchDispatcher(bool r): Dispatcher(g_ceph_context),
+                                    lock("BatchDispatcher::lock"), reply(r),
+                                    received(0), out_of_order(0) {}
+  bool ms_can_fast_dispatch_any() const override { return true; }
+  bool ms_can_fast_dispatch(const Message *m) const override {
+    return m->get_type() == CEPH_MSG_PING;
+  }
+  void ms_fast_dispatch(Message *m) override {
+    uint64_t i;
+    auto p = m->get_data().begin();
+    ::decode(i, p);
+    Mutex::Locker l(lock);
+    if (i != received)
+      ++out_of_order;
+    ++received;
+    if (reply) {
+      MPing *rm = new MPing();
+      rm->set_data(m->get_data());
+      m->get_connection()->send_message(rm);
+    }
+    m->put();
+    cond.Signal();
+  }
+  bool ms_dispatch(Message *m) override {
+    ceph_abort();
+  }
+  bool ms_handle_reset(Connection *con) override {
+    return false;
+  }
+  void ms_handle_remote_reset(Connection *con) override {}
+  bool ms_handle_refused(Connection *con) override {
+    return false;
+  }
+  bool ms_verify_authorizer(Connection *con, int peer_type, int protocol,
+                            bufferlist& authorizer, bufferlist& authorizer_reply,
+                            bool& isvalid, CryptoKey& session_key) override {
+    isvalid = true;
+    return true;
+  }
+  void wait_for(uint64_t n) {
+    Mutex::Locker l(lock);
+    while (received < n)
+      cond.Wait(lock);
+  }
+};
+
+TEST_P(MessengerTest, BatchTest) {
+  BatchDispatcher cli_dispatcher(false), srv_dispatcher(false);
+  entity_addr_t bind_addr;
+  bind_addr.parse("127.0.0.1");
+  Messenger::Policy p = Messenger::Policy::stateful_server(0);
+  server_msgr->set_policy(entity_name_t::TYPE_CLIENT, p);
+  p = Messenger::Policy::lossless_peer(0);
+  client_msgr->set_policy(entity_name_t::TYPE_OSD, p);
+
+  server_msgr->bind(bind_addr);
+  server_msgr->add_dispatcher_head(&srv_dispatcher);
+  server_msgr->start();
+  client_msgr->add_dispatcher_head(&cli_dispatcher);
+  client_msgr->start();
+
+  // bursts of small messages, so that a connection has many queued when
+  // it becomes writable; with replies, each side also owes the other an
+  // ack that goes out with the batch
+  struct {
+    const char *messages;
+    const char *bytes;
+  } batches[] = {
+    { "1", "262144" },   // each message on its own
+    { "64", "262144" },  // the defaults
+    { "64", "100" },     // flushed on size, every message or two
+  };
+  const uint64_t burst = 1000;
+  ConnectionRef conn = client_msgr->get_connection(server_msgr->get_myinst());
+  uint64_t sent = 0;
+  for (auto &b : batches) {
+    g_ceph_context->_conf->set_val("ms_async_send_batch_messages", b.messages);
+    g_ceph_context->_conf->set_val("ms_async_send_batch_bytes", b.bytes);
+    g_ceph_context->_conf->apply_changes(nullptr);
+    for (auto reply : { false, true }) {
+      {
+	Mutex::Locker l(srv_dispatcher.lock);
+	srv_dispatcher.reply = reply;
+      }
+      {
+	// replies carry the index of the message they answer
+	Mutex::Locker l(cli_dispatcher.lock);
+	cli_dispatcher.received = sent;
+      }
+      for (uint64_t i = 0; i < burst; ++i, ++sent) {
+	bufferlist bl;
+	::encode(sent, bl);
+	bl.append(string(i % 50, 'x'));
+	MPing *m = new MPing();
+	m->set_data(bl);
+	ASSERT_EQ(0, conn->send_message(m));
+      }
+      srv_dispatcher.wait_for(sent);
+      {
+	Mutex::Locker l(srv_dispatcher.lock);
+	ASSERT_EQ(0u, srv_dispatcher.out_of_order)
+	  << b.messages << " messages " << b.bytes << " bytes";
+      }
+      if (reply) {
+	cli_dispatcher.wait_for(sent);
+	Mutex::Locker l(cli_dispatcher.lock);
+	ASSERT_EQ(0u, cli_dispatcher.out_of_order)
+	  << b.messages << " messages " << b.bytes << " bytes";
+      }
+    }
+  }
+
+  g_ceph_context->_conf->set_val("ms_async_send_batch_messages", "64");
+  g_ceph_context->_conf->set_val("ms_async_send_batch_bytes", "262144");
+  g_ceph_context->_conf->apply_changes(nullptr);
+  server_msgr->shutdown();
+  client_msgr->shutdown();
+  server_msgr->wait();
+  client_msgr->wait();
+}
+
 class SyntheticWorkload;
 
 struct Payload {
@@ -1503,6 +1764,85 @@ INSTANTIATE_TEST_CASE_P(
   )
 );
 
+// large message data over the async stacks; those that can read in
+// place (rdma) hand it over in their own receive buffers, but only to a
+// dispatcher that opts in, and copy it for the others
+class LargeDataMessengerTest : public MessengerTest {};
+
+TEST_P(LargeDataMessengerTest, LargeDataTest) {
+  FakeDispatcher cli_dispatcher(false), srv_dispatcher(true);
+  entity_addr_t bind_addr;
+  bind_addr.parse("127.0.0.1");
+  server_msgr->bind(bind_addr);
+  server_msgr->add_dispatcher_head(&srv_dispatcher);
+  server_msgr->start();
+
+  client_msgr->add_dispatcher_head(&cli_dispatcher);
+  client_msgr->start();
+
+  // around and well past the zero copy threshold and the size of one
+  // receive chunk (ms_async_rdma_buffer_size), so that messages span
+  // chunks and the reads stop short in the middle of the data
+  uint64_t chunk = g_ceph_context->_conf->ms_async_rdma_buffer_size;
+  uint64_t min = g_ceph_context->_conf->ms_async_zero_copy_rx_min_size;
+  vector<uint64_t> sizes = { min, chunk - 1, chunk + 1, 3 * chunk + 17,
+			     4 << 20 };
+  ConnectionRef conn = client_msgr->get_connection(server_msgr->get_myinst());
+  for (unsigned round = 0; round < 2; ++round) {
+    {
+      Mutex::Locker l(srv_dispatcher.lock);
+      srv_dispatcher.zero_copy_rx = round > 0;
+    }
+    for (auto len : sizes) {
+      bufferlist bl;
+      bufferptr bp(len);
+      for (unsigned i = 0; i < len; ++i)
+	bp.c_str()[i] = (char)(i * 31 + len);
+      bl.append(std::move(bp));
+      MPing *m = new MPing();
+      m->set_data(bl);
+      ASSERT_EQ(conn->send_message(m), 0);
+      {
+	Mutex::Locker l(cli_dispatcher.lock);
+	while (!cli_dispatcher.got_new)
+	  cli_dispatcher.cond.Wait(cli_dispatcher.lock);
+	cli_dispatcher.got_new = false;
+      }
+      Mutex::Locker l(srv_dispatcher.lock);
+      ASSERT_TRUE(srv_dispatcher.last_data.contents_equal(bl))
+	<< "round " << round << " len " << len;
+      srv_dispatcher.last_data.clear();
+    }
+  }
+  ASSERT_EQ(2 * sizes.size(),
+	    static_cast<Session*>(conn->get_priv())->get_count());
+
+  client_msgr->shutdown();
+  client_msgr->wait();
+  server_msgr->shutdown();
+  server_msgr->wait();
+}
+
+static std::vector<const char*> get_large_data_stacks()
+{
+  std::vector<const char*> stacks;
+#ifdef HAVE_RDMA
+  // needs a device, but soft-RoCE will do, e.g.
+  //   rdma link add rxe0 type rxe netdev eth0
+  //   CEPH_TEST_RDMA_DEVICE=rxe0 ceph_test_msgr
+  if (getenv("CEPH_TEST_RDMA_DEVICE"))
+    stacks.push_back("async+rdma");
+#endif
+  stacks.push_back("async+posix");
+  return stacks;
+}
+
+INSTANTIATE_TEST_CASE_P(
+  Messenger,
+  LargeDataMessengerTest,
+  ::testing::ValuesIn(get_large_data_stacks())
+);
+
 #else
 
 // Google Test may not support value-parameterized tests with some
@@ -1529,6 +1869,9 @@ int main(int argc, char **argv) {
   g_ceph_context->_conf->set_val("ms_die_on_bad_msg", "true");
   g_ceph_context->_conf->set_val("ms_die_on_old_message", "true");
   g_ceph_context->_conf->set_val("ms_max_backoff", "1");
+  if (getenv("CEPH_TEST_RDMA_DEVICE"))
+    g_ceph_context->_conf->set_val("ms_async_rdma_device_name",
+				   getenv("CEPH_TEST_RDMA_DEVICE"));
   common_init_finish(g_ceph_context);
 
   ::testing::InitGoogleTest(&argc, argv);
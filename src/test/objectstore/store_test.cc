@@ -510,6 +510,42 @@ TEST_P(StoreTest, FiemapHoles) {
   }
 }
 
+TEST_P(StoreTest, Readahead) {
+  ObjectStore::Sequencer osr("test");
+  coll_t cid;
+  int r = 0;
+  ghobject_t oid(hobject_t(sobject_t("readahead_object", CEPH_NOSNAP)));
+  ghobject_t missing(hobject_t(sobject_t("readahead_missing", CEPH_NOSNAP)));
+  bufferlist bl;
+  bl.append(string(100000, 'r'));
+  {
+    ObjectStore::Transaction t;
+    t.create_collection(cid, 0);
+    t.write(cid, oid, 0, bl.length(), bl);
+    r = apply_transaction(store, &osr, std::move(t));
+    ASSERT_EQ(r, 0);
+  }
+  // only a hint: stores that cannot act on it ignore it, and none may
+  // fail on a missing object or a range past the end
+  store->readahead(cid, oid, 0, bl.length());
+  store->readahead(cid, oid, 50000, 200000);
+  store->readahead(cid, missing, 0, 4096);
+  {
+    bufferlist got;
+    r = store->read(cid, oid, 0, bl.length(), got);
+    ASSERT_EQ(r, (int)bl.length());
+    ASSERT_TRUE(got.contents_equal(bl));
+    ASSERT_FALSE(store->exists(cid, missing));
+  }
+  {
+    ObjectStore::Transaction t;
+    t.remove(cid, oid);
+    t.remove_collection(cid);
+    r = apply_transaction(store, &osr, std::move(t));
+    ASSERT_EQ(r, 0);
+  }
+}
+
 TEST_P(StoreTest, SimpleMetaColTest) {
   ObjectStore::Sequencer osr("test");
   coll_t cid;
@@ -446,6 +446,399 @@ TEST_F(OSDMapTest, PrimaryAffinity) {
   }
 }
 
+TEST_F(OSDMapTest, IncrementalMapping) {
+  set_up_map();
+
+  ThreadPool tp(g_ceph_context, "OSDMapTest::tp", "tp_osdmap_test", 2);
+  tp.start();
+  ParallelPGMapper mapper(g_ceph_context, &tp);
+
+  // the mapping matches the map pg for pg
+  auto check_mapping = [&]() {
+    mapping.start_update(osdmap, mapper, 16)->wait();
+    ASSERT_EQ(osdmap.get_epoch(), mapping.get_epoch());
+    for (auto pool : { my_ec_pool, my_rep_pool }) {
+      for (unsigned ps = 0; ps < 64; ++ps) {
+	pg_t pgid(ps, pool);
+	vector<int> up, acting, up2, acting2;
+	int up_primary, acting_primary, up_primary2, acting_primary2;
+	osdmap.pg_to_up_acting_osds(pgid, &up, &up_primary,
+				    &acting, &acting_primary);
+	mapping.get(pgid, &up2, &up_primary2, &acting2, &acting_primary2);
+	ASSERT_EQ(up, up2) << pgid;
+	ASSERT_EQ(up_primary, up_primary2) << pgid;
+	ASSERT_EQ(acting, acting2) << pgid;
+	ASSERT_EQ(acting_primary, acting_primary2) << pgid;
+      }
+    }
+  };
+  check_mapping();
+
+  set<int> changed_osds;
+  set<pg_t> changed_pgs;
+  set<int64_t> changed_pools;
+  OSDMap prev;
+  {
+    // osd.1 goes down
+    prev.deepish_copy_from(osdmap);
+    OSDMap::Incremental inc(osdmap.get_epoch() + 1);
+    inc.new_state[1] = CEPH_OSD_UP;
+    osdmap.apply_incremental(inc);
+    ASSERT_TRUE(osdmap.get_mapping_changes(prev, &changed_osds,
+					   &changed_pgs, &changed_pools));
+    ASSERT_EQ(set<int>{1}, changed_osds);
+    ASSERT_TRUE(changed_pgs.empty());
+    ASSERT_TRUE(changed_pools.empty());
+    check_mapping();
+  }
+  {
+    // and out
+    OSDMap::Incremental inc(osdmap.get_epoch() + 1);
+    inc.new_weight[1] = CEPH_OSD_OUT;
+    osdmap.apply_incremental(inc);
+    check_mapping();
+  }
+  pg_t pgid = osdmap.raw_pg_to_pg(pg_t(0, my_rep_pool));
+  {
+    // a pg_temp and an upmap
+    vector<int> up, acting;
+    int up_primary, acting_primary;
+    osdmap.pg_to_up_acting_osds(pgid, &up, &up_primary,
+				&acting, &acting_primary);
+    int unused = -1;
+    for (unsigned i = 0; i < get_num_osds(); ++i) {
+      if (i != 1 && std::find(up.begin(), up.end(), i) == up.end()) {
+	unused = i;
+	break;
+      }
+    }
+    ASSERT_LE(0, unused);
+    prev.deepish_copy_from(osdmap);
+    OSDMap::Incremental inc(osdmap.get_epoch() + 1);
+    inc.new_pg_temp[pgid] = mempool::osdmap::vector<int>(
+      acting.rbegin(), acting.rend());
+    pg_t upmap_pgid = osdmap.raw_pg_to_pg(pg_t(1, my_rep_pool));
+    osdmap.pg_to_up_acting_osds(upmap_pgid, &up, &up_primary,
+				&acting, &acting_primary);
+    inc.new_pg_upmap_items[upmap_pgid] =
+      mempool::osdmap::vector<pair<int32_t,int32_t>>(
+	{ make_pair(up[0], unused) });
+    osdmap.apply_incremental(inc);
+    changed_osds.clear();
+    changed_pgs.clear();
+    changed_pools.clear();
+    ASSERT_TRUE(osdmap.get_mapping_changes(prev, &changed_osds,
+					   &changed_pgs, &changed_pools));
+    ASSERT_TRUE(changed_osds.empty());
+    ASSERT_EQ(set<pg_t>({pgid, upmap_pgid}), changed_pgs);
+    check_mapping();
+  }
+  {
+    // primary affinity
+    OSDMap::Incremental inc(osdmap.get_epoch() + 1);
+    inc.new_primary_affinity[2] = 0;
+    osdmap.apply_incremental(inc);
+    check_mapping();
+  }
+  {
+    // the pg_temp goes away
+    OSDMap::Incremental inc(osdmap.get_epoch() + 1);
+    inc.new_pg_temp[pgid] = mempool::osdmap::vector<int>();
+    osdmap.apply_incremental(inc);
+    check_mapping();
+  }
+  {
+    // osd.1 comes back up and in: not incremental
+    prev.deepish_copy_from(osdmap);
+    OSDMap::Incremental inc(osdmap.get_epoch() + 1);
+    inc.new_state[1] = CEPH_OSD_UP;
+    inc.new_up_client[1] = entity_addr_t();
+    inc.new_up_cluster[1] = entity_addr_t();
+    inc.new_hb_back_up[1] = entity_addr_t();
+    inc.new_hb_front_up[1] = entity_addr_t();
+    inc.new_weight[1] = CEPH_OSD_IN;
+    osdmap.apply_incremental(inc);
+    ASSERT_FALSE(osdmap.get_mapping_changes(prev, &changed_osds,
+					    &changed_pgs, &changed_pools));
+    check_mapping();
+  }
+  tp.stop();
+}
+
+TEST_F(OSDMapTest, PlacementCache) {
+  set_up_map();
+
+  OSDMapPlacementCache cache;
+  // looks every pg up, checks it against the map and counts the hits
+  auto check_cache = [&](unsigned *hits) {
+    *hits = 0;
+    for (auto pool : { my_ec_pool, my_rep_pool }) {
+      for (unsigned ps = 0; ps < 64; ++ps) {
+	pg_t pgid(ps, pool);
+	vector<int> up, acting, up2, acting2;
+	int up_primary, acting_primary, up_primary2, acting_primary2;
+	osdmap.pg_to_up_acting_osds(pgid, &up, &up_primary,
+				    &acting, &acting_primary);
+	if (cache.get(osdmap, pgid, &up2, &up_primary2,
+		      &acting2, &acting_primary2))
+	  ++*hits;
+	ASSERT_EQ(up, up2) << pgid;
+	ASSERT_EQ(up_primary, up_primary2) << pgid;
+	ASSERT_EQ(acting, acting2) << pgid;
+	ASSERT_EQ(acting_primary, acting_primary2) << pgid;
+      }
+    }
+  };
+  auto apply = [&](const OSDMap::Incremental& inc) {
+    cache.invalidate(osdmap, inc);
+    osdmap.apply_incremental(inc);
+  };
+
+  unsigned hits;
+  check_cache(&hits);
+  ASSERT_EQ(0u, hits);
+  ASSERT_EQ(128u, cache.size());
+  check_cache(&hits);
+  ASSERT_EQ(128u, hits);
+
+  // raw pgids hit the entry of their pg
+  {
+    vector<int> up, acting;
+    int up_primary, acting_primary;
+    ASSERT_TRUE(cache.get(osdmap, pg_t(64 + 3, my_rep_pool), &up,
+			  &up_primary, &acting, &acting_primary));
+  }
+  {
+    // osd.1 goes down: only its pgs are remapped
+    OSDMap::Incremental inc(osdmap.get_epoch() + 1);
+    inc.new_state[1] = CEPH_OSD_UP;
+    apply(inc);
+    check_cache(&hits);
+    ASSERT_LT(0u, hits);
+    ASSERT_GT(128u, hits);
+    check_cache(&hits);
+    ASSERT_EQ(128u, hits);
+  }
+  {
+    // and out
+    OSDMap::Incremental inc(osdmap.get_epoch() + 1);
+    inc.new_weight[1] = CEPH_OSD_OUT;
+    apply(inc);
+    check_cache(&hits);
+  }
+  {
+    // a pg_temp only drops its pg
+    pg_t pgid = osdmap.raw_pg_to_pg(pg_t(0, my_rep_pool));
+    vector<int> up, acting;
+    int up_primary, acting_primary;
+    osdmap.pg_to_up_acting_osds(pgid, &up, &up_primary,
+				&acting, &acting_primary);
+    OSDMap::Incremental inc(osdmap.get_epoch() + 1);
+    inc.new_pg_temp[pgid] = mempool::osdmap::vector<int>(
+      acting.rbegin(), acting.rend());
+    apply(inc);
+    check_cache(&hits);
+    ASSERT_EQ(127u, hits);
+  }
+  {
+    // a new pool only changes the cached epoch
+    OSDMap::Incremental inc(osdmap.get_epoch() + 1);
+    inc.new_pool_max = osdmap.get_pool_max() + 1;
+    pg_pool_t empty;
+    pg_pool_t *p = inc.get_new_pool(inc.new_pool_max, &empty);
+    p->size = 3;
+    p->set_pg_num(8);
+    p->set_pgp_num(8);
+    p->type = pg_pool_t::TYPE_REPLICATED;
+    p->crush_rule = 0;
+    inc.new_pool_names[inc.new_pool_max] = "other";
+    apply(inc);
+    check_cache(&hits);
+    ASSERT_EQ(128u, hits);
+  }
+  {
+    // osd.1 comes back up: everything may move
+    OSDMap::Incremental inc(osdmap.get_epoch() + 1);
+    inc.new_up_client[1] = entity_addr_t();
+    inc.new_up_cluster[1] = entity_addr_t();
+    inc.new_hb_back_up[1] = entity_addr_t();
+    inc.new_hb_front_up[1] = entity_addr_t();
+    inc.new_weight[1] = CEPH_OSD_IN;
+    apply(inc);
+    ASSERT_EQ(0u, cache.size());
+    check_cache(&hits);
+    ASSERT_EQ(0u, hits);
+  }
+  {
+    // a map the cache was not told about
+    OSDMap::Incremental inc(osdmap.get_epoch() + 1);
+    inc.new_primary_affinity[2] = 0;
+    osdmap.apply_incremental(inc);
+    check_cache(&hits);
+    ASSERT_EQ(0u, hits);
+  }
+}
+
+TEST_F(OSDMapTest, CalcChooseArgs) {
+  set_up_map();
+
+  // all the osds have the same weight: each should get 1/6 of the pgs
+  auto get_deviation = [&](const OSDMap& m) {
+    map<int,int> pgs;
+    int total = 0;
+    for (auto pool : { my_ec_pool, my_rep_pool }) {
+      for (unsigned ps = 0; ps < 64; ++ps) {
+	vector<int> raw;
+	m.pg_to_raw_osds(pg_t(ps, pool), &raw, nullptr);
+	for (auto osd : raw) {
+	  ++pgs[osd];
+	  ++total;
+	}
+      }
+    }
+    float deviation = 0;
+    for (unsigned osd = 0; osd < get_num_osds(); ++osd) {
+      deviation += abs(pgs[osd] - (float)total / get_num_osds());
+    }
+    return deviation / total;
+  };
+  // the number of pgs whose up set differs between the two maps
+  auto get_moved = [&](const OSDMap& a, const OSDMap& b) {
+    int moved = 0;
+    for (auto pool : { my_ec_pool, my_rep_pool }) {
+      for (unsigned ps = 0; ps < 64; ++ps) {
+	vector<int> up_a, up_b;
+	a.pg_to_up_acting_osds(pg_t(ps, pool), &up_a, nullptr, nullptr,
+			       nullptr);
+	b.pg_to_up_acting_osds(pg_t(ps, pool), &up_b, nullptr, nullptr,
+			       nullptr);
+	if (up_a != up_b) {
+	  ++moved;
+	}
+      }
+    }
+    return moved;
+  };
+  float deviation = get_deviation(osdmap);
+  ASSERT_LT(0, deviation);
+
+  {
+    // one weight-set for both pools, without bound
+    OSDMap::Incremental inc(osdmap.get_epoch() + 1);
+    map<int64_t,map<int,float>> weights;
+    int moved = osdmap.calc_choose_args(g_ceph_context, 0, 20, 0, false,
+					{}, {}, &weights, &inc);
+    ASSERT_LT(0, moved);
+    ASSERT_EQ(1u, weights.size());
+    ASSERT_EQ(get_num_osds(),
+	      weights[CrushWrapper::DEFAULT_CHOOSE_ARGS].size());
+    ASSERT_LT(0u, inc.crush.length());
+    OSDMap tmp;
+    tmp.deepish_copy_from(osdmap);
+    ASSERT_EQ(0, tmp.apply_incremental(inc));
+    ASSERT_TRUE(tmp.crush->have_choose_args(
+		  CrushWrapper::DEFAULT_CHOOSE_ARGS));
+    ASSERT_GT(deviation, get_deviation(tmp));
+    ASSERT_EQ(moved, get_moved(osdmap, tmp));
+  }
+  {
+    // one weight-set for both pools, moving at most 10 pgs.  the crush
+    // map may come back unchanged, in which case nothing moved.
+    OSDMap::Incremental inc(osdmap.get_epoch() + 1);
+    map<int64_t,map<int,float>> weights;
+    int moved = osdmap.calc_choose_args(g_ceph_context, 0, 20, 10, false,
+					{}, {}, &weights, &inc);
+    ASSERT_LE(0, moved);
+    ASSERT_GE(10, moved);
+    ASSERT_EQ(1u, weights.size());
+    OSDMap tmp;
+    tmp.deepish_copy_from(osdmap);
+    ASSERT_EQ(0, tmp.apply_incremental(inc));
+    ASSERT_GE(deviation, get_deviation(tmp));
+    ASSERT_EQ(moved, get_moved(osdmap, tmp));
+  }
+  {
+    // a weight-set per pool, without bound
+    OSDMap::Incremental inc(osdmap.get_epoch() + 1);
+    map<int64_t,map<int,float>> weights;
+    int moved = osdmap.calc_choose_args(g_ceph_context, 0, 20, 0, true,
+					{}, {}, &weights, &inc);
+    ASSERT_LT(0, moved);
+    ASSERT_EQ(2u, weights.size());
+    ASSERT_TRUE(weights.count(my_ec_pool));
+    ASSERT_TRUE(weights.count(my_rep_pool));
+    ASSERT_LT(0u, inc.crush.length());
+    OSDMap tmp;
+    tmp.deepish_copy_from(osdmap);
+    ASSERT_EQ(0, tmp.apply_incremental(inc));
+    ASSERT_TRUE(tmp.crush->have_choose_args(my_ec_pool));
+    ASSERT_TRUE(tmp.crush->have_choose_args(my_rep_pool));
+    ASSERT_GT(deviation, get_deviation(tmp));
+  }
+  {
+    map<int64_t,map<int,float>> weights;
+    OSDMap::Incremental inc(osdmap.get_epoch() + 1);
+    ASSERT_EQ(-EINVAL, osdmap.calc_choose_args(g_ceph_context, 0, 20, 0,
+					       false, { 1234 }, {},
+					       &weights, &inc));
+  }
+}
+
+TEST_F(OSDMapTest, Dedup) {
+  set_up_map();
+
+  // an identical map shares everything with the original
+  {
+    bufferlist bl;
+    osdmap.encode(bl, CEPH_FEATURES_SUPPORTED_DEFAULT | CEPH_FEATURE_RESERVED);
+    OSDMap same;
+    same.decode(bl);
+    same.inc_epoch();
+    ASSERT_EQ(7, OSDMap::dedup(&osdmap, &same));
+  }
+
+  // build the next epoch copy-on-write; a pg_temp change only touches
+  // pg_temp, and the previous epoch is left alone
+  pg_t pgid = osdmap.raw_pg_to_pg(pg_t(0, my_rep_pool, -1));
+  vector<int> up, acting;
+  int up_primary, acting_primary;
+  osdmap.pg_to_up_acting_osds(pgid, &up, &up_primary, &acting, &acting_primary);
+  vector<int> temp(acting.rbegin(), acting.rend());
+  {
+    OSDMap next;
+    next.cow_copy_from(osdmap);
+    OSDMap::Incremental inc(osdmap.get_epoch() + 1);
+    inc.new_pg_temp[pgid] = mempool::osdmap::vector<int>(temp.begin(),
+							 temp.end());
+    ASSERT_EQ(0, next.apply_incremental(inc));
+    ASSERT_EQ(6, OSDMap::dedup(&osdmap, &next));
+
+    vector<int> next_acting;
+    next.pg_to_up_acting_osds(pgid, &up, &up_primary, &next_acting,
+			      &acting_primary);
+    ASSERT_EQ(temp, next_acting);
+    vector<int> old_acting;
+    osdmap.pg_to_up_acting_osds(pgid, &up, &up_primary, &old_acting,
+				&acting_primary);
+    ASSERT_EQ(acting, old_acting);
+  }
+
+  // a pool change unshares the pools but nothing else
+  {
+    OSDMap next;
+    next.cow_copy_from(osdmap);
+    OSDMap::Incremental inc(osdmap.get_epoch() + 1);
+    unsigned size = osdmap.get_pg_pool(my_rep_pool)->get_size();
+    pg_pool_t *p = inc.get_new_pool(my_rep_pool,
+				    osdmap.get_pg_pool(my_rep_pool));
+    p->size = size + 1;
+    ASSERT_EQ(0, next.apply_incremental(inc));
+    ASSERT_EQ(6, OSDMap::dedup(&osdmap, &next));
+    ASSERT_EQ(size + 1, next.get_pg_pool(my_rep_pool)->get_size());
+    ASSERT_EQ(size, osdmap.get_pg_pool(my_rep_pool)->get_size());
+  }
+}
+
 TEST(PGTempMap, basic)
 {
   PGTempMap m;
@@ -0,0 +1,44 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t -*-
+// vim: ts=8 sw=2 smarttab
+/*
+ * Ceph - scalable distributed file system
+ *
+ * This is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License version 2.1, as published by the Free Software
+ * Foundation.  See file COPYING.
+ *
+ */
+
+#include <string>
+#include "osd/PGBackend.h"
+#include "gtest/gtest.h"
+
+// the order of the read ahead hints (h) and deep scrubs (s) of n objects
+static std::string read_ahead_order(size_t n, uint64_t window)
+{
+  std::string out;
+  PGBackend::for_each_read_ahead(
+    n, window,
+    [&](size_t i) { out += " h" + std::to_string(i); },
+    [&](size_t i) { out += " s" + std::to_string(i); });
+  return out;
+}
+
+TEST(PGBackend, deep_scrub_read_ahead)
+{
+  ASSERT_EQ("", read_ahead_order(0, 4));
+
+  // 0 and 1 read nothing ahead
+  ASSERT_EQ(" s0 s1 s2", read_ahead_order(3, 0));
+  ASSERT_EQ(" s0 s1 s2", read_ahead_order(3, 1));
+
+  // the next window - 1 objects are hinted before each scrub, each once
+  ASSERT_EQ(" h1 s0 h2 s1 h3 s2 h4 s3 s4", read_ahead_order(5, 2));
+  ASSERT_EQ(" h1 h2 s0 h3 s1 h4 s2 s3 s4", read_ahead_order(5, 3));
+
+  // never past the end of the chunk
+  ASSERT_EQ(" h1 h2 h3 h4 s0 s1 s2 s3 s4", read_ahead_order(5, 5));
+  ASSERT_EQ(" h1 h2 h3 h4 s0 s1 s2 s3 s4", read_ahead_order(5, 64));
+  ASSERT_EQ(" s0", read_ahead_order(1, 64));
+}
@@ -2786,6 +2786,108 @@ TEST_F(PGLogTrimTest, TestTrimNoTrimmed) {
 }
 
 
+TEST_F(PGLogTrimTest, TestTrimWriteFromDups)
+{
+  SetUp(1, 2, 20);
+  PGLog::IndexedLog log;
+  log.head = mk_evt(20, 0);
+  log.skip_can_rollback_to_to_head();
+  log.head = mk_evt(9, 0);
+
+  log.add(mk_ple_mod(mk_obj(1), mk_evt(10, 100), mk_evt(8, 70)));
+  log.add(mk_ple_dt(mk_obj(2), mk_evt(15, 150), mk_evt(10, 100)));
+  log.add(mk_ple_mod_rb(mk_obj(3), mk_evt(15, 155), mk_evt(15, 150)));
+  log.add(mk_ple_mod(mk_obj(1), mk_evt(20, 160), mk_evt(25, 152)));
+  log.add(mk_ple_mod(mk_obj(4), mk_evt(21, 165), mk_evt(26, 160)));
+  log.add(mk_ple_dt_rb(mk_obj(5), mk_evt(21, 167), mk_evt(31, 166)));
+
+  const string dup_150 = pg_log_dup_t(*std::next(log.log.begin(), 1)).get_key_name();
+  const string dup_155 = pg_log_dup_t(*std::next(log.log.begin(), 2)).get_key_name();
+
+  // write out what the trim left behind and collect the omap range
+  // deletes and the keys it set
+  auto write = [&](const set<eversion_t>& trimmed,
+		   const set<string>& trimmed_dups,
+		   eversion_t write_from_dups,
+		   vector<pair<string,string>> *rm_ranges,
+		   map<string,bufferlist> *km) {
+    ObjectStore::Transaction t;
+    bool rebuilt_missing_with_deletes = false;
+    PGLog::_write_log_and_missing(
+      t, km, log, coll_t(), ghobject_t(),
+      eversion_t(), eversion_t::max(), eversion_t::max(),
+      trimmed, trimmed_dups, pg_missing_tracker_t(),
+      false, false, false, false, write_from_dups,
+      &rebuilt_missing_with_deletes, nullptr);
+    auto i = t.begin();
+    while (i.have_op()) {
+      auto op = i.decode_op();
+      EXPECT_NE(ObjectStore::Transaction::OP_OMAP_RMKEYS, op->op);
+      if (op->op == ObjectStore::Transaction::OP_OMAP_RMKEYRANGE) {
+	string first = i.decode_string();
+	string last = i.decode_string();
+	rm_ranges->push_back(make_pair(first, last));
+      }
+    }
+  };
+
+  set<eversion_t> trimmed;
+  set<string> trimmed_dups;
+  eversion_t write_from_dups = eversion_t::max();
+
+  log.trim(cct, mk_evt(15, 150), &trimmed, &trimmed_dups, nullptr, &write_from_dups);
+
+  // only the newly appended dups need to be written out
+  EXPECT_EQ(1u, log.dups.size());
+  EXPECT_EQ(mk_evt(15, 150), write_from_dups);
+  EXPECT_EQ(2u, trimmed.size());
+  EXPECT_TRUE(trimmed_dups.empty());
+
+  {
+    vector<pair<string,string>> rm_ranges;
+    map<string,bufferlist> km;
+    write(trimmed, trimmed_dups, write_from_dups, &rm_ranges, &km);
+
+    // the trimmed entries go in a single range that ends right after
+    // the newest of them, and the surviving entries are not touched
+    ASSERT_EQ(1u, rm_ranges.size());
+    EXPECT_EQ(eversion_t().get_key_name(), rm_ranges[0].first);
+    EXPECT_EQ(mk_evt(15, 150).get_key_name() + '\0', rm_ranges[0].second);
+    EXPECT_LT(mk_evt(15, 150).get_key_name(), rm_ranges[0].second);
+    EXPECT_GT(mk_evt(15, 155).get_key_name(), rm_ranges[0].second);
+
+    ASSERT_EQ(1u, km.size());
+    EXPECT_EQ(dup_150, km.begin()->first);
+  }
+
+  // the next trim starts from a clean slate, as after undirty()
+  trimmed.clear();
+  trimmed_dups.clear();
+  write_from_dups = eversion_t::max();
+
+  log.trim(cct, mk_evt(19, 157), &trimmed, &trimmed_dups, nullptr, &write_from_dups);
+
+  EXPECT_EQ(2u, log.dups.size());
+  EXPECT_EQ(mk_evt(15, 155), write_from_dups);
+  EXPECT_EQ(1u, trimmed.size());
+
+  {
+    vector<pair<string,string>> rm_ranges;
+    map<string,bufferlist> km;
+    write(trimmed, trimmed_dups, write_from_dups, &rm_ranges, &km);
+
+    ASSERT_EQ(1u, rm_ranges.size());
+    EXPECT_EQ(eversion_t().get_key_name(), rm_ranges[0].first);
+    EXPECT_EQ(mk_evt(15, 155).get_key_name() + '\0', rm_ranges[0].second);
+    EXPECT_GT(mk_evt(20, 160).get_key_name(), rm_ranges[0].second);
+
+    // the dup written by the previous round is not rewritten
+    ASSERT_EQ(1u, km.size());
+    EXPECT_EQ(dup_155, km.begin()->first);
+  }
+}
+
+
 TEST_F(PGLogTrimTest, TestTrimNoDups)
 {
   SetUp(1, 2, 10);
@@ -2972,6 +3074,56 @@ TEST_F(PGLogTest, _merge_object_divergent_entries) {
   }
 }
 
+TEST(pg_log_reqid_index_t, insert_lookup_erase) {
+  mempool::osd_pglog::list<pg_log_dup_t> dups;
+  pg_log_reqid_index_t<pg_log_dup_t> index;
+  const unsigned n = 1000;
+
+  // many reqids from a handful of clients, as in a real log
+  for (unsigned i = 0; i < n; ++i) {
+    dups.push_back(pg_log_dup_t(eversion_t(1, i + 1), i + 1,
+				osd_reqid_t(entity_name_t::CLIENT(i % 7),
+					    0, i / 7),
+				0));
+    index.insert(&dups.back());
+  }
+  EXPECT_EQ(n, index.size());
+  for (auto& d : dups) {
+    EXPECT_EQ(&d, index.lookup(d.reqid));
+  }
+  EXPECT_EQ(0u, index.count(osd_reqid_t(entity_name_t::CLIENT(99), 0, 1)));
+
+  // re-inserting a reqid replaces the mapping
+  pg_log_dup_t other = dups.front();
+  index.insert(&other);
+  EXPECT_EQ(n, index.size());
+  EXPECT_EQ(&other, index.lookup(other.reqid));
+
+  // erase only removes the expected item when one is given
+  EXPECT_FALSE(index.erase(other.reqid, &dups.front()));
+  EXPECT_TRUE(index.erase(other.reqid, &other));
+  EXPECT_EQ(n - 1, index.size());
+
+  // remove every other entry; the rest must stay reachable
+  unsigned i = 0;
+  for (auto& d : dups) {
+    if (i++ % 2)
+      EXPECT_TRUE(index.erase(d.reqid));
+  }
+  i = 0;
+  for (auto& d : dups) {
+    if (i++ % 2 || i == 1)
+      EXPECT_EQ(0u, index.count(d.reqid));
+    else
+      EXPECT_EQ(&d, index.lookup(d.reqid));
+  }
+  EXPECT_EQ(n / 2 - 1, index.size());
+
+  index.clear();
+  EXPECT_TRUE(index.empty());
+  EXPECT_EQ(nullptr, index.lookup(dups.back().reqid));
+}
+
 // Local Variables:
 // compile-command: "cd ../.. ; make unittest_pglog ; ./unittest_pglog --log-to-stderr=true  --debug-osd=20 # --gtest_filter=*.* "
 // End:
@@ -0,0 +1,196 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t -*-
+// vim: ts=8 sw=2 smarttab
+/*
+ * Ceph - scalable distributed file system
+ *
+ * This is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License version 2.1, as published by the Free Software
+ * Foundation.  See file COPYING.
+ *
+ */
+
+#include <gtest/gtest.h>
+#include <string>
+#include <vector>
+#include "osd/RecoveryThrottle.h"
+#include "osd/osd_types.h"
+
+static const uint64_t max_rate = 1600000;  // bytes/sec
+static const double step = max_rate / 16.0;
+
+static utime_t at(double secs)
+{
+  utime_t t(1000, 0);
+  t += secs;
+  return t;
+}
+
+TEST(RecoveryByteBudget, Disabled)
+{
+  RecoveryByteBudget b;
+  for (int i = 0; i < 10; ++i) {
+    ASSERT_TRUE(b.allows_start(0, at(0)));
+    b.charge(1 << 30);
+  }
+  ASSERT_EQ(0, b.get_rate());
+  ASSERT_EQ(0, b.get_avail());
+  b.adjust(0, 0.1, 10000, at(1));
+  ASSERT_EQ(0, b.get_rate());
+  ASSERT_TRUE(b.allows_start(0, at(1)));
+}
+
+TEST(RecoveryByteBudget, Exhaustion)
+{
+  RecoveryByteBudget b;
+  // starts with one second worth of budget
+  ASSERT_TRUE(b.allows_start(max_rate, at(0)));
+  ASSERT_EQ(max_rate, b.get_rate());
+  ASSERT_EQ(max_rate, b.get_avail());
+
+  b.charge(1000000);
+  ASSERT_TRUE(b.allows_start(max_rate, at(0)));
+  b.charge(1000000);
+  ASSERT_DOUBLE_EQ(-400000, b.get_avail());
+  // no new start until the overdraft is paid back
+  ASSERT_FALSE(b.allows_start(max_rate, at(0)));
+  ASSERT_FALSE(b.allows_start(max_rate, at(0.1)));
+  ASSERT_FALSE(b.allows_start(max_rate, at(0.2)));
+  ASSERT_TRUE(b.allows_start(max_rate, at(0.3)));
+  ASSERT_NEAR(80000, b.get_avail(), 1);
+
+  // time going backwards does not refill
+  b.charge(100000);
+  ASSERT_FALSE(b.allows_start(max_rate, at(0.2)));
+
+  // an idle period banks at most one second worth
+  ASSERT_TRUE(b.allows_start(max_rate, at(100)));
+  ASSERT_EQ(max_rate, b.get_avail());
+}
+
+TEST(RecoveryByteBudget, MaxRateChange)
+{
+  RecoveryByteBudget b;
+  ASSERT_TRUE(b.allows_start(max_rate, at(0)));
+  // lowered at runtime: the rate and the burst follow
+  ASSERT_TRUE(b.allows_start(max_rate / 4, at(1)));
+  ASSERT_EQ(max_rate / 4, b.get_rate());
+  ASSERT_EQ(max_rate / 4, b.get_avail());
+  // disabled and enabled again: starts over
+  ASSERT_TRUE(b.allows_start(0, at(2)));
+  b.refill(0, at(2));
+  ASSERT_EQ(0, b.get_rate());
+  ASSERT_TRUE(b.allows_start(max_rate, at(3)));
+  ASSERT_EQ(max_rate, b.get_rate());
+}
+
+TEST(RecoveryByteBudget, AIMD)
+{
+  RecoveryByteBudget b;
+  const double target = 0.05;  // seconds
+  double t = 0;
+
+  // clients above target latency: halve down to one step
+  b.adjust(max_rate, target, 100, at(t++));
+  ASSERT_EQ(max_rate / 2, b.get_rate());
+  b.adjust(max_rate, target, 100, at(t++));
+  ASSERT_EQ(max_rate / 4, b.get_rate());
+  b.adjust(max_rate, target, 51, at(t++));
+  ASSERT_EQ(max_rate / 8, b.get_rate());
+  b.adjust(max_rate, target, 100, at(t++));
+  ASSERT_EQ(step, b.get_rate());
+  b.adjust(max_rate, target, 1000, at(t++));
+  ASSERT_EQ(step, b.get_rate());
+
+  // the budget follows: one second worth at most
+  ASSERT_TRUE(b.allows_start(max_rate, at(t + 10)));
+  ASSERT_EQ(step, b.get_avail());
+
+  // at or below target: probe up one step at a time, up to max_rate
+  for (int i = 2; i <= 16; ++i) {
+    b.adjust(max_rate, target, i % 2 ? 50 : 10, at(t++));
+    ASSERT_EQ(step * i, b.get_rate());
+  }
+  b.adjust(max_rate, target, 10, at(t++));
+  ASSERT_EQ(max_rate, b.get_rate());
+
+  // and back down
+  b.adjust(max_rate, target, 100, at(t++));
+  ASSERT_EQ(max_rate / 2, b.get_rate());
+  b.adjust(max_rate, target, 10, at(t++));
+  ASSERT_EQ(max_rate / 2 + step, b.get_rate());
+}
+
+TEST(RecoveryByteBudget, NoLatencyTarget)
+{
+  RecoveryByteBudget b;
+  b.adjust(max_rate, 0, 100000, at(0));
+  ASSERT_EQ(max_rate, b.get_rate());
+  b.adjust(max_rate, 0, 100000, at(1));
+  ASSERT_EQ(max_rate, b.get_rate());
+}
+
+TEST(RecoveryQueue, Priority)
+{
+  const unsigned rp = OSD_RECOVERY_PRIORITY_BASE;
+  const unsigned bp = OSD_BACKFILL_PRIORITY_BASE;
+  ASSERT_EQ(rp, get_recovery_queue_priority(PG_STATE_RECOVERING, rp, bp));
+  ASSERT_EQ(rp, get_recovery_queue_priority(
+	      PG_STATE_RECOVERING | PG_STATE_DEGRADED, rp, bp));
+  ASSERT_EQ(bp, get_recovery_queue_priority(PG_STATE_BACKFILL, rp, bp));
+  ASSERT_EQ(bp, get_recovery_queue_priority(
+	      PG_STATE_BACKFILL | PG_STATE_RECOVERING, rp, bp));
+  ASSERT_EQ(bp, get_recovery_queue_priority(PG_STATE_BACKFILL_WAIT, rp, bp));
+  ASSERT_EQ((unsigned)OSD_RECOVERY_PRIORITY_FORCED,
+	    get_recovery_queue_priority(
+	      PG_STATE_RECOVERING | PG_STATE_FORCED_RECOVERY, rp, bp));
+  ASSERT_EQ((unsigned)OSD_RECOVERY_PRIORITY_FORCED,
+	    get_recovery_queue_priority(
+	      PG_STATE_BACKFILL | PG_STATE_FORCED_BACKFILL, rp, bp));
+}
+
+TEST(RecoveryQueue, Order)
+{
+  struct {
+    const char *name;
+    int state;
+    unsigned recovery_priority;
+  } pgs[] = {
+    { "backfill.1", PG_STATE_BACKFILL, 0 },
+    { "recovery.1", PG_STATE_RECOVERING, OSD_RECOVERY_PRIORITY_BASE },
+    { "forced_backfill.1",
+      PG_STATE_BACKFILL | PG_STATE_FORCED_BACKFILL, 0 },
+    { "backfill.2", PG_STATE_BACKFILL, 0 },
+    { "recovery.2", PG_STATE_RECOVERING, OSD_RECOVERY_PRIORITY_BASE },
+    { "forced_recovery.1",
+      PG_STATE_RECOVERING | PG_STATE_FORCED_RECOVERY, 0 },
+    // fewer replicas left: ahead of the other recoveries
+    { "recovery.degraded", PG_STATE_RECOVERING,
+      OSD_RECOVERY_PRIORITY_BASE + 2 },
+    { "backfill.3", PG_STATE_BACKFILL, 0 },
+    { "forced_backfill.2",
+      PG_STATE_BACKFILL | PG_STATE_FORCED_BACKFILL, 0 },
+    { "recovery.3", PG_STATE_RECOVERING, OSD_RECOVERY_PRIORITY_BASE },
+  };
+
+  RecoveryQueue<std::string> q;
+  for (auto &pg : pgs) {
+    q.insert(make_pair(
+	       get_recovery_queue_priority(
+		 pg.state, pg.recovery_priority, OSD_BACKFILL_PRIORITY_BASE),
+	       std::string(pg.name)));
+  }
+
+  std::vector<std::string> order;
+  while (!q.empty()) {
+    order.push_back(q.begin()->second);
+    q.erase(q.begin());
+  }
+  std::vector<std::string> expected = {
+    "forced_backfill.1", "forced_recovery.1", "forced_backfill.2",
+    "recovery.degraded",
+    "recovery.1", "recovery.2", "recovery.3",
+    "backfill.1", "backfill.2", "backfill.3",
+  };
+  ASSERT_EQ(expected, order);
+}
@@ -0,0 +1,299 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t -*-
+// vim: ts=8 sw=2 smarttab
+/*
+ * Ceph - scalable distributed file system
+ *
+ * This is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License version 2.1, as published by the Free Software
+ * Foundation.  See file COPYING.
+ *
+ */
+
+#include <gtest/gtest.h>
+#include "osd/ECTailStripeCache.h"
+#include <iostream>
+
+static const ECUtil::stripe_info_t sinfo(2, 8192);
+static const uint64_t sw = 8192;
+static const uint64_t max_bytes = 256 << 10;
+
+static auto no_write_in_flight = [](const hobject_t &) { return false; };
+
+hobject_t make_oid(const char *name)
+{
+  return hobject_t(object_t(name), "", CEPH_NOSNAP, 0, 1, "");
+}
+
+ECUtil::HashInfoRef hinfo_of_size(uint64_t logical_size)
+{
+  auto hinfo = std::make_shared<ECUtil::HashInfo>(3);
+  hinfo->set_total_chunk_size_clear_hash(
+    sinfo.aligned_logical_offset_to_chunk_offset(
+      sinfo.logical_to_next_stripe_offset(logical_size)));
+  return hinfo;
+}
+
+bufferlist pattern(uint64_t off, uint64_t len, char seed)
+{
+  bufferlist bl;
+  bufferptr bp(len);
+  for (uint64_t i = 0; i < len; ++i)
+    bp.c_str()[i] = (char)((off + i) * 7 + seed);
+  bl.append(std::move(bp));
+  return bl;
+}
+
+/// what an rmw write sends to the shards: whole stripes of the object
+extent_map stripes_of(const bufferlist &object, uint64_t off, uint64_t len)
+{
+  uint64_t start = sinfo.logical_to_prev_stripe_offset(off);
+  uint64_t end = sinfo.logical_to_next_stripe_offset(off + len);
+  bufferlist bl;
+  bl.substr_of(object, start, MIN(end, object.length()) - start);
+  if (bl.length() < end - start)
+    bl.append_zero(end - start - bl.length());
+  extent_map out;
+  out.insert(start, bl.length(), bl);
+  return out;
+}
+
+extent_set single(uint64_t off, uint64_t len)
+{
+  extent_set out;
+  out.insert(off, len);
+  return out;
+}
+
+void cache_whole_object(ECTailStripeCache &c, const hobject_t &oid,
+			uint64_t size, char seed)
+{
+  bufferlist object = pattern(0, size, seed);
+  c.update(sinfo, {{oid, hinfo_of_size(size)}},
+	   {{oid, stripes_of(object, 0, size)}}, max_bytes);
+}
+
+TEST(ectailstripecache, sequential_appends)
+{
+  hobject_t oid = make_oid("foo");
+  ECTailStripeCache c;
+  bufferlist object;
+  unsigned served = 0;
+
+  for (unsigned i = 0; i < 40; ++i) {
+    uint64_t off = object.length();
+    uint64_t len = 1000 + i;
+    // an unaligned append reads the rest of the last stripe first
+    if (!sinfo.logical_offset_is_stripe_aligned(off)) {
+      uint64_t stripe = sinfo.logical_to_prev_stripe_offset(off);
+      map<hobject_t, extent_set> to_read = {{oid, single(stripe, sw)}};
+      map<hobject_t, extent_map> results;
+      ASSERT_TRUE(c.read(to_read, no_write_in_flight, &results))
+	<< "append " << i << " at " << off;
+      ++served;
+      bufferlist expected = stripes_of(object, stripe, sw).begin().get_val();
+      ASSERT_EQ(1u, results.size());
+      ASSERT_EQ(1u, results[oid].get_interval_set().num_intervals());
+      ASSERT_EQ(stripe, results[oid].begin().get_off());
+      ASSERT_TRUE(results[oid].begin().get_val().contents_equal(expected));
+    }
+    object.append(pattern(off, len, i));
+    c.update(sinfo, {{oid, hinfo_of_size(object.length())}},
+	     {{oid, stripes_of(object, off, len)}}, max_bytes);
+    ASSERT_TRUE(c.contains(oid));
+    ASSERT_EQ(sw, c.get_bytes());
+  }
+  ASSERT_GT(served, 30u);
+}
+
+TEST(ectailstripecache, partial_reads)
+{
+  hobject_t oid = make_oid("foo");
+  ECTailStripeCache c;
+  cache_whole_object(c, oid, 3 * sw - 10, 1);
+  bufferlist object = pattern(0, 3 * sw - 10, 1);
+
+  // pieces of the last stripe
+  extent_set pieces;
+  pieces.insert(2 * sw, 100);
+  pieces.insert(2 * sw + 4096, 4000);
+  map<hobject_t, extent_map> results;
+  ASSERT_TRUE(c.read({{oid, pieces}}, no_write_in_flight, &results));
+  ASSERT_EQ(2u, results[oid].get_interval_set().num_intervals());
+  for (auto &&i: results[oid]) {
+    bufferlist expected;
+    expected.substr_of(object, i.get_off(), i.get_len());
+    ASSERT_TRUE(i.get_val().contents_equal(expected));
+  }
+
+  // anything before the last stripe must come from the shards
+  results.clear();
+  ASSERT_FALSE(c.read({{oid, single(sw, sw)}}, no_write_in_flight, &results));
+  ASSERT_FALSE(c.read({{oid, single(2 * sw - 1, 2)}}, no_write_in_flight,
+		      &results));
+  ASSERT_TRUE(results.empty());
+}
+
+TEST(ectailstripecache, all_or_nothing)
+{
+  hobject_t foo = make_oid("foo"), bar = make_oid("bar");
+  ECTailStripeCache c;
+  cache_whole_object(c, foo, sw + 1, 1);
+
+  map<hobject_t, extent_map> results;
+  ASSERT_FALSE(c.read({{foo, single(sw, sw)}, {bar, single(0, sw)}},
+		      no_write_in_flight, &results));
+  ASSERT_TRUE(results.empty());
+
+  cache_whole_object(c, bar, 10, 2);
+  ASSERT_TRUE(c.read({{foo, single(sw, sw)}, {bar, single(0, sw)}},
+		     no_write_in_flight, &results));
+  ASSERT_EQ(2u, results.size());
+}
+
+TEST(ectailstripecache, write_in_flight)
+{
+  hobject_t foo = make_oid("foo"), bar = make_oid("bar");
+  ECTailStripeCache c;
+  cache_whole_object(c, foo, sw + 1, 1);
+  cache_whole_object(c, bar, sw + 1, 2);
+
+  // a pipelined write to foo has yet to reach update(): its stripe is
+  // not the one the next write must read
+  auto foo_in_flight = [&](const hobject_t &hoid) { return hoid == foo; };
+  map<hobject_t, extent_map> results;
+  ASSERT_FALSE(c.read({{foo, single(sw, sw)}}, foo_in_flight, &results));
+  ASSERT_FALSE(c.read({{foo, single(sw, sw)}, {bar, single(sw, sw)}},
+		      foo_in_flight, &results));
+  ASSERT_TRUE(results.empty());
+  ASSERT_TRUE(c.read({{bar, single(sw, sw)}}, foo_in_flight, &results));
+
+  // once it is accounted for, the cache holds what it wrote
+  bufferlist object = pattern(0, sw + 1, 1);
+  object.append(pattern(sw + 1, 100, 3));
+  c.update(sinfo, {{foo, hinfo_of_size(object.length())}},
+	   {{foo, stripes_of(object, sw + 1, 100)}}, max_bytes);
+  results.clear();
+  ASSERT_TRUE(c.read({{foo, single(sw, sw)}}, no_write_in_flight, &results));
+  ASSERT_TRUE(results[foo].begin().get_val().contents_equal(
+		stripes_of(object, sw, sw).begin().get_val()));
+}
+
+TEST(ectailstripecache, overwrite_elsewhere)
+{
+  hobject_t oid = make_oid("foo");
+  ECTailStripeCache c;
+  cache_whole_object(c, oid, 3 * sw - 10, 1);
+
+  // a write that does not cover the last stripe drops it
+  bufferlist object = pattern(0, 3 * sw - 10, 1);
+  c.update(sinfo, {{oid, hinfo_of_size(object.length())}},
+	   {{oid, stripes_of(object, 10, 10)}}, max_bytes);
+  ASSERT_FALSE(c.contains(oid));
+  ASSERT_EQ(0u, c.get_bytes());
+}
+
+TEST(ectailstripecache, truncate)
+{
+  hobject_t oid = make_oid("foo");
+  ECTailStripeCache c;
+
+  // to a stripe boundary: nothing is written
+  cache_whole_object(c, oid, 3 * sw - 10, 1);
+  c.update(sinfo, {{oid, hinfo_of_size(sw)}}, {{oid, extent_map()}},
+	   max_bytes);
+  ASSERT_FALSE(c.contains(oid));
+  map<hobject_t, extent_map> results;
+  ASSERT_FALSE(c.read({{oid, single(2 * sw, sw)}}, no_write_in_flight,
+		      &results));
+  ASSERT_FALSE(c.read({{oid, single(0, sw)}}, no_write_in_flight, &results));
+
+  // within a stripe: the new last stripe is rewritten, zero padded
+  cache_whole_object(c, oid, 3 * sw - 10, 1);
+  bufferlist object = pattern(0, sw + 10, 1);
+  c.update(sinfo, {{oid, hinfo_of_size(sw + 10)}},
+	   {{oid, stripes_of(object, sw, 10)}}, max_bytes);
+  ASSERT_TRUE(c.contains(oid));
+  ASSERT_EQ(sw, c.get_bytes());
+  ASSERT_FALSE(c.read({{oid, single(2 * sw, sw)}}, no_write_in_flight,
+		      &results));
+  ASSERT_TRUE(c.read({{oid, single(sw, sw)}}, no_write_in_flight, &results));
+  ASSERT_TRUE(results[oid].begin().get_val().contents_equal(
+		stripes_of(object, sw, sw).begin().get_val()));
+}
+
+TEST(ectailstripecache, remove)
+{
+  hobject_t foo = make_oid("foo"), bar = make_oid("bar");
+  ECTailStripeCache c;
+  cache_whole_object(c, foo, sw + 1, 1);
+  cache_whole_object(c, bar, sw + 1, 2);
+
+  c.update(sinfo, {{foo, hinfo_of_size(0)}}, {}, max_bytes);
+  ASSERT_FALSE(c.contains(foo));
+  ASSERT_TRUE(c.contains(bar));
+  ASSERT_EQ(sw, c.get_bytes());
+
+  // recreated by a later write, only with what that one wrote
+  bufferlist object = pattern(0, 20, 3);
+  c.update(sinfo, {{foo, hinfo_of_size(20)}},
+	   {{foo, stripes_of(object, 0, 20)}}, max_bytes);
+  map<hobject_t, extent_map> results;
+  ASSERT_TRUE(c.read({{foo, single(0, sw)}}, no_write_in_flight, &results));
+  ASSERT_TRUE(results[foo].begin().get_val().contents_equal(
+		stripes_of(object, 0, sw).begin().get_val()));
+}
+
+TEST(ectailstripecache, rename)
+{
+  hobject_t src = make_oid("src"), dst = make_oid("dst");
+  ECTailStripeCache c;
+  cache_whole_object(c, src, sw + 1, 1);
+  cache_whole_object(c, dst, sw + 1, 2);
+
+  // the rename target takes over the source: neither may be served from
+  // what was cached for them before
+  c.update(sinfo, {{src, hinfo_of_size(sw + 1)}, {dst, hinfo_of_size(sw + 1)}},
+	   {{dst, extent_map()}}, max_bytes);
+  ASSERT_FALSE(c.contains(src));
+  ASSERT_FALSE(c.contains(dst));
+  ASSERT_TRUE(c.empty());
+  ASSERT_EQ(0u, c.get_bytes());
+}
+
+TEST(ectailstripecache, bounded)
+{
+  hobject_t a = make_oid("a"), b = make_oid("b"), d = make_oid("d");
+  ECTailStripeCache c;
+  bufferlist object = pattern(0, 10, 1);
+  for (auto &oid : { a, b, d })
+    c.update(sinfo, {{oid, hinfo_of_size(10)}},
+	     {{oid, stripes_of(object, 0, 10)}}, 2 * sw);
+  ASSERT_FALSE(c.contains(a));
+  ASSERT_TRUE(c.contains(b));
+  ASSERT_TRUE(c.contains(d));
+  ASSERT_EQ(2 * sw, c.get_bytes());
+
+  // 0 disables the cache
+  c.update(sinfo, {{a, hinfo_of_size(10)}},
+	   {{a, stripes_of(object, 0, 10)}}, 0);
+  ASSERT_TRUE(c.empty());
+  ASSERT_EQ(0u, c.get_bytes());
+}
+
+TEST(ectailstripecache, clear)
+{
+  // what ECBackend::on_change() does on a new interval
+  hobject_t foo = make_oid("foo"), bar = make_oid("bar");
+  ECTailStripeCache c;
+  cache_whole_object(c, foo, sw + 1, 1);
+  cache_whole_object(c, bar, sw + 1, 2);
+  c.clear();
+  ASSERT_TRUE(c.empty());
+  ASSERT_EQ(0u, c.get_bytes());
+  map<hobject_t, extent_map> results;
+  ASSERT_FALSE(c.read({{foo, single(sw, sw)}}, no_write_in_flight, &results));
+
+  cache_whole_object(c, foo, sw + 1, 1);
+  ASSERT_EQ(sw, c.get_bytes());
+}
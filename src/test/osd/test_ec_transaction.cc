@@ -122,3 +122,38 @@ TEST(ectransaction, many_writes)
   ASSERT_EQ(0u, plan.to_read.size());
   ASSERT_EQ(1u, plan.will_write.size());
 }
+
+TEST(ectransaction, full_stripe_writes)
+{
+  hobject_t h;
+  PGTransactionUPtr t(new PGTransaction);
+  bufferlist a, b, c;
+  a.append_zero(16384);
+  b.append_zero(512);
+  c.append_zero(16896);
+  t->create(h);
+
+  ECUtil::stripe_info_t sinfo(2, 8192);
+  // stripe aligned, encoded as it is
+  t->write(h, 0, a.length(), a, 0);
+  // unaligned, merged with the zero padding of its stripe
+  t->write(h, 20480, b.length(), b, 0);
+  // aligned offset, unaligned length
+  t->write(h, 32768, c.length(), c, 0);
+
+  auto plan = ECTransaction::get_write_plan(
+    sinfo,
+    std::move(t),
+    [&](const hobject_t &i) {
+      ECUtil::HashInfoRef ref(new ECUtil::HashInfo(1));
+      return ref;
+    },
+    &dpp);
+
+  ECTransaction::full_stripe_writes_t to_encode;
+  ASSERT_EQ(16384u, ECTransaction::get_full_stripe_writes(
+	      sinfo, plan, &to_encode));
+  ASSERT_EQ(1u, to_encode.size());
+  ASSERT_EQ(1u, to_encode[h].size());
+  ASSERT_EQ(0u, to_encode[h].begin()->first);
+}
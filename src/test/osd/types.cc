@@ -1818,6 +1818,39 @@ TEST_F(PITest, past_intervals_ec_lost) {
 }
 
 
+TEST(object_dirty_extents_t, mark_merge) {
+  object_dirty_extents_t de;
+  ASSERT_TRUE(de.all);
+  de.clear();
+  ASSERT_FALSE(de.all);
+  de.mark(0, 10, 2);
+  de.mark(5, 10, 2);
+  ASSERT_EQ(1u, de.extents.size());
+  ASSERT_EQ(0u, de.extents[0].first);
+  ASSERT_EQ(15u, de.extents[0].second);
+  de.mark(100, 10, 2);
+  ASSERT_FALSE(de.all);
+  de.mark(200, 10, 2);
+  ASSERT_TRUE(de.all);
+  ASSERT_TRUE(de.extents.empty());
+
+  object_dirty_extents_t a, b;
+  a.clear();
+  b.clear();
+  a.mark(0, 10, 4);
+  b.mark(20, 10, 4);
+  a.merge(b, 4);
+  ASSERT_FALSE(a.all);
+  interval_set<uint64_t> merged;
+  a.get_extents(&merged);
+  ASSERT_EQ(2u, merged.num_intervals());
+  ASSERT_EQ(20u, merged.size());
+  b.mark_all();
+  a.merge(b, 4);
+  ASSERT_TRUE(a.all);
+}
+
+
 /*
  * Local Variables:
  * compile-command: "cd ../.. ;
@@ -199,6 +199,15 @@ void usage()
   cout << "      [--simulate]       simulate placements using a random\n";
   cout << "                         number generator in place of the CRUSH\n";
   cout << "                         algorithm\n";
+  cout << "      [--benchmark]      time mapping the inputs one at a time\n";
+  cout << "                         against mapping them in one batch\n";
+  cout << "   -i mapfn --compare mapfn2\n";
+  cout << "                         compare the mappings of mapfn, after any\n";
+  cout << "                         modifications, with those of mapfn2 and\n";
+  cout << "                         report the data movement per rule (and per\n";
+  cout << "                         device with --show-utilization[-all]); takes\n";
+  cout << "                         the --test input, rule and num-rep options\n";
+  cout << "      [--num-threads n]  map with n threads (default: one per cpu)\n";
   cout << "   --show-utilization    show OSD usage\n";
   cout << "   --show-utilization-all\n";
   cout << "                         include zero weight items\n";
@@ -251,6 +260,7 @@ int main(int argc, const char **argv)
   bool check = false;
   int max_id = -1;
   bool test = false;
+  std::string compare_fn;
   bool display = false;
   bool tree = false;
   string dump_format = "json-pretty";
@@ -347,6 +357,9 @@ int main(int argc, const char **argv)
     } else if (ceph_argparse_flag(args, i, "--show_choose_tries", (char*)NULL)) {
       display = true;
       tester.set_output_choose_tries(true);
+    } else if (ceph_argparse_flag(args, i, "--benchmark", (char*)NULL)) {
+      display = true;
+      tester.set_output_benchmark(true);
     } else if (ceph_argparse_witharg(args, i, &val, "-c", "--compile", (char*)NULL)) {
       srcfn = val;
       compile = true;
@@ -593,6 +606,14 @@ int main(int argc, const char **argv)
 	return EXIT_FAILURE;
       }
       tester.set_ruleset(x);
+    } else if (ceph_argparse_witharg(args, i, &val, "--compare", (char*)NULL)) {
+      compare_fn = val;
+    } else if (ceph_argparse_witharg(args, i, &x, err, "--num-threads", (char*)NULL)) {
+      if (!err.str().empty()) {
+	cerr << err.str() << std::endl;
+	return EXIT_FAILURE;
+      }
+      tester.set_num_threads(x);
     } else if (ceph_argparse_witharg(args, i, &x, err, "--batches", (char*)NULL)) {
       if (!err.str().empty()) {
 	cerr << err.str() << std::endl;
@@ -639,6 +660,7 @@ int main(int argc, const char **argv)
     return EXIT_FAILURE;
   }
   if (!check && !compile && !decompile && !build && !test && !reweight && !adjust && !tree && !dump &&
+      compare_fn.empty() &&
       add_item < 0 && !add_rule && !del_rule && full_location < 0 &&
       remove_name.empty() && reweight_name.empty()) {
     cerr << "no action specified; -h for help" << std::endl;
@@ -1025,6 +1047,33 @@ int main(int argc, const char **argv)
       return EXIT_FAILURE;
   }
 
+  if (!compare_fn.empty()) {
+    bufferlist bl;
+    std::string error;
+    int r = bl.read_file(compare_fn.c_str(), &error);
+    if (r < 0) {
+      cerr << me << ": error reading '" << compare_fn << "': "
+	   << error << std::endl;
+      return EXIT_FAILURE;
+    }
+    CrushWrapper other;
+    bufferlist::iterator p = bl.begin();
+    try {
+      other.decode(p);
+    } catch(...) {
+      cerr << me << ": unable to decode " << compare_fn << std::endl;
+      return EXIT_FAILURE;
+    }
+    crush.finalize();
+    r = tester.compare(other);
+    if (r == -ENOENT) {
+      cerr << me << ": no rule to compare" << std::endl;
+    }
+    if (r < 0) {
+      return EXIT_FAILURE;
+    }
+  }
+
   // output ---
   if (modified) {
     crush.finalize();
@@ -50,6 +50,18 @@ void usage()
   cout << "                           max deviation from target [default: .01]" << std::endl;
   cout << "   --upmap-pool <poolname> restrict upmap balancing to 1 or more pools" << std::endl;
   cout << "   --upmap-save            write modified OSDMap with upmap changes" << std::endl;
+  cout << "   --weight-set <file>     calculate crush weight-set weights to balance pg" << std::endl;
+  cout << "                           layout, writing commands to <file> [default: - for stdout]" << std::endl;
+  cout << "   --weight-set-mode <compat|per-pool>" << std::endl;
+  cout << "                           one weight-set for all pools or one per pool [default: compat]" << std::endl;
+  cout << "   --weight-set-max-moved <max-count>" << std::endl;
+  cout << "                           max pgs to move [default: 0, no limit]" << std::endl;
+  cout << "   --weight-set-iterations <count>" << std::endl;
+  cout << "                           max iterations to run [default: 100]" << std::endl;
+  cout << "   --weight-set-deviation <max-deviation>" << std::endl;
+  cout << "                           ratio of misplaced pgs to stop at [default: .01]" << std::endl;
+  cout << "   --weight-set-pool <poolname> restrict weight-set balancing to 1 or more pools" << std::endl;
+  cout << "   --weight-set-save       write modified OSDMap with weight-set changes" << std::endl;
   exit(1);
 }
 
@@ -84,6 +96,54 @@ void print_inc_upmaps(const OSDMap::Incremental& pending_inc, int fd)
   }
 }
 
+void print_weight_sets(const OSDMap& osdmap,
+		       const map<int64_t,map<int,float>>& weights,
+		       int fd)
+{
+  ostringstream ss;
+  for (auto& i : weights) {
+    string pool;
+    if (i.first == CrushWrapper::DEFAULT_CHOOSE_ARGS) {
+      if (!osdmap.crush->have_choose_args(i.first)) {
+	ss << "ceph osd crush weight-set create-compat" << std::endl;
+      }
+    } else {
+      pool = osdmap.get_pool_name(i.first);
+      if (!osdmap.crush->have_choose_args(i.first)) {
+	ss << "ceph osd crush weight-set create " << pool << " flat"
+	   << std::endl;
+      }
+    }
+    crush_choose_arg_map cmap =
+      osdmap.crush->choose_args_get_with_fallback(i.first);
+    for (auto& p : i.second) {
+      int weight = -1;
+      if (cmap.args) {
+	weight = osdmap.crush->choose_args_get_item_weight(cmap, p.first);
+      }
+      if (weight < 0) {
+	weight = osdmap.crush->get_item_weight(p.first);
+      }
+      if ((float)weight / (float)0x10000 == p.second) {
+	continue;
+      }
+      if (pool.empty()) {
+	ss << "ceph osd crush weight-set reweight-compat ";
+      } else {
+	ss << "ceph osd crush weight-set reweight " << pool << " ";
+      }
+      ss << osdmap.crush->get_item_name(p.first) << " " << p.second
+	 << std::endl;
+    }
+  }
+  string s = ss.str();
+  int r = safe_write(fd, s.c_str(), s.size());
+  if (r < 0) {
+    cerr << "error writing output: " << cpp_strerror(r) << std::endl;
+    exit(1);
+  }
+}
+
 int main(int argc, const char **argv)
 {
   vector<const char*> args;
@@ -128,6 +188,14 @@ int main(int argc, const char **argv)
   int upmap_max = 100;
   float upmap_deviation = .01;
   std::set<std::string> upmap_pools;
+  bool weight_set = false;
+  bool weight_set_save = false;
+  std::string weight_set_file = "-";
+  std::string weight_set_mode = "compat";
+  int weight_set_max_moved = 0;
+  int weight_set_iterations = 100;
+  float weight_set_deviation = .01;
+  std::set<std::string> weight_set_pools;
   int64_t pg_num = -1;
   bool test_map_pgs_dump_all = false;
 
@@ -161,6 +229,20 @@ int main(int argc, const char **argv)
     } else if (ceph_argparse_witharg(args, i, &upmap_deviation, err, "--upmap-deviation", (char*)NULL)) {
     } else if (ceph_argparse_witharg(args, i, &val, "--upmap-pool", (char*)NULL)) {
       upmap_pools.insert(val);
+    } else if (ceph_argparse_witharg(args, i, &weight_set_file, "--weight-set", (char*)NULL)) {
+      weight_set = true;
+    } else if (ceph_argparse_witharg(args, i, &weight_set_mode, "--weight-set-mode", (char*)NULL)) {
+      if (weight_set_mode != "compat" && weight_set_mode != "per-pool") {
+	cerr << "unknown weight-set mode '" << weight_set_mode << "'" << std::endl;
+	exit(EXIT_FAILURE);
+      }
+    } else if (ceph_argparse_witharg(args, i, &weight_set_max_moved, err, "--weight-set-max-moved", (char*)NULL)) {
+    } else if (ceph_argparse_witharg(args, i, &weight_set_iterations, err, "--weight-set-iterations", (char*)NULL)) {
+    } else if (ceph_argparse_witharg(args, i, &weight_set_deviation, err, "--weight-set-deviation", (char*)NULL)) {
+    } else if (ceph_argparse_witharg(args, i, &val, "--weight-set-pool", (char*)NULL)) {
+      weight_set_pools.insert(val);
+    } else if (ceph_argparse_flag(args, i, "--weight-set-save", (char*)NULL)) {
+      weight_set_save = true;
     } else if (ceph_argparse_witharg(args, i, &num_osd, err, "--createsimple", (char*)NULL)) {
       if (!err.str().empty()) {
 	cerr << err.str() << std::endl;
@@ -380,6 +462,62 @@ int main(int argc, const char **argv)
   if (upmap_file != "-") {
     ::close(upmap_fd);
   }
+  if (weight_set) {
+    cout << "weight-set " << weight_set_mode
+	 << ", max iterations " << weight_set_iterations
+	 << ", max moved " << weight_set_max_moved
+	 << ", max deviation " << weight_set_deviation
+	 << std::endl;
+    int weight_set_fd = STDOUT_FILENO;
+    if (weight_set_file != "-") {
+      weight_set_fd = ::open(weight_set_file.c_str(), O_CREAT|O_WRONLY, 0644);
+      if (weight_set_fd < 0) {
+	cerr << "error opening " << weight_set_file << ": "
+	     << cpp_strerror(errno) << std::endl;
+	exit(1);
+      }
+      cout << "writing weight-set command output to: " << weight_set_file
+	   << std::endl;
+    }
+    set<int64_t> pools;
+    for (auto& s : weight_set_pools) {
+      int64_t p = osdmap.lookup_pg_pool_name(s);
+      if (p < 0) {
+	cerr << " pool '" << s << "' does not exist" << std::endl;
+	exit(1);
+      }
+      pools.insert(p);
+    }
+    if (!pools.empty())
+      cout << " limiting to pools " << weight_set_pools << " (" << pools << ")"
+	   << std::endl;
+    OSDMap::Incremental pending_inc(osdmap.get_epoch()+1);
+    pending_inc.fsid = osdmap.get_fsid();
+    map<int64_t,map<int,float>> weights;
+    int moved = osdmap.calc_choose_args(
+      g_ceph_context, weight_set_deviation, weight_set_iterations,
+      weight_set_max_moved, weight_set_mode == "per-pool", pools,
+      map<pg_t,uint64_t>(), &weights, &pending_inc);
+    if (moved < 0) {
+      cerr << "error calculating weight-set: " << cpp_strerror(moved)
+	   << std::endl;
+      exit(1);
+    }
+    if (pending_inc.crush.length()) {
+      cout << "weight-set moves " << moved << " pgs" << std::endl;
+      print_weight_sets(osdmap, weights, weight_set_fd);
+      if (weight_set_save) {
+	int r = osdmap.apply_incremental(pending_inc);
+	assert(r == 0);
+	modified = true;
+      }
+    } else {
+      cout << "no weight-set changes proposed" << std::endl;
+    }
+    if (weight_set_file != "-") {
+      ::close(weight_set_fd);
+    }
+  }
 
   if (!import_crush.empty()) {
     bufferlist cbl;
@@ -617,7 +755,7 @@ int main(int argc, const char **argv)
       export_crush.empty() && import_crush.empty() && 
       test_map_pg.empty() && test_map_object.empty() &&
       !test_map_pgs && !test_map_pgs_dump && !test_map_pgs_dump_all &&
-      !upmap && !upmap_cleanup) {
+      !upmap && !upmap_cleanup && !weight_set) {
     cerr << me << ": no action specified?" << std::endl;
     usage();
   }